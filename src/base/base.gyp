@@ -45,6 +45,7 @@
         'run_level.cc',
         'scheduler.cc',
         'stopwatch.cc',
+        'thread_pool.cc',
         'unnamed_event.cc',
       ],
       'dependencies': [
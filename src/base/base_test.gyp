@@ -83,6 +83,7 @@
         'cpu_stats_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
+        'thread_pool_test.cc',
         'unnamed_event_test.cc',
       ],
       'conditions': [
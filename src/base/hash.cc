@@ -38,6 +38,69 @@ const uint32 kFingerPrint32Seed = 0xfd12deff;
 const uint32 kFingerPrintSeed0 = 0x6d6f;
 const uint32 kFingerPrintSeed1 = 0x7a63;
 
+// The constants of FastFingerprint(), which are taken from wyhash (public
+// domain).
+const uint64 kFastSecret0 = GG_ULONGLONG(0xa0761d6478bd642f);
+const uint64 kFastSecret1 = GG_ULONGLONG(0xe7037ed1a0b428db);
+const uint64 kFastSecret2 = GG_ULONGLONG(0x8ebc6af09c88c6e3);
+const uint64 kFastSecret3 = GG_ULONGLONG(0x589965cc75374cc3);
+
+// Reads the bytes in little endian regardless of the platform so that the
+// fingerprints are portable.  Compilers reduce these to single loads on
+// little endian platforms.
+inline uint64 Read64(const char *p) {
+  const uint8 *u = reinterpret_cast<const uint8 *>(p);
+  return static_cast<uint64>(u[0]) | (static_cast<uint64>(u[1]) << 8) |
+         (static_cast<uint64>(u[2]) << 16) |
+         (static_cast<uint64>(u[3]) << 24) |
+         (static_cast<uint64>(u[4]) << 32) |
+         (static_cast<uint64>(u[5]) << 40) |
+         (static_cast<uint64>(u[6]) << 48) |
+         (static_cast<uint64>(u[7]) << 56);
+}
+
+inline uint64 Read32(const char *p) {
+  const uint8 *u = reinterpret_cast<const uint8 *>(p);
+  return static_cast<uint64>(u[0]) | (static_cast<uint64>(u[1]) << 8) |
+         (static_cast<uint64>(u[2]) << 16) |
+         (static_cast<uint64>(u[3]) << 24);
+}
+
+// Reads 1 to 3 bytes.
+inline uint64 ReadSmall(const char *p, size_t len) {
+  const uint8 *u = reinterpret_cast<const uint8 *>(p);
+  return (static_cast<uint64>(u[0]) << 16) |
+         (static_cast<uint64>(u[len >> 1]) << 8) | u[len - 1];
+}
+
+// Multiplies |a| and |b| into 128 bits, and stores the lower half in |a| and
+// the upper half in |b|.
+inline void Multiply128(uint64 *a, uint64 *b) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 r = static_cast<unsigned __int128>(*a) * *b;
+  *a = static_cast<uint64>(r);
+  *b = static_cast<uint64>(r >> 64);
+#else  // __SIZEOF_INT128__
+  const uint64 a_hi = *a >> 32;
+  const uint64 a_lo = static_cast<uint32>(*a);
+  const uint64 b_hi = *b >> 32;
+  const uint64 b_lo = static_cast<uint32>(*b);
+  const uint64 hh = a_hi * b_hi;
+  const uint64 hl = a_hi * b_lo;
+  const uint64 lh = a_lo * b_hi;
+  const uint64 ll = a_lo * b_lo;
+  const uint64 t = hl + (ll >> 32);
+  const uint64 u = lh + static_cast<uint32>(t);
+  *a = (u << 32) | static_cast<uint32>(ll);
+  *b = hh + (t >> 32) + (u >> 32);
+#endif  // __SIZEOF_INT128__
+}
+
+inline uint64 Mix64(uint64 a, uint64 b) {
+  Multiply128(&a, &b);
+  return a ^ b;
+}
+
 }  // namespace
 
 #define Mix(a, b, c) {            \
@@ -131,4 +194,71 @@ uint64 Hash::FingerprintWithSeed(StringPiece str, uint32 seed) {
   return result;
 }
 
+uint64 Hash::FastFingerprint(StringPiece str) {
+  return FastFingerprintWithSeed(str, kFingerPrintSeed0);
+}
+
+uint64 Hash::FastFingerprintWithSeed(StringPiece str, uint32 seed) {
+  const char *p = str.data();
+  const size_t len = str.size();
+  uint64 state = Mix64(seed ^ kFastSecret0, kFastSecret1);
+  uint64 a = 0;
+  uint64 b = 0;
+  if (len <= 16) {
+    // Most of the keys are short enough to be read by overlapping loads
+    // without loops.
+    if (len >= 4) {
+      const size_t offset = (len >> 3) << 2;
+      a = (Read32(p) << 32) | Read32(p + offset);
+      b = (Read32(p + len - 4) << 32) | Read32(p + len - 4 - offset);
+    } else if (len > 0) {
+      a = ReadSmall(p, len);
+    }
+  } else {
+    size_t rest = len;
+    if (rest > 48) {
+      // Three independent lanes keep the multipliers busy.
+      uint64 state1 = state;
+      uint64 state2 = state;
+      do {
+        state = Mix64(Read64(p) ^ kFastSecret1, Read64(p + 8) ^ state);
+        state1 = Mix64(Read64(p + 16) ^ kFastSecret2, Read64(p + 24) ^ state1);
+        state2 = Mix64(Read64(p + 32) ^ kFastSecret3, Read64(p + 40) ^ state2);
+        p += 48;
+        rest -= 48;
+      } while (rest > 48);
+      state ^= state1 ^ state2;
+    }
+    while (rest > 16) {
+      state = Mix64(Read64(p) ^ kFastSecret1, Read64(p + 8) ^ state);
+      p += 16;
+      rest -= 16;
+    }
+    a = Read64(p + rest - 16);
+    b = Read64(p + rest - 8);
+  }
+  a ^= kFastSecret1;
+  b ^= state;
+  Multiply128(&a, &b);
+  return Mix64(a ^ kFastSecret0 ^ len, b ^ kFastSecret1);
+}
+
+uint64 Hash::FingerprintWithVersion(StringPiece str, uint32 seed,
+                                    FingerprintVersion version) {
+  // Note: this library doesn't depend on logging.  The callers should
+  // validate the versions read from files.
+  if (version == FINGERPRINT_LOOKUP2) {
+    return FingerprintWithSeed(str, seed);
+  }
+  return FastFingerprintWithSeed(str, seed);
+}
+
+uint32 Hash::Fingerprint32WithVersion(StringPiece str,
+                                      FingerprintVersion version) {
+  if (version == FINGERPRINT_LOOKUP2) {
+    return Fingerprint32(str);
+  }
+  return static_cast<uint32>(FastFingerprintWithSeed(str, kFingerPrint32Seed));
+}
+
 }  // namespace mozc
@@ -0,0 +1,107 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the throughput of the fingerprint functions for short UTF-8
+// strings, which are typical keys of the user history and the storages.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/hash.h"
+#include "base/init_mozc.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+
+DEFINE_int32(iterations, 1000, "number of iterations over the strings");
+DEFINE_int32(num_strings, 10000, "number of strings per length");
+
+namespace {
+
+string GenRandomString(size_t size) {
+  // Hiragana, which is 3 bytes in UTF-8, and ASCII letters.
+  string result;
+  while (result.size() < size) {
+    if (mozc::Util::Random(4) == 0) {
+      result.push_back(static_cast<char>('a' + mozc::Util::Random(26)));
+    } else {
+      mozc::Util::UCS4ToUTF8Append(0x3041 + mozc::Util::Random(0x56), &result);
+    }
+  }
+  result.resize(size);
+  return result;
+}
+
+template <typename Function>
+void Run(const char *name, const vector<string> &strings, Function function) {
+  mozc::Stopwatch stopwatch;
+  uint64 sum = 0;
+  stopwatch.Start();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    for (size_t j = 0; j < strings.size(); ++j) {
+      sum += function(strings[j]);
+    }
+  }
+  stopwatch.Stop();
+  const double num_hashes =
+      static_cast<double>(FLAGS_iterations) * strings.size();
+  std::cout << name << ": "
+            << num_hashes * 1000.0 / stopwatch.GetElapsedMicroseconds()
+            << " hashes/msec (checksum: " << sum << ")" << std::endl;
+}
+
+uint64 Lookup2(const string &str) {
+  return mozc::Hash::Fingerprint(str);
+}
+
+uint64 Fast(const string &str) {
+  return mozc::Hash::FastFingerprint(str);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  const size_t kLengths[] = {4, 8, 16, 32, 64};
+  for (size_t i = 0; i < arraysize(kLengths); ++i) {
+    vector<string> strings;
+    for (int j = 0; j < FLAGS_num_strings; ++j) {
+      strings.push_back(GenRandomString(kLengths[i]));
+    }
+    std::cout << kLengths[i] << " bytes" << std::endl;
+    Run("  Fingerprint", strings, Lookup2);
+    Run("  FastFingerprint", strings, Fast);
+  }
+
+  return 0;
+}
@@ -57,6 +57,57 @@ TEST(HashTest, Basic) {
   EXPECT_EQ(0xe3fd29979d4f0b39, Hash::FingerprintWithSeed(s, 0xdeadbeef));
 }
 
+// The values must not change since they are stored in files.
+TEST(HashTest, FastFingerprint) {
+  string s = "";
+  EXPECT_EQ(0x158206f6fa3095f3, Hash::FastFingerprint(s));
+  EXPECT_EQ(0x843d2f014fdc22fb, Hash::FastFingerprintWithSeed(s, 0xdeadbeef));
+
+  s = "google";
+  EXPECT_EQ(0xb61e0c4e99a9a3ce, Hash::FastFingerprint(s));
+  EXPECT_EQ(0x9b6542cd12927fad, Hash::FastFingerprintWithSeed(s, 0xdeadbeef));
+
+  // Lengths around the boundaries of the code paths.
+  s = "0123456789abcdef";
+  EXPECT_EQ(0x9232e606fb91bda5, Hash::FastFingerprint(s));
+  s = "0123456789abcdefg";
+  EXPECT_EQ(0xca5a425543d90e42, Hash::FastFingerprint(s));
+
+  s = "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  EXPECT_EQ(0xb61e70f87d3ff2e8, Hash::FastFingerprint(s));
+  EXPECT_EQ(0x4a9f2401fa324282, Hash::FastFingerprintWithSeed(s, 0xdeadbeef));
+}
+
+TEST(HashTest, FastFingerprintReadsOnlyGivenBytes) {
+  // Every prefix of a string has a distinct fingerprint, and the bytes after
+  // the prefix don't affect it.
+  const string kStr = "0123456789abcdefghijklmnopqrstuvwxyz"
+                      "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  for (size_t len = 0; len <= kStr.size(); ++len) {
+    const string prefix = kStr.substr(0, len);
+    EXPECT_EQ(Hash::FastFingerprint(prefix),
+              Hash::FastFingerprint(StringPiece(kStr.data(), len)));
+    if (len > 0) {
+      EXPECT_NE(Hash::FastFingerprint(prefix),
+                Hash::FastFingerprint(kStr.substr(0, len - 1)));
+    }
+  }
+}
+
+TEST(HashTest, FingerprintWithVersion) {
+  const string s = "google";
+  EXPECT_EQ(Hash::FingerprintWithSeed(s, 0xdeadbeef),
+            Hash::FingerprintWithVersion(s, 0xdeadbeef,
+                                         Hash::FINGERPRINT_LOOKUP2));
+  EXPECT_EQ(Hash::FastFingerprintWithSeed(s, 0xdeadbeef),
+            Hash::FingerprintWithVersion(s, 0xdeadbeef,
+                                         Hash::FINGERPRINT_FAST));
+  EXPECT_EQ(Hash::Fingerprint32(s),
+            Hash::Fingerprint32WithVersion(s, Hash::FINGERPRINT_LOOKUP2));
+  EXPECT_EQ(0x8f96ce00,
+            Hash::Fingerprint32WithVersion(s, Hash::FINGERPRINT_FAST));
+}
+
 TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   const uint32 seed = 0xabcdef;
   {
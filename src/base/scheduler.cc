@@ -39,90 +39,75 @@
 #include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
-#include "base/thread.h"
-#include "base/unnamed_event.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 
 namespace mozc {
 namespace {
 
-class TimerThread final : public Thread {
+// Runs |callback| on the default thread pool after |due_time| msec, and then
+// every |period| msec if |period| is not 0.
+class QueueTimer final {
  public:
-  TimerThread(std::function<void()> callback,
-              uint32 due_time,
-              uint32 interval)
+  QueueTimer(std::function<void()> callback,
+             uint32 due_time,
+             uint32 period)
       : callback_(callback),
         due_time_(due_time),
-        interval_(interval) {
-    CHECK(due_time_ != 0 || interval_ != 0)
-        << "Either of due_time or interval must be non 0.";
+        period_(period),
+        stopped_(false) {
+    CHECK(due_time_ != 0 || period_ != 0)
+        << "Either of due_time or period must be non 0.";
   }
 
-  ~TimerThread() override {
-    SignalQuit();
-    Join();
+  ~QueueTimer() {
+    TaskHandle task;
+    {
+      scoped_lock l(&mutex_);
+      stopped_ = true;
+      task = task_;
+    }
+    // Waits for the callback if it is running.  As |stopped_| is set, it does
+    // not reschedule itself.
+    task.Cancel();
+    task.Wait();
   }
 
-  void Run() override {
-    if (event_.Wait(due_time_)) {
-      VLOG(1) << "Received notification event";
-      return;
-    }
+  void Start() {
+    scoped_lock l(&mutex_);
+    Schedule(due_time_);
+  }
 
+ private:
+  // Requires |mutex_|.
+  void Schedule(uint32 delay) {
+    task_ = ThreadPool::GetDefault()->SubmitAfter(
+        delay, std::bind(&QueueTimer::Fire, this));
+  }
+
+  void Fire() {
     VLOG(2) << "call TimerCallback()";
     callback_();
-
-    if (interval_ == 0) {
-      VLOG(2) << "Run() end";
-      return;
-    }
-
-    while (true) {
-      if (event_.Wait(interval_)) {
-        VLOG(1) << "Received notification event";
-        return;
-      }
-      VLOG(2) << "call TimerCallback()";
-      callback_();
+    scoped_lock l(&mutex_);
+    if (!stopped_ && period_ != 0) {
+      Schedule(period_);
     }
   }
 
- private:
-  void SignalQuit() {
-    const bool result = event_.Notify();
-    DCHECK(result);
-  }
-
   std::function<void()> callback_;
 
   // The amount of time to elapse before the timer is to be set to the
   // signaled state for the first time, in milliseconds.
-  uint32 due_time_;
+  const uint32 due_time_;
 
   // The period of the timer, in milliseconds. If this is zero, the
   // timer is one-shot timer. If this is greater than zero, the timer
   // is periodic.
-  uint32 interval_;
-
-  UnnamedEvent event_;
-
-  DISALLOW_COPY_AND_ASSIGN(TimerThread);
-};
-
-class QueueTimer final {
- public:
-  QueueTimer(std::function<void()> callback,
-             uint32 due_time,
-             uint32 period)
-      : timer_thread_(callback, due_time, period) {
-  }
+  const uint32 period_;
 
-  void Start() {
-    timer_thread_.Start("QueueTimer");
-  }
-
- private:
-  TimerThread timer_thread_;
+  Mutex mutex_;
+  bool stopped_;
+  Future<void> task_;
 
   DISALLOW_COPY_AND_ASSIGN(QueueTimer);
 };
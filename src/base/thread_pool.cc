@@ -0,0 +1,701 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+
+DEFINE_int32(thread_pool_size, 4,
+             "The number of worker threads of the default thread pool. "
+             "0 runs the pool in deterministic single-thread mode, where "
+             "the background tasks run only when they are waited for, so "
+             "it's only for tools and tests.");
+
+namespace mozc {
+namespace thread_pool_internal {
+
+class TaskState {
+ public:
+  TaskState(std::function<void()> func, PoolImpl *pool, uint64 runnable_ticks,
+            uint64 deadline_ticks, uint64 sequence)
+      : func_(std::move(func)),
+        pool_(pool),
+        runnable_ticks_(runnable_ticks),
+        deadline_ticks_(deadline_ticks),
+        sequence_(sequence),
+        status_(TaskHandle::PENDING) {}
+
+  PoolImpl *pool() const { return pool_; }
+  uint64 runnable_ticks() const { return runnable_ticks_; }
+  uint64 deadline_ticks() const { return deadline_ticks_; }
+  uint64 sequence() const { return sequence_; }
+
+  TaskHandle::Status status() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+  }
+
+  bool IsDone() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return IsFinal(status_);
+  }
+
+  // Moves the status from PENDING to |status|.  Returns false if the task has
+  // already left PENDING.
+  bool Leave(TaskHandle::Status status) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (status_ != TaskHandle::PENDING) {
+        return false;
+      }
+      status_ = status;
+      if (status == TaskHandle::RUNNING) {
+        return true;
+      }
+    }
+    Finish(status);
+    return true;
+  }
+
+  void Run() {
+    DCHECK_EQ(TaskHandle::RUNNING, status());
+    func_();
+  }
+
+  // Moves the status to the final |status| and wakes up the waiters.
+  void Finish(TaskHandle::Status status) {
+    // Releases what the closure captured before waking up waiters.
+    func_ = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      status_ = status;
+    }
+    done_.notify_all();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return IsFinal(status_); });
+  }
+
+  // Returns true if the task has finished within |msec|.
+  bool WaitFor(int msec) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return done_.wait_for(lock, std::chrono::milliseconds(msec),
+                          [this]() { return IsFinal(status_); });
+  }
+
+ private:
+  static bool IsFinal(TaskHandle::Status status) {
+    return status != TaskHandle::PENDING && status != TaskHandle::RUNNING;
+  }
+
+  std::function<void()> func_;
+  PoolImpl *const pool_;
+  const uint64 runnable_ticks_;
+  const uint64 deadline_ticks_;  // 0 if the task has no deadline.
+  const uint64 sequence_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  TaskHandle::Status status_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskState);
+};
+
+namespace {
+
+typedef std::shared_ptr<TaskState> TaskPtr;
+
+// Orders the delayed tasks so that the earliest one is on top of the heap.
+struct LaterTask {
+  bool operator()(const TaskPtr &lhs, const TaskPtr &rhs) const {
+    if (lhs->runnable_ticks() != rhs->runnable_ticks()) {
+      return lhs->runnable_ticks() > rhs->runnable_ticks();
+    }
+    return lhs->sequence() > rhs->sequence();
+  }
+};
+
+uint64 MsecToTicks(uint64 msec) {
+  return msec * Clock::GetFrequency() / 1000;
+}
+
+uint64 TicksToUsec(uint64 ticks) {
+  const uint64 frequency = Clock::GetFrequency();
+  return ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+}
+
+void UpdateMax(std::atomic<uint64> *max_value, uint64 value) {
+  uint64 current = max_value->load();
+  while (current < value && !max_value->compare_exchange_weak(current, value)) {
+  }
+}
+
+}  // namespace
+
+class PoolImpl {
+ public:
+  PoolImpl(int num_threads, const string &name);
+  ~PoolImpl();
+
+  int num_threads() const { return static_cast<int>(workers_.size()); }
+
+  TaskPtr Post(std::function<void()> func, uint32 delay_msec,
+               uint32 deadline_msec);
+  void WaitFor(TaskState *task);
+  int RunUntilIdle();
+  void OnCancelled() { ++cancelled_; }
+  ThreadPool::Stats GetStats() const;
+
+ private:
+  // Task deque owned by a worker.  The owner pushes and pops at the back and
+  // the other workers steal from the front.
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<TaskPtr> tasks;
+    std::thread::id thread_id;
+  };
+
+  class Worker : public Thread {
+   public:
+    Worker(PoolImpl *pool, int index) : pool_(pool), index_(index) {}
+    void Run() override { pool_->WorkerLoop(index_); }
+
+   private:
+    PoolImpl *pool_;
+    const int index_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+  };
+
+  void WorkerLoop(int index);
+
+  // Returns the index of the worker running on the calling thread, or -1.
+  int CurrentWorkerIndex() const;
+
+  void Push(const TaskPtr &task);
+
+  // Returns a runnable task, or NULL.  |worker_index| is -1 when the caller
+  // is not a worker.
+  TaskPtr TakeTask(int worker_index);
+
+  // Moves the delayed tasks whose time has come to the injection queue.
+  // Requires |mutex_|.
+  void PromoteDelayedTasks(uint64 now);
+
+  // Returns false if the task has been cancelled or has expired.
+  bool RunTask(const TaskPtr &task);
+
+  // Cancels every queued task.
+  void CancelQueuedTasks();
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Guards the members below as well as the sleep of the workers.
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::deque<TaskPtr> injection_;
+  std::vector<TaskPtr> delayed_;  // Heap ordered by LaterTask.
+  int num_started_;
+  std::atomic<uint64> next_sequence_;
+  std::atomic<bool> shutdown_;
+
+  // The number of tasks in |injection_| and |queues_| and the number of
+  // sleeping workers.  A pusher increments |queued_| before reading
+  // |sleeping_| and a worker increments |sleeping_| before reading |queued_|,
+  // so at least one of them sees the other and no wakeup is lost.
+  std::atomic<uint64> queued_;
+  std::atomic<int> sleeping_;
+  // Runnable time of the earliest delayed task, kuint64max if none.
+  std::atomic<uint64> next_due_ticks_;
+
+  std::atomic<uint64> submitted_;
+  std::atomic<uint64> executed_;
+  std::atomic<uint64> cancelled_;
+  std::atomic<uint64> expired_;
+  std::atomic<uint64> stolen_;
+  std::atomic<uint64> max_queue_depth_;
+  std::atomic<uint64> total_queue_latency_usec_;
+  std::atomic<uint64> max_queue_latency_usec_;
+  std::atomic<uint64> total_run_latency_usec_;
+  std::atomic<uint64> max_run_latency_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(PoolImpl);
+};
+
+PoolImpl::PoolImpl(int num_threads, const string &name)
+    : num_started_(0),
+      next_sequence_(0),
+      shutdown_(false),
+      queued_(0),
+      sleeping_(0),
+      next_due_ticks_(kuint64max),
+      submitted_(0),
+      executed_(0),
+      cancelled_(0),
+      expired_(0),
+      stolen_(0),
+      max_queue_depth_(0),
+      total_queue_latency_usec_(0),
+      max_queue_latency_usec_(0),
+      total_run_latency_usec_(0),
+      max_run_latency_usec_(0) {
+  DCHECK_GE(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+    workers_.push_back(std::unique_ptr<Worker>(new Worker(this, i)));
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->SetJoinable(true);
+    workers_[i]->Start(name);
+  }
+  // Waits for the workers to register their thread IDs, which are read
+  // without locks afterwards.
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_available_.wait(lock, [this, num_threads]() {
+    return num_started_ == num_threads;
+  });
+}
+
+PoolImpl::~PoolImpl() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  CancelQueuedTasks();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_available_.notify_all();
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->Join();
+  }
+  // Tasks running at the shutdown may have posted new ones.
+  CancelQueuedTasks();
+}
+
+TaskPtr PoolImpl::Post(std::function<void()> func, uint32 delay_msec,
+                       uint32 deadline_msec) {
+  const uint64 now = Clock::GetTicks();
+  const uint64 runnable_ticks = now + MsecToTicks(delay_msec);
+  const uint64 deadline_ticks =
+      deadline_msec == 0 ? 0 : runnable_ticks + MsecToTicks(deadline_msec);
+  const TaskPtr task = std::make_shared<TaskState>(
+      std::move(func), this, runnable_ticks, deadline_ticks, next_sequence_++);
+  ++submitted_;
+  if (shutdown_) {
+    LOG(WARNING) << "The pool is shutting down";
+    if (task->Leave(TaskHandle::CANCELLED)) {
+      ++cancelled_;
+    }
+    return task;
+  }
+  if (delay_msec == 0) {
+    Push(task);
+    return task;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  delayed_.push_back(task);
+  std::push_heap(delayed_.begin(), delayed_.end(), LaterTask());
+  next_due_ticks_ = delayed_.front()->runnable_ticks();
+  // A sleeping worker has to recompute its timeout.
+  work_available_.notify_one();
+  return task;
+}
+
+int PoolImpl::CurrentWorkerIndex() const {
+  const std::thread::id id = std::this_thread::get_id();
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    if (queues_[i]->thread_id == id) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void PoolImpl::Push(const TaskPtr &task) {
+  const int index = CurrentWorkerIndex();
+  if (index >= 0) {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(task);
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    injection_.push_back(task);
+  }
+  UpdateMax(&max_queue_depth_, ++queued_);
+  if (sleeping_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_available_.notify_one();
+  }
+}
+
+void PoolImpl::PromoteDelayedTasks(uint64 now) {
+  while (!delayed_.empty() && delayed_.front()->runnable_ticks() <= now) {
+    std::pop_heap(delayed_.begin(), delayed_.end(), LaterTask());
+    injection_.push_back(delayed_.back());
+    delayed_.pop_back();
+    UpdateMax(&max_queue_depth_, ++queued_);
+  }
+  next_due_ticks_ =
+      delayed_.empty() ? kuint64max : delayed_.front()->runnable_ticks();
+}
+
+TaskPtr PoolImpl::TakeTask(int worker_index) {
+  const uint64 now = Clock::GetTicks();
+  if (next_due_ticks_ <= now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PromoteDelayedTasks(now);
+  }
+  if (queued_ == 0) {
+    return nullptr;
+  }
+
+  TaskPtr task;
+  if (worker_index >= 0) {
+    WorkerQueue *queue = queues_[worker_index].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      task = queue->tasks.back();
+      queue->tasks.pop_back();
+    }
+  }
+  if (task == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!injection_.empty()) {
+      task = injection_.front();
+      injection_.pop_front();
+    }
+  }
+  // Steals the oldest task of another worker, starting from the next one so
+  // that the victims are spread over the workers.
+  for (size_t i = 1; task == nullptr && i <= queues_.size(); ++i) {
+    const size_t victim = (worker_index + i) % queues_.size();
+    if (static_cast<int>(victim) == worker_index) {
+      continue;
+    }
+    WorkerQueue *queue = queues_[victim].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      task = queue->tasks.front();
+      queue->tasks.pop_front();
+      ++stolen_;
+    }
+  }
+  if (task != nullptr) {
+    --queued_;
+  }
+  return task;
+}
+
+bool PoolImpl::RunTask(const TaskPtr &task) {
+  const uint64 start = Clock::GetTicks();
+  if (task->deadline_ticks() != 0 && start > task->deadline_ticks()) {
+    if (task->Leave(TaskHandle::EXPIRED)) {
+      ++expired_;
+    }
+    return false;
+  }
+  if (!task->Leave(TaskHandle::RUNNING)) {
+    // Cancelled while in the queue.
+    return false;
+  }
+  const uint64 queue_latency = TicksToUsec(
+      start > task->runnable_ticks() ? start - task->runnable_ticks() : 0);
+  total_queue_latency_usec_ += queue_latency;
+  UpdateMax(&max_queue_latency_usec_, queue_latency);
+
+  task->Run();
+
+  const uint64 end = Clock::GetTicks();
+  const uint64 run_latency = TicksToUsec(end > start ? end - start : 0);
+  total_run_latency_usec_ += run_latency;
+  UpdateMax(&max_run_latency_usec_, run_latency);
+  ++executed_;
+  // Updates the counters first so that a waiter sees them.
+  task->Finish(TaskHandle::DONE);
+  return true;
+}
+
+void PoolImpl::WorkerLoop(int index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queues_[index]->thread_id = std::this_thread::get_id();
+    ++num_started_;
+    work_available_.notify_all();
+  }
+  while (true) {
+    const TaskPtr task = TakeTask(index);
+    if (task != nullptr) {
+      RunTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (shutdown_) {
+      return;
+    }
+    const uint64 now = Clock::GetTicks();
+    PromoteDelayedTasks(now);
+    ++sleeping_;
+    if (queued_ == 0) {
+      if (delayed_.empty()) {
+        work_available_.wait(lock);
+      } else {
+        const uint64 wait_usec =
+            TicksToUsec(delayed_.front()->runnable_ticks() - now);
+        work_available_.wait_for(lock,
+                                 std::chrono::microseconds(wait_usec + 1000));
+      }
+    }
+    --sleeping_;
+  }
+}
+
+void PoolImpl::WaitFor(TaskState *task) {
+  const int index = CurrentWorkerIndex();
+  if (index < 0 && !workers_.empty()) {
+    task->Wait();
+    return;
+  }
+  // Runs other tasks instead of blocking the worker or, in single-thread
+  // mode, the only thread which can make progress.
+  while (!task->IsDone()) {
+    const TaskPtr other = TakeTask(index);
+    if (other != nullptr) {
+      RunTask(other);
+      continue;
+    }
+    if (workers_.empty() && task->status() == TaskHandle::PENDING) {
+      LOG(DFATAL) << "The task is not runnable yet";
+      return;
+    }
+    task->WaitFor(1);
+  }
+}
+
+int PoolImpl::RunUntilIdle() {
+  const int index = CurrentWorkerIndex();
+  int num_tasks = 0;
+  for (TaskPtr task = TakeTask(index); task != nullptr;
+       task = TakeTask(index)) {
+    if (RunTask(task)) {
+      ++num_tasks;
+    }
+  }
+  return num_tasks;
+}
+
+void PoolImpl::CancelQueuedTasks() {
+  std::vector<TaskPtr> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks.insert(tasks.end(), injection_.begin(), injection_.end());
+    tasks.insert(tasks.end(), delayed_.begin(), delayed_.end());
+    queued_ -= injection_.size();
+    injection_.clear();
+    delayed_.clear();
+    next_due_ticks_ = kuint64max;
+  }
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+    tasks.insert(tasks.end(), queues_[i]->tasks.begin(),
+                 queues_[i]->tasks.end());
+    queued_ -= queues_[i]->tasks.size();
+    queues_[i]->tasks.clear();
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (tasks[i]->Leave(TaskHandle::CANCELLED)) {
+      ++cancelled_;
+    }
+  }
+}
+
+ThreadPool::Stats PoolImpl::GetStats() const {
+  ThreadPool::Stats stats;
+  stats.submitted = submitted_;
+  stats.executed = executed_;
+  stats.cancelled = cancelled_;
+  stats.expired = expired_;
+  stats.stolen = stolen_;
+  stats.queue_depth = queued_;
+  stats.max_queue_depth = max_queue_depth_;
+  stats.total_queue_latency_usec = total_queue_latency_usec_;
+  stats.max_queue_latency_usec = max_queue_latency_usec_;
+  stats.total_run_latency_usec = total_run_latency_usec_;
+  stats.max_run_latency_usec = max_run_latency_usec_;
+  return stats;
+}
+
+}  // namespace thread_pool_internal
+
+TaskHandle::TaskHandle() {}
+
+TaskHandle::~TaskHandle() {}
+
+TaskHandle::Status TaskHandle::status() const {
+  // An invalid handle behaves as a cancelled task.
+  return state_ == nullptr ? CANCELLED : state_->status();
+}
+
+bool TaskHandle::IsDone() const {
+  return state_ == nullptr || state_->IsDone();
+}
+
+void TaskHandle::Wait() const {
+  // The pool is alive as long as the task is not finished.
+  if (!IsDone()) {
+    state_->pool()->WaitFor(state_.get());
+  }
+}
+
+bool TaskHandle::Cancel() {
+  if (state_ == nullptr || !state_->Leave(CANCELLED)) {
+    return false;
+  }
+  state_->pool()->OnCancelled();
+  return true;
+}
+
+ThreadPool::Stats::Stats()
+    : submitted(0),
+      executed(0),
+      cancelled(0),
+      expired(0),
+      stolen(0),
+      queue_depth(0),
+      max_queue_depth(0),
+      total_queue_latency_usec(0),
+      max_queue_latency_usec(0),
+      total_run_latency_usec(0),
+      max_run_latency_usec(0) {}
+
+ThreadPool::ThreadPool(int num_threads, const string &name)
+    : impl_(new thread_pool_internal::PoolImpl(num_threads, name)) {}
+
+ThreadPool::~ThreadPool() {}
+
+int ThreadPool::num_threads() const {
+  return impl_->num_threads();
+}
+
+std::shared_ptr<thread_pool_internal::TaskState> ThreadPool::Post(
+    std::function<void()> func, uint32 delay_msec, uint32 deadline_msec) {
+  return impl_->Post(std::move(func), delay_msec, deadline_msec);
+}
+
+int ThreadPool::RunUntilIdle() {
+  return impl_->RunUntilIdle();
+}
+
+ThreadPool::Stats ThreadPool::GetStats() const {
+  return impl_->GetStats();
+}
+
+void ThreadPool::ParallelFor(ThreadPool *pool, int begin, int end,
+                             const std::function<void(int)> &func) {
+  if (begin >= end) {
+    return;
+  }
+  const int num_helpers =
+      pool == nullptr ? 0 : std::min(pool->num_threads(), end - begin - 1);
+  if (num_helpers == 0) {
+    for (int i = begin; i < end; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  // Indices are handed out one by one, so uneven iterations balance
+  // themselves.  Helpers which start after the caller has finished the loop
+  // are cancelled.
+  std::atomic<int> next(begin);
+  std::function<void()> loop = [&next, end, &func]() {
+    for (int i = next++; i < end; i = next++) {
+      func(i);
+    }
+  };
+  std::vector<Future<void>> helpers;
+  helpers.reserve(num_helpers);
+  for (int i = 0; i < num_helpers; ++i) {
+    helpers.push_back(pool->Submit(loop));
+  }
+  loop();
+  for (size_t i = 0; i < helpers.size(); ++i) {
+    helpers[i].Cancel();
+  }
+  for (size_t i = 0; i < helpers.size(); ++i) {
+    helpers[i].Wait();
+  }
+}
+
+namespace {
+
+class DefaultThreadPool {
+ public:
+  DefaultThreadPool()
+      : pool_(std::max(FLAGS_thread_pool_size, 0), "ThreadPool") {}
+
+  ThreadPool *get() { return &pool_; }
+
+ private:
+  ThreadPool pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(DefaultThreadPool);
+};
+
+ThreadPool *g_default_pool_for_testing = nullptr;
+
+}  // namespace
+
+ThreadPool *ThreadPool::GetDefault() {
+  if (g_default_pool_for_testing != nullptr) {
+    return g_default_pool_for_testing;
+  }
+  return Singleton<DefaultThreadPool>::get()->get();
+}
+
+void ThreadPool::SetDefaultForTesting(ThreadPool *pool) {
+  g_default_pool_for_testing = pool;
+}
+
+}  // namespace mozc
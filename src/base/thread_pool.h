@@ -0,0 +1,258 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// ThreadPool runs small tasks on a fixed set of worker threads.
+//
+// Each worker owns a deque of tasks.  Tasks submitted from a worker are
+// pushed to the worker's own deque and popped in LIFO order, while idle
+// workers steal from the other end of the busiest-looking deques.  Tasks
+// submitted from other threads go to a shared FIFO injection queue.
+//
+// A pool created with zero threads runs in deterministic single-thread mode:
+// nothing runs until the owner calls RunUntilIdle() or waits on a future, and
+// tasks are then executed on the calling thread in submission order.  Delayed
+// tasks become runnable according to Clock, so ClockMock can drive them.
+//
+// usage:
+//   ThreadPool *pool = ThreadPool::GetDefault();
+//   Future<int> f = pool->Submit([]() { return Compute(); });
+//   ...
+//   const int result = f.Get();
+//
+//   ThreadPool::ParallelFor(pool, 0, items.size(), [&](int i) {
+//     Process(&items[i]);
+//   });
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/port.h"
+
+namespace mozc {
+
+class ThreadPool;
+
+namespace thread_pool_internal {
+class PoolImpl;
+class TaskState;
+}  // namespace thread_pool_internal
+
+// Type-erased handle of a submitted task.  Handles are cheap to copy and all
+// copies refer to the same task.  A default-constructed handle refers to no
+// task; Wait() returns immediately and Cancel() returns false on it.
+class TaskHandle {
+ public:
+  enum Status {
+    PENDING,    // Queued and not started yet.
+    RUNNING,
+    DONE,
+    CANCELLED,  // Cancelled by Cancel() or by the pool shutting down.
+    EXPIRED,    // The deadline passed before a worker picked the task up.
+  };
+
+  TaskHandle();
+  ~TaskHandle();
+
+  bool valid() const { return state_ != nullptr; }
+  Status status() const;
+
+  // Returns true if the task will not change its status anymore.
+  bool IsDone() const;
+
+  // Blocks until the task is done, cancelled or expired.  When called from a
+  // worker of the owning pool, or on a single-thread pool, the calling thread
+  // runs other queued tasks while waiting instead of blocking the pool.
+  void Wait() const;
+
+  // Cancels the task if it has not started yet.  Returns true if the task is
+  // guaranteed not to run.  A running task is never interrupted.
+  bool Cancel();
+
+ protected:
+  friend class ThreadPool;
+
+  std::shared_ptr<thread_pool_internal::TaskState> state_;
+};
+
+// Handle of a task returning T.
+template <typename T>
+class Future : public TaskHandle {
+ public:
+  Future() {}
+
+  // Waits for the task and returns its result.  The task must have run to
+  // completion, i.e. it must not be cancelled or expired.
+  const T &Get() const {
+    Wait();
+    CHECK_EQ(DONE, status()) << "The task did not run";
+    return *result_->value;
+  }
+
+ private:
+  friend class ThreadPool;
+
+  struct Result {
+    std::unique_ptr<T> value;
+  };
+  std::shared_ptr<Result> result_;
+};
+
+template <>
+class Future<void> : public TaskHandle {
+ public:
+  Future() {}
+
+  void Get() const { Wait(); }
+};
+
+class ThreadPool {
+ public:
+  // Snapshot of the counters of a pool.  Latencies are in microseconds.
+  // Queue latency is the time from when a task becomes runnable until a
+  // worker starts it; run latency is the time spent in the task itself.
+  struct Stats {
+    Stats();
+
+    uint64 submitted;
+    uint64 executed;
+    uint64 cancelled;
+    uint64 expired;
+    uint64 stolen;
+    uint64 queue_depth;
+    uint64 max_queue_depth;
+    uint64 total_queue_latency_usec;
+    uint64 max_queue_latency_usec;
+    uint64 total_run_latency_usec;
+    uint64 max_run_latency_usec;
+  };
+
+  // Creates a pool with |num_threads| workers.  If |num_threads| is 0, the
+  // pool runs in deterministic single-thread mode (see above).
+  ThreadPool(int num_threads, const string &name);
+
+  // Cancels tasks which have not started and joins the workers.
+  ~ThreadPool();
+
+  int num_threads() const;
+
+  // Submits |func|.  The returned future holds the return value of |func|.
+  template <typename F>
+  Future<typename std::result_of<F()>::type> Submit(F func) {
+    return SubmitWithOptions(std::move(func), 0, 0);
+  }
+
+  // Submits |func| to be run after |delay_msec| milliseconds.
+  template <typename F>
+  Future<typename std::result_of<F()>::type> SubmitAfter(uint32 delay_msec,
+                                                         F func) {
+    return SubmitWithOptions(std::move(func), delay_msec, 0);
+  }
+
+  // Submits |func| which is dropped with EXPIRED status unless a worker picks
+  // it up within |deadline_msec| milliseconds after it becomes runnable.
+  template <typename F>
+  Future<typename std::result_of<F()>::type> SubmitWithDeadline(
+      uint32 deadline_msec, F func) {
+    return SubmitWithOptions(std::move(func), 0, deadline_msec);
+  }
+
+  // Runs queued tasks on the calling thread until no runnable task is left.
+  // Mainly for single-thread mode; on a multi-threaded pool this only helps
+  // the workers.  Returns the number of tasks run.
+  int RunUntilIdle();
+
+  Stats GetStats() const;
+
+  // Calls |func(i)| for every i in [begin, end) and returns after all the
+  // calls finish.  The calling thread takes part in the loop, so this is safe
+  // to call from a task running on |pool|.  If |pool| is NULL or has no
+  // worker, the loop runs sequentially in ascending order.
+  static void ParallelFor(ThreadPool *pool, int begin, int end,
+                          const std::function<void(int)> &func);
+
+  // Returns the process-wide pool shared by the background work of the
+  // engine.  Its size is controlled by --thread_pool_size.  With 0, it runs
+  // in single-thread mode, in which the tasks nobody waits for never run, so
+  // a server needs at least 1.
+  static ThreadPool *GetDefault();
+
+  // Replaces the pool returned by GetDefault().  Pass NULL to restore the
+  // default one.  The caller keeps the ownership.
+  static void SetDefaultForTesting(ThreadPool *pool);
+
+ private:
+  template <typename F>
+  Future<typename std::result_of<F()>::type> SubmitWithOptions(
+      F func, uint32 delay_msec, uint32 deadline_msec) {
+    return MakeFuture(std::move(func), delay_msec, deadline_msec,
+                      std::is_void<typename std::result_of<F()>::type>());
+  }
+
+  template <typename F>
+  Future<void> MakeFuture(F func, uint32 delay_msec, uint32 deadline_msec,
+                          std::true_type /* is_void */) {
+    Future<void> future;
+    future.state_ = Post(std::move(func), delay_msec, deadline_msec);
+    return future;
+  }
+
+  template <typename F>
+  Future<typename std::result_of<F()>::type> MakeFuture(
+      F func, uint32 delay_msec, uint32 deadline_msec,
+      std::false_type /* is_void */) {
+    typedef typename std::result_of<F()>::type T;
+    Future<T> future;
+    // The task shares the result with the future, so dropping every copy of
+    // the future before the task runs is safe.
+    std::shared_ptr<typename Future<T>::Result> result(
+        new typename Future<T>::Result);
+    future.result_ = result;
+    future.state_ = Post(
+        [func, result]() mutable { result->value.reset(new T(func())); },
+        delay_msec, deadline_msec);
+    return future;
+  }
+
+  std::shared_ptr<thread_pool_internal::TaskState> Post(
+      std::function<void()> func, uint32 delay_msec, uint32 deadline_msec);
+
+  std::unique_ptr<thread_pool_internal::PoolImpl> impl_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
@@ -0,0 +1,254 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "base/port.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, SingleThreadModeRunsTasksInOrder) {
+  ThreadPool pool(0, "ThreadPoolTest");
+  EXPECT_EQ(0, pool.num_threads());
+
+  vector<int> order;
+  Future<int> first = pool.Submit([&order]() {
+    order.push_back(1);
+    return 10;
+  });
+  Future<void> second = pool.Submit([&order]() { order.push_back(2); });
+  pool.Submit([&order]() { order.push_back(3); });
+
+  // Nothing runs until someone drives the pool.
+  EXPECT_TRUE(order.empty());
+  EXPECT_EQ(TaskHandle::PENDING, first.status());
+
+  // Waiting for the second task runs the tasks before it as well.
+  second.Wait();
+  EXPECT_EQ(TaskHandle::DONE, second.status());
+  ASSERT_EQ(2, order.size());
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(2, order[1]);
+  EXPECT_EQ(10, first.Get());
+
+  EXPECT_EQ(1, pool.RunUntilIdle());
+  ASSERT_EQ(3, order.size());
+  EXPECT_EQ(3, order[2]);
+  EXPECT_EQ(0, pool.RunUntilIdle());
+}
+
+TEST(ThreadPoolTest, Cancel) {
+  ThreadPool pool(0, "ThreadPoolTest");
+  bool ran = false;
+  Future<void> future = pool.Submit([&ran]() { ran = true; });
+  EXPECT_TRUE(future.Cancel());
+  EXPECT_FALSE(future.Cancel());
+  EXPECT_EQ(TaskHandle::CANCELLED, future.status());
+  EXPECT_TRUE(future.IsDone());
+  future.Wait();
+  EXPECT_EQ(0, pool.RunUntilIdle());
+  EXPECT_FALSE(ran);
+
+  Future<void> done = pool.Submit([]() {});
+  done.Wait();
+  EXPECT_FALSE(done.Cancel());
+  EXPECT_EQ(TaskHandle::DONE, done.status());
+
+  const ThreadPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(2, stats.submitted);
+  EXPECT_EQ(1, stats.executed);
+  EXPECT_EQ(1, stats.cancelled);
+
+  TaskHandle invalid;
+  EXPECT_FALSE(invalid.valid());
+  EXPECT_FALSE(invalid.Cancel());
+  invalid.Wait();
+}
+
+TEST(ThreadPoolTest, DelayAndDeadline) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+  const uint64 ticks_per_msec = Clock::GetFrequency() / 1000;
+  {
+    ThreadPool pool(0, "ThreadPoolTest");
+    Future<void> delayed = pool.SubmitAfter(100, []() {});
+    Future<void> expiring = pool.SubmitWithDeadline(50, []() {});
+    Future<void> in_time = pool.SubmitWithDeadline(200, []() {});
+
+    clock.PutClockForwardByTicks(99 * ticks_per_msec);
+    EXPECT_EQ(1, pool.RunUntilIdle());
+    EXPECT_EQ(TaskHandle::PENDING, delayed.status());
+    EXPECT_EQ(TaskHandle::EXPIRED, expiring.status());
+    EXPECT_EQ(TaskHandle::DONE, in_time.status());
+
+    clock.PutClockForwardByTicks(ticks_per_msec);
+    EXPECT_EQ(1, pool.RunUntilIdle());
+    EXPECT_EQ(TaskHandle::DONE, delayed.status());
+
+    const ThreadPool::Stats stats = pool.GetStats();
+    EXPECT_EQ(3, stats.submitted);
+    EXPECT_EQ(2, stats.executed);
+    EXPECT_EQ(1, stats.expired);
+    EXPECT_EQ(0, stats.queue_depth);
+    EXPECT_EQ(2, stats.max_queue_depth);
+    // The first task waited 99 msec in the queue.
+    EXPECT_EQ(99000, stats.max_queue_latency_usec);
+  }
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST(ThreadPoolTest, DestructorCancelsPendingTasks) {
+  Future<void> future;
+  {
+    ThreadPool pool(0, "ThreadPoolTest");
+    future = pool.SubmitAfter(60 * 1000, []() {});
+  }
+  EXPECT_EQ(TaskHandle::CANCELLED, future.status());
+}
+
+TEST(ThreadPoolTest, MultiThreaded) {
+  ThreadPool pool(4, "ThreadPoolTest");
+  EXPECT_EQ(4, pool.num_threads());
+
+  std::atomic<int> sum(0);
+  vector<Future<int>> futures;
+  for (int i = 0; i < 100; ++i) {
+    futures.push_back(pool.Submit([i, &sum]() {
+      sum += i;
+      return i * 2;
+    }));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i * 2, futures[i].Get());
+  }
+  EXPECT_EQ(4950, sum);
+
+  // A delayed task is picked up by a sleeping worker.
+  Future<bool> delayed = pool.SubmitAfter(10, []() { return true; });
+  EXPECT_TRUE(delayed.Get());
+
+  const ThreadPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(101, stats.submitted);
+  EXPECT_EQ(101, stats.executed);
+  EXPECT_EQ(0, stats.queue_depth);
+}
+
+TEST(ThreadPoolTest, TasksSubmittedFromWorkersAreStolen) {
+  ThreadPool pool(4, "ThreadPoolTest");
+  // A worker pushes children to its own deque and blocks on them, so the
+  // other workers have to steal them.
+  std::atomic<int> finished(0);
+  Future<void> parent = pool.Submit([&pool, &finished]() {
+    vector<Future<void>> children;
+    for (int i = 0; i < 8; ++i) {
+      children.push_back(pool.Submit([&finished]() {
+        Util::Sleep(10);
+        ++finished;
+      }));
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+      children[i].Wait();
+    }
+  });
+  parent.Wait();
+  EXPECT_EQ(8, finished);
+  EXPECT_LT(0, pool.GetStats().stolen);
+}
+
+TEST(ThreadPoolTest, WaitFromWorkerDoesNotDeadlock) {
+  // With one worker, a task waiting for another task has to run it.
+  ThreadPool pool(1, "ThreadPoolTest");
+  Future<int> outer = pool.Submit([&pool]() {
+    Future<int> inner = pool.Submit([]() { return 42; });
+    return inner.Get() + 1;
+  });
+  EXPECT_EQ(43, outer.Get());
+}
+
+TEST(ThreadPoolTest, ParallelFor) {
+  const int kSize = 1000;
+  {
+    ThreadPool pool(4, "ThreadPoolTest");
+    vector<int> values(kSize, 0);
+    ThreadPool::ParallelFor(&pool, 0, kSize,
+                            [&values](int i) { values[i] = i * i; });
+    for (int i = 0; i < kSize; ++i) {
+      EXPECT_EQ(i * i, values[i]);
+    }
+
+    // Nested loops run on the workers as well.
+    std::atomic<int> count(0);
+    ThreadPool::ParallelFor(&pool, 0, 10, [&pool, &count](int i) {
+      ThreadPool::ParallelFor(&pool, 0, 10, [&count](int j) { ++count; });
+    });
+    EXPECT_EQ(100, count);
+  }
+
+  // Sequential in single-thread mode and without a pool.
+  ThreadPool single(0, "ThreadPoolTest");
+  vector<int> order;
+  ThreadPool::ParallelFor(&single, 3, 6, [&order](int i) {
+    order.push_back(i);
+  });
+  ThreadPool::ParallelFor(nullptr, 6, 8, [&order](int i) {
+    order.push_back(i);
+  });
+  ASSERT_EQ(5, order.size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i + 3, order[i]);
+  }
+  EXPECT_EQ(0, single.GetStats().submitted);
+  ThreadPool::ParallelFor(&single, 5, 5, [](int i) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, GetDefault) {
+  ThreadPool *pool = ThreadPool::GetDefault();
+  ASSERT_NE(nullptr, pool);
+  EXPECT_LT(0, pool->num_threads());
+  EXPECT_EQ(3, pool->Submit([]() { return 3; }).Get());
+
+  ThreadPool replacement(0, "ThreadPoolTest");
+  ThreadPool::SetDefaultForTesting(&replacement);
+  EXPECT_EQ(&replacement, ThreadPool::GetDefault());
+  ThreadPool::SetDefaultForTesting(nullptr);
+  EXPECT_EQ(pool, ThreadPool::GetDefault());
+}
+
+}  // namespace
+}  // namespace mozc
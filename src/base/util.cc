@@ -61,6 +61,13 @@
 #include <utility>
 #include <vector>
 
+// SSE2 is available on all the x86-64 processors.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOZC_UTIL_USE_SSE2
+#include <emmintrin.h>
+#endif  // __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+
 #include "base/double_array.h"
 #include "base/japanese_util_rule.h"
 #include "base/logging.h"
@@ -568,6 +575,51 @@ bool IsUTF8TrailingByte(uint8 c) {
   return (c & 0xc0) == 0x80;
 }
 
+#ifdef MOZC_UTIL_USE_SSE2
+int PopCount(uint32 x) {
+#ifdef __GNUC__
+  return __builtin_popcount(x);
+#else  // __GNUC__
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  return (x * 0x01010101) >> 24;
+#endif  // __GNUC__
+}
+
+// Counts the characters in [*begin, *begin + 16) in the same way as stepping
+// by OneCharLen(), and advances |*begin| to the next character.  Returns
+// false if the block can't be counted at once, i.e., when some lead byte is
+// skipped as a part of the preceding character.
+bool CountCharsInBlock(const char **begin, size_t *count) {
+  const __m128i v =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(*begin));
+  // Every byte is a character by itself if the block is ASCII.
+  const int non_ascii = _mm_movemask_epi8(v);
+  if (non_ascii == 0) {
+    *begin += 16;
+    *count += 16;
+    return true;
+  }
+  // The bytes are compared as signed: 0x80-0xbf < 0xc0 <= 0xe0 <= 0xf0 < 0.
+  const uint32 trailing =
+      _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0xc0 - 0x100)));
+  const uint32 lead2 = non_ascii & ~trailing;
+  const uint32 lead3 = non_ascii &
+      ~_mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0xe0 - 0x100)));
+  const uint32 lead4 = non_ascii &
+      ~_mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0xf0 - 0x100)));
+  // The bytes skipped when every non-trailing byte starts a character.
+  const uint32 skipped = (lead2 << 1) | (lead3 << 2) | (lead4 << 3);
+  if ((skipped & 0xffff & ~trailing) != 0) {
+    return false;
+  }
+  *count += 16 - PopCount(skipped & 0xffff);
+  *begin += 16 + PopCount(skipped >> 16);
+  return true;
+}
+#endif  // MOZC_UTIL_USE_SSE2
+
 }  // namespace
 
 // Return length of a single UTF-8 source character
@@ -578,7 +630,15 @@ size_t Util::OneCharLen(const char *src) {
 size_t Util::CharsLen(const char *src, size_t length) {
   const char *begin = src;
   const char *end = src + length;
-  int result = 0;
+  size_t result = 0;
+#ifdef MOZC_UTIL_USE_SSE2
+  while (end - begin >= 16) {
+    if (!CountCharsInBlock(&begin, &result)) {
+      ++result;
+      begin += OneCharLen(begin);
+    }
+  }
+#endif  // MOZC_UTIL_USE_SSE2
   while (begin < end) {
     ++result;
     begin += OneCharLen(begin);
@@ -615,6 +675,21 @@ bool Util::SplitFirstChar32(StringPiece s,
   *first_char32 = 0;
   rest->clear();
 
+  // Fast path for the most common 3-byte characters (U+1000 to U+FFFF), which
+  // are always valid once the trailing bytes are found.
+  if (s.size() >= 3) {
+    const uint8 leading_byte = static_cast<uint8>(s[0]);
+    const uint8 c1 = static_cast<uint8>(s[1]);
+    const uint8 c2 = static_cast<uint8>(s[2]);
+    if (leading_byte >= 0xe1 && leading_byte <= 0xef &&
+        IsUTF8TrailingByte(c1) && IsUTF8TrailingByte(c2)) {
+      *first_char32 = ((leading_byte & 0x0f) << 12) | ((c1 & 0x3f) << 6) |
+                      (c2 & 0x3f);
+      *rest = s.substr(3);
+      return true;
+    }
+  }
+
   while (true) {
     if (s.empty()) {
       return false;
@@ -1096,6 +1171,236 @@ int LookupDoubleArray(const japanese_util_rule::DoubleArray *array,
   return seekto;
 }
 
+// Appends the value of the longest prefix of [begin, end) in the rule to
+// |output|, and returns the end of the consumed prefix.  Returns |begin| if
+// no prefix is found.
+const char *AppendLongestMatch(const japanese_util_rule::DoubleArray *da,
+                               const char *ctable,
+                               const char *begin, const char *end,
+                               string *output) {
+  int result = 0;
+  const int mblen = LookupDoubleArray(da, begin, static_cast<int>(end - begin),
+                                      &result);
+  if (mblen <= 0) {
+    return begin;
+  }
+  const char *p = &ctable[result];
+  const size_t len = strlen(p);
+  output->append(p, len);
+  return begin + mblen - static_cast<int32>(p[len + 1]);
+}
+
+// Same as Util::ConvertUsingDoubleArray() for one step.
+const char *ConvertOneUsingDoubleArray(
+    const japanese_util_rule::DoubleArray *da, const char *ctable,
+    const char *begin, const char *end, string *output) {
+  const char *next = AppendLongestMatch(da, ctable, begin, end, output);
+  if (next != begin) {
+    return next;
+  }
+  const size_t mblen = Util::OneCharLen(begin);
+  output->append(begin, mblen);
+  return begin + mblen;
+}
+
+// Returns the end of the ASCII run starting at |begin|.
+const char *SkipAscii(const char *begin, const char *end) {
+#ifdef MOZC_UTIL_USE_SSE2
+  while (end - begin >= 16) {
+    const int non_ascii = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin)));
+    if (non_ascii != 0) {
+      break;
+    }
+    begin += 16;
+  }
+#endif  // MOZC_UTIL_USE_SSE2
+  for (; begin < end && static_cast<uint8>(*begin) < 0x80; ++begin) {}
+  return begin;
+}
+
+// Hiragana and katakana are the contiguous blocks in U+3000 to U+30FF, whose
+// UTF-8 sequences are "E3 xx yy".  The conversion between them shifts the
+// code points in [first, last] by |delta|, which is the same as the rules in
+// japanese_util_rule except for the characters followed by
+// |voiced_sound_mark|, which are left to the rule.
+struct KanaShift {
+  char32 first;
+  char32 last;
+  int delta;
+  char32 voiced_sound_mark;  // 0 if no such sequence.
+};
+
+const KanaShift kHiraganaToKatakanaShift = {
+  0x3041,  // "ぁ"
+  0x3094,  // "ゔ"
+  0x60,
+  0x309b,  // "゛" ("う゛" -> "ヴ")
+};
+
+const KanaShift kKatakanaToHiraganaShift = {
+  0x30a1,  // "ァ"
+  0x30f4,  // "ヴ"
+  -0x60,
+  0,
+};
+
+bool IsKanaSequence(const char *ptr, char32 c) {
+  return static_cast<uint8>(ptr[0]) == 0xe3 &&
+         static_cast<uint8>(ptr[1]) == (0x80 | ((c >> 6) & 0x3f)) &&
+         static_cast<uint8>(ptr[2]) == (0x80 | (c & 0x3f));
+}
+
+#ifdef MOZC_UTIL_USE_SSE2
+// Converts the five characters in [src, src + 15) to |dst| by |shift|, reading
+// 16 bytes from |src|.  Returns false if some of them are not "E3 xx yy" or
+// the voiced sound mark is found.
+bool ShiftKanaBlock(const KanaShift &shift, const char *src, char *dst) {
+  // The lead, the second and the third bytes of the characters.
+  static const int kLeadMask = 0x1249;
+  static const int kBodyMask = 0x7fff & ~kLeadMask;
+  const __m128i mask2 = _mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0,
+                                      0, -1, 0, 0);
+  const __m128i mask3 = _mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1,
+                                      0, 0, -1, 0);
+
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+  const int lead =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(0xe3 - 0x100)));
+  // The bytes are compared as signed: 0x80-0xbf < 0xc0.
+  const int trailing =
+      _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0xc0 - 0x100)));
+  if ((lead & 0x7fff) != kLeadMask || (trailing & 0x7fff) != kBodyMask) {
+    return false;
+  }
+
+  // The second and the third bytes of the character of each byte.
+  const __m128i prev = _mm_slli_si128(v, 1);
+  const __m128i next = _mm_srli_si128(v, 1);
+  const __m128i c2 = _mm_or_si128(_mm_and_si128(mask2, v),
+                                  _mm_andnot_si128(mask2, prev));
+  const __m128i c3 = _mm_or_si128(_mm_and_si128(mask2, next),
+                                  _mm_andnot_si128(mask2, v));
+  if (shift.voiced_sound_mark != 0) {
+    const __m128i is_mark = _mm_and_si128(
+        _mm_cmpeq_epi8(
+            c2, _mm_set1_epi8(0x80 | ((shift.voiced_sound_mark >> 6) & 0x3f))),
+        _mm_cmpeq_epi8(
+            c3, _mm_set1_epi8(0x80 | (shift.voiced_sound_mark & 0x3f))));
+    if (_mm_movemask_epi8(_mm_and_si128(mask2, is_mark)) != 0) {
+      return false;
+    }
+  }
+
+  // Characters in [first, last] have the second byte of |first| and the third
+  // byte >= that of |first|, or the second byte of |last| and the third byte
+  // <= that of |last|.  Unsigned a <= b iff the saturated a - b is 0.
+  DCHECK_EQ((shift.first >> 6) + 1, shift.last >> 6);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i in_range = _mm_or_si128(
+      _mm_and_si128(
+          _mm_cmpeq_epi8(c2, _mm_set1_epi8(0x80 | ((shift.first >> 6) & 0x3f))),
+          _mm_cmpeq_epi8(
+              _mm_subs_epu8(_mm_set1_epi8(0x80 | (shift.first & 0x3f)), c3),
+              zero)),
+      _mm_and_si128(
+          _mm_cmpeq_epi8(c2, _mm_set1_epi8(0x80 | ((shift.last >> 6) & 0x3f))),
+          _mm_cmpeq_epi8(
+              _mm_subs_epu8(c3, _mm_set1_epi8(0x80 | (shift.last & 0x3f))),
+              zero)));
+
+  // delta = 64 * delta2 + delta3 where 0 <= delta3 < 64.
+  const int delta3 = shift.delta & 0x3f;
+  const int delta2 = (shift.delta - delta3) / 64;
+  const __m128i mask6 = _mm_set1_epi8(0x3f);
+  const __m128i t3 = _mm_add_epi8(_mm_and_si128(c3, mask6),
+                                  _mm_set1_epi8(delta3));
+  // -1 if the third byte overflows to the second byte.
+  const __m128i carry = _mm_cmpgt_epi8(t3, mask6);
+  const __m128i new2 =
+      _mm_sub_epi8(_mm_add_epi8(c2, _mm_set1_epi8(delta2)), carry);
+  const __m128i new3 =
+      _mm_or_si128(_mm_and_si128(t3, mask6), _mm_set1_epi8(0x80 - 0x100));
+  const __m128i shifted = _mm_or_si128(_mm_and_si128(mask2, new2),
+                                       _mm_and_si128(mask3, new3));
+  const __m128i update = _mm_and_si128(in_range, _mm_or_si128(mask2, mask3));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                   _mm_or_si128(_mm_and_si128(update, shifted),
+                                _mm_andnot_si128(update, v)));
+  return true;
+}
+#endif  // MOZC_UTIL_USE_SSE2
+
+// Same as Util::ConvertUsingDoubleArray() with the rule equivalent to
+// |shift|, but processes the kana and ASCII runs without the rule.
+void ConvertKana(const KanaShift &shift,
+                 const japanese_util_rule::DoubleArray *da,
+                 const char *ctable,
+                 StringPiece input,
+                 string *output) {
+  output->clear();
+  output->reserve(input.size());
+  const char *begin = input.data();
+  const char *const end = input.data() + input.size();
+  while (begin < end) {
+#ifdef MOZC_UTIL_USE_SSE2
+    // The voiced sound mark just after the block is also left to the rule.
+    if (end - begin >= 16 &&
+        (shift.voiced_sound_mark == 0 || end - begin < 18 ||
+         !IsKanaSequence(begin + 15, shift.voiced_sound_mark))) {
+      char block[16];
+      if (ShiftKanaBlock(shift, begin, block)) {
+        output->append(block, 15);
+        begin += 15;
+        continue;
+      }
+    }
+#endif  // MOZC_UTIL_USE_SSE2
+    const uint8 c = static_cast<uint8>(*begin);
+    if (c < 0x80) {
+      // No rule for ASCII.
+      const char *ascii_end = SkipAscii(begin, end);
+      output->append(begin, ascii_end - begin);
+      begin = ascii_end;
+      continue;
+    }
+    if (c == 0xe3 && end - begin >= 3 &&
+        IsUTF8TrailingByte(begin[1]) && IsUTF8TrailingByte(begin[2])) {
+      const char32 ucs4 = 0x3000 | ((begin[1] & 0x3f) << 6) |
+                          (begin[2] & 0x3f);
+      if (ucs4 >= shift.first && ucs4 <= shift.last &&
+          (shift.voiced_sound_mark == 0 || end - begin < 6 ||
+           !IsKanaSequence(begin + 3, shift.voiced_sound_mark))) {
+        const char32 shifted = ucs4 + shift.delta;
+        const char buf[3] = {
+          static_cast<char>(0xe3),
+          static_cast<char>(0x80 | ((shifted >> 6) & 0x3f)),
+          static_cast<char>(0x80 | (shifted & 0x3f)),
+        };
+        output->append(buf, sizeof(buf));
+        begin += 3;
+        continue;
+      }
+    }
+    begin = ConvertOneUsingDoubleArray(da, ctable, begin, end, output);
+  }
+}
+
+// Returns the full width character of the ASCII |c| by the rule of
+// halfwidthascii_to_fullwidthascii, or 0 if not found.
+char32 HalfWidthAsciiToFullWidthChar(uint8 c) {
+  switch (c) {
+    case ' ': return 0x3000;   // "　"
+    case '"': return 0x201d;   // "”"
+    case '\'': return 0x2019;  // "’"
+    case '-': return 0x2212;   // "−"
+    case '\\': return 0xffe5;  // "￥"
+    case '~': return 0x301c;   // "〜"
+    default:
+      return (c > ' ' && c < 0x7f) ? c + 0xfee0 : 0;
+  }
+}
+
 }  // namespace
 
 void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
@@ -1106,38 +1411,23 @@ void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
   const char *begin = input.data();
   const char *const end = input.data() + input.size();
   while (begin < end) {
-    int result = 0;
-    int mblen = LookupDoubleArray(da, begin, static_cast<int>(end - begin),
-                                  &result);
-    if (mblen > 0) {
-      const char *p = &ctable[result];
-      const size_t len = strlen(p);
-      output->append(p, len);
-      mblen -= static_cast<int32>(p[len + 1]);
-      begin += mblen;
-    } else {
-      mblen = OneCharLen(begin);
-      output->append(begin, mblen);
-      begin += mblen;
-    }
+    begin = ConvertOneUsingDoubleArray(da, ctable, begin, end, output);
   }
 }
 
 void Util::HiraganaToKatakana(StringPiece input, string *output) {
-  ConvertUsingDoubleArray(japanese_util_rule::hiragana_to_katakana_da,
-                          japanese_util_rule::hiragana_to_katakana_table,
-                          input,
-                          output);
+  ConvertKana(kHiraganaToKatakanaShift,
+              japanese_util_rule::hiragana_to_katakana_da,
+              japanese_util_rule::hiragana_to_katakana_table,
+              input,
+              output);
 }
 
 void Util::HiraganaToHalfwidthKatakana(StringPiece input,
                                        string *output) {
   // combine two rules
   string tmp;
-  ConvertUsingDoubleArray(
-      japanese_util_rule::hiragana_to_katakana_da,
-      japanese_util_rule::hiragana_to_katakana_table,
-      input, &tmp);
+  HiraganaToKatakana(input, &tmp);
   ConvertUsingDoubleArray(
       japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_da,
       japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_table,
@@ -1190,10 +1480,11 @@ void Util::RomanjiToHiragana(StringPiece input, string *output) {
 }
 
 void Util::KatakanaToHiragana(StringPiece input, string *output) {
-  ConvertUsingDoubleArray(japanese_util_rule::katakana_to_hiragana_da,
-                          japanese_util_rule::katakana_to_hiragana_table,
-                          input,
-                          output);
+  ConvertKana(kKatakanaToHiraganaShift,
+              japanese_util_rule::katakana_to_hiragana_da,
+              japanese_util_rule::katakana_to_hiragana_table,
+              input,
+              output);
 }
 
 void Util::HalfWidthKatakanaToFullWidthKatakana(StringPiece input,
@@ -1214,18 +1505,60 @@ void Util::FullWidthKatakanaToHalfWidthKatakana(StringPiece input,
       output);
 }
 
+// FullWidthToHalfWidth() and HalfWidthToFullWidth() are the compositions of
+// the ASCII and the katakana rules, but are done in one pass.  It's the same
+// since the keys of the ASCII rules are single characters, whose values are
+// never the part of the keys of the katakana rules.
+
 void Util::FullWidthToHalfWidth(StringPiece input, string *output) {
-  string tmp;
-  FullWidthAsciiToHalfWidthAscii(input, &tmp);
   output->clear();
-  FullWidthKatakanaToHalfWidthKatakana(tmp, output);
+  output->reserve(input.size());
+  const char *begin = input.data();
+  const char *const end = input.data() + input.size();
+  while (begin < end) {
+    if (static_cast<uint8>(*begin) < 0x80) {
+      // No rule for ASCII.
+      const char *ascii_end = SkipAscii(begin, end);
+      output->append(begin, ascii_end - begin);
+      begin = ascii_end;
+      continue;
+    }
+    const char *next = AppendLongestMatch(
+        japanese_util_rule::fullwidthascii_to_halfwidthascii_da,
+        japanese_util_rule::fullwidthascii_to_halfwidthascii_table,
+        begin, end, output);
+    if (next == begin) {
+      next = ConvertOneUsingDoubleArray(
+          japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_da,
+          japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_table,
+          begin, end, output);
+    }
+    begin = next;
+  }
 }
 
 void Util::HalfWidthToFullWidth(StringPiece input, string *output) {
-  string tmp;
-  HalfWidthAsciiToFullWidthAscii(input, &tmp);
   output->clear();
-  HalfWidthKatakanaToFullWidthKatakana(tmp, output);
+  output->reserve(input.size() * 3);
+  const char *begin = input.data();
+  const char *const end = input.data() + input.size();
+  while (begin < end) {
+    const uint8 c = static_cast<uint8>(*begin);
+    if (c < 0x80) {
+      const char32 full_width = HalfWidthAsciiToFullWidthChar(c);
+      if (full_width != 0) {
+        UCS4ToUTF8Append(full_width, output);
+      } else {
+        output->push_back(*begin);
+      }
+      ++begin;
+      continue;
+    }
+    begin = ConvertOneUsingDoubleArray(
+        japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_da,
+        japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_table,
+        begin, end, output);
+  }
 }
 
 // TODO(tabata): Add another function to split voice mark
@@ -0,0 +1,177 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the throughput of the character form conversions in Util against
+// the conversions by the rules of japanese_util_rule, which they must be the
+// same as.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/japanese_util_rule.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+
+DEFINE_int32(iterations, 100000, "number of iterations over the inputs");
+
+namespace {
+
+using mozc::StringPiece;
+using mozc::Util;
+namespace rule = mozc::japanese_util_rule;
+
+// Typical inputs: readings, their katakana forms and the mixed ones.
+const char *kInputs[] = {
+  // "きょうはいいてんきですね"
+  "\xe3\x81\x8d\xe3\x82\x87\xe3\x81\x86\xe3\x81\xaf\xe3\x81\x84\xe3\x81\x84"
+  "\xe3\x81\xa6\xe3\x82\x93\xe3\x81\x8d\xe3\x81\xa7\xe3\x81\x99\xe3\x81\xad",
+  // "わたしのなまえはなかのです"
+  "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3\x81\xbe"
+  "\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81\xae\xe3\x81\xa7"
+  "\xe3\x81\x99",
+  // "インターネットグーグル"
+  "\xe3\x82\xa4\xe3\x83\xb3\xe3\x82\xbf\xe3\x83\xbc\xe3\x83\x8d\xe3\x83\x83"
+  "\xe3\x83\x88\xe3\x82\xb0\xe3\x83\xbc\xe3\x82\xb0\xe3\x83\xab",
+  // "mozcをつかう"
+  "mozc\xe3\x82\x92\xe3\x81\xa4\xe3\x81\x8b\xe3\x81\x86",
+  // "あ"
+  "\xe3\x81\x82",
+  "google",
+};
+
+typedef void (*ConvertFunction)(StringPiece, string *);
+
+void HiraganaToKatakanaByRule(StringPiece input, string *output) {
+  Util::ConvertUsingDoubleArray(rule::hiragana_to_katakana_da,
+                                rule::hiragana_to_katakana_table,
+                                input, output);
+}
+
+void KatakanaToHiraganaByRule(StringPiece input, string *output) {
+  Util::ConvertUsingDoubleArray(rule::katakana_to_hiragana_da,
+                                rule::katakana_to_hiragana_table,
+                                input, output);
+}
+
+void FullWidthToHalfWidthByRule(StringPiece input, string *output) {
+  string tmp;
+  Util::FullWidthAsciiToHalfWidthAscii(input, &tmp);
+  Util::FullWidthKatakanaToHalfWidthKatakana(tmp, output);
+}
+
+void HalfWidthToFullWidthByRule(StringPiece input, string *output) {
+  string tmp;
+  Util::HalfWidthAsciiToFullWidthAscii(input, &tmp);
+  Util::HalfWidthKatakanaToFullWidthKatakana(tmp, output);
+}
+
+void CharsLenByOneCharLen(StringPiece input, string *output) {
+  size_t result = 0;
+  for (const char *begin = input.begin(); begin < input.end();
+       begin += Util::OneCharLen(begin)) {
+    ++result;
+  }
+  output->assign(result, ' ');
+}
+
+void CharsLen(StringPiece input, string *output) {
+  output->assign(Util::CharsLen(input), ' ');
+}
+
+// Returns the throughput in MB/sec.
+double Run(const vector<string> &inputs, ConvertFunction function) {
+  string output;
+  size_t bytes = 0;
+  mozc::Stopwatch stopwatch;
+  stopwatch.Start();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    for (size_t j = 0; j < inputs.size(); ++j) {
+      function(inputs[j], &output);
+      bytes += inputs[j].size();
+    }
+  }
+  stopwatch.Stop();
+  return static_cast<double>(bytes) / stopwatch.GetElapsedMicroseconds();
+}
+
+void Compare(const char *name, const vector<string> &inputs,
+             ConvertFunction by_rule, ConvertFunction function) {
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    string expected, actual;
+    by_rule(inputs[i], &expected);
+    function(inputs[i], &actual);
+    if (expected != actual) {
+      std::cout << name << ": different output for " << inputs[i]
+                << std::endl;
+      return;
+    }
+  }
+  const double base = Run(inputs, by_rule);
+  const double fast = Run(inputs, function);
+  std::cout << name << ": " << base << " MB/s -> " << fast << " MB/s ("
+            << fast / base << "x)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  vector<string> hiragana(kInputs, kInputs + arraysize(kInputs));
+  // A sentence long enough for the vectorized paths.
+  hiragana.push_back(hiragana[0] + hiragana[1]);
+  vector<string> katakana, full_width, half_width;
+  for (size_t i = 0; i < hiragana.size(); ++i) {
+    string output;
+    Util::HiraganaToKatakana(hiragana[i], &output);
+    katakana.push_back(output);
+    Util::FullWidthToHalfWidth(katakana[i], &output);
+    half_width.push_back(output);
+    Util::HalfWidthToFullWidth(half_width[i], &output);
+    full_width.push_back(output);
+  }
+
+  Compare("HiraganaToKatakana", hiragana,
+          HiraganaToKatakanaByRule, Util::HiraganaToKatakana);
+  Compare("KatakanaToHiragana", katakana,
+          KatakanaToHiraganaByRule, Util::KatakanaToHiragana);
+  Compare("FullWidthToHalfWidth", full_width,
+          FullWidthToHalfWidthByRule, Util::FullWidthToHalfWidth);
+  Compare("HalfWidthToFullWidth", half_width,
+          HalfWidthToFullWidthByRule, Util::HalfWidthToFullWidth);
+  Compare("CharsLen", hiragana, CharsLenByOneCharLen, CharsLen);
+
+  return 0;
+}
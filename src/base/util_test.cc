@@ -35,10 +35,12 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "base/compiler_specific.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/japanese_util_rule.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "testing/base/public/gunit.h"
@@ -1423,6 +1425,106 @@ TEST(UtilTest, FullWidthAndHalfWidth) {
   CHECK_EQ("\x20\xe3\x80\x80", output);
 }
 
+namespace {
+
+// The reference implementations by the rules, which the fast paths must
+// produce the same outputs as.
+void HiraganaToKatakanaByRule(StringPiece input, string *output) {
+  Util::ConvertUsingDoubleArray(japanese_util_rule::hiragana_to_katakana_da,
+                                japanese_util_rule::hiragana_to_katakana_table,
+                                input, output);
+}
+
+void KatakanaToHiraganaByRule(StringPiece input, string *output) {
+  Util::ConvertUsingDoubleArray(japanese_util_rule::katakana_to_hiragana_da,
+                                japanese_util_rule::katakana_to_hiragana_table,
+                                input, output);
+}
+
+void FullWidthToHalfWidthByRule(StringPiece input, string *output) {
+  string tmp;
+  Util::FullWidthAsciiToHalfWidthAscii(input, &tmp);
+  Util::FullWidthKatakanaToHalfWidthKatakana(tmp, output);
+}
+
+void HalfWidthToFullWidthByRule(StringPiece input, string *output) {
+  string tmp;
+  Util::HalfWidthAsciiToFullWidthAscii(input, &tmp);
+  Util::HalfWidthKatakanaToFullWidthKatakana(tmp, output);
+}
+
+size_t CharsLenByOneCharLen(StringPiece input) {
+  size_t result = 0;
+  for (const char *begin = input.begin(); begin < input.end();
+       begin += Util::OneCharLen(begin)) {
+    ++result;
+  }
+  return result;
+}
+
+void ExpectSameAsRules(const string &input) {
+  string expected, actual;
+  HiraganaToKatakanaByRule(input, &expected);
+  Util::HiraganaToKatakana(input, &actual);
+  EXPECT_EQ(expected, actual) << input;
+  KatakanaToHiraganaByRule(input, &expected);
+  Util::KatakanaToHiragana(input, &actual);
+  EXPECT_EQ(expected, actual) << input;
+  FullWidthToHalfWidthByRule(input, &expected);
+  Util::FullWidthToHalfWidth(input, &actual);
+  EXPECT_EQ(expected, actual) << input;
+  HalfWidthToFullWidthByRule(input, &expected);
+  Util::HalfWidthToFullWidth(input, &actual);
+  EXPECT_EQ(expected, actual) << input;
+  EXPECT_EQ(CharsLenByOneCharLen(input), Util::CharsLen(input)) << input;
+}
+
+}  // namespace
+
+TEST(UtilTest, KanaAndWidthConversionsAreSameAsRules) {
+  // Every single character around the rules.
+  for (char32 c = 0; c < 0x10000; ++c) {
+    string input;
+    Util::UCS4ToUTF8(c, &input);
+    ExpectSameAsRules(input);
+    // Followed by the voiced sound marks.
+    ExpectSameAsRules(input + "\xe3\x82\x9b");  // "゛"
+    ExpectSameAsRules(input + "\xef\xbe\x9e");  // "ﾞ"
+  }
+
+  // Random strings, which are long enough for the vectorized paths.
+  vector<char32> chars;
+  for (char32 c = 0x3040; c < 0x3100; ++c) {  // Hiragana and katakana.
+    chars.push_back(c);
+  }
+  const size_t num_kana = chars.size();
+  for (char32 c = 0xff61; c < 0xffa0; ++c) {  // Half-width katakana.
+    chars.push_back(c);
+  }
+  for (char32 c = 0x20; c < 0x7f; ++c) {
+    chars.push_back(c);
+  }
+  chars.push_back(0x3000);   // "　"
+  chars.push_back(0x4e2d);   // "中"
+  chars.push_back(0xff21);   // "Ａ"
+  chars.push_back(0x1f600);  // 4-byte character.
+  Util::SetRandomSeed(0);
+  for (int i = 0; i < 3000; ++i) {
+    string input;
+    const int size = Util::Random(120);
+    // Only kana for every three strings.
+    const int num_chars = (i % 3 == 1) ? num_kana : chars.size();
+    for (int j = 0; j < size; ++j) {
+      Util::UCS4ToUTF8Append(chars[Util::Random(num_chars)], &input);
+    }
+    if (i % 3 == 0 && !input.empty()) {
+      // Broken UTF-8.
+      input[Util::Random(input.size())] = static_cast<char>(Util::Random(256));
+    }
+    ExpectSameAsRules(input);
+  }
+}
+
 TEST(UtilTest, BracketTest) {
   static const struct BracketType {
     const char *open_bracket;
@@ -2191,6 +2293,22 @@ TEST(UtilTest, RandomSeedTest) {
   EXPECT_EQ(first_try, Util::Random(INT_MAX));
 }
 
+TEST(UtilTest, SplitFirstChar32ThreeBytes) {
+  for (char32 c = 0x800; c < 0x10000; ++c) {
+    string input;
+    Util::UCS4ToUTF8(c, &input);
+    input.append(" ");
+    StringPiece rest;
+    char32 actual = 0;
+    EXPECT_TRUE(Util::SplitFirstChar32(input, &actual, &rest));
+    EXPECT_EQ(c, actual);
+    EXPECT_EQ(" ", rest);
+  }
+  EXPECT_FALSE(Util::SplitFirstChar32("\xE3\x81", NULL, NULL));
+  EXPECT_FALSE(Util::SplitFirstChar32("\xE3\x81\x41", NULL, NULL));
+  EXPECT_FALSE(Util::SplitFirstChar32("\xE0\x9F\xBF", NULL, NULL));
+}
+
 TEST(UtilTest, SplitFirstChar32) {
   StringPiece rest;
   char32 c = 0;
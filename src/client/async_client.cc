@@ -0,0 +1,203 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/async_client.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "base/logging.h"
+#include "base/thread_pool.h"
+#include "client/client_interface.h"
+
+namespace mozc {
+namespace client {
+
+struct AsyncClient::AsyncCall::State {
+  State(uint64 sequence_number, bool run_on_wait)
+      : sequence_number(sequence_number),
+        run_on_wait(run_on_wait),
+        cancelled(false),
+        status(PENDING) {}
+
+  const uint64 sequence_number;
+  // True if the request is sent only when it is waited for.
+  const bool run_on_wait;
+  std::atomic<bool> cancelled;
+  TaskHandle handle;
+
+  std::mutex mutex;
+  std::condition_variable done;
+  // Guarded by |mutex|.
+  Status status;
+  commands::Output output;
+};
+
+AsyncClient::AsyncCall::AsyncCall() {}
+
+AsyncClient::AsyncCall::~AsyncCall() {}
+
+uint64 AsyncClient::AsyncCall::sequence_number() const {
+  return state_ ? state_->sequence_number : 0;
+}
+
+AsyncClient::Status AsyncClient::AsyncCall::status() const {
+  if (!state_) {
+    return CANCELLED;
+  }
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->status;
+}
+
+AsyncClient::Status AsyncClient::AsyncCall::Wait(
+    commands::Output *output) const {
+  if (!state_) {
+    return CANCELLED;
+  }
+  state_->handle.Wait();
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->done.wait(lock, [this]() { return state_->status != PENDING; });
+  if (output != nullptr) {
+    output->CopyFrom(state_->output);
+  }
+  return state_->status;
+}
+
+AsyncClient::Status AsyncClient::AsyncCall::WaitWithTimeout(
+    int timeout_msec, commands::Output *output) const {
+  if (!state_) {
+    return CANCELLED;
+  }
+  if (state_->run_on_wait) {
+    // Nobody else sends the request.
+    return Wait(output);
+  }
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  if (!state_->done.wait_for(
+          lock, std::chrono::milliseconds(timeout_msec),
+          [this]() { return state_->status != PENDING; })) {
+    return PENDING;
+  }
+  if (output != nullptr) {
+    output->CopyFrom(state_->output);
+  }
+  return state_->status;
+}
+
+void AsyncClient::AsyncCall::Cancel() {
+  if (state_) {
+    state_->cancelled = true;
+  }
+}
+
+AsyncClient::AsyncClient(ClientInterface *client)
+    : AsyncClient(client, true) {}
+
+AsyncClient::AsyncClient(ClientInterface *client, bool use_worker_thread)
+    : client_(client),
+      // A single worker keeps the requests in the order they are issued.
+      pool_(new ThreadPool(use_worker_thread ? 1 : 0, "AsyncClient")),
+      last_sequence_number_(0),
+      latest_sequence_number_(0) {
+  DCHECK(client_);
+}
+
+AsyncClient::~AsyncClient() {
+  WaitForAllRequests();
+}
+
+AsyncClient::AsyncCall AsyncClient::SendKeyAsync(
+    const commands::KeyEvent &key, const commands::Context &context) {
+  return Issue([key, context](ClientInterface *client,
+                              commands::Output *output) {
+    return client->SendKeyWithContext(key, context, output);
+  }, true);
+}
+
+AsyncClient::AsyncCall AsyncClient::TestSendKeyAsync(
+    const commands::KeyEvent &key, const commands::Context &context) {
+  return Issue([key, context](ClientInterface *client,
+                              commands::Output *output) {
+    return client->TestSendKeyWithContext(key, context, output);
+  }, false);
+}
+
+AsyncClient::AsyncCall AsyncClient::SendCommandAsync(
+    const commands::SessionCommand &command,
+    const commands::Context &context) {
+  return Issue([command, context](ClientInterface *client,
+                                  commands::Output *output) {
+    return client->SendCommandWithContext(command, context, output);
+  }, true);
+}
+
+void AsyncClient::WaitForAllRequests() {
+  // The requests finish in the order they are issued.
+  last_call_.Wait(nullptr);
+}
+
+AsyncClient::AsyncCall AsyncClient::Issue(const Request &request,
+                                          bool changes_state) {
+  const uint64 sequence_number = ++last_sequence_number_;
+  if (changes_state) {
+    latest_sequence_number_ = sequence_number;
+  }
+
+  AsyncCall call;
+  call.state_.reset(
+      new AsyncCall::State(sequence_number, pool_->num_threads() == 0));
+  std::shared_ptr<AsyncCall::State> state = call.state_;
+  state->handle = pool_->Submit([this, request, changes_state, state]() {
+    Status status = CANCELLED;
+    commands::Output output;
+    if (!changes_state && state->cancelled) {
+      // Nothing depends on the dropped request.
+    } else {
+      uint64 latest = latest_sequence_number_;
+      if (state->cancelled) {
+        // Makes the request obsolete.
+        latest = std::max(latest, state->sequence_number + 1);
+      }
+      client_->SetSequenceNumber(state->sequence_number, latest);
+      status = request(client_.get(), &output) ? SUCCEEDED : FAILED;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->status = status;
+    state->output.Swap(&output);
+    state->done.notify_all();
+  });
+  last_call_ = call;
+  return call;
+}
+
+}  // namespace client
+}  // namespace mozc
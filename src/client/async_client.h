@@ -0,0 +1,153 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// AsyncClient sends requests of a ClientInterface on a background thread so
+// that the front-end thread is not blocked while the server converts.
+//
+// Requests are sent one by one in the order they are issued.  Every request
+// gets a sequence number, and also carries the sequence number of the latest
+// key event or command issued so far.  The server uses them to skip the
+// suggestion for a request whose output is already obsolete, e.g. while the
+// user types faster than the server converts.
+//
+// usage:
+//   AsyncClient async_client(new Client);
+//   AsyncClient::AsyncCall call = async_client.SendKeyAsync(key, context);
+//   ...
+//   commands::Output output;
+//   if (call.WaitWithTimeout(100, &output) == AsyncClient::SUCCEEDED) {
+//     Render(output);
+//   }
+
+#ifndef MOZC_CLIENT_ASYNC_CLIENT_H_
+#define MOZC_CLIENT_ASYNC_CLIENT_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "base/port.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+
+class ThreadPool;
+
+namespace client {
+
+class ClientInterface;
+
+class AsyncClient {
+ public:
+  enum Status {
+    PENDING,    // Not sent yet or waiting for the server.
+    SUCCEEDED,
+    FAILED,     // The underlying client returned false.
+    CANCELLED,  // Cancelled before it was sent.
+  };
+
+  // Handle of an issued request.  Handles are cheap to copy and all copies
+  // refer to the same request.
+  class AsyncCall {
+   public:
+    AsyncCall();
+    ~AsyncCall();
+
+    uint64 sequence_number() const;
+    Status status() const;
+
+    // Blocks until the request finishes and copies its output to |output|
+    // unless it is NULL.
+    Status Wait(commands::Output *output) const;
+
+    // Same as Wait() but gives up after |timeout_msec| milliseconds, in which
+    // case PENDING is returned and |output| is not modified.
+    Status WaitWithTimeout(int timeout_msec, commands::Output *output) const;
+
+    // Tells that the caller is not interested in the output anymore.  A
+    // TestSendKey request which has not been sent yet is dropped.  Since key
+    // events and commands change the state of the session, they are still
+    // sent, but as obsolete requests so that the server skips the suggestion.
+    void Cancel();
+
+   private:
+    friend class AsyncClient;
+    struct State;
+
+    std::shared_ptr<State> state_;
+  };
+
+  // Takes the ownership of |client|.
+  explicit AsyncClient(ClientInterface *client);
+
+  // Same as above but, if |use_worker_thread| is false, requests are not sent
+  // until one of them is waited for, and then they are sent on the waiting
+  // thread.  Useful for deterministic tests.
+  AsyncClient(ClientInterface *client, bool use_worker_thread);
+
+  // Waits for all the requests issued.
+  ~AsyncClient();
+
+  AsyncCall SendKeyAsync(const commands::KeyEvent &key,
+                         const commands::Context &context);
+  AsyncCall TestSendKeyAsync(const commands::KeyEvent &key,
+                             const commands::Context &context);
+  AsyncCall SendCommandAsync(const commands::SessionCommand &command,
+                             const commands::Context &context);
+
+  // Blocks until all the requests issued so far finish.
+  void WaitForAllRequests();
+
+  // Returns the underlying client.  It must not be used directly while any
+  // request is pending, as ClientInterface is not thread-safe.
+  ClientInterface *client() { return client_.get(); }
+
+ private:
+  typedef std::function<bool(ClientInterface *client,
+                             commands::Output *output)> Request;
+
+  // |changes_state| is true for the requests which change the state of the
+  // session and hence make the outputs of the older requests obsolete.
+  AsyncCall Issue(const Request &request, bool changes_state);
+
+  std::unique_ptr<ClientInterface> client_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::atomic<uint64> last_sequence_number_;
+  // Sequence number of the latest request which changes the state.
+  std::atomic<uint64> latest_sequence_number_;
+  AsyncCall last_call_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncClient);
+};
+
+}  // namespace client
+}  // namespace mozc
+
+#endif  // MOZC_CLIENT_ASYNC_CLIENT_H_
@@ -0,0 +1,163 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "client/async_client.h"
+
+#include "client/client_mock.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace client {
+namespace {
+
+commands::KeyEvent MakeKeyEvent(char key_code) {
+  commands::KeyEvent key;
+  key.set_key_code(key_code);
+  return key;
+}
+
+class AsyncClientTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    client_mock_ = new ClientMock;
+    client_mock_->SetBoolFunctionReturn("SendKeyWithContext", true);
+    client_mock_->SetBoolFunctionReturn("TestSendKeyWithContext", true);
+    client_mock_->SetBoolFunctionReturn("SendCommandWithContext", true);
+    async_client_.reset(new AsyncClient(client_mock_, false));
+  }
+
+  ClientMock *client_mock_;
+  std::unique_ptr<AsyncClient> async_client_;
+  commands::Context context_;
+};
+
+TEST_F(AsyncClientTest, RequestsAreSentInOrder) {
+  commands::Output output;
+  output.set_consumed(true);
+  client_mock_->set_output_SendKeyWithContext(output);
+
+  AsyncClient::AsyncCall call1 =
+      async_client_->SendKeyAsync(MakeKeyEvent('a'), context_);
+  AsyncClient::AsyncCall call2 =
+      async_client_->SendKeyAsync(MakeKeyEvent('b'), context_);
+  AsyncClient::AsyncCall call3 =
+      async_client_->SendKeyAsync(MakeKeyEvent('c'), context_);
+  EXPECT_EQ(1, call1.sequence_number());
+  EXPECT_EQ(2, call2.sequence_number());
+  EXPECT_EQ(3, call3.sequence_number());
+  EXPECT_EQ(AsyncClient::PENDING, call1.status());
+  EXPECT_EQ(0, client_mock_->GetFunctionCallCount("SendKeyWithContext"));
+
+  // The first request is obsolete as the third one is already issued.
+  output.Clear();
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call1.Wait(&output));
+  EXPECT_TRUE(output.consumed());
+  EXPECT_EQ(1, client_mock_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ('a', client_mock_->called_SendKeyWithContext().key_code());
+  EXPECT_EQ(1, client_mock_->sequence_number());
+  EXPECT_EQ(3, client_mock_->latest_sequence_number());
+  EXPECT_EQ(AsyncClient::PENDING, call3.status());
+
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call3.Wait(nullptr));
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call2.status());
+  EXPECT_EQ(3, client_mock_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ('c', client_mock_->called_SendKeyWithContext().key_code());
+  EXPECT_EQ(3, client_mock_->sequence_number());
+  EXPECT_EQ(3, client_mock_->latest_sequence_number());
+}
+
+TEST_F(AsyncClientTest, TestSendKeyDoesNotObsoleteOtherRequests) {
+  AsyncClient::AsyncCall call1 =
+      async_client_->SendKeyAsync(MakeKeyEvent('a'), context_);
+  AsyncClient::AsyncCall call2 =
+      async_client_->TestSendKeyAsync(MakeKeyEvent('b'), context_);
+  async_client_->WaitForAllRequests();
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call1.status());
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call2.status());
+  EXPECT_EQ(1, client_mock_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ(1, client_mock_->GetFunctionCallCount("TestSendKeyWithContext"));
+  EXPECT_EQ(2, client_mock_->sequence_number());
+  EXPECT_EQ(1, client_mock_->latest_sequence_number());
+}
+
+TEST_F(AsyncClientTest, CancelledTestSendKeyIsDropped) {
+  AsyncClient::AsyncCall call =
+      async_client_->TestSendKeyAsync(MakeKeyEvent('a'), context_);
+  call.Cancel();
+  EXPECT_EQ(AsyncClient::CANCELLED, call.Wait(nullptr));
+  EXPECT_EQ(0, client_mock_->GetFunctionCallCount("TestSendKeyWithContext"));
+}
+
+TEST_F(AsyncClientTest, CancelledSendKeyIsSentAsObsolete) {
+  AsyncClient::AsyncCall call =
+      async_client_->SendKeyAsync(MakeKeyEvent('a'), context_);
+  call.Cancel();
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call.Wait(nullptr));
+  EXPECT_EQ(1, client_mock_->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ(1, client_mock_->sequence_number());
+  EXPECT_EQ(2, client_mock_->latest_sequence_number());
+
+  commands::SessionCommand command;
+  command.set_type(commands::SessionCommand::SUBMIT);
+  call = async_client_->SendCommandAsync(command, context_);
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call.Wait(nullptr));
+  EXPECT_EQ(commands::SessionCommand::SUBMIT,
+            client_mock_->called_SendCommandWithContext().type());
+  EXPECT_EQ(2, client_mock_->sequence_number());
+  EXPECT_EQ(2, client_mock_->latest_sequence_number());
+}
+
+TEST_F(AsyncClientTest, FailedRequest) {
+  client_mock_->SetBoolFunctionReturn("SendKeyWithContext", false);
+  AsyncClient::AsyncCall call =
+      async_client_->SendKeyAsync(MakeKeyEvent('a'), context_);
+  EXPECT_EQ(AsyncClient::FAILED, call.WaitWithTimeout(100, nullptr));
+}
+
+TEST(AsyncClientThreadTest, WaitForRequestsOnWorkerThread) {
+  ClientMock *client_mock = new ClientMock;
+  client_mock->SetBoolFunctionReturn("SendKeyWithContext", true);
+  AsyncClient async_client(client_mock);
+  commands::Context context;
+  AsyncClient::AsyncCall call;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    call = async_client.SendKeyAsync(MakeKeyEvent(c), context);
+  }
+  EXPECT_EQ(AsyncClient::SUCCEEDED, call.WaitWithTimeout(10000, nullptr));
+  EXPECT_EQ(26, client_mock->GetFunctionCallCount("SendKeyWithContext"));
+  EXPECT_EQ('z', client_mock->called_SendKeyWithContext().key_code());
+  EXPECT_EQ(26, client_mock->sequence_number());
+  EXPECT_EQ(26, client_mock->latest_sequence_number());
+}
+
+}  // namespace
+}  // namespace client
+}  // namespace mozc
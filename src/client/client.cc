@@ -93,7 +93,9 @@ Client::Client()
       server_status_(SERVER_UNKNOWN),
       server_protocol_version_(0),
       server_process_id_(0),
-      last_mode_(commands::DIRECT) {
+      last_mode_(commands::DIRECT),
+      sequence_number_(0),
+      latest_sequence_number_(0) {
   client_factory_ = IPCClientFactory::GetIPCClientFactory();
 }
 
@@ -243,6 +245,9 @@ void Client::PushHistory(const commands::Input &input,
   // reaches to the maximum size. This prevents DOS attack.
   if (history_inputs_.size() < kMaxPlayBackSize) {
     history_inputs_.push_back(input);
+    // The acknowledged output is meaningless for the session restored by
+    // the playback.
+    history_inputs_.back().clear_acknowledged_output_revision();
   }
 
   // found context boundary.
@@ -390,6 +395,11 @@ bool Client::EnsureCallCommand(commands::Input *input,
     }
   }
 
+  if (!output_delta_decoder_.Decode(output)) {
+    // The omitted fields are lost, but the next output is sent in full.
+    LOG(ERROR) << "Failed to restore the delta-encoded output";
+  }
+
   PushHistory(*input, *output);
   return true;
 }
@@ -417,12 +427,19 @@ void Client::set_suppress_error_dialog(bool suppress) {
   server_launcher_->set_suppress_error_dialog(suppress);
 }
 
+void Client::SetSequenceNumber(uint64 sequence_number,
+                               uint64 latest_sequence_number) {
+  sequence_number_ = sequence_number;
+  latest_sequence_number_ = latest_sequence_number;
+}
+
 void Client::set_client_capability(const commands::Capability &capability) {
   client_capability_.CopyFrom(capability);
 }
 
 bool Client::CreateSession() {
   id_ = 0;
+  output_delta_decoder_.Reset();
   commands::Input input;
   input.set_type(commands::Input::CREATE_SESSION);
 
@@ -724,6 +741,13 @@ void Client::InitInput(commands::Input *input) const {
   if (preferences_.get() != NULL) {
     input->mutable_config()->CopyFrom(*preferences_);
   }
+  if (client_capability_.delta_output()) {
+    input->set_acknowledged_output_revision(output_delta_decoder_.revision());
+  }
+  if (sequence_number_ != 0) {
+    input->set_sequence_number(sequence_number_);
+    input->set_latest_sequence_number(latest_sequence_number_);
+  }
 }
 
 bool Client::CheckVersionOrRestartServerInternal(
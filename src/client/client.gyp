@@ -37,6 +37,7 @@
       'target_name': 'client',
       'type': 'static_library',
       'sources': [
+        'async_client.cc',
         'client.cc',
         'server_launcher.cc',
       ],
@@ -45,6 +46,7 @@
         '../ipc/ipc.gyp:ipc',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../session/session_base.gyp:output_delta',
       ],
     },
     {
@@ -39,6 +39,7 @@
 #include "base/port.h"
 #include "client/client_interface.h"
 #include "protocol/commands.pb.h"
+#include "session/output_delta.h"
 #include "testing/base/public/gunit_prod.h"
 // for FRIEND_TEST()
 
@@ -145,6 +146,8 @@ class Client : public ClientInterface {
   void set_server_program(const string &server_program);
   void set_suppress_error_dialog(bool suppress);
   void set_client_capability(const commands::Capability &capability);
+  void SetSequenceNumber(uint64 sequence_number,
+                         uint64 latest_sequence_number);
 
   bool LaunchTool(const string &mode, const string &arg);
   bool LaunchToolWithProtoBuf(const commands::Output &output);
@@ -255,6 +258,12 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // Sequence numbers set to the inputs.  Not set if |sequence_number_| is 0.
+  uint64 sequence_number_;
+  uint64 latest_sequence_number_;
+  // Restores the outputs delta-encoded by the server when
+  // client_capability_ has delta_output.
+  OutputDeltaDecoder output_delta_decoder_;
 };
 
 }  // namespace client
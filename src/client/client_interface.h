@@ -220,6 +220,12 @@ class ClientInterface {
   virtual void set_client_capability(const commands::Capability &capability)
       = 0;
 
+  // Sets the sequence numbers attached to the following requests.  The server
+  // skips the suggestion for a request whose |sequence_number| is smaller
+  // than |latest_sequence_number|.  See commands::Input for details.
+  virtual void SetSequenceNumber(uint64 sequence_number,
+                                 uint64 latest_sequence_number) = 0;
+
   // Launches mozc tool. |mode| is the mode of MozcTool,
   // e,g,. "config_dialog", "dictionary_tool".
   virtual bool LaunchTool(const string &mode,
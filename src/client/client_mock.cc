@@ -148,6 +148,14 @@ bool ClientMock::SetConfig(const config::Config &config) {
   return false;
 }
 
+// SetSequenceNumber needs to store the numbers.
+void ClientMock::SetSequenceNumber(uint64 sequence_number,
+                                   uint64 latest_sequence_number) {
+  function_counter_["SetSequenceNumber"]++;
+  sequence_number_ = sequence_number;
+  latest_sequence_number_ = latest_sequence_number;
+}
+
 // LaunchTool arguments are quite different from other methods.
 bool ClientMock::LaunchTool(const string &mode, const string &extra_arg) {
   function_counter_["LaunchTool"]++;
@@ -40,6 +40,8 @@ namespace client {
 
 class ClientMock : public client::ClientInterface {
  public:
+  ClientMock() : sequence_number_(0), latest_sequence_number_(0) {}
+
   void SetIPCClientFactory(IPCClientFactoryInterface *client_factory);
   void SetServerLauncher(ServerLauncherInterface *server_launcher);
   bool IsValidRunLevel() const;
@@ -73,6 +75,8 @@ class ClientMock : public client::ClientInterface {
   virtual void set_server_program(const string &program_path);
   virtual void set_suppress_error_dialog(bool suppress);
   virtual void set_client_capability(const commands::Capability &capability);
+  virtual void SetSequenceNumber(uint64 sequence_number,
+                                 uint64 latest_sequence_number);
   bool LaunchTool(const string &mode, const string &extra_arg);
   bool LaunchToolWithProtoBuf(const commands::Output &output);
   bool OpenBrowser(const string &url);
@@ -81,6 +85,9 @@ class ClientMock : public client::ClientInterface {
   void SetBoolFunctionReturn(string func_name, bool value);
   int GetFunctionCallCount(string key);
 
+  uint64 sequence_number() const { return sequence_number_; }
+  uint64 latest_sequence_number() const { return latest_sequence_number_; }
+
 #define TEST_METHODS(method_name, arg_type)                             \
  private:                                                               \
   arg_type called_##method_name##_;                                     \
@@ -106,6 +113,9 @@ class ClientMock : public client::ClientInterface {
   map<string, commands::Output> outputs_;
 
   config::Config called_config_;
+
+  uint64 sequence_number_;
+  uint64 latest_sequence_number_;
 };
 }  // namespace client
 }  // namespace mozc
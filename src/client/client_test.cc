@@ -300,6 +300,31 @@ TEST_F(ClientTest, SendKeyWithContext) {
   EXPECT_EQ(kSuppressSuggestion, input.context().suppress_suggestion());
 }
 
+TEST_F(ClientTest, SendKeyWithSequenceNumber) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::KeyEvent key_event;
+  key_event.set_key_code('a');
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  SetMockOutput(mock_output);
+
+  commands::Output output;
+  commands::Input input;
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  GetGeneratedInput(&input);
+  EXPECT_FALSE(input.has_sequence_number());
+  EXPECT_FALSE(input.has_latest_sequence_number());
+
+  client_->SetSequenceNumber(3, 5);
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  GetGeneratedInput(&input);
+  EXPECT_EQ(3, input.sequence_number());
+  EXPECT_EQ(5, input.latest_sequence_number());
+}
+
 TEST_F(ClientTest, TestSendKey) {
   const int mock_id = 512;
   EXPECT_TRUE(SetupConnection(mock_id));
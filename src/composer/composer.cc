@@ -226,6 +226,10 @@ void Composer::Reset() {
   typing_corrector_.Reset();
 }
 
+void Composer::ReleaseUnusedMemory() {
+  composition_->ReleaseUnusedMemory();
+}
+
 void Composer::ResetInputMode() {
   SetInputMode(comeback_input_mode_);
 }
@@ -72,6 +72,10 @@ class Composer {
   // Reset all composing data except table.
   void Reset();
 
+  // Releases the memory kept for the later inputs if the composition is
+  // empty, e.g., while the session is idle.
+  void ReleaseUnusedMemory();
+
   // Reset input mode.  When the current input mode is
   // HalfAlphanumeric by pressing shifted alphabet, this function
   // revert the input mode from HalfAlphanumeric to the previous input
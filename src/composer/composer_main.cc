@@ -27,12 +27,17 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cstdlib>
 #include <iostream>  // NOLINT
 #include <memory>
+#include <new>
 #include <string>
+#include <vector>
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
 #include "composer/composer.h"
 #include "composer/composition_interface.h"
 #include "composer/table.h"
@@ -42,15 +47,116 @@
 
 DEFINE_string(table, "system://romanji-hiragana.tsv",
               "preedit conversion table file.");
+DEFINE_int32(benchmark_length, 0,
+             "If positive, types a romaji sequence of this many keys instead "
+             "of reading commands from stdin, and reports the time and the "
+             "number of allocations per keystroke.");
+DEFINE_int32(benchmark_iterations, 10, "number of runs for the benchmark.");
+DEFINE_string(benchmark_keys, "kyounotenkihaharedesu",
+              "UTF-8 characters typed repeatedly by the benchmark.");
+DEFINE_bool(compile_table, true,
+            "If true, compiles the table into a flat automaton.");
 
 using ::mozc::commands::Request;
 using ::mozc::config::Config;
 
+namespace {
+
+// Number of calls of operator new, counted for the benchmark.
+size_t g_num_allocations = 0;
+
+struct BenchmarkResult {
+  BenchmarkResult() : usec(0), allocations(0) {}
+  double usec;
+  size_t allocations;
+};
+
+// Types |length| keys and measures InsertCharacter(), GetPreedit() and
+// CopyFrom() to a temporary composer after each key, as the session does to
+// keep the composer for undo or to evaluate a key with another input mode.
+void RunBenchmark(const mozc::composer::Table &table, int length) {
+  vector<string> keys;
+  mozc::Util::SplitStringToUtf8Chars(FLAGS_benchmark_keys, &keys);
+  if (keys.empty()) {
+    return;
+  }
+  const char *kNames[] = {"InsertCharacter", "GetPreedit", "CopyFrom"};
+  BenchmarkResult results[arraysize(kNames)];
+
+  for (int iteration = 0; iteration < FLAGS_benchmark_iterations;
+       ++iteration) {
+    mozc::composer::Composer composer(&table, &Request::default_instance(),
+                                      &Config::default_instance());
+    string left, focused, right;
+    for (int i = 0; i < length; ++i) {
+      const string &key = keys[i % keys.size()];
+      for (size_t step = 0; step < arraysize(kNames); ++step) {
+        const size_t allocations = g_num_allocations;
+        mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+        switch (step) {
+          case 0:
+            composer.InsertCharacter(key);
+            break;
+          case 1:
+            composer.GetPreedit(&left, &focused, &right);
+            break;
+          case 2: {
+            mozc::composer::Composer copy(&table, &Request::default_instance(),
+                                          &Config::default_instance());
+            copy.CopyFrom(composer);
+            break;
+          }
+        }
+        stopwatch.Stop();
+        results[step].usec += stopwatch.GetElapsedMicroseconds();
+        results[step].allocations += g_num_allocations - allocations;
+      }
+    }
+  }
+
+  const double num_keys =
+      static_cast<double>(length) * FLAGS_benchmark_iterations;
+  std::cout << "keys: " << length << std::endl;
+  for (size_t step = 0; step < arraysize(kNames); ++step) {
+    std::cout << kNames[step] << ": "
+              << results[step].usec / num_keys << " usec/key, "
+              << results[step].allocations / num_keys << " allocs/key"
+              << std::endl;
+  }
+  std::cout << "InsertCharacter throughput: "
+            << num_keys * 1000000.0 / results[0].usec << " keys/sec"
+            << std::endl;
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  ++g_num_allocations;
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
 
   mozc::composer::Table table;
   table.LoadFromFile(FLAGS_table.c_str());
+  if (FLAGS_compile_table) {
+    table.Compile();
+  }
+
+  if (FLAGS_benchmark_length > 0) {
+    RunBenchmark(table, FLAGS_benchmark_length);
+    return 0;
+  }
+
   std::unique_ptr<mozc::composer::Composer> composer(
       new mozc::composer::Composer(&table,
                                    &Request::default_instance(),
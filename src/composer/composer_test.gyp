@@ -39,6 +39,7 @@
         'internal/composition_test.cc',
         'internal/converter_test.cc',
         'internal/mode_switching_handler_test.cc',
+        'internal/table_automaton_test.cc',
         'internal/transliterators_test.cc',
         'internal/typing_corrector_test.cc',
         'table_test.cc',
@@ -62,6 +62,10 @@ class CompositionInterface {
 
   virtual void Erase() = 0;
 
+  // Releases the memory pooled for the later insertions if the composition
+  // is empty.
+  virtual void ReleaseUnusedMemory() = 0;
+
   // Get the position on mode_to from position_from on mode_from.
   virtual size_t ConvertPosition(
       size_t position_from,
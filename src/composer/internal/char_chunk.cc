@@ -29,6 +29,7 @@
 
 #include "composer/internal/char_chunk.h"
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -549,6 +550,17 @@ void CharChunk::set_ambiguous(const string &ambiguous) {
 bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
                            const size_t position,
                            CharChunk **left_new_chunk) {
+  std::unique_ptr<CharChunk> left_chunk(new CharChunk(transliterator_, table_));
+  if (!SplitChunkInto(t12r, position, left_chunk.get())) {
+    return false;
+  }
+  *left_new_chunk = left_chunk.release();
+  return true;
+}
+
+bool CharChunk::SplitChunkInto(Transliterators::Transliterator t12r,
+                               const size_t position,
+                               CharChunk *left_chunk) {
   if (position <= 0 || position >= GetLength(t12r)) {
     LOG(WARNING) << "Invalid position: " << position;
     return false;
@@ -561,23 +573,23 @@ bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
       Table::DeleteSpecialKey(conversion_ + pending_),
       &raw_lhs, &raw_rhs, &converted_lhs, &converted_rhs);
 
-  *left_new_chunk = new CharChunk(transliterator_, table_);
-  (*left_new_chunk)->set_raw(raw_lhs);
+  *left_chunk = CharChunk(transliterator_, table_);
+  left_chunk->set_raw(raw_lhs);
   set_raw(raw_rhs);
 
   if (converted_lhs.size() > conversion_.size()) {
     // [ conversion | pending ] => [ conv | pend#1 ] [ pend#2 ]
     const string pending_lhs(converted_lhs, conversion_.size());
-    (*left_new_chunk)->set_conversion(conversion_);
-    (*left_new_chunk)->set_pending(pending_lhs);
+    left_chunk->set_conversion(conversion_);
+    left_chunk->set_pending(pending_lhs);
 
     conversion_.clear();
     pending_ = converted_rhs;
     ambiguous_.clear();
   } else {
     // [ conversion | pending ] => [ conv#1 ] [ conv#2 | pending ]
-    (*left_new_chunk)->set_conversion(converted_lhs);
-    // left_new_chunk->set_pending("");
+    left_chunk->set_conversion(converted_lhs);
+    // left_chunk->set_pending("");
     const size_t pending_pos = converted_rhs.size() - pending_.size();
     conversion_.assign(converted_rhs, 0, pending_pos);
     // pending_ = pending_;
@@ -100,6 +100,13 @@ class CharChunk {
                   size_t position,
                   CharChunk **left_new_chunk);
 
+  // Same as SplitChunk, but stores the left part to |left_chunk| owned by the
+  // caller, e.g., a chunk recycled by Composition.  The previous content of
+  // |left_chunk| is discarded.
+  bool SplitChunkInto(Transliterators::Transliterator transliterator,
+                      size_t position,
+                      CharChunk *left_chunk);
+
   // Return true if this chunk should be commited immediately.  This
   // function refers DIRECT_INPUT attribute.
   bool ShouldCommit() const;
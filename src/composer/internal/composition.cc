@@ -30,6 +30,7 @@
 #include "composer/internal/composition.h"
 
 #include <memory>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -41,19 +42,102 @@
 namespace mozc {
 namespace composer {
 
+// Owns the chunks of Composition.  Chunks are allocated in blocks, and the
+// chunks removed from the list are kept for reuse, so that typing a character
+// doesn't allocate a chunk.
+class Composition::ChunkStorage {
+ public:
+  ChunkStorage() {}
+  ~ChunkStorage() {}
+
+  const CharChunkList &chunks() const {
+    return chunks_;
+  }
+
+  CharChunkList *mutable_chunks() {
+    return &chunks_;
+  }
+
+  CharChunk *NewChunk(Transliterators::Transliterator transliterator,
+                      const Table *table) {
+    if (!free_chunks_.empty()) {
+      CharChunk *chunk = free_chunks_.back();
+      free_chunks_.pop_back();
+      *chunk = CharChunk(transliterator, table);
+      return chunk;
+    }
+    if (blocks_.empty() || blocks_.back()->size() == kBlockSize) {
+      blocks_.push_back(
+          std::unique_ptr<vector<CharChunk>>(new vector<CharChunk>));
+      blocks_.back()->reserve(kBlockSize);
+    }
+    // As the capacity is reserved, the pointers to the chunks in the block
+    // are stable.
+    blocks_.back()->push_back(CharChunk(transliterator, table));
+    return &blocks_.back()->back();
+  }
+
+  // Returns |chunk| allocated by NewChunk to the pool.
+  void DeleteChunk(CharChunk *chunk) {
+    free_chunks_.push_back(chunk);
+  }
+
+  // Removes all the chunks from the list.
+  void Clear() {
+    free_chunks_.insert(free_chunks_.end(), chunks_.begin(), chunks_.end());
+    chunks_.clear();
+  }
+
+  void CopyChunksFrom(const ChunkStorage &other) {
+    Clear();
+    for (CharChunkList::const_iterator it = other.chunks_.begin();
+         it != other.chunks_.end(); ++it) {
+      CharChunk *chunk = NewChunk(Transliterators::CONVERSION_STRING, NULL);
+      *chunk = **it;
+      chunks_.push_back(chunk);
+    }
+  }
+
+ private:
+  static const size_t kBlockSize = 16;
+
+  CharChunkList chunks_;
+  vector<CharChunk *> free_chunks_;
+  vector<std::unique_ptr<vector<CharChunk>>> blocks_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChunkStorage);
+};
+
 Composition::Composition(const Table *table)
-    : table_(table), input_t12r_(Transliterators::CONVERSION_STRING) {}
+    : table_(table),
+      storage_(new ChunkStorage),
+      input_t12r_(Transliterators::CONVERSION_STRING) {}
+
+Composition::~Composition() {}
 
-Composition::~Composition() {
-  Erase();
+Composition::ChunkStorage *Composition::mutable_storage() {
+  if (storage_.use_count() != 1) {
+    std::shared_ptr<ChunkStorage> storage(new ChunkStorage);
+    storage->CopyChunksFrom(*storage_);
+    storage_.swap(storage);
+  }
+  return storage_.get();
 }
 
 void Composition::Erase() {
-  CharChunkList::iterator it;
-  for (it = chunks_.begin(); it != chunks_.end(); ++it) {
-    delete *it;
+  if (storage_.use_count() != 1) {
+    // Leaves the chunks to the clones.
+    storage_.reset(new ChunkStorage);
+    return;
   }
-  chunks_.clear();
+  storage_->Clear();
+}
+
+void Composition::ReleaseUnusedMemory() {
+  if (!storage_->chunks().empty()) {
+    return;
+  }
+  storage_.reset(new ChunkStorage);
 }
 
 size_t Composition::InsertAt(size_t pos, const string &input) {
@@ -98,6 +182,8 @@ size_t Composition::InsertInput(size_t pos, const CompositionInput &input) {
 
 // Deletes a right-hand character of the composition.
 size_t Composition::DeleteAt(const size_t position) {
+  ChunkStorage *storage = mutable_storage();
+  CharChunkList *chunks = storage->mutable_chunks();
   CharChunkList::iterator chunk_it;
   const size_t original_size = GetLength();
   size_t new_position = position;
@@ -107,10 +193,10 @@ size_t Composition::DeleteAt(const size_t position) {
   // chunk0 : '{a}'  (invisible character only == 0-length)
   // chunk1 : 'b'
   // And DeleteAt(0) is invoked, we have to delete both chunks.
-  while (!chunks_.empty() && GetLength() == original_size) {
+  while (!chunks->empty() && GetLength() == original_size) {
     MaybeSplitChunkAt(position, &chunk_it);
     new_position = GetPosition(Transliterators::LOCAL, chunk_it);
-    if (chunk_it == chunks_.end()) {
+    if (chunk_it == chunks->end()) {
       break;
     }
 
@@ -118,14 +204,15 @@ size_t Composition::DeleteAt(const size_t position) {
     // If a chunk contains only invisible characters,
     // the result of GetLength is 0.
     if ((*chunk_it)->GetLength(Transliterators::LOCAL) <= 1) {
-      delete *chunk_it;
-      chunks_.erase(chunk_it);
+      storage->DeleteChunk(*chunk_it);
+      chunks->erase(chunk_it);
       continue;
     }
 
-    CharChunk *left_deleted_chunk_ptr = NULL;
-    (*chunk_it)->SplitChunk(Transliterators::LOCAL, 1, &left_deleted_chunk_ptr);
-    std::unique_ptr<CharChunk> left_deleted_chunk(left_deleted_chunk_ptr);
+    CharChunk *left_deleted_chunk =
+        storage->NewChunk(input_t12r_, table_);
+    (*chunk_it)->SplitChunkInto(Transliterators::LOCAL, 1, left_deleted_chunk);
+    storage->DeleteChunk(left_deleted_chunk);
   }
   return new_position;
 }
@@ -139,13 +226,13 @@ size_t Composition::ConvertPosition(
     return position_from;
   }
 
-  CharChunkList::iterator chunk_it;
+  CharChunkList::const_iterator chunk_it;
   size_t inner_position_from;
-  GetChunkAt(position_from, transliterator_from,
-             &chunk_it, &inner_position_from);
+  FindChunkAt(position_from, transliterator_from,
+              &chunk_it, &inner_position_from);
 
   // No chunk was found, return 0 as a fallback.
-  if (chunk_it == chunks_.end()) {
+  if (chunk_it == chunks().end()) {
     return 0;
   }
 
@@ -201,7 +288,7 @@ void Composition::SetTransliterator(
     return;
   }
 
-  if (chunks_.empty()) {
+  if (chunks().empty()) {
     return;
   }
 
@@ -224,16 +311,14 @@ void Composition::SetTransliterator(
 
 Transliterators::Transliterator
 Composition::GetTransliterator(size_t position) {
-  // Due to GetChunkAt is not a const funcion, this function cannot be
-  // a const function.
-  CharChunkList::iterator chunk_it;
+  CharChunkList::const_iterator chunk_it;
   size_t inner_position;
-  GetChunkAt(position, Transliterators::LOCAL, &chunk_it, &inner_position);
+  FindChunkAt(position, Transliterators::LOCAL, &chunk_it, &inner_position);
   return (*chunk_it)->GetTransliterator(Transliterators::LOCAL);
 }
 
 size_t Composition::GetLength() const {
-  return GetPosition(Transliterators::LOCAL, chunks_.end());
+  return GetPosition(Transliterators::LOCAL, chunks().end());
 }
 
 void Composition::GetStringWithModes(
@@ -241,7 +326,8 @@ void Composition::GetStringWithModes(
     const TrimMode trim_mode,
     string* composition) const {
   composition->clear();
-  if (chunks_.empty()) {
+  const CharChunkList &chunks = GetCharChunkList();
+  if (chunks.empty()) {
     // This is not an error. For example, the composition should be empty for
     // the first keydown event after turning on the IME.
     DCHECK(composition->empty()) << "An empty string should be returned.";
@@ -249,7 +335,7 @@ void Composition::GetStringWithModes(
   }
 
   CharChunkList::const_iterator it;
-  for (it = chunks_.begin(); *it != chunks_.back(); ++it) {
+  for (it = chunks.begin(); *it != chunks.back(); ++it) {
     (*it)->AppendResult(transliterator, composition);
   }
 
@@ -282,30 +368,32 @@ void Composition::GetExpandedStringsWithTransliterator(
   DCHECK(expanded);
   base->clear();
   expanded->clear();
-  if (chunks_.empty()) {
+  const CharChunkList &chunks = GetCharChunkList();
+  if (chunks.empty()) {
     VLOG(1) << "The composition size is zero.";
     return;
   }
 
   CharChunkList::const_iterator it;
-  for (it = chunks_.begin(); (*it) != chunks_.back(); ++it) {
+  for (it = chunks.begin(); (*it) != chunks.back(); ++it) {
     (*it)->AppendFixedResult(transliterator, base);
   }
 
-  chunks_.back()->AppendTrimedResult(transliterator, base);
+  chunks.back()->AppendTrimedResult(transliterator, base);
   // Get expanded from the last chunk
-  chunks_.back()->GetExpandedResults(expanded);
+  chunks.back()->GetExpandedResults(expanded);
 }
 
 void Composition::GetString(string *composition) const {
   composition->clear();
-  if (chunks_.empty()) {
+  const CharChunkList &chunks = GetCharChunkList();
+  if (chunks.empty()) {
     VLOG(1) << "The composition size is zero.";
     return;
   }
 
-  for (CharChunkList::const_iterator it = chunks_.begin();
-       it != chunks_.end();
+  for (CharChunkList::const_iterator it = chunks.begin();
+       it != chunks.end();
        ++it) {
     (*it)->AppendResult(Transliterators::LOCAL, composition);
   }
@@ -331,21 +419,20 @@ void Composition::GetPreedit(
   right->assign(Util::SubString(composition, position + 1, string::npos));
 }
 
-// This function is essentialy a const function, but chunks_.begin()
-// violates the constness of this function.
-void Composition::GetChunkAt(const size_t position,
-                             Transliterators::Transliterator transliterator,
-                             CharChunkList::iterator *chunk_it,
-                             size_t *inner_position) {
-  if (chunks_.empty()) {
+void Composition::FindChunkAt(const size_t position,
+                              Transliterators::Transliterator transliterator,
+                              CharChunkList::const_iterator *chunk_it,
+                              size_t *inner_position) const {
+  const CharChunkList &chunks = GetCharChunkList();
+  if (chunks.empty()) {
     *inner_position = 0;
-    *chunk_it = chunks_.begin();
+    *chunk_it = chunks.begin();
     return;
   }
 
   size_t rest_pos = position;
-  CharChunkList::iterator it;
-  for (it = chunks_.begin(); it != chunks_.end(); ++it) {
+  CharChunkList::const_iterator it;
+  for (it = chunks.begin(); it != chunks.end(); ++it) {
     const size_t chunk_length = (*it)->GetLength(transliterator);
     if (rest_pos <= chunk_length) {
       *inner_position = rest_pos;
@@ -354,17 +441,28 @@ void Composition::GetChunkAt(const size_t position,
     }
     rest_pos -= chunk_length;
   }
-  *chunk_it = chunks_.end();
+  *chunk_it = chunks.end();
   --(*chunk_it);
   *inner_position = (**chunk_it)->GetLength(transliterator);
 }
 
+void Composition::GetChunkAt(const size_t position,
+                             Transliterators::Transliterator transliterator,
+                             CharChunkList::iterator *chunk_it,
+                             size_t *inner_position) {
+  CharChunkList *chunks = mutable_storage()->mutable_chunks();
+  CharChunkList::const_iterator const_it;
+  FindChunkAt(position, transliterator, &const_it, inner_position);
+  // Converts the const_iterator to the iterator.
+  *chunk_it = chunks->erase(const_it, const_it);
+}
+
 size_t Composition::GetPosition(
     Transliterators::Transliterator transliterator,
     const CharChunkList::const_iterator &cur_it) const {
   size_t position = 0;
   CharChunkList::const_iterator it;
-  for (it = chunks_.begin(); it != cur_it; ++it) {
+  for (it = chunks().begin(); it != cur_it; ++it) {
     position += (*it)->GetLength(transliterator);
   }
   return position;
@@ -374,8 +472,9 @@ size_t Composition::GetPosition(
 CharChunk *Composition::MaybeSplitChunkAt(const size_t pos,
                                           CharChunkList::iterator *it) {
   // The position is the beginning of composition.
+  ChunkStorage *storage = mutable_storage();
   if (pos <= 0) {
-    *it = chunks_.begin();
+    *it = storage->mutable_chunks()->begin();
     return NULL;
   }
 
@@ -388,9 +487,13 @@ CharChunk *Composition::MaybeSplitChunkAt(const size_t pos,
     return chunk;
   }
 
-  CharChunk *left_chunk = NULL;
-  chunk->SplitChunk(Transliterators::LOCAL, inner_position, &left_chunk);
-  chunks_.insert(*it, left_chunk);
+  CharChunk *left_chunk = storage->NewChunk(input_t12r_, table_);
+  if (!chunk->SplitChunkInto(Transliterators::LOCAL, inner_position,
+                             left_chunk)) {
+    storage->DeleteChunk(left_chunk);
+    return NULL;
+  }
+  storage->mutable_chunks()->insert(*it, left_chunk);
   return left_chunk;
 }
 
@@ -400,7 +503,10 @@ void Composition::CombinePendingChunks(
   const string &next_input =
     input.has_conversion() ? input.conversion() : input.raw();
 
-  while (it != chunks_.begin()) {
+  // |it| is given by a method which has made the storage mutable.
+  DCHECK_EQ(1, storage_.use_count());
+  ChunkStorage *storage = storage_.get();
+  while (it != storage->chunks().begin()) {
     CharChunkList::iterator left_it = it;
     --left_it;
     if (!(*left_it)->IsConvertible(
@@ -409,24 +515,27 @@ void Composition::CombinePendingChunks(
     }
 
     (*it)->Combine(**left_it);
-    delete *left_it;
-    chunks_.erase(left_it);
+    storage->DeleteChunk(*left_it);
+    storage->mutable_chunks()->erase(left_it);
   }
 }
 
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(CharChunkList::iterator *it) {
-  CharChunk *new_chunk = new CharChunk(input_t12r_, table_);
-  return chunks_.insert(*it, new_chunk);
+  // |it| is given by a method which has made the storage mutable.
+  DCHECK_EQ(1, storage_.use_count());
+  CharChunk *new_chunk = storage_->NewChunk(input_t12r_, table_);
+  return storage_->mutable_chunks()->insert(*it, new_chunk);
 }
 
 const CharChunkList &Composition::GetCharChunkList() const {
-  return chunks_;
+  return storage_->chunks();
 }
 
 bool Composition::ShouldCommit() const {
-  for (CharChunkList::const_iterator it = chunks_.begin();
-       it != chunks_.end();
+  const CharChunkList &chunks = GetCharChunkList();
+  for (CharChunkList::const_iterator it = chunks.begin();
+       it != chunks.end();
        ++it) {
     if (!(*it)->ShouldCommit()) {
       return false;
@@ -446,11 +555,7 @@ Composition *Composition::CloneImpl() const {
   // it instead of copying pointers.
   object->input_t12r_ = input_t12r_;
   object->table_ = table_;
-
-  for (CharChunkList::const_iterator it = chunks_.begin();
-       it != chunks_.end(); ++it) {
-    object->chunks_.push_back((*it)->Clone());
-  }
+  object->storage_ = storage_;
 
   return object;
 }
@@ -458,7 +563,8 @@ Composition *Composition::CloneImpl() const {
 // Return charchunk to be inserted and iterator of the *next* char chunk.
 CharChunkList::iterator Composition::GetInsertionChunk(
     CharChunkList::iterator *it) {
-  if (*it == chunks_.begin()) {
+  DCHECK_EQ(1, storage_.use_count());
+  if (*it == storage_->chunks().begin()) {
     return InsertChunk(it);
   }
 
@@ -33,6 +33,7 @@
 #include "composer/composition_interface.h"
 
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -62,6 +63,7 @@ class Composition : public CompositionInterface {
   virtual size_t InsertInput(size_t position, const CompositionInput &input);
 
   virtual void Erase();
+  virtual void ReleaseUnusedMemory();
 
   // Get the position on mode_to from position_from on mode_from.
   virtual size_t ConvertPosition(
@@ -104,6 +106,9 @@ class Composition : public CompositionInterface {
   // Get a clone.
   // Clone is a thin wrapper of CloneImpl.
   // CloneImpl is created to write test codes without dynamic_cast.
+  // The clone shares the chunks with this object until either of them is
+  // modified, so cloning doesn't copy the chunks.  Iterators and chunk
+  // pointers obtained before cloning must not be used to modify the chunks.
   virtual CompositionInterface *Clone() const;
   Composition *CloneImpl() const;
 
@@ -135,19 +140,32 @@ class Composition : public CompositionInterface {
     return table_;
   }
   const CharChunkList &chunks() const {
-    return chunks_;
+    return GetCharChunkList();
   }
   Transliterators::Transliterator input_t12r() const {
     return input_t12r_;
   }
 
  private:
+  class ChunkStorage;
+
   void GetStringWithModes(Transliterators::Transliterator transliterator,
                           TrimMode trim_mode,
                           string *output) const;
 
+  // Same as GetChunkAt, but doesn't make the chunks mutable.
+  void FindChunkAt(size_t position,
+                   Transliterators::Transliterator transliterator,
+                   CharChunkList::const_iterator *chunk_it,
+                   size_t *inner_position) const;
+
+  // Returns the storage owned only by this object, copying the chunks if they
+  // are shared with clones.
+  ChunkStorage *mutable_storage();
+
   const Table *table_;
-  CharChunkList chunks_;
+  // Shared with clones until either of them is modified.  Never NULL.
+  std::shared_ptr<ChunkStorage> storage_;
   Transliterators::Transliterator input_t12r_;
 
   DISALLOW_COPY_AND_ASSIGN(Composition);
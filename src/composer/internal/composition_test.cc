@@ -2049,5 +2049,99 @@ TEST_F(CompositionTest, Clone) {
   }
 }
 
+TEST_F(CompositionTest, CloneIsCopyOnWrite) {
+  // "か"
+  table_->AddRule("ka", "\xe3\x81\x8b", "");
+  // "な"
+  table_->AddRule("na", "\xe3\x81\xaa", "");
+  Composition src(table_.get());
+  src.SetInputMode(Transliterators::HIRAGANA);
+  size_t pos = 0;
+  pos = src.InsertAt(pos, "k");
+  pos = src.InsertAt(pos, "a");
+  pos = src.InsertAt(pos, "n");
+
+  std::unique_ptr<Composition> dest(src.CloneImpl());
+  // The chunks are shared until modified.
+  EXPECT_EQ(&src.chunks(), &dest->chunks());
+
+  // Modifying the clone doesn't change the source.
+  dest->InsertAt(pos, "a");
+  EXPECT_NE(&src.chunks(), &dest->chunks());
+  string output;
+  src.GetString(&output);
+  // "かn"
+  EXPECT_EQ("\xe3\x81\x8b\xef\xbd\x8e", output);
+  dest->GetString(&output);
+  // "かな"
+  EXPECT_EQ("\xe3\x81\x8b\xe3\x81\xaa", output);
+
+  // Modifying the source doesn't change the clone either.
+  std::unique_ptr<Composition> dest2(src.CloneImpl());
+  src.DeleteAt(0);
+  src.GetString(&output);
+  // "n"
+  EXPECT_EQ("\xef\xbd\x8e", output);
+  dest2->GetString(&output);
+  // "かn"
+  EXPECT_EQ("\xe3\x81\x8b\xef\xbd\x8e", output);
+
+  // Erasing the source keeps the clone.
+  src.Erase();
+  EXPECT_EQ(0, src.GetLength());
+  EXPECT_EQ(2, dest2->GetLength());
+}
+
+TEST_F(CompositionTest, ReuseChunksAfterErase) {
+  // "か"
+  table_->AddRule("ka", "\xe3\x81\x8b", "");
+  // "き"
+  table_->AddRule("ki", "\xe3\x81\x8d", "");
+  Composition composition(table_.get());
+  composition.SetInputMode(Transliterators::HIRAGANA);
+  for (int i = 0; i < 3; ++i) {
+    size_t pos = 0;
+    pos = composition.InsertAt(pos, "k");
+    pos = composition.InsertAt(pos, "a");
+    pos = composition.InsertAt(pos, "k");
+    pos = composition.InsertAt(pos, "i");
+    string output;
+    composition.GetString(&output);
+    // "かき"
+    EXPECT_EQ("\xe3\x81\x8b\xe3\x81\x8d", output);
+    EXPECT_EQ(1, composition.DeleteAt(1));
+    composition.GetString(&output);
+    // "か"
+    EXPECT_EQ("\xe3\x81\x8b", output);
+    composition.Erase();
+    EXPECT_EQ(0, composition.GetLength());
+  }
+}
+
+TEST_F(CompositionTest, ReleaseUnusedMemory) {
+  // "か"
+  table_->AddRule("ka", "\xe3\x81\x8b", "");
+  Composition composition(table_.get());
+  composition.SetInputMode(Transliterators::HIRAGANA);
+  size_t pos = composition.InsertAt(0, "k");
+  pos = composition.InsertAt(pos, "a");
+
+  // The composition is kept if it is not empty.
+  composition.ReleaseUnusedMemory();
+  string output;
+  composition.GetString(&output);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", output);
+
+  composition.Erase();
+  composition.ReleaseUnusedMemory();
+  EXPECT_EQ(0, composition.GetLength());
+  pos = composition.InsertAt(0, "k");
+  pos = composition.InsertAt(pos, "a");
+  composition.GetString(&output);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", output);
+}
+
 }  // namespace composer
 }  // namespace mozc
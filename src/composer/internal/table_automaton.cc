@@ -0,0 +1,225 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "composer/internal/table_automaton.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "composer/table.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+const uint32 kInvalidCheck = kuint32max;
+
+bool EntryInputLess(const Entry *lhs, const Entry *rhs) {
+  return lhs->input() < rhs->input();
+}
+
+// Returns true if |depth| is a boundary of UTF-8 characters of |key|, in the
+// same way as Trie splits keys.
+bool IsCharBoundary(const string &key, size_t depth) {
+  size_t pos = 0;
+  while (pos < depth) {
+    pos += Util::OneCharLen(key.data() + pos);
+  }
+  return pos == depth;
+}
+
+}  // namespace
+
+TableAutomaton::TableAutomaton() {}
+
+TableAutomaton::~TableAutomaton() {}
+
+void TableAutomaton::Build(const vector<const Entry *> &entries) {
+  entries_ = entries;
+  sort(entries_.begin(), entries_.end(), EntryInputLess);
+  for (size_t i = 1; i < entries_.size(); ++i) {
+    DCHECK_NE(entries_[i - 1]->input(), entries_[i]->input());
+  }
+
+  const japanese_util_rule::DoubleArray kEmptyUnit = {0, kInvalidCheck};
+  units_.assign(1, kEmptyUnit);
+  nodes_.assign(1, Node());
+  vector<bool> used(1, true);
+  size_t first_free = 1;
+  BuildNode(0, 0, static_cast<uint32>(entries_.size()), 0,
+            &used, &first_free);
+
+  // Drop the trailing units that are not used.
+  size_t size = units_.size();
+  while (size > 1 && units_[size - 1].check == kInvalidCheck) {
+    --size;
+  }
+  units_.resize(size);
+  nodes_.resize(size);
+  vector<japanese_util_rule::DoubleArray>(units_).swap(units_);
+  vector<Node>(nodes_).swap(nodes_);
+}
+
+void TableAutomaton::BuildNode(uint32 node, uint32 begin, uint32 end,
+                               size_t depth, vector<bool> *used,
+                               size_t *first_free) {
+  const bool has_entry =
+      begin < end && entries_[begin]->input().size() == depth;
+  Node &info = nodes_[node];
+  info.begin = begin;
+  info.end = end;
+  info.has_entry = has_entry;
+  info.char_boundary =
+      depth == 0 || has_entry ||
+      (begin < end && IsCharBoundary(entries_[begin]->input(), depth));
+
+  // Collects the labels of the children.  Since the entries are sorted, the
+  // entries of each child are contiguous.
+  vector<uint8> labels;
+  vector<uint32> child_begins;
+  for (uint32 i = has_entry ? begin + 1 : begin; i < end; ++i) {
+    const uint8 label = static_cast<uint8>(entries_[i]->input()[depth]);
+    if (labels.empty() || labels.back() != label) {
+      labels.push_back(label);
+      child_begins.push_back(i);
+    }
+  }
+  if (labels.empty()) {
+    return;
+  }
+  child_begins.push_back(end);
+
+  // Finds the smallest base at which all the children fit in unused units.
+  while (*first_free < used->size() && (*used)[*first_free]) {
+    ++*first_free;
+  }
+  size_t base = *first_free > labels[0] ? *first_free - labels[0] : 0;
+  for (;; ++base) {
+    bool fits = true;
+    for (size_t i = 0; i < labels.size(); ++i) {
+      const size_t unit = base + labels[i];
+      if (unit < used->size() && (*used)[unit]) {
+        fits = false;
+        break;
+      }
+    }
+    if (fits) {
+      break;
+    }
+  }
+
+  const size_t new_size = base + labels.back() + 1;
+  if (new_size > units_.size()) {
+    const japanese_util_rule::DoubleArray kEmptyUnit = {0, kInvalidCheck};
+    units_.resize(new_size, kEmptyUnit);
+    nodes_.resize(new_size, Node());
+    used->resize(new_size, false);
+  }
+  units_[node].base = static_cast<int32>(base);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    units_[base + labels[i]].check = node;
+    (*used)[base + labels[i]] = true;
+  }
+  for (size_t i = 0; i < labels.size(); ++i) {
+    BuildNode(static_cast<uint32>(base + labels[i]),
+              child_begins[i], child_begins[i + 1], depth + 1,
+              used, first_free);
+  }
+}
+
+bool TableAutomaton::Traverse(StringPiece key, uint32 *node) const {
+  for (size_t i = 0; i < key.size(); ++i) {
+    if (!MoveToChild(static_cast<uint8>(key[i]), node)) {
+      return false;
+    }
+  }
+  return nodes_[*node].char_boundary;
+}
+
+const Entry *TableAutomaton::LookUp(StringPiece input) const {
+  uint32 node = 0;
+  if (!Traverse(input, &node) || !nodes_[node].has_entry) {
+    return NULL;
+  }
+  return entries_[nodes_[node].begin];
+}
+
+const Entry *TableAutomaton::LookUpPrefix(StringPiece input,
+                                          size_t *key_length,
+                                          bool *fixed) const {
+  // Follows |input| character by character, as Trie does.
+  uint32 node = 0;
+  size_t length = 0;
+  size_t pos = 0;
+  while (pos < input.size()) {
+    const size_t char_length = Util::OneCharLen(input.data() + pos);
+    uint32 next = node;
+    if (!Traverse(input.substr(pos, char_length), &next)) {
+      break;
+    }
+    node = next;
+    // Trie counts the length of a truncated character at the end as is.
+    length += char_length;
+    pos += char_length;
+  }
+
+  *key_length = length;
+  const Node &info = nodes_[node];
+  if (!info.has_entry) {
+    *fixed = true;
+    return NULL;
+  }
+  *fixed = (info.end - info.begin == 1);
+  return entries_[info.begin];
+}
+
+void TableAutomaton::LookUpPredictiveAll(
+    StringPiece input, vector<const Entry *> *results) const {
+  DCHECK(results);
+  uint32 node = 0;
+  if (!Traverse(input, &node)) {
+    return;
+  }
+  results->insert(results->end(),
+                  entries_.begin() + nodes_[node].begin,
+                  entries_.begin() + nodes_[node].end);
+}
+
+bool TableAutomaton::HasSubRules(StringPiece input) const {
+  if (input.empty()) {
+    return false;
+  }
+  uint32 node = 0;
+  return Traverse(input, &node);
+}
+
+}  // namespace composer
+}  // namespace mozc
@@ -0,0 +1,128 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Flat automaton of the rules of a composer::Table.
+
+#ifndef MOZC_COMPOSER_INTERNAL_TABLE_AUTOMATON_H_
+#define MOZC_COMPOSER_INTERNAL_TABLE_AUTOMATON_H_
+
+#include <vector>
+
+#include "base/double_array.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+namespace composer {
+
+class Entry;
+
+// Read-only automaton over the inputs of table entries.  Transitions are
+// byte-level and stored in a double array, so that the lookups neither walk
+// a tree of maps nor allocate strings.  The lookup methods return the same
+// results as the corresponding methods of Trie<const Entry *>, which works on
+// UTF-8 characters.
+//
+// Units of the double array are indexed by node; the root is node 0.  The
+// child of node |n| for byte |c| is node |base(n) + c| if its check is |n|.
+class TableAutomaton {
+ public:
+  TableAutomaton();
+  ~TableAutomaton();
+
+  // Builds the automaton from |entries|.  The inputs of the entries must be
+  // unique.  This object doesn't take the ownership of the entries.
+  void Build(const vector<const Entry *> &entries);
+
+  // Returns the entry whose input is |input|, or NULL.
+  const Entry *LookUp(StringPiece input) const;
+
+  // Same as Trie::LookUpPrefix(); returns the entry of the longest prefix of
+  // |input| that is a path of the automaton if the path has an entry.
+  // |key_length| is set to the length of the path, and |fixed| is set to
+  // false if the entry can be extended by other entries.
+  const Entry *LookUpPrefix(StringPiece input,
+                            size_t *key_length,
+                            bool *fixed) const;
+
+  // Appends the entries whose inputs start with |input| to |results| in the
+  // order of their inputs.
+  void LookUpPredictiveAll(StringPiece input,
+                           vector<const Entry *> *results) const;
+
+  // Returns true if |input| is a non-empty prefix of an entry input.
+  bool HasSubRules(StringPiece input) const;
+
+  // Returns the number of the units of the double array.
+  size_t num_units() const { return units_.size(); }
+
+ private:
+  struct Node {
+    // Range of |entries_| whose inputs start with the path to this node.
+    uint32 begin;
+    uint32 end;
+    // True if |entries_[begin]| ends at this node.
+    bool has_entry;
+    // True if the path to this node ends at a UTF-8 character boundary.
+    bool char_boundary;
+  };
+
+  // Moves |node| to its child for |c|.  Returns false if there is no child.
+  bool MoveToChild(uint8 c, uint32 *node) const {
+    const uint32 child = static_cast<uint32>(units_[*node].base) + c;
+    if (child >= units_.size() || units_[child].check != *node) {
+      return false;
+    }
+    *node = child;
+    return true;
+  }
+
+  // Moves |node| along |key|.  Returns false if the path doesn't exist or
+  // doesn't end at a character boundary.
+  bool Traverse(StringPiece key, uint32 *node) const;
+
+  // Builds the subtree of |node| for |entries_| in [begin, end), whose inputs
+  // share the first |depth| bytes.  |used| marks the units already taken,
+  // and no unit before |first_free| is free.
+  void BuildNode(uint32 node, uint32 begin, uint32 end, size_t depth,
+                 vector<bool> *used, size_t *first_free);
+
+  vector<japanese_util_rule::DoubleArray> units_;
+  vector<Node> nodes_;
+  // Sorted by input.
+  vector<const Entry *> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TableAutomaton);
+};
+
+}  // namespace composer
+}  // namespace mozc
+
+#endif  // MOZC_COMPOSER_INTERNAL_TABLE_AUTOMATON_H_
@@ -0,0 +1,149 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "composer/internal/table_automaton.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/stl_util.h"
+#include "base/trie.h"
+#include "composer/table.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+class TableAutomatonTest : public testing::Test {
+ protected:
+  virtual void TearDown() {
+    STLDeleteElements(&entries_);
+  }
+
+  void AddEntry(const string &input, const string &result) {
+    Entry *entry = new Entry(input, result, "", NO_TABLE_ATTRIBUTE);
+    entries_.push_back(entry);
+    trie_.AddEntry(input, entry);
+  }
+
+  void Build() {
+    automaton_.Build(entries_);
+  }
+
+  // Expects that the automaton returns the same results as the trie.
+  void ExpectSameAsTrie(const string &key) {
+    SCOPED_TRACE(key);
+
+    const Entry *trie_entry = NULL;
+    trie_.LookUp(key, &trie_entry);
+    EXPECT_EQ(trie_entry, automaton_.LookUp(key));
+
+    trie_entry = NULL;
+    size_t trie_length = 0;
+    bool trie_fixed = false;
+    trie_.LookUpPrefix(key, &trie_entry, &trie_length, &trie_fixed);
+    size_t length = 0;
+    bool fixed = false;
+    EXPECT_EQ(trie_entry, automaton_.LookUpPrefix(key, &length, &fixed));
+    EXPECT_EQ(trie_length, length);
+    EXPECT_EQ(trie_fixed, fixed);
+
+    vector<const Entry *> trie_results, results;
+    trie_.LookUpPredictiveAll(key, &trie_results);
+    automaton_.LookUpPredictiveAll(key, &results);
+    EXPECT_EQ(trie_results, results);
+
+    EXPECT_EQ(trie_.HasSubTrie(key), automaton_.HasSubRules(key));
+  }
+
+  vector<const Entry *> entries_;
+  Trie<const Entry *> trie_;
+  TableAutomaton automaton_;
+};
+
+TEST_F(TableAutomatonTest, Empty) {
+  Build();
+  ExpectSameAsTrie("");
+  ExpectSameAsTrie("a");
+}
+
+TEST_F(TableAutomatonTest, SameAsTrie) {
+  AddEntry("a", "\xE3\x81\x82");  // "あ"
+  AddEntry("ka", "\xE3\x81\x8B");  // "か"
+  AddEntry("kya", "\xE3\x81\x8D\xE3\x82\x83");  // "きゃ"
+  AddEntry("n", "\xE3\x82\x93");  // "ん"
+  AddEntry("nn", "\xE3\x82\x93");  // "ん"
+  AddEntry("\t1", "1");
+  // "か゛" (the voiced sound mark is typed separately on the kana layout)
+  AddEntry("\xE3\x81\x8B\xE3\x82\x9B", "\xE3\x81\x8C");
+  AddEntry("\xE3\x81\x8B", "\xE3\x81\x8B");  // "か"
+  AddEntry("\xE3\x81\x8D", "\xE3\x81\x8D");  // "き"
+  Build();
+
+  const char *kKeys[] = {
+    "", "a", "ab", "k", "ka", "kan", "ky", "kya", "kyo", "n", "nn", "nnn",
+    "x", "\t", "\t1", "\t2",
+    "\xE3\x81\x8B",  // "か"
+    "\xE3\x81\x8B\xE3\x82\x9B",  // "か゛"
+    "\xE3\x81\x8B\xE3\x82\x9C",  // "か゜"
+    "\xE3\x81\x8D\xE3\x82\x9B",  // "き゛"
+    "\xE3\x81\x8C",  // "が" shares two bytes with "か".
+    "\xE3\x81",  // A truncated character.
+    "\xE3\x81\x8B\xE3",
+  };
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    ExpectSameAsTrie(kKeys[i]);
+  }
+}
+
+TEST_F(TableAutomatonTest, ManyEntries) {
+  // Every byte from 0x21 to 0x7E and some pairs of them.
+  for (char c1 = 0x21; c1 < 0x7F; ++c1) {
+    AddEntry(string(1, c1), "");
+    for (char c2 = 0x21; c2 < 0x7F; c2 += 3) {
+      AddEntry(string(1, c1) + string(1, c2), "");
+    }
+  }
+  Build();
+
+  for (char c1 = 0x20; c1 <= 0x7F; ++c1) {
+    ExpectSameAsTrie(string(1, c1));
+    for (char c2 = 0x20; c2 <= 0x7F; ++c2) {
+      ExpectSameAsTrie(string(1, c1) + string(1, c2));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace composer
+}  // namespace mozc
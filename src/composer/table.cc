@@ -44,6 +44,7 @@
 #include "base/port.h"
 #include "base/trie.h"
 #include "base/util.h"
+#include "composer/internal/table_automaton.h"
 #include "composer/internal/typing_model.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -335,6 +336,7 @@ const Entry *Table::AddRuleWithAttributes(const string &escaped_input,
     return NULL;
   }
 
+  automaton_.reset();
   const Entry *old_entry = NULL;
   if (entries_->LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
@@ -368,6 +370,7 @@ void Table::DeleteRule(const string &input) {
   //     - This method is not used.
   //     - This method has no tests.
   //     - This method is private scope.
+  automaton_.reset();
   const Entry *old_entry;
   if (entries_->LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
@@ -447,41 +450,77 @@ bool Table::LoadFromStream(istream *is) {
   return true;
 }
 
+void Table::Compile() {
+  vector<const Entry *> entries;
+  entries_->LookUpPredictiveAll("", &entries);
+  automaton_.reset(new TableAutomaton);
+  automaton_->Build(entries);
+}
+
+namespace {
+// Returns true if Util::LowerString() may change |input|, i.e. |input|
+// contains 'A'-'Z' or a full-width one.
+bool MayContainUpperCase(const string &input) {
+  for (size_t i = 0; i < input.size(); ++i) {
+    const uint8 c = static_cast<uint8>(input[i]);
+    if ('A' <= c && c <= 'Z') {
+      return true;
+    }
+    // Full-width "\xEF\xBC\xA1" to "\xEF\xBC\xBA" ("Ａ" to "Ｚ").
+    if (c == 0xEF && i + 2 < input.size() &&
+        static_cast<uint8>(input[i + 1]) == 0xBC &&
+        0xA1 <= static_cast<uint8>(input[i + 2]) &&
+        static_cast<uint8>(input[i + 2]) <= 0xBA) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+const string &Table::NormalizeInput(const string &input,
+                                    string *buffer) const {
+  if (case_sensitive_ || !MayContainUpperCase(input)) {
+    return input;
+  }
+  *buffer = input;
+  Util::LowerString(buffer);
+  return *buffer;
+}
+
 const Entry *Table::LookUp(const string &input) const {
-  const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUp(input, &entry);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUp(normalized_input, &entry);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (automaton_.get() != NULL) {
+    return automaton_->LookUp(key);
   }
+  const Entry *entry = NULL;
+  entries_->LookUp(key, &entry);
   return entry;
 }
 
 const Entry *Table::LookUpPrefix(const string &input,
                                  size_t *key_length,
                                  bool *fixed) const {
-  const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUpPrefix(input, &entry, key_length, fixed);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUpPrefix(normalized_input, &entry, key_length, fixed);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (automaton_.get() != NULL) {
+    return automaton_->LookUpPrefix(key, key_length, fixed);
   }
+  const Entry *entry = NULL;
+  entries_->LookUpPrefix(key, &entry, key_length, fixed);
   return entry;
 }
 
 void Table::LookUpPredictiveAll(const string &input,
                                 vector<const Entry *> *results) const {
-  if (case_sensitive_) {
-    entries_->LookUpPredictiveAll(input, results);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUpPredictiveAll(normalized_input, results);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (automaton_.get() != NULL) {
+    automaton_->LookUpPredictiveAll(key, results);
+    return;
   }
+  entries_->LookUpPredictiveAll(key, results);
 }
 
 bool Table::HasNewChunkEntry(const string &input) const {
@@ -501,13 +540,12 @@ bool Table::HasNewChunkEntry(const string &input) const {
 }
 
 bool Table::HasSubRules(const string &input) const {
-  if (case_sensitive_) {
-    return entries_->HasSubTrie(input);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    return entries_->HasSubTrie(normalized_input);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (automaton_.get() != NULL) {
+    return automaton_->HasSubRules(key);
   }
+  return entries_->HasSubTrie(key);
 }
 
 void Table::DeleteEntry(const Entry *entry) {
@@ -655,6 +693,9 @@ const Table *TableManager::GetTable(const mozc::commands::Request &request,
   if (!table->InitializeWithRequestAndConfig(request, config)) {
     return NULL;
   }
+  // The table is shared by all the sessions with the same request and config
+  // and is no longer modified.
+  table->Compile();
 
   Table* table_to_cache = table.release();
   table_map_[hash] = table_to_cache;
@@ -55,6 +55,7 @@ class Config;
 }  // namespace config
 namespace composer {
 
+class TableAutomaton;
 class TypingModel;
 
 // This is a bitmap representing Entry's additional attributes.
@@ -120,6 +121,12 @@ class Table {
   bool LoadFromString(const string &str);
   bool LoadFromFile(const char *filepath);
 
+  // Compiles the current rules into a flat automaton, which the lookup
+  // methods use instead of the trie.  Adding or deleting a rule discards the
+  // automaton, so call this after all the rules are loaded.
+  void Compile();
+  bool is_compiled() const { return automaton_.get() != NULL; }
+
   const Entry *LookUp(const string &input) const;
   const Entry *LookUpPrefix(const string &input,
                             size_t *key_length,
@@ -152,9 +159,14 @@ class Table {
   bool LoadFromStream(istream *is);
   void DeleteEntry(const Entry *entry);
   void ResetEntrySet();
+  // Returns |input|, or its lower-cased copy in |buffer| if the table is not
+  // case sensitive.
+  const string &NormalizeInput(const string &input, string *buffer) const;
 
   typedef Trie<const Entry*> EntryTrie;
   std::unique_ptr<EntryTrie> entries_;
+  // Built by Compile().  NULL if the table is not compiled.
+  std::unique_ptr<TableAutomaton> automaton_;
   typedef set<const Entry*> EntrySet;
   EntrySet entry_set_;
 
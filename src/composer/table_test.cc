@@ -32,6 +32,7 @@
 #include "base/file_util.h"
 #include "base/port.h"
 #include "base/system_util.h"
+#include "base/util.h"
 #include "composer/internal/composition_input.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -1063,6 +1064,7 @@ TEST_F(TableTest, TableManager) {
           config.set_symbol_method(symbol_method[symbol]);
           const Table *table = table_manager.GetTable(request, config);
           EXPECT_TRUE(table != NULL);
+          EXPECT_TRUE(table->is_compiled());
           EXPECT_TRUE(table_manager.GetTable(request, config) == table);
           EXPECT_TRUE(table_set.find(table) == table_set.end());
           table_set.insert(table);
@@ -1101,5 +1103,105 @@ TEST_F(TableTest, TableManager) {
   }
 }
 
+namespace {
+
+string EntryToString(const Entry *entry) {
+  if (entry == NULL) {
+    return "<NULL>";
+  }
+  return entry->input() + "\t" + entry->result() + "\t" + entry->pending() +
+      "\t" + Util::StringPrintf("%d", entry->attributes());
+}
+
+string EntriesToString(const vector<const Entry *> &entries) {
+  string result;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    result.append(EntryToString(entries[i]));
+    result.append("\n");
+  }
+  return result;
+}
+
+// Expects that |compiled| returns the same results as |table| for |key|.
+void ExpectSameLookUpResults(const Table &table, const Table &compiled,
+                             const string &key) {
+  SCOPED_TRACE(key);
+  EXPECT_EQ(EntryToString(table.LookUp(key)),
+            EntryToString(compiled.LookUp(key)));
+
+  size_t length = 0, compiled_length = 0;
+  bool fixed = false, compiled_fixed = false;
+  EXPECT_EQ(EntryToString(table.LookUpPrefix(key, &length, &fixed)),
+            EntryToString(compiled.LookUpPrefix(key, &compiled_length,
+                                                &compiled_fixed)));
+  EXPECT_EQ(length, compiled_length);
+  EXPECT_EQ(fixed, compiled_fixed);
+
+  vector<const Entry *> results, compiled_results;
+  table.LookUpPredictiveAll(key, &results);
+  compiled.LookUpPredictiveAll(key, &compiled_results);
+  EXPECT_EQ(EntriesToString(results), EntriesToString(compiled_results));
+
+  EXPECT_EQ(table.HasSubRules(key), compiled.HasSubRules(key));
+  EXPECT_EQ(table.HasNewChunkEntry(key), compiled.HasNewChunkEntry(key));
+}
+
+}  // namespace
+
+TEST_F(TableTest, Compile) {
+  const char *kTableFiles[] = {
+    "system://romanji-hiragana.tsv",
+    "system://kana.tsv",
+    "system://12keys-hiragana.tsv",
+    "system://toggle_flick-hiragana.tsv",
+  };
+  for (size_t i = 0; i < arraysize(kTableFiles); ++i) {
+    SCOPED_TRACE(kTableFiles[i]);
+    Table table;
+    ASSERT_TRUE(table.LoadFromFile(kTableFiles[i]));
+    EXPECT_FALSE(table.is_compiled());
+    table.Compile();
+    EXPECT_TRUE(table.is_compiled());
+
+    // Compares with the trie of the same table, using the inputs of all the
+    // entries, their prefixes and their upper-case versions as keys.
+    Table uncompiled;
+    ASSERT_TRUE(uncompiled.LoadFromFile(kTableFiles[i]));
+    vector<const Entry *> entries;
+    table.LookUpPredictiveAll("", &entries);
+    ASSERT_FALSE(entries.empty());
+    ExpectSameLookUpResults(uncompiled, table, "");
+    for (size_t j = 0; j < entries.size(); ++j) {
+      const string &input = entries[j]->input();
+      for (size_t length = 1; length <= input.size(); ++length) {
+        ExpectSameLookUpResults(uncompiled, table, input.substr(0, length));
+      }
+      ExpectSameLookUpResults(uncompiled, table, input + "a");
+      string upper = input;
+      Util::UpperString(&upper);
+      ExpectSameLookUpResults(uncompiled, table, upper);
+    }
+  }
+}
+
+TEST_F(TableTest, AddRuleToCompiledTable) {
+  Table table;
+  InitTable(&table);
+  table.Compile();
+  EXPECT_EQ("\xe3\x81\x8b", GetResult(table, "ka"));  // "か"
+  EXPECT_EQ("<NULL>", GetResult(table, "sa"));
+
+  // Modifying the rules discards the automaton.
+  table.AddRule("sa", "\xe3\x81\x95", "");  // "さ"
+  EXPECT_FALSE(table.is_compiled());
+  EXPECT_EQ("\xe3\x81\x95", GetResult(table, "sa"));
+
+  table.Compile();
+  EXPECT_EQ("\xe3\x81\x95", GetResult(table, "sa"));
+  table.DeleteRule("ka");
+  EXPECT_FALSE(table.is_compiled());
+  EXPECT_EQ("<NULL>", GetResult(table, "ka"));
+}
+
 }  // namespace composer
 }  // namespace mozc
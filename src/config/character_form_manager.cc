@@ -30,6 +30,7 @@
 #include "config/character_form_manager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -560,13 +561,27 @@ class CharacterFormManager::Data {
     return conversion_.get();
   }
 
+  uint64 GetStorageGeneration() const {
+    return storage_.get() == NULL ? 0 : storage_->generation();
+  }
+
+  // Called after the rules or the storage are changed.
+  void IncrementGeneration() {
+    generation_.fetch_add(1);
+  }
+
+  uint64 generation() const {
+    return generation_.load();
+  }
+
  private:
   std::unique_ptr<PreeditCharacterFormManagerImpl> preedit_;
   std::unique_ptr<ConversionCharacterFormManagerImpl> conversion_;
   std::unique_ptr<LRUStorage> storage_;
+  std::atomic<uint64> generation_;
 };
 
-CharacterFormManager::Data::Data() {
+CharacterFormManager::Data::Data() : generation_(0) {
   const string filename = ConfigFileStream::GetFileName(kFileName);
   const uint32 key_type = 0;
   storage_.reset(LRUStorage::Create(filename.c_str(),
@@ -663,40 +678,57 @@ void CharacterFormManager::ClearHistory() {
   // GetPreeditManager()->ClearHistory();
   VLOG(1) << "CharacterFormManager::ClearHistory() is called";
   data_->GetConversionManager()->ClearHistory();
+  data_->IncrementGeneration();
 }
 
 void CharacterFormManager::Clear() {
   VLOG(1) << "CharacterFormManager::Clear() is called";
   data_->GetConversionManager()->Clear();
   data_->GetPreeditManager()->Clear();
+  data_->IncrementGeneration();
 }
 
 void CharacterFormManager::SetCharacterForm(
     const string &input, Config::CharacterForm form) {
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
+  const uint64 storage_generation = data_->GetStorageGeneration();
   data_->GetConversionManager()->SetCharacterForm(input, form);
+  if (data_->GetStorageGeneration() != storage_generation) {
+    data_->IncrementGeneration();
+  }
 }
 
 void CharacterFormManager::GuessAndSetCharacterForm(const string &input) {
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
+  const uint64 storage_generation = data_->GetStorageGeneration();
   data_->GetConversionManager()->GuessAndSetCharacterForm(input);
+  if (data_->GetStorageGeneration() != storage_generation) {
+    data_->IncrementGeneration();
+  }
 }
 
 void CharacterFormManager::AddPreeditRule(
     const string &input, Config::CharacterForm form) {
   data_->GetPreeditManager()->AddRule(input, form);
+  data_->IncrementGeneration();
 }
 
 void CharacterFormManager::AddConversionRule(
     const string &input, Config::CharacterForm form) {
   data_->GetConversionManager()->AddRule(input, form);
+  data_->IncrementGeneration();
 }
 
 void CharacterFormManager::SetDefaultRule() {
   data_->GetPreeditManager()->SetDefaultRule();
   data_->GetConversionManager()->SetDefaultRule();
+  data_->IncrementGeneration();
+}
+
+uint64 CharacterFormManager::generation() const {
+  return data_->generation();
 }
 
 namespace {
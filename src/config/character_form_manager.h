@@ -113,6 +113,10 @@ class CharacterFormManager {
   // Reload config explicitly.
   void ReloadConfig(const Config &config);
 
+  // Returns a number incremented whenever the rules or the stored character
+  // forms are changed.
+  uint64 generation() const;
+
   // Utility function: pass character form.
   static void ConvertWidth(const string &input, string *output,
                            Config::CharacterForm form);
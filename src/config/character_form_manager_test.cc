@@ -993,6 +993,32 @@ TEST_F(CharacterFormManagerTest, GroupTest) {
   }
 }
 
+TEST_F(CharacterFormManagerTest, Generation) {
+  CharacterFormManager *manager =
+      CharacterFormManager::GetCharacterFormManager();
+  manager->ClearHistory();
+
+  uint64 generation = manager->generation();
+  manager->Clear();
+  manager->AddConversionRule("0", config::Config::LAST_FORM);
+  EXPECT_NE(generation, manager->generation());
+
+  generation = manager->generation();
+  manager->SetCharacterForm("0", config::Config::HALF_WIDTH);
+  EXPECT_NE(generation, manager->generation());
+
+  // The same form is not stored again.
+  generation = manager->generation();
+  manager->SetCharacterForm("0", config::Config::HALF_WIDTH);
+  manager->GuessAndSetCharacterForm("1");
+  EXPECT_EQ(generation, manager->generation());
+
+  manager->GuessAndSetCharacterForm("\xEF\xBC\x91");  // "１"
+  EXPECT_NE(generation, manager->generation());
+  EXPECT_EQ(config::Config::FULL_WIDTH,
+            manager->GetConversionCharacterForm("0"));
+}
+
 TEST_F(CharacterFormManagerTest, GetFormTypesFromStringPair) {
   CharacterFormManager::FormType f1, f2;
 
@@ -37,6 +37,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -82,6 +83,12 @@ const int   kStructureCostOffset     = 3453;
 const int   kMinStructureCostOffset  = 1151;
 const int32 kStopEnmerationCacheSize = 15;
 
+// Returns true if |value| consists of one character, i.e.,
+// Util::CharsLen(value) == 1, without scanning the whole value.
+inline bool IsSingleCharacter(const string &value) {
+  return !value.empty() && Util::OneCharLen(value.data()) >= value.size();
+}
+
 // Returns true if the given node sequence is noisy weak compound.
 // Please refer to the comment in FilterCandidateInternal for the idea.
 inline bool IsNoisyWeakCompound(const vector<const Node *> &nodes,
@@ -155,6 +162,7 @@ CandidateFilter::CandidateFilter(
   CHECK(suppression_dictionary_);
   CHECK(pos_matcher_);
   CHECK(suggestion_filter_);
+  seen_.reserve(kMaxCandidatesSize);
 }
 
 CandidateFilter::~CandidateFilter() {}
@@ -167,6 +175,7 @@ void CandidateFilter::Reset() {
 CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
     const string &original_key,
     const Segment::Candidate *candidate,
+    uint64 value_fingerprint,
     const vector<const Node *> &nodes,
     Segments::RequestType request_type) {
   DCHECK(candidate);
@@ -266,7 +275,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // The candidate is already seen.
-  if (seen_.find(candidate->value) != seen_.end()) {
+  if (seen_.count(value_fingerprint) != 0) {
     return CandidateFilter::BAD_CANDIDATE;
   }
 
@@ -280,36 +289,41 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   //  - KagyoTaConnectionVerb(= 動詞,*,*,*,五段・カ行(促|イ)音便,連用タ接続",
   // "書い", "歩い", "言っ", etc) should not connect to verb suffix other
   // than TeSuffix
-  if (Util::GetScriptType(nodes[0]->value) != Util::HIRAGANA) {
-    if (nodes.size() >= 2) {
-      // For node sequence
-      if (pos_matcher_->IsKagyoTaConnectionVerb(nodes[0]->rid) &&
-          pos_matcher_->IsVerbSuffix(nodes[1]->lid) &&
-          !pos_matcher_->IsTeSuffix(nodes[1]->lid)) {
-        // "書い" | "ます", "過ぎ", etc
-        return CandidateFilter::BAD_CANDIDATE;
-      }
-      if (pos_matcher_->IsWagyoRenyoConnectionVerb(nodes[0]->rid) &&
-          pos_matcher_->IsTeSuffix(nodes[1]->lid)) {
-        // "買い" | "て"
-        return CandidateFilter::BAD_CANDIDATE;
-      }
+  // The POS ids are checked first, as the script type of the value is more
+  // expensive and almost all the candidates don't match the POS ids.
+  bool is_bad_verb_connection = false;
+  if (nodes.size() >= 2) {
+    // For node sequence
+    if (pos_matcher_->IsKagyoTaConnectionVerb(nodes[0]->rid) &&
+        pos_matcher_->IsVerbSuffix(nodes[1]->lid) &&
+        !pos_matcher_->IsTeSuffix(nodes[1]->lid)) {
+      // "書い" | "ます", "過ぎ", etc
+      is_bad_verb_connection = true;
     }
-    if (nodes[0]->lid != nodes[0]->rid) {
-      // For compound
-      if (pos_matcher_->IsKagyoTaConnectionVerb(nodes[0]->lid) &&
-          pos_matcher_->IsVerbSuffix(nodes[0]->rid) &&
-          !pos_matcher_->IsTeSuffix(nodes[0]->rid)) {
-        // "書い" | "ます", "過ぎ", etc
-        return CandidateFilter::BAD_CANDIDATE;
-      }
-      if (pos_matcher_->IsWagyoRenyoConnectionVerb(nodes[0]->lid) &&
-          pos_matcher_->IsTeSuffix(nodes[0]->rid)) {
-        // "買い" | "て"
-        return CandidateFilter::BAD_CANDIDATE;
-      }
+    if (pos_matcher_->IsWagyoRenyoConnectionVerb(nodes[0]->rid) &&
+        pos_matcher_->IsTeSuffix(nodes[1]->lid)) {
+      // "買い" | "て"
+      is_bad_verb_connection = true;
+    }
+  }
+  if (nodes[0]->lid != nodes[0]->rid) {
+    // For compound
+    if (pos_matcher_->IsKagyoTaConnectionVerb(nodes[0]->lid) &&
+        pos_matcher_->IsVerbSuffix(nodes[0]->rid) &&
+        !pos_matcher_->IsTeSuffix(nodes[0]->rid)) {
+      // "書い" | "ます", "過ぎ", etc
+      is_bad_verb_connection = true;
+    }
+    if (pos_matcher_->IsWagyoRenyoConnectionVerb(nodes[0]->lid) &&
+        pos_matcher_->IsTeSuffix(nodes[0]->rid)) {
+      // "買い" | "て"
+      is_bad_verb_connection = true;
     }
   }
+  if (is_bad_verb_connection &&
+      Util::GetScriptType(nodes[0]->value) != Util::HIRAGANA) {
+    return CandidateFilter::BAD_CANDIDATE;
+  }
 
   // The candidate consists of only one token
   if (nodes.size() == 1) {
@@ -318,7 +332,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // don't drop single character
-  if (Util::CharsLen(candidate->value) == 1) {
+  if (IsSingleCharacter(candidate->value)) {
     VLOG(1) << "don't filter single character";
     return CandidateFilter::GOOD_CANDIDATE;
   }
@@ -469,19 +483,20 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     const Segment::Candidate *candidate,
     const vector<const Node *> &nodes,
     Segments::RequestType request_type) {
+  const uint64 value_fingerprint = Hash::FastFingerprint(candidate->value);
   if (request_type == Segments::REVERSE_CONVERSION) {
     // In reverse conversion, only remove duplicates because the filtering
     // criteria of FilterCandidateInternal() are completely designed for
     // (forward) conversion.
-    const bool inserted = seen_.insert(candidate->value).second;
+    const bool inserted = seen_.insert(value_fingerprint).second;
     return inserted ? GOOD_CANDIDATE : BAD_CANDIDATE;
   } else {
-    const ResultType result = FilterCandidateInternal(original_key, candidate,
-                                                      nodes, request_type);
+    const ResultType result = FilterCandidateInternal(
+        original_key, candidate, value_fingerprint, nodes, request_type);
     if (result != GOOD_CANDIDATE) {
       return result;
     }
-    seen_.insert(candidate->value);
+    seen_.insert(value_fingerprint);
     return result;
   }
 }
@@ -30,8 +30,8 @@
 #ifndef MOZC_CONVERTER_CANDIDATE_FILTER_H_
 #define MOZC_CONVERTER_CANDIDATE_FILTER_H_
 
-#include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/port.h"
@@ -71,8 +71,10 @@ class CandidateFilter {
   void Reset();
 
  private:
+  // |value_fingerprint| is the fingerprint of |candidate->value|.
   ResultType FilterCandidateInternal(const string &original_key,
                                      const Segment::Candidate *candidate,
+                                     uint64 value_fingerprint,
                                      const vector<const Node *> &nodes,
                                      Segments::RequestType request_type);
 
@@ -80,7 +82,10 @@ class CandidateFilter {
   const dictionary::POSMatcher *pos_matcher_;
   const SuggestionFilter *suggestion_filter_;
 
-  set<string> seen_;
+  // Fingerprints of the values of the candidates seen so far, which are
+  // computed without copying the values.  The collision of 64-bit
+  // fingerprints is negligible for the number of candidates per segment.
+  std::unordered_set<uint64> seen_;
   const Segment::Candidate *top_candidate_;
   bool apply_suggestion_filter_for_exact_match_;
 
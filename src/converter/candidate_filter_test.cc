@@ -294,6 +294,126 @@ TEST_F(CandidateFilterTest, KatakanaT13N) {
   }
 }
 
+TEST_F(CandidateFilterTest, BadVerbConnection) {
+  std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
+  const uint16 kagyo_ta_id = pos_matcher().GetKagyoTaConnectionVerbId();
+  const uint16 wagyo_renyo_id = pos_matcher().GetWagyoRenyoConnectionVerbId();
+  const uint16 verb_suffix_id = pos_matcher().GetVerbSuffixId();
+  const uint16 te_suffix_id = pos_matcher().GetTeSuffixId();
+  ASSERT_FALSE(pos_matcher().IsTeSuffix(verb_suffix_id));
+
+  Segment::Candidate *c = NewCandidate();
+  c->key = "test";
+  c->value = "test";
+  vector<const Node *> nodes;
+  Node *n1 = NewNode();
+  Node *n2 = NewNode();
+  nodes.push_back(n1);
+  nodes.push_back(n2);
+
+  // "書い" | "ます"
+  n1->lid = kagyo_ta_id;
+  n1->rid = kagyo_ta_id;
+  n1->value = "\xE6\x9B\xB8\xE3\x81\x84";
+  n2->lid = verb_suffix_id;
+  n2->rid = verb_suffix_id;
+  n2->value = "\xE3\x81\xBE\xE3\x81\x99";
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    EXPECT_EQ(CandidateFilter::BAD_CANDIDATE,
+              filter->FilterCandidate("test", c, nodes, kRequestTypes[i]));
+    filter->Reset();
+  }
+
+  // "買い" | "て"
+  n1->lid = wagyo_renyo_id;
+  n1->rid = wagyo_renyo_id;
+  n1->value = "\xE8\xB2\xB7\xE3\x81\x84";
+  n2->lid = te_suffix_id;
+  n2->rid = te_suffix_id;
+  n2->value = "\xE3\x81\xA6";
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    EXPECT_EQ(CandidateFilter::BAD_CANDIDATE,
+              filter->FilterCandidate("test", c, nodes, kRequestTypes[i]));
+    filter->Reset();
+  }
+
+  // "かい" | "て" is not filtered, as the verb is written in Hiragana.
+  n1->value = "\xE3\x81\x8B\xE3\x81\x84";
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    EXPECT_EQ(CandidateFilter::GOOD_CANDIDATE,
+              filter->FilterCandidate("test", c, nodes, kRequestTypes[i]));
+    filter->Reset();
+  }
+
+  // Compound "書います"
+  nodes.resize(1);
+  n1->lid = kagyo_ta_id;
+  n1->rid = verb_suffix_id;
+  n1->value = "\xE6\x9B\xB8\xE3\x81\x84\xE3\x81\xBE\xE3\x81\x99";
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    EXPECT_EQ(CandidateFilter::BAD_CANDIDATE,
+              filter->FilterCandidate("test", c, nodes, kRequestTypes[i]));
+    filter->Reset();
+  }
+
+  // Compound "かいます"
+  n1->value = "\xE3\x81\x8B\xE3\x81\x84\xE3\x81\xBE\xE3\x81\x99";
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    EXPECT_EQ(CandidateFilter::GOOD_CANDIDATE,
+              filter->FilterCandidate("test", c, nodes, kRequestTypes[i]));
+    filter->Reset();
+  }
+}
+
+TEST_F(CandidateFilterTest, SingleCharacter) {
+  std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
+  vector<const Node *> nodes;
+  GetDefaultNodes(&nodes);
+  // nodes[1] is KatakanaT13N, which is filtered unless the candidate is a
+  // single character.
+  Node *n = NewNode();
+  n->lid = pos_matcher().GetFunctionalId();
+  n->rid = pos_matcher().GetFunctionalId();
+  n->key = "abc";
+  n->value = "abc";
+  nodes[1] = n;
+
+  const char *kSingleCharacters[] = {
+    "a",
+    "\xC3\xA9",  // "é"
+    "\xE4\xBA\x9C",  // "亜"
+    "\xF0\xA0\xAE\xB7",  // "𠮷"
+  };
+  for (size_t i = 0; i < arraysize(kSingleCharacters); ++i) {
+    Segment::Candidate *c = NewCandidate();
+    c->key = "abc";
+    c->value = kSingleCharacters[i];
+    for (size_t j = 0; j < arraysize(kRequestTypes); ++j) {
+      EXPECT_EQ(CandidateFilter::GOOD_CANDIDATE,
+                filter->FilterCandidate("abc", c, nodes, kRequestTypes[j]))
+          << c->value;
+      filter->Reset();
+    }
+  }
+
+  const char *kMultipleCharacters[] = {
+    "\xE4\xBA\x9C\xE4\xBA\x9C",  // "亜亜"
+    "\xE4\xBA\x9C" "a",  // "亜a"
+    "\xF0\xA0\xAE\xB7" "a",  // "𠮷a"
+  };
+  for (size_t i = 0; i < arraysize(kMultipleCharacters); ++i) {
+    Segment::Candidate *c = NewCandidate();
+    c->key = "abc";
+    c->value = kMultipleCharacters[i];
+    for (size_t j = 0; j < arraysize(kRequestTypes); ++j) {
+      EXPECT_EQ(CandidateFilter::BAD_CANDIDATE,
+                filter->FilterCandidate("abc", c, nodes, kRequestTypes[j]))
+          << c->value;
+      filter->Reset();
+    }
+  }
+}
+
 TEST_F(CandidateFilterTest, IsolatedWord) {
   std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
   vector<const Node *> nodes;
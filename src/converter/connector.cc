@@ -29,8 +29,6 @@
 
 #include "converter/connector.h"
 
-#include <algorithm>
-
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
@@ -59,6 +57,10 @@ inline uint32 EncodeKey(uint16 rid, uint16 lid) {
   return (static_cast<uint32>(rid) << 16) | lid;
 }
 
+inline uint64 EncodeCacheEntry(uint32 key, int value) {
+  return (static_cast<uint64>(key) << 32) | static_cast<uint32>(value);
+}
+
 }  // namespace
 
 class Connector::Row {
@@ -128,8 +130,7 @@ Connector::Connector(const char *connection_data,
     : default_cost_(nullptr),
       cache_size_(cache_size),
       cache_hash_mask_(cache_size - 1),
-      cache_key_(new uint32[cache_size]),
-      cache_value_(new int[cache_size]) {
+      cache_(new std::atomic<uint64>[cache_size]) {
   const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
   CHECK_EQ(kConnectorMagicNumber, ptr[0]);
   resolution_ = ptr[1];
@@ -186,12 +187,13 @@ Connector::~Connector() {
 int Connector::GetTransitionCost(uint16 rid, uint16 lid) const {
   const uint32 index = EncodeKey(rid, lid);
   const uint32 bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  const uint64 entry = cache_[bucket].load(std::memory_order_relaxed);
+  if (static_cast<uint32>(entry >> 32) == index) {
+    return static_cast<int>(static_cast<uint32>(entry));
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket].store(EncodeCacheEntry(index, value),
+                       std::memory_order_relaxed);
   return value;
 }
 
@@ -200,7 +202,10 @@ int Connector::GetResolution() const {
 }
 
 void Connector::ClearCache() {
-  std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
+  const uint64 invalid_entry = EncodeCacheEntry(kInvalidCacheKey, 0);
+  for (int i = 0; i < cache_size_; ++i) {
+    cache_[i].store(invalid_entry, std::memory_order_relaxed);
+  }
 }
 
 int Connector::LookupCost(uint16 rid, uint16 lid) const {
@@ -30,6 +30,7 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -50,6 +51,7 @@ class Connector {
             int cache_size);
   ~Connector();
 
+  // Thread-safe.  The cache may be shared by concurrent conversions.
   int GetTransitionCost(uint16 rid, uint16 lid) const;
   int GetResolution() const;
 
@@ -66,8 +68,10 @@ class Connector {
 
   const int cache_size_;
   const uint32 cache_hash_mask_;
-  mutable std::unique_ptr<uint32[]> cache_key_;
-  mutable std::unique_ptr<int[]> cache_value_;
+  // Each entry packs the key in the upper 32 bits and the cost in the lower
+  // 32 bits, so that a lookup never sees the key and the cost of different
+  // entries written by other threads.
+  mutable std::unique_ptr<std::atomic<uint64>[]> cache_;
 
   DISALLOW_COPY_AND_ASSIGN(Connector);
 };
@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "base/mmap.h"
+#include "base/thread_pool.h"
 #include "data_manager/connection_file_reader.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
@@ -50,6 +51,19 @@ struct ConnectionDataEntry {
 
 #ifndef OS_NACL
 // Disabled on NaCl since it uses a mock file system.
+void LoadRawData(vector<ConnectionDataEntry> *data) {
+  const string connection_text_path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection_single_column.txt"});
+  for (ConnectionFileReader reader(connection_text_path);
+       !reader.done(); reader.Next()) {
+    ConnectionDataEntry entry;
+    entry.rid = reader.rid_of_left_node();
+    entry.lid = reader.lid_of_right_node();
+    entry.cost = reader.cost();
+    data->push_back(entry);
+  }
+}
+
 TEST(ConnectorTest, CompareWithRawData) {
   const string path = testing::GetSourceFileOrDie({
       "data_manager", "testing", "connection.data"});
@@ -59,17 +73,8 @@ TEST(ConnectorTest, CompareWithRawData) {
       new Connector(cmmap.begin(), cmmap.size(), 256));
   ASSERT_EQ(1, connector->GetResolution());
 
-  const string connection_text_path = testing::GetSourceFileOrDie({
-      "data_manager", "testing", "connection_single_column.txt"});
   vector<ConnectionDataEntry> data;
-  for (ConnectionFileReader reader(connection_text_path);
-       !reader.done(); reader.Next()) {
-    ConnectionDataEntry entry;
-    entry.rid = reader.rid_of_left_node();
-    entry.lid = reader.lid_of_right_node();
-    entry.cost = reader.cost();
-    data.push_back(entry);
-  }
+  LoadRawData(&data);
 
   for (int trial = 0; trial < 3; ++trial) {
     // Lookup in random order for a few times.
@@ -84,6 +89,38 @@ TEST(ConnectorTest, CompareWithRawData) {
     }
   }
 }
+
+TEST(ConnectorTest, ConcurrentLookup) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  // A small cache so that the threads keep overwriting the same entries.
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 16));
+
+  vector<ConnectionDataEntry> data;
+  LoadRawData(&data);
+
+  const int kNumTasks = 4;
+  vector<vector<ConnectionDataEntry>> shuffled(kNumTasks, data);
+  for (size_t i = 0; i < shuffled.size(); ++i) {
+    std::random_shuffle(shuffled[i].begin(), shuffled[i].end());
+  }
+  vector<int> num_errors(kNumTasks, 0);
+  ThreadPool pool(kNumTasks - 1, "ConnectorTest");
+  ThreadPool::ParallelFor(&pool, 0, kNumTasks, [&](int task) {
+    for (size_t i = 0; i < shuffled[task].size(); ++i) {
+      const ConnectionDataEntry &entry = shuffled[task][i];
+      if (connector->GetTransitionCost(entry.rid, entry.lid) != entry.cost) {
+        ++num_errors[task];
+      }
+    }
+  });
+  for (int task = 0; task < kNumTasks; ++task) {
+    EXPECT_EQ(0, num_errors[task]) << "task: " << task;
+  }
+}
 #endif  // !OS_NACL
 
 }  // namespace
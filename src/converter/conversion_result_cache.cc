@@ -0,0 +1,100 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/conversion_result_cache.h"
+
+#include "base/logging.h"
+
+namespace mozc {
+
+ConversionResultCache::Stats::Stats()
+    : hits(0), misses(0), hit_microseconds(0), miss_microseconds(0) {}
+
+ConversionResultCache::ConversionResultCache(size_t size) : cache_(size) {
+  DCHECK_GT(size, 0);
+}
+
+ConversionResultCache::~ConversionResultCache() {}
+
+bool ConversionResultCache::Lookup(uint64 key, Segments *segments) {
+  DCHECK(segments);
+  scoped_lock l(&mutex_);
+  const Segments *cached = cache_.Lookup(key);
+  if (cached == NULL) {
+    ++stats_.misses;
+    return false;
+  }
+  ++stats_.hits;
+  segments->clear_conversion_segments();
+  for (size_t i = 0; i < cached->segments_size(); ++i) {
+    segments->add_segment()->CopyFrom(cached->segment(i));
+  }
+  return true;
+}
+
+void ConversionResultCache::Insert(uint64 key, const Segments &segments) {
+  scoped_lock l(&mutex_);
+  storage::LRUCache<uint64, Segments>::Element *element = cache_.Insert(key);
+  if (element == NULL) {
+    return;
+  }
+  // The evicted element is reused, so its segments are cleared first.
+  Segments *cached = &element->value;
+  cached->Clear();
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    cached->add_segment()->CopyFrom(segments.conversion_segment(i));
+  }
+}
+
+void ConversionResultCache::Clear() {
+  scoped_lock l(&mutex_);
+  cache_.Clear();
+}
+
+void ConversionResultCache::AddLatency(bool hit, uint64 microseconds) {
+  scoped_lock l(&mutex_);
+  if (hit) {
+    stats_.hit_microseconds += microseconds;
+  } else {
+    stats_.miss_microseconds += microseconds;
+  }
+}
+
+ConversionResultCache::Stats ConversionResultCache::GetStats() const {
+  scoped_lock l(&mutex_);
+  return stats_;
+}
+
+void ConversionResultCache::ClearStats() {
+  scoped_lock l(&mutex_);
+  stats_ = Stats();
+}
+
+}  // namespace mozc
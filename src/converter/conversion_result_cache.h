@@ -0,0 +1,89 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_CONVERTER_CONVERSION_RESULT_CACHE_H_
+#define MOZC_CONVERTER_CONVERSION_RESULT_CACHE_H_
+
+#include <memory>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "converter/segments.h"
+#include "storage/lru_cache.h"
+
+namespace mozc {
+
+// A bounded LRU cache of the finished conversion segments, keyed by a
+// fingerprint of everything the conversion depends on.  The caller is
+// responsible for making the key, including the generations of the user data,
+// so that a stale result is never looked up.  All the methods are
+// thread-safe.
+class ConversionResultCache {
+ public:
+  struct Stats {
+    Stats();
+
+    uint64 hits;
+    uint64 misses;
+    // The sums of the end-to-end latencies of the conversions.
+    uint64 hit_microseconds;
+    uint64 miss_microseconds;
+  };
+
+  explicit ConversionResultCache(size_t size);
+  ~ConversionResultCache();
+
+  // Replaces the conversion segments of |segments| with the ones cached for
+  // |key|.  The history segments are kept.  Returns false on miss.
+  bool Lookup(uint64 key, Segments *segments);
+
+  // Stores the conversion segments of |segments| for |key|.
+  void Insert(uint64 key, const Segments &segments);
+
+  // Removes all the entries.  The memory is kept for reuse.
+  void Clear();
+
+  // Adds the end-to-end latency of a conversion to the statistics.
+  void AddLatency(bool hit, uint64 microseconds);
+
+  Stats GetStats() const;
+  void ClearStats();
+
+ private:
+  mutable Mutex mutex_;
+  storage::LRUCache<uint64, Segments> cache_;
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConversionResultCache);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_CONVERSION_RESULT_CACHE_H_
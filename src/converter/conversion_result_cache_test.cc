@@ -0,0 +1,128 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/conversion_result_cache.h"
+
+#include "converter/segments.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void AddSegment(const string &key, const string &value,
+                Segment::SegmentType type, Segments *segments) {
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  segment->set_segment_type(type);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->Init();
+  candidate->key = key;
+  candidate->value = value;
+  candidate->content_key = key;
+  candidate->content_value = value;
+}
+
+}  // namespace
+
+TEST(ConversionResultCacheTest, LookupAndInsert) {
+  ConversionResultCache cache(4);
+
+  Segments segments;
+  AddSegment("history", "HISTORY", Segment::HISTORY, &segments);
+  AddSegment("key", "VALUE", Segment::FREE, &segments);
+  EXPECT_FALSE(cache.Lookup(1, &segments));
+  cache.Insert(1, segments);
+
+  Segments result;
+  AddSegment("other_history", "OTHER", Segment::HISTORY, &result);
+  AddSegment("stale", "STALE", Segment::FREE, &result);
+  AddSegment("stale2", "STALE2", Segment::FREE, &result);
+  ASSERT_TRUE(cache.Lookup(1, &result));
+
+  // The history segments of the destination are kept as they are.
+  ASSERT_EQ(1, result.history_segments_size());
+  EXPECT_EQ("other_history", result.history_segment(0).key());
+  ASSERT_EQ(1, result.conversion_segments_size());
+  EXPECT_EQ("key", result.conversion_segment(0).key());
+  ASSERT_EQ(1, result.conversion_segment(0).candidates_size());
+  EXPECT_EQ("VALUE", result.conversion_segment(0).candidate(0).value);
+
+  const ConversionResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+}
+
+TEST(ConversionResultCacheTest, Eviction) {
+  ConversionResultCache cache(2);
+  Segments segments;
+  AddSegment("key", "VALUE", Segment::FREE, &segments);
+  cache.Insert(1, segments);
+  cache.Insert(2, segments);
+  cache.Insert(3, segments);
+
+  Segments result;
+  EXPECT_FALSE(cache.Lookup(1, &result));
+  EXPECT_TRUE(cache.Lookup(2, &result));
+  EXPECT_TRUE(cache.Lookup(3, &result));
+}
+
+TEST(ConversionResultCacheTest, Clear) {
+  ConversionResultCache cache(2);
+  Segments segments;
+  AddSegment("key", "VALUE", Segment::FREE, &segments);
+  cache.Insert(1, segments);
+  cache.Clear();
+
+  Segments result;
+  EXPECT_FALSE(cache.Lookup(1, &result));
+
+  // The cache is still usable after Clear().
+  cache.Insert(1, segments);
+  EXPECT_TRUE(cache.Lookup(1, &result));
+}
+
+TEST(ConversionResultCacheTest, Stats) {
+  ConversionResultCache cache(2);
+  cache.AddLatency(true, 10);
+  cache.AddLatency(true, 20);
+  cache.AddLatency(false, 300);
+
+  ConversionResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(30, stats.hit_microseconds);
+  EXPECT_EQ(300, stats.miss_microseconds);
+
+  cache.ClearStats();
+  stats = cache.GetStats();
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+  EXPECT_EQ(0, stats.hit_microseconds);
+  EXPECT_EQ(0, stats.miss_microseconds);
+}
+
+}  // namespace mozc
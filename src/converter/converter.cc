@@ -34,17 +34,23 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "composer/composer.h"
+#include "converter/conversion_result_cache.h"
 #include "converter/immutable_converter_interface.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
 #include "transliteration/transliteration.h"
@@ -52,6 +58,7 @@
 
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::SuppressionDictionary;
+using mozc::dictionary::UserDictionary;
 using mozc::usage_stats::UsageStats;
 
 namespace mozc {
@@ -206,11 +213,84 @@ bool TryNormalizingKeyAsMathExpression(StringPiece s, string *key) {
   return true;
 }
 
+void AppendStringToCacheKey(const string &str, string *cache_key) {
+  const uint32 size = static_cast<uint32>(str.size());
+  cache_key->append(reinterpret_cast<const char *>(&size), sizeof(size));
+  cache_key->append(str);
+}
+
+void AppendIntegerToCacheKey(uint64 value, string *cache_key) {
+  cache_key->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Returns the fingerprint of everything the result of the conversion of
+// |segments| depends on, except for the user data, of which generations are
+// given.  The composition is used by the rewriters, e.g., for the
+// transliterations, and the history segments give the left context.  The
+// transliterations themselves are not computed as they are slow and determined
+// by the raw string, the modes and the table, which is chosen by the request
+// and the config.
+uint64 GetConversionResultCacheKey(const ConversionRequest &request,
+                                   const Segments &segments,
+                                   uint64 user_dictionary_generation,
+                                   uint64 learning_generation) {
+  string cache_key;
+  DCHECK_EQ(1, segments.conversion_segments_size());
+  AppendStringToCacheKey(segments.conversion_segment(0).key(), &cache_key);
+
+  const composer::Composer &composer = request.composer();
+  string str;
+  composer.GetRawString(&str);
+  AppendStringToCacheKey(str, &cache_key);
+  composer.GetStringForPreedit(&str);
+  AppendStringToCacheKey(str, &cache_key);
+  AppendStringToCacheKey(composer.source_text(), &cache_key);
+  AppendIntegerToCacheKey(composer.GetCursor(), &cache_key);
+  AppendIntegerToCacheKey(composer.GetInputMode(), &cache_key);
+  AppendIntegerToCacheKey(composer.GetOutputMode(), &cache_key);
+  AppendIntegerToCacheKey(composer.GetInputFieldType(), &cache_key);
+
+  AppendIntegerToCacheKey(segments.history_segments_size(), &cache_key);
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    AppendStringToCacheKey(segment.key(), &cache_key);
+    AppendIntegerToCacheKey(segment.segment_type(), &cache_key);
+    AppendIntegerToCacheKey(segment.candidates_size(), &cache_key);
+    if (segment.candidates_size() > 0) {
+      const Segment::Candidate &candidate = segment.candidate(0);
+      AppendStringToCacheKey(candidate.key, &cache_key);
+      AppendStringToCacheKey(candidate.value, &cache_key);
+      AppendStringToCacheKey(candidate.content_key, &cache_key);
+      AppendStringToCacheKey(candidate.content_value, &cache_key);
+      AppendIntegerToCacheKey(candidate.lid, &cache_key);
+      AppendIntegerToCacheKey(candidate.rid, &cache_key);
+      AppendIntegerToCacheKey(candidate.attributes, &cache_key);
+    }
+  }
+  AppendIntegerToCacheKey(segments.max_history_segments_size(), &cache_key);
+  AppendIntegerToCacheKey(segments.max_conversion_candidates_size(),
+                          &cache_key);
+  AppendIntegerToCacheKey(segments.user_history_enabled(), &cache_key);
+
+  AppendStringToCacheKey(request.request().SerializeAsString(), &cache_key);
+  AppendStringToCacheKey(request.config().SerializeAsString(), &cache_key);
+  AppendIntegerToCacheKey(request.composer_key_selection(), &cache_key);
+  AppendIntegerToCacheKey(request.create_partial_candidates(), &cache_key);
+  AppendIntegerToCacheKey(request.skip_slow_rewriters(), &cache_key);
+  AppendIntegerToCacheKey(
+      request.use_actual_converter_for_realtime_conversion(), &cache_key);
+
+  AppendIntegerToCacheKey(user_dictionary_generation, &cache_key);
+  AppendIntegerToCacheKey(learning_generation, &cache_key);
+  return Hash::Fingerprint(cache_key);
+}
+
 }  // namespace
 
 ConverterImpl::ConverterImpl() : pos_matcher_(NULL),
                                  immutable_converter_(NULL),
-                                 general_noun_id_(kuint16max) {
+                                 general_noun_id_(kuint16max),
+                                 user_dictionary_(NULL) {
 }
 
 ConverterImpl::~ConverterImpl() {}
@@ -229,6 +309,21 @@ void ConverterImpl::Init(const POSMatcher *pos_matcher,
   general_noun_id_ = pos_matcher_->GetGeneralNounId();
 }
 
+void ConverterImpl::EnableConversionResultCache(
+    size_t size, const UserDictionary *user_dictionary) {
+  DCHECK_GT(size, 0);
+  result_cache_.reset(new ConversionResultCache(size));
+  user_dictionary_ = user_dictionary;
+}
+
+ConversionResultCache::Stats
+ConverterImpl::GetConversionResultCacheStats() const {
+  if (result_cache_.get() == NULL) {
+    return ConversionResultCache::Stats();
+  }
+  return result_cache_->GetStats();
+}
+
 bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
   if (!request.has_composer()) {
@@ -253,12 +348,53 @@ bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
 
   SetKey(segments, conversion_key);
   segments->set_request_type(Segments::CONVERSION);
+  if (result_cache_.get() != NULL) {
+    return StartConversionWithResultCache(request, segments);
+  }
   immutable_converter_->ConvertForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
   return IsValidSegments(request, *segments);
 }
 
+bool ConverterImpl::StartConversionWithResultCache(
+    const ConversionRequest &request, Segments *segments) const {
+  // The lazy expansion of the candidates needs the lattice, which is not
+  // cached.
+  if (segments->initial_conversion_candidates_size() != 0) {
+    immutable_converter_->ConvertForRequest(request, segments);
+    RewriteAndSuppressCandidates(request, segments);
+    TrimCandidates(request, segments);
+    return IsValidSegments(request, *segments);
+  }
+
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  // The key is made before the conversion, so that a result computed with the
+  // user data being updated is stored for the old generation.
+  const uint64 cache_key = GetConversionResultCacheKey(
+      request, *segments,
+      (user_dictionary_ == NULL) ? 0 : user_dictionary_->generation(),
+      rewriter_->GetLearningGeneration());
+  if (result_cache_->Lookup(cache_key, segments)) {
+    // The state of the previous lazy expansion refers to the lattice of
+    // another conversion.
+    segments->set_expansion_state(NULL);
+    result_cache_->AddLatency(true, stopwatch.GetElapsedMicroseconds());
+    return true;
+  }
+
+  immutable_converter_->ConvertForRequest(request, segments);
+  RewriteAndSuppressCandidates(request, segments);
+  TrimCandidates(request, segments);
+  const bool is_valid = IsValidSegments(request, *segments);
+  // Only the valid results are cached.
+  if (is_valid && !rewriter_->IsVolatile(request, *segments)) {
+    result_cache_->Insert(cache_key, *segments);
+  }
+  result_cache_->AddLatency(false, stopwatch.GetElapsedMicroseconds());
+  return is_valid;
+}
+
 bool ConverterImpl::StartConversion(Segments *segments,
                                     const string &key) const {
   if (key.empty()) {
@@ -926,6 +1062,69 @@ void ConverterImpl::RewriteAndSuppressCandidates(
   }
 }
 
+bool ConverterImpl::ExpandSegmentCandidates(const ConversionRequest &request,
+                                            Segments *segments,
+                                            size_t segment_index,
+                                            size_t candidates_size) const {
+  if (segment_index >= segments->conversion_segments_size()) {
+    return false;
+  }
+  Segment *segment = segments->mutable_conversion_segment(segment_index);
+  const mozc::commands::Request &request_proto = request.request();
+  if (request_proto.has_candidates_size_limit()) {
+    const int candidates_limit =
+        max(1, request_proto.candidates_size_limit() -
+                   static_cast<int>(segment->meta_candidates_size()));
+    candidates_size =
+        min(candidates_size, static_cast<size_t>(candidates_limit));
+  }
+
+  bool expanded = false;
+  while (segment->candidates_size() < candidates_size) {
+    const size_t old_size = segment->candidates_size();
+    if (!immutable_converter_->ExpandCandidates(
+            segments, segment_index, candidates_size - old_size)) {
+      break;
+    }
+
+    // The rewriters are applied only to the new candidates.  They are moved to
+    // a segments which consists of the history segments and this segment, so
+    // the candidates already shown to the user are never reordered.
+    Segments expansion;
+    expansion.set_request_type(segments->request_type());
+    expansion.set_user_history_enabled(segments->user_history_enabled());
+    expansion.set_max_history_segments_size(
+        segments->max_history_segments_size());
+    for (size_t i = 0; i < segments->history_segments_size(); ++i) {
+      expansion.add_segment()->CopyFrom(segments->history_segment(i));
+    }
+    Segment *new_segment = expansion.add_segment();
+    new_segment->set_key(segment->key());
+    new_segment->set_segment_type(segment->segment_type());
+    for (size_t i = old_size; i < segment->candidates_size(); ++i) {
+      new_segment->push_back_candidate()->CopyFrom(segment->candidate(i));
+    }
+    segment->erase_candidates(old_size, segment->candidates_size() - old_size);
+    RewriteAndSuppressCandidates(request, &expansion);
+
+    for (size_t i = 0; i < new_segment->candidates_size(); ++i) {
+      const Segment::Candidate &candidate = new_segment->candidate(i);
+      bool found = false;
+      for (size_t j = 0; j < segment->candidates_size(); ++j) {
+        if (segment->candidate(j).value == candidate.value) {
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        segment->push_back_candidate()->CopyFrom(candidate);
+        expanded = true;
+      }
+    }
+  }
+  return expanded;
+}
+
 void ConverterImpl::TrimCandidates(const ConversionRequest &request,
                                    Segments *segments) const {
   const mozc::commands::Request &request_proto = request.request();
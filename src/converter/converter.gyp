@@ -38,12 +38,14 @@
       'type': 'static_library',
       'sources': [
         '<(gen_out_mozc_dir)/dictionary/pos_matcher.h',
+        'conversion_result_cache.cc',
         'converter.cc',
       ],
       'dependencies': [
         '../composer/composer.gyp:composer',
         '../data_manager/data_manager.gyp:user_pos_manager',
         '../dictionary/dictionary_base.gyp:pos_matcher',
+        '../dictionary/dictionary_base.gyp:user_dictionary',
         '../prediction/prediction.gyp:prediction',
         '../prediction/prediction.gyp:prediction_protocol',
         '../protocol/protocol.gyp:commands_proto',
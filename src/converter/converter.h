@@ -33,6 +33,7 @@
 #include <memory>
 #include <string>
 
+#include "converter/conversion_result_cache.h"
 #include "converter/converter_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
@@ -47,6 +48,10 @@ class PredictorInterface;
 class RewriterInterface;
 class Segments;
 
+namespace dictionary {
+class UserDictionary;
+}  // namespace dictionary
+
 class ConverterImpl : public ConverterInterface {
  public:
   ConverterImpl();
@@ -59,6 +64,18 @@ class ConverterImpl : public ConverterInterface {
             RewriterInterface *rewriter,
             ImmutableConverterInterface *immutable_converter);
 
+  // Enables the cache of the results of StartConversionForRequest() with at
+  // most |size| entries.  A result is reused for the same key, composition,
+  // history segments, request and config while the user data is unchanged,
+  // i.e., the generations of |user_dictionary| and the data learned by the
+  // rewriters are unchanged.  |user_dictionary| can be NULL.
+  void EnableConversionResultCache(
+      size_t size, const dictionary::UserDictionary *user_dictionary);
+
+  // Returns the hits, misses and latencies of the cache.  All zero if the
+  // cache is disabled.
+  ConversionResultCache::Stats GetConversionResultCacheStats() const;
+
   bool Predict(const ConversionRequest &request,
                const string &key,
                const Segments::RequestType request_type,
@@ -121,6 +138,10 @@ class ConverterImpl : public ConverterInterface {
                              size_t segments_size,
                              const uint8 *new_size_array,
                              size_t array_size) const;
+  virtual bool ExpandSegmentCandidates(const ConversionRequest &request,
+                                       Segments *segments,
+                                       size_t segment_index,
+                                       size_t candidates_size) const;
 
  private:
   FRIEND_TEST(ConverterTest, CompletePOSIds);
@@ -135,6 +156,11 @@ class ConverterImpl : public ConverterInterface {
   // input strings. This function estimates IDs from value heuristically.
   void CompletePOSIds(Segment::Candidate *candidate) const;
 
+  // StartConversionForRequest() with the conversion result cache, for
+  // |segments| of which conversion key is already set.
+  bool StartConversionWithResultCache(const ConversionRequest &request,
+                                      Segments *segments) const;
+
   bool CommitSegmentValueInternal(Segments *segments,
                                   size_t segment_index,
                                   int candidate_index,
@@ -179,6 +205,8 @@ class ConverterImpl : public ConverterInterface {
   std::unique_ptr<RewriterInterface> rewriter_;
   const ImmutableConverterInterface *immutable_converter_;
   uint16 general_noun_id_;
+  std::unique_ptr<ConversionResultCache> result_cache_;
+  const dictionary::UserDictionary *user_dictionary_;
 };
 
 }  // namespace mozc
@@ -119,6 +119,18 @@ class ConverterInterface {
     return true;
   }
 
+  // Appends more candidates to the |segment_index|-th conversion segment
+  // until it has |candidates_size| candidates, when the segments were
+  // converted with Segments::initial_conversion_candidates_size().  Returns
+  // true if any candidate is appended.  The default implementation does not
+  // support the expansion.
+  virtual bool ExpandSegmentCandidates(const ConversionRequest &request,
+                                       Segments *segments,
+                                       size_t segment_index,
+                                       size_t candidates_size) const {
+    return false;
+  }
+
   // Commit candidate
   virtual bool CommitSegmentValue(Segments *segments,
                                   size_t segment_index,
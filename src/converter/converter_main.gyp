@@ -52,5 +52,23 @@
         'converter_base.gyp:segments',
       ],
     },
+    {
+      'target_name': 'nbest_generator_main',
+      'type': 'executable',
+      'sources': [
+        'nbest_generator_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        '../dictionary/dictionary.gyp:dictionary_impl',
+        '../dictionary/dictionary.gyp:suffix_dictionary',
+        '../dictionary/system/system_dictionary.gyp:system_dictionary',
+        '../dictionary/system/system_dictionary.gyp:value_dictionary',
+        '../prediction/prediction_base.gyp:suggestion_filter',
+        'converter_base.gyp:immutable_converter',
+        'converter_base.gyp:segments',
+      ],
+    },
   ],
 }
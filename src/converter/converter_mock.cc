@@ -188,6 +188,13 @@ void ConverterMock::SetResizeSegment2(Segments *segments, bool result) {
   resizesegment2_output_.return_value = result;
 }
 
+void ConverterMock::SetExpandSegmentCandidates(Segments *segments,
+                                               bool result) {
+  expandsegmentcandidates_output_.initialized = true;
+  expandsegmentcandidates_output_.segments.CopyFrom(*segments);
+  expandsegmentcandidates_output_.return_value = result;
+}
+
 void ConverterMock::GetStartConversionForRequest(
     Segments *segments, ConversionRequest *request) {
   segments->CopyFrom(startconversionwithrequest_input_.segments);
@@ -321,6 +328,14 @@ void ConverterMock::GetResizeSegment2(Segments *segments,
   *array_size = resizesegment2_input_.new_size_array.size();
 }
 
+void ConverterMock::GetExpandSegmentCandidates(Segments *segments,
+                                               size_t *segment_index,
+                                               size_t *candidates_size) {
+  segments->CopyFrom(expandsegmentcandidates_input_.segments);
+  *segment_index = expandsegmentcandidates_input_.segment_index;
+  *candidates_size = expandsegmentcandidates_input_.candidates_size;
+}
+
 bool ConverterMock::StartConversionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
   VLOG(2) << "mock function: StartConversion with ConversionRequest";
@@ -661,4 +676,21 @@ bool ConverterMock::ResizeSegment(Segments *segments,
   }
 }
 
+bool ConverterMock::ExpandSegmentCandidates(const ConversionRequest &request,
+                                            Segments *segments,
+                                            size_t segment_index,
+                                            size_t candidates_size) const {
+  VLOG(2) << "mock function: ExpandSegmentCandidates";
+  expandsegmentcandidates_input_.segments.CopyFrom(*segments);
+  expandsegmentcandidates_input_.segment_index = segment_index;
+  expandsegmentcandidates_input_.candidates_size = candidates_size;
+
+  if (!expandsegmentcandidates_output_.initialized) {
+    return false;
+  } else {
+    segments->CopyFrom(expandsegmentcandidates_output_.segments);
+    return expandsegmentcandidates_output_.return_value;
+  }
+}
+
 }  // namespace mozc
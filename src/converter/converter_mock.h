@@ -67,6 +67,7 @@ class ConverterMock : public ConverterInterface {
   void SetCommitSegments(Segments *segments, bool result);
   void SetResizeSegment1(Segments *segments, bool result);
   void SetResizeSegment2(Segments *segments, bool result);
+  void SetExpandSegmentCandidates(Segments *segments, bool result);
 
   // get last input of respective functions
   void GetStartConversionForRequest(Segments *segments,
@@ -106,6 +107,8 @@ class ConverterMock : public ConverterInterface {
   void GetResizeSegment2(Segments *segments, size_t *start_segment_index,
                         size_t *segments_size, uint8 **new_size_array,
                         size_t *array_size);
+  void GetExpandSegmentCandidates(Segments *segments, size_t *segment_index,
+                                  size_t *candidates_size);
 
   // ConverterInterface
   bool StartConversionForRequest(const ConversionRequest &request,
@@ -163,6 +166,10 @@ class ConverterMock : public ConverterInterface {
                      size_t segments_size,
                      const uint8 *new_size_array,
                      size_t array_size) const;
+  bool ExpandSegmentCandidates(const ConversionRequest &request,
+                               Segments *segments,
+                               size_t segment_index,
+                               size_t candidates_size) const;
 
  private:
   struct ConverterOutput {
@@ -186,6 +193,7 @@ class ConverterMock : public ConverterInterface {
     vector<uint8> new_size_array;
     string current_segment_key;
     string new_segment_key;
+    size_t candidates_size;
     ConverterInput() {}
   };
 
@@ -213,6 +221,7 @@ class ConverterMock : public ConverterInterface {
   mutable ConverterInput submitsegments_input_;
   mutable ConverterInput resizesegment1_input_;
   mutable ConverterInput resizesegment2_input_;
+  mutable ConverterInput expandsegmentcandidates_input_;
 
   ConverterOutput startconversionwithrequest_output_;
   ConverterOutput startconversion_output_;
@@ -237,6 +246,7 @@ class ConverterMock : public ConverterInterface {
   ConverterOutput submitsegments_output_;
   ConverterOutput resizesegment1_output_;
   ConverterOutput resizesegment2_output_;
+  ConverterOutput expandsegmentcandidates_output_;
 };
 
 }  // namespace mozc
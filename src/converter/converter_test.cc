@@ -30,6 +30,7 @@
 #include "converter/converter.h"
 
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -119,6 +120,43 @@ class StubRewriter : public RewriterInterface {
   }
 };
 
+class VolatileRewriter : public RewriterInterface {
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    return true;
+  }
+
+  bool IsVolatile(const ConversionRequest &request,
+                  const Segments &segments) const override {
+    return true;
+  }
+};
+
+// Learns the committed values.  The generation is changed only when a new
+// value is learned.
+class LearningRewriter : public RewriterInterface {
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    return false;
+  }
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      const Segment &segment = segments->conversion_segment(i);
+      if (segment.candidates_size() > 0) {
+        learned_values_.insert(segment.candidate(0).value);
+      }
+    }
+  }
+
+  uint64 GetLearningGeneration() const override {
+    return learned_values_.size();
+  }
+
+ private:
+  set<string> learned_values_;
+};
+
 SuffixDictionary *CreateSuffixDictionaryFromDataManager(
     const DataManagerInterface &data_manager) {
   StringPiece suffix_key_array_data, suffix_value_array_data;
@@ -1486,6 +1524,116 @@ TEST_F(ConverterTest, ComposerKeySelection) {
   }
 }
 
+TEST_F(ConverterTest, ConversionResultCache) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateStubbedConverterAndData());
+  ConverterImpl *converter = converter_and_data->converter.get();
+  converter->EnableConversionResultCache(16, nullptr);
+
+  composer::Table table;
+  config::Config config;
+  composer::Composer composer(&table, &default_request(), &config);
+  composer.InsertCharacterPreedit(
+      "\xE3\x82\x8F\xE3\x81\x9F\xE3\x81\x97");  // "わたし"
+  ConversionRequest request(&composer, &default_request(), &config);
+
+  Segments expected;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &expected));
+  EXPECT_EQ(0, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(1, converter->GetConversionResultCacheStats().misses);
+
+  Segments segments;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments));
+  EXPECT_EQ(1, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(1, converter->GetConversionResultCacheStats().misses);
+  ASSERT_EQ(expected.conversion_segments_size(),
+            segments.conversion_segments_size());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &expected_segment = expected.conversion_segment(i);
+    const Segment &segment = segments.conversion_segment(i);
+    EXPECT_EQ(expected_segment.key(), segment.key());
+    ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      EXPECT_EQ(expected_segment.candidate(j).value,
+                segment.candidate(j).value);
+    }
+  }
+
+  // The history segments are another context.
+  converter->CommitSegmentValue(&segments, 0, 0);
+  Segments with_history;
+  with_history.CopyFrom(segments);
+  with_history.mutable_segment(0)->set_segment_type(Segment::HISTORY);
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &with_history));
+  EXPECT_EQ(1, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+  EXPECT_EQ(1, with_history.history_segments_size());
+
+  // Committing keeps the cache while the rewriters learn nothing.
+  converter->FinishConversion(request, &segments);
+  Segments after_commit;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &after_commit));
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+
+  // The result is not cached for the lazy expansion.
+  Segments lazy;
+  lazy.set_initial_conversion_candidates_size(1);
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &lazy));
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+}
+
+TEST_F(ConverterTest, ConversionResultCacheMissesAfterLearning) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateConverterAndData(new LearningRewriter, STUB_PREDICTOR));
+  ConverterImpl *converter = converter_and_data->converter.get();
+  converter->EnableConversionResultCache(16, nullptr);
+
+  composer::Table table;
+  config::Config config;
+  composer::Composer composer(&table, &default_request(), &config);
+  composer.InsertCharacterPreedit(
+      "\xE3\x82\x8F\xE3\x81\x9F\xE3\x81\x97");  // "わたし"
+  ConversionRequest request(&composer, &default_request(), &config);
+
+  // The first commit learns the value.
+  Segments segments1;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments1));
+  converter->FinishConversion(request, &segments1);
+  Segments segments2;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments2));
+  EXPECT_EQ(0, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+
+  // The second one learns nothing new.
+  converter->FinishConversion(request, &segments2);
+  Segments segments3;
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments3));
+  EXPECT_EQ(1, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+}
+
+TEST_F(ConverterTest, ConversionResultCacheSkipsVolatileResult) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateConverterAndData(new VolatileRewriter, STUB_PREDICTOR));
+  ConverterImpl *converter = converter_and_data->converter.get();
+  converter->EnableConversionResultCache(16, nullptr);
+
+  composer::Table table;
+  config::Config config;
+  composer::Composer composer(&table, &default_request(), &config);
+  composer.InsertCharacterPreedit(
+      "\xE3\x82\x8F\xE3\x81\x9F\xE3\x81\x97");  // "わたし"
+  ConversionRequest request(&composer, &default_request(), &config);
+  for (int i = 0; i < 2; ++i) {
+    Segments segments;
+    ASSERT_TRUE(converter->StartConversionForRequest(request, &segments));
+  }
+  EXPECT_EQ(0, converter->GetConversionResultCacheStats().hits);
+  EXPECT_EQ(2, converter->GetConversionResultCacheStats().misses);
+}
+
 TEST_F(ConverterTest, SuppressionDictionaryForRewriter) {
   std::unique_ptr<ConverterAndData> ret(
       CreateConverterAndDataWithInsertDummyWordsRewriter());
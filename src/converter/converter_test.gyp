@@ -38,6 +38,7 @@
       'type': 'executable',
       'sources': [
         'candidate_filter_test.cc',
+        'conversion_result_cache_test.cc',
         'converter_mock_test.cc',
         'converter_test.cc',
         'immutable_converter_test.cc',
@@ -108,6 +109,7 @@
         'connector_test.cc',
       ],
       'dependencies': [
+        '../base/base.gyp:base',
         '../data_manager/data_manager.gyp:connection_file_reader',
         '../data_manager/testing/mock_data_manager.gyp:gen_separate_connection_data_for_mock#host',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
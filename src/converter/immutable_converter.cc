@@ -37,10 +37,12 @@
 #include <utility>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
@@ -67,6 +69,11 @@ using mozc::dictionary::PosGroup;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::Token;
 
+DEFINE_int32(parallel_nbest_min_segments, 8,
+             "If positive, the N-best candidates of the segments are "
+             "generated in parallel on the default thread pool when the "
+             "conversion has at least this many segments.");
+
 namespace mozc {
 namespace {
 
@@ -269,8 +276,77 @@ Lattice *GetLattice(Segments *segments, bool is_prediction) {
   return lattice;
 }
 
+// Keeps the N-best generators of the conversion segments whose candidates
+// are not fully enumerated yet.  The generators refer to the lattice cached in
+// the segments, so this state must be released when the lattice is rebuilt.
+class LazyExpansionState : public Segments::ExpansionState {
+ public:
+  LazyExpansionState(const string &original_key, size_t expand_size)
+      : original_key_(original_key), expand_size_(expand_size) {}
+  virtual ~LazyExpansionState() {}
+
+  // Adds the generator for the next conversion segment.  |nbest| is NULL if
+  // the candidates of the segment are already exhausted.
+  void AddSegment(const string &key, NBestGenerator *nbest) {
+    keys_.push_back(key);
+    generators_.push_back(std::unique_ptr<NBestGenerator>(nbest));
+  }
+
+  // Returns the generator for the |segment_index|-th conversion segment, or
+  // NULL if it is exhausted or the segment has been modified since.  As the
+  // leading segments may have been committed, the conversion segments are
+  // matched against the last ones.
+  NBestGenerator *GetGenerator(const Segments &segments,
+                               size_t segment_index) const {
+    const size_t index = GetIndex(segments, segment_index);
+    return index < generators_.size() ? generators_[index].get() : NULL;
+  }
+
+  void ReleaseGenerator(const Segments &segments, size_t segment_index) {
+    const size_t index = GetIndex(segments, segment_index);
+    if (index < generators_.size()) {
+      generators_[index].reset();
+    }
+  }
+
+  const string &original_key() const { return original_key_; }
+  size_t expand_size() const { return expand_size_; }
+
+ private:
+  // Returns the index of the generator, or the size of |generators_| if not
+  // found.
+  size_t GetIndex(const Segments &segments, size_t segment_index) const {
+    const size_t size = segments.conversion_segments_size();
+    if (segment_index >= size || size > keys_.size()) {
+      return generators_.size();
+    }
+    const size_t offset = keys_.size() - size;
+    for (size_t i = 0; i < size; ++i) {
+      if (segments.conversion_segment(i).key() != keys_[offset + i]) {
+        return generators_.size();
+      }
+    }
+    return offset + segment_index;
+  }
+
+  const string original_key_;
+  const size_t expand_size_;
+  vector<string> keys_;
+  vector<std::unique_ptr<NBestGenerator>> generators_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyExpansionState);
+};
+
 }  // namespace
 
+// The range of the lattice to enumerate the candidates of |segment|.
+struct ImmutableConverterImpl::SegmentRange {
+  const Node *begin_node;
+  const Node *end_node;
+  NBestGenerator::BoundaryCheckMode mode;
+  Segment *segment;
+};
+
 ImmutableConverterImpl::ImmutableConverterImpl(
     const DictionaryInterface *dictionary,
     const DictionaryInterface *suffix_dictionary,
@@ -875,13 +951,94 @@ namespace {
 // calculated based on kVeryBigCost.
 const int kVeryBigCost = (INT_MAX >> 2);
 
+// The nodes ending at a position, contracted by their rid.  For each rid,
+// the node with the minimum cost is kept (the first one in the enext order
+// on tie), with its order in the list to break ties among the rids in the
+// same way as the plain scan over the list.  The fields are stored in
+// parallel arrays sorted by the rid so that the innermost loop of the Viterbi
+// search reads only contiguous memory instead of chasing the enext pointers.
+class LeftNodeTable {
+ public:
+  LeftNodeTable() {
+    rids_.reserve(128);
+    costs_.reserve(128);
+    orders_.reserve(128);
+    nodes_.reserve(128);
+  }
+
+  // Builds the table from the valid nodes in the list |lnodes|.
+  void Build(Node *lnodes) {
+    rids_.clear();
+    costs_.clear();
+    orders_.clear();
+    nodes_.clear();
+    int order = 0;
+    for (Node *lnode = lnodes; lnode != NULL; lnode = lnode->enext, ++order) {
+      if (lnode->prev == NULL) {
+        // Invalid lnode.
+        continue;
+      }
+      const vector<uint16>::iterator iter =
+          std::lower_bound(rids_.begin(), rids_.end(), lnode->rid);
+      const size_t i = iter - rids_.begin();
+      if (iter == rids_.end() || *iter != lnode->rid) {
+        rids_.insert(iter, lnode->rid);
+        costs_.insert(costs_.begin() + i, lnode->cost);
+        orders_.insert(orders_.begin() + i, order);
+        nodes_.insert(nodes_.begin() + i, lnode);
+      } else if (lnode->cost < costs_[i]) {
+        costs_[i] = lnode->cost;
+        orders_[i] = order;
+        nodes_[i] = lnode;
+      }
+    }
+  }
+
+  // Finds the node which connects to a node of |lid| with the minimum
+  // cost, which is exactly the same one as the scan over all the nodes
+  // finds.  Returns NULL if there is no such node.
+  Node *FindBest(const Connector &connector, uint16 lid,
+                 int *best_cost) const {
+    int cost_found = kVeryBigCost;
+    int order_found = INT_MAX;
+    Node *node_found = NULL;
+    for (size_t i = 0; i < rids_.size(); ++i) {
+      const int cost = costs_[i] + connector.GetTransitionCost(rids_[i], lid);
+      if (cost < cost_found ||
+          (cost == cost_found && node_found != NULL &&
+           orders_[i] < order_found)) {
+        cost_found = cost;
+        order_found = orders_[i];
+        node_found = nodes_[i];
+      }
+    }
+    *best_cost = cost_found;
+    return node_found;
+  }
+
+ private:
+  vector<uint16> rids_;
+  vector<int32> costs_;
+  vector<int32> orders_;
+  vector<Node *> nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(LeftNodeTable);
+};
+
+// Mapping from the lid of rnodes to (cost, Node) of the best lnode, sorted by
+// the lid.
+typedef vector<pair<uint16, pair<int, Node *>>> BestMapByLid;
+
 // Runs viterbi algorithm at position |pos|. The left_boundary/right_boundary
 // are the next boundary looked from pos. (If pos is on the boundary,
 // left_boundary should be the previous one, and right_boundary should be
-// the next).
+// the next).  |lnodes| and |best_by_lid| are the working space.
 inline void ViterbiInternal(
     const Connector &connector, size_t pos, size_t right_boundary,
-    Lattice *lattice) {
+    Lattice *lattice, LeftNodeTable *lnodes, BestMapByLid *best_by_lid) {
+  lnodes->Build(lattice->end_nodes(pos));
+  best_by_lid->clear();
+
   for (Node *rnode = lattice->begin_nodes(pos);
        rnode != NULL; rnode = rnode->bnext) {
     if (rnode->end_pos > right_boundary) {
@@ -905,25 +1062,21 @@ inline void ViterbiInternal(
     }
 
     // Find a valid node which connects to the rnode with minimum cost.
-    int best_cost = kVeryBigCost;
-    Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(pos);
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost + connector.GetTransitionCost(lnode->rid, rnode->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
-      }
-    }
-
-    rnode->prev = best_node;
-    rnode->cost = best_cost + rnode->wcost;
+    // The result depends only on the lid of the rnode.
+    const BestMapByLid::value_type key(
+        rnode->lid, pair<int, Node *>(kVeryBigCost, NULL));
+    BestMapByLid::iterator iter =
+        std::lower_bound(best_by_lid->begin(), best_by_lid->end(), key,
+                         OrderBy<FirstKey, Less>());
+    if (iter == best_by_lid->end() || iter->first != rnode->lid) {
+      int best_cost = kVeryBigCost;
+      Node *best_node = lnodes->FindBest(connector, rnode->lid, &best_cost);
+      iter = best_by_lid->insert(
+          iter, BestMapByLid::value_type(
+                    rnode->lid, std::make_pair(best_cost, best_node)));
+    }
+    rnode->prev = iter->second.second;
+    rnode->cost = iter->second.first + rnode->wcost;
   }
 }
 }  // namespace
@@ -960,6 +1113,9 @@ bool ImmutableConverterImpl::Viterbi(
 
   size_t left_boundary = 0;
   const size_t segments_size = segments.segments_size();
+  LeftNodeTable lnodes;
+  BestMapByLid best_by_lid;
+  best_by_lid.reserve(128);
 
   // Specialization for the first segment.
   // Don't run on the left boundary (the connection with BOS node),
@@ -968,7 +1124,8 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &lnodes,
+                      &best_by_lid);
     }
     left_boundary = right_boundary;
   }
@@ -979,7 +1136,8 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternal(*connector_, pos, right_boundary, lattice, &lnodes,
+                      &best_by_lid);
     }
     left_boundary = right_boundary;
   }
@@ -998,24 +1156,9 @@ bool ImmutableConverterImpl::Viterbi(
     left_boundary =
         key.size() - segments.segment(segments_size - 1).key().size();
     // Find a valid node which connects to the rnode with minimum cost.
+    lnodes.Build(lattice->end_nodes(key.size()));
     int best_cost = kVeryBigCost;
-    Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(key.size());
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost +
-          connector_->GetTransitionCost(lnode->rid, eos_node->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
-      }
-    }
-
+    Node *best_node = lnodes.FindBest(*connector_, eos_node->lid, &best_cost);
     eos_node->prev = best_node;
     eos_node->cost = best_cost + eos_node->wcost;
   }
@@ -1813,15 +1956,26 @@ void ImmutableConverterImpl::InsertCandidates(
           min(static_cast<size_t>(512), max_candidates_size));
 
   const bool is_single_segment = (type == SINGLE_SEGMENT);
-  NBestGenerator nbest_generator(
-      suppression_dictionary_, segmenter_, connector_, pos_matcher_,
-      &lattice, suggestion_filter_, (filter_type == DESKTOP));
 
   string original_key;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     original_key.append(segments->conversion_segment(i).key());
   }
 
+  // In lazy expansion mode, only the first |initial_size| candidates are
+  // generated here, and the generators are kept in the segments so that
+  // ExpandCandidates() can resume the enumeration.
+  const size_t initial_size = segments->initial_conversion_candidates_size();
+  std::unique_ptr<LazyExpansionState> expansion_state;
+  if (type == MULTI_SEGMENTS &&
+      segments->request_type() == Segments::CONVERSION &&
+      initial_size > 0 && initial_size < expand_size) {
+    expansion_state.reset(new LazyExpansionState(original_key, expand_size));
+  }
+
+  // Determines the segments first, as the N-best generation of a segment
+  // depends only on the lattice.
+  vector<SegmentRange> ranges;
   size_t begin_pos = string::npos;
   for (Node *node = prev->next; node->next != NULL; node = node->next) {
     if (begin_pos == string::npos) {
@@ -1844,14 +1998,12 @@ void ImmutableConverterImpl::InsertCandidates(
       // Boundary is specified. Skip boundary check in nbest generator.
       mode = NBestGenerator::ONLY_MID;
     }
-    nbest_generator.Reset(prev, node->next, mode);
-
-    ExpandCandidates(original_key, &nbest_generator, segment,
-                     segments->request_type(), expand_size);
-
-    if (type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) {
-      InsertDummyCandidates(segment, expand_size);
-    }
+    SegmentRange range;
+    range.begin_node = prev;
+    range.end_node = node->next;
+    range.mode = mode;
+    range.segment = segment;
+    ranges.push_back(range);
 
     if (node->node_type == Node::CON_NODE) {
       segment->set_segment_type(Segment::FIXED_VALUE);
@@ -1863,6 +2015,86 @@ void ImmutableConverterImpl::InsertCandidates(
     begin_pos = string::npos;
     prev = node;
   }
+
+  const Segments::RequestType request_type = segments->request_type();
+  const size_t size =
+      (expansion_state.get() != NULL) ? initial_size : expand_size;
+  vector<NBestGenerator *> lazy_generators(ranges.size(), NULL);
+  auto insert_candidates = [&](size_t i, NBestGenerator *nbest) {
+    if (expansion_state.get() == NULL) {
+      InsertCandidatesForSegment(original_key, ranges[i], request_type, type,
+                                 size, expand_size, nbest);
+      return;
+    }
+    // Each segment owns its generator to resume the enumeration later.
+    std::unique_ptr<NBestGenerator> lazy_nbest(new NBestGenerator(
+        suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+        &lattice, suggestion_filter_, (filter_type == DESKTOP)));
+    if (!InsertCandidatesForSegment(original_key, ranges[i], request_type,
+                                    type, size, expand_size,
+                                    lazy_nbest.get())) {
+      lazy_generators[i] = lazy_nbest.release();
+    }
+  };
+
+  // Each segment is written by only one task, and the result is identical to
+  // the sequential generation.  Since the segments of SINGLE_SEGMENT share
+  // the target segment, only MULTI_SEGMENTS is parallelized.
+  ThreadPool *pool = ThreadPool::GetDefault();
+  if (type == MULTI_SEGMENTS &&
+      FLAGS_parallel_nbest_min_segments > 0 &&
+      ranges.size() >=
+          static_cast<size_t>(FLAGS_parallel_nbest_min_segments) &&
+      pool->num_threads() > 0) {
+    // One generator per task, so that its free list is reused for the
+    // segments assigned to the task.
+    const size_t num_tasks =
+        min(ranges.size(), static_cast<size_t>(pool->num_threads() + 1));
+    ThreadPool::ParallelFor(
+        pool, 0, static_cast<int>(num_tasks), [&](int task) {
+          NBestGenerator nbest_generator(
+              suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+              &lattice, suggestion_filter_, (filter_type == DESKTOP));
+          for (size_t i = task; i < ranges.size(); i += num_tasks) {
+            insert_candidates(i, &nbest_generator);
+          }
+        });
+  } else {
+    NBestGenerator nbest_generator(
+        suppression_dictionary_, segmenter_, connector_, pos_matcher_,
+        &lattice, suggestion_filter_, (filter_type == DESKTOP));
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      insert_candidates(i, &nbest_generator);
+    }
+  }
+
+  if (expansion_state.get() != NULL) {
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      expansion_state->AddSegment(ranges[i].segment->key(),
+                                  lazy_generators[i]);
+    }
+    segments->set_expansion_state(expansion_state.release());
+  }
+}
+
+bool ImmutableConverterImpl::InsertCandidatesForSegment(
+    const string &original_key,
+    const SegmentRange &range,
+    Segments::RequestType request_type,
+    InsertCandidatesType type,
+    size_t size,
+    size_t expand_size,
+    NBestGenerator *nbest) const {
+  nbest->Reset(range.begin_node, range.end_node, range.mode);
+  ExpandCandidates(original_key, nbest, range.segment, request_type, size);
+  const bool exhausted = range.segment->candidates_size() < size;
+  // The dummy candidates are inserted after the last candidate.  In lazy
+  // expansion mode, it is when the enumeration is exhausted.
+  if ((type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) &&
+      (size == expand_size || exhausted)) {
+    InsertDummyCandidates(range.segment, expand_size);
+  }
+  return exhausted;
 }
 
 bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
@@ -1963,6 +2195,9 @@ bool ImmutableConverterImpl::ConvertForRequest(
       (segments->request_type() == Segments::PREDICTION ||
        segments->request_type() == Segments::SUGGESTION);
 
+  // The state of the previous lazy expansion refers to the lattice which is
+  // about to be rebuilt.
+  segments->set_expansion_state(NULL);
   Lattice *lattice = GetLattice(segments, is_prediction);
 
   if (!MakeLattice(request, segments, lattice)) {
@@ -1994,4 +2229,31 @@ bool ImmutableConverterImpl::ConvertForRequest(
   return true;
 }
 
+bool ImmutableConverterImpl::ExpandCandidates(
+    Segments *segments, size_t segment_index, size_t size) const {
+  DCHECK(segments);
+  LazyExpansionState *state =
+      static_cast<LazyExpansionState *>(segments->mutable_expansion_state());
+  if (state == NULL || size == 0) {
+    return false;
+  }
+  NBestGenerator *nbest = state->GetGenerator(*segments, segment_index);
+  if (nbest == NULL) {
+    return false;
+  }
+
+  Segment *segment = segments->mutable_conversion_segment(segment_index);
+  const size_t old_size = segment->candidates_size();
+  const size_t target_size =
+      min(state->expand_size(), old_size + size);
+  ExpandCandidates(state->original_key(), nbest, segment,
+                   segments->request_type(), target_size);
+  if (segment->candidates_size() < target_size ||
+      segment->candidates_size() >= state->expand_size()) {
+    InsertDummyCandidates(segment, state->expand_size());
+    state->ReleaseGenerator(*segments, segment_index);
+  }
+  return segment->candidates_size() > old_size;
+}
+
 }  // namespace mozc
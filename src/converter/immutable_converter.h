@@ -69,6 +69,8 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   virtual bool ConvertForRequest(
       const ConversionRequest &request, Segments *segments) const;
+  virtual bool ExpandCandidates(Segments *segments, size_t segment_index,
+                                size_t size) const;
 
  private:
   FRIEND_TEST(ImmutableConverterTest, AddPredictiveNodes);
@@ -76,6 +78,8 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesInnerSegmentBoundary);
   FRIEND_TEST(ImmutableConverterTest, NotConnectedTest);
   FRIEND_TEST(ImmutableConverterTest, PredictiveNodesOnlyForConversionKey);
+  FRIEND_TEST(ImmutableConverterTest, ViterbiBreaksTiesByListOrder);
+  FRIEND_TEST(NBestGeneratorTest, BucketQueueAgenda);
   FRIEND_TEST(NBestGeneratorTest, InnerSegmentBoundary);
   FRIEND_TEST(NBestGeneratorTest, MultiSegmentConnectionTest);
   FRIEND_TEST(NBestGeneratorTest, SingleSegmentConnectionTest);
@@ -96,6 +100,8 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
     MOBILE,
   };
 
+  struct SegmentRange;
+
   void ExpandCandidates(const string &original_key,
                         NBestGenerator *nbest, Segment *segment,
                         Segments::RequestType request_type,
@@ -160,6 +166,18 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                         InsertCandidatesType type,
                         FilterType filter_type) const;
 
+  // Helper function for InsertCandidates().
+  // Generates at most |size| candidates of |range| with |nbest|.  Returns
+  // true if the enumeration is exhausted.  Thread-safe as long as |nbest| and
+  // the segment of |range| are not shared.
+  bool InsertCandidatesForSegment(const string &original_key,
+                                  const SegmentRange &range,
+                                  Segments::RequestType request_type,
+                                  InsertCandidatesType type,
+                                  size_t size,
+                                  size_t expand_size,
+                                  NBestGenerator *nbest) const;
+
   // Helper function for InsertCandidates().
   // Returns true if |node| is valid node for segment end.
   bool IsSegmentEndNode(const Segments &segments,
@@ -49,4 +49,9 @@ bool ImmutableConverterInterface::ConvertForRequest(
   return false;
 }
 
+bool ImmutableConverterInterface::ExpandCandidates(
+    Segments *segments, size_t segment_index, size_t size) const {
+  return false;
+}
+
 }  // namespace mozc
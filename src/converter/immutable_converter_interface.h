@@ -30,6 +30,8 @@
 #ifndef MOZC_CONVERTER_IMMUTABLE_CONVERTER_INTERFACE_H_
 #define MOZC_CONVERTER_IMMUTABLE_CONVERTER_INTERFACE_H_
 
+#include <cstddef>
+
 namespace mozc {
 
 class ConversionRequest;
@@ -54,6 +56,14 @@ class ImmutableConverterInterface {
   virtual bool ConvertForRequest(
       const ConversionRequest &request, Segments *segments) const;
 
+  // Appends at most |size| more candidates to the |segment_index|-th
+  // conversion segment, continuing the N-best enumeration left by the last
+  // ConvertForRequest() with Segments::initial_conversion_candidates_size().
+  // Returns true if any candidate is appended.  The default implementation
+  // does not support the expansion and always returns false.
+  virtual bool ExpandCandidates(Segments *segments, size_t segment_index,
+                                size_t size) const;
+
  protected:
   ImmutableConverterInterface() {}
 };
@@ -29,15 +29,18 @@
 
 #include "converter/immutable_converter.h"
 
+#include <climits>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
@@ -60,6 +63,8 @@
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
+DECLARE_int32(parallel_nbest_min_segments);
+
 using mozc::dictionary::DictionaryImpl;
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
@@ -421,6 +426,103 @@ TEST(ImmutableConverterTest, NoInnerSegmenBoundaryForConversion) {
   }
 }
 
+TEST(ImmutableConverterTest, ExpandCandidatesLazily) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "ゆうき" has many candidates in the test dictionary.
+  const string kRequestKey = "\xe3\x82\x86\xe3\x81\x86\xe3\x81\x8d";
+
+  Segments expected;
+  expected.set_request_type(Segments::CONVERSION);
+  expected.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->Convert(&expected));
+  // Nothing to expand without the lazy expansion.
+  EXPECT_FALSE(converter->ExpandCandidates(&expected, 0, 10));
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  segments.set_initial_conversion_candidates_size(3);
+  segments.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->Convert(&segments));
+  ASSERT_EQ(expected.conversion_segments_size(),
+            segments.conversion_segments_size());
+
+  EXPECT_GT(expected.conversion_segment(0).candidates_size(),
+            segments.conversion_segment(0).candidates_size());
+
+  // Expanding the candidates in small batches yields the same candidates as
+  // the conversion at once.
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    while (converter->ExpandCandidates(&segments, i, 5)) {
+    }
+    const Segment &expected_segment = expected.conversion_segment(i);
+    const Segment &segment = segments.conversion_segment(i);
+    EXPECT_EQ(expected_segment.key(), segment.key());
+    ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      EXPECT_EQ(expected_segment.candidate(j).value,
+                segment.candidate(j).value);
+    }
+  }
+
+  // The state is released by the next conversion.
+  segments.set_initial_conversion_candidates_size(0);
+  EXPECT_TRUE(converter->Convert(&segments));
+  EXPECT_FALSE(converter->ExpandCandidates(&segments, 0, 10));
+}
+
+TEST(ImmutableConverterTest, GenerateCandidatesInParallel) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "わたしのなまえはなかのです" * 3
+  const string kKey =
+      "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3"
+      "\x81\xbe\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81"
+      "\xae\xe3\x81\xa7\xe3\x81\x99";
+  const string kRequestKey = kKey + kKey + kKey;
+  const int32 original_min_segments = FLAGS_parallel_nbest_min_segments;
+
+  FLAGS_parallel_nbest_min_segments = 0;
+  Segments expected;
+  expected.set_request_type(Segments::CONVERSION);
+  expected.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(converter->Convert(&expected));
+  ASSERT_LT(2, expected.conversion_segments_size());
+
+  ThreadPool pool(3, "ImmutableConverterTest");
+  ThreadPool::SetDefaultForTesting(&pool);
+  FLAGS_parallel_nbest_min_segments = 2;
+  // The parallel generation yields exactly the same candidates, with and
+  // without the lazy expansion.
+  for (size_t initial_size = 0; initial_size <= 3; initial_size += 3) {
+    Segments segments;
+    segments.set_request_type(Segments::CONVERSION);
+    segments.set_initial_conversion_candidates_size(initial_size);
+    segments.add_segment()->set_key(kRequestKey);
+    EXPECT_TRUE(converter->Convert(&segments));
+    ASSERT_EQ(expected.conversion_segments_size(),
+              segments.conversion_segments_size());
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      while (converter->ExpandCandidates(&segments, i, 5)) {
+      }
+      const Segment &expected_segment = expected.conversion_segment(i);
+      const Segment &segment = segments.conversion_segment(i);
+      EXPECT_EQ(expected_segment.key(), segment.key());
+      ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+      for (size_t j = 0; j < segment.candidates_size(); ++j) {
+        EXPECT_EQ(expected_segment.candidate(j).value,
+                  segment.candidate(j).value);
+        EXPECT_EQ(expected_segment.candidate(j).cost,
+                  segment.candidate(j).cost);
+      }
+    }
+  }
+  ThreadPool::SetDefaultForTesting(nullptr);
+  FLAGS_parallel_nbest_min_segments = original_min_segments;
+}
+
 TEST(ImmutableConverterTest, NotConnectedTest) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
       new MockDataAndImmutableConverter);
@@ -469,6 +571,94 @@ TEST(ImmutableConverterTest, NotConnectedTest) {
   EXPECT_TRUE(tested);
 }
 
+TEST(ImmutableConverterTest, ViterbiBreaksTiesByListOrder) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  const Connector &connector = *converter->connector_;
+  const POSMatcher &pos_matcher = *converter->pos_matcher_;
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  Segment *segment = segments.add_segment();
+  segment->set_segment_type(Segment::FREE);
+  segment->set_key("ab");
+
+  Lattice lattice;
+  lattice.SetKey("ab");
+  const int kNumLeftNodes = 5;
+  for (int i = 0; i < kNumLeftNodes; ++i) {
+    Node *node = lattice.NewNode();
+    node->key = "a";
+    node->value = "a";
+    node->lid = pos_matcher.GetUnknownId();
+    lattice.Insert(0, node);
+  }
+  const uint16 kRightLids[] = {
+    pos_matcher.GetGeneralNounId(),
+    pos_matcher.GetFunctionalId(),
+    pos_matcher.GetGeneralNounId(),
+  };
+  for (size_t i = 0; i < arraysize(kRightLids); ++i) {
+    Node *node = lattice.NewNode();
+    node->key = "b";
+    node->value = "b";
+    node->lid = kRightLids[i];
+    node->rid = kRightLids[i];
+    lattice.Insert(1, node);
+  }
+
+  // The left nodes in the order of the end node list.  All but the first
+  // one have the same cost to the right nodes of the general noun, and the
+  // first and the third ones share their rid.  The plain scan over the list
+  // picks the second one.
+  vector<Node *> lnodes;
+  for (Node *node = lattice.end_nodes(1); node != NULL; node = node->enext) {
+    lnodes.push_back(node);
+  }
+  ASSERT_EQ(kNumLeftNodes, lnodes.size());
+  const uint16 kLeftRids[kNumLeftNodes] = {
+    pos_matcher.GetUnknownId(),
+    pos_matcher.GetNumberId(),
+    pos_matcher.GetUnknownId(),
+    pos_matcher.GetFunctionalId(),
+    pos_matcher.GetNumberId(),
+  };
+  ASSERT_NE(kLeftRids[0], kLeftRids[1]);
+  ASSERT_NE(kLeftRids[0], kLeftRids[3]);
+  ASSERT_NE(kLeftRids[1], kLeftRids[3]);
+  const int kExtraCosts[kNumLeftNodes] = {100, 0, 0, 0, 0};
+  for (int i = 0; i < kNumLeftNodes; ++i) {
+    lnodes[i]->rid = kLeftRids[i];
+    lnodes[i]->wcost =
+        3000 + kExtraCosts[i] -
+        connector.GetTransitionCost(kLeftRids[i], kRightLids[0]);
+  }
+
+  converter->Viterbi(segments, &lattice);
+
+  for (Node *rnode = lattice.begin_nodes(1); rnode != NULL;
+       rnode = rnode->bnext) {
+    // The first node with the minimum cost in the list order.
+    Node *expected_prev = NULL;
+    int expected_cost = INT_MAX;
+    for (size_t i = 0; i < lnodes.size(); ++i) {
+      const int cost =
+          lnodes[i]->cost +
+          connector.GetTransitionCost(lnodes[i]->rid, rnode->lid);
+      if (cost < expected_cost) {
+        expected_prev = lnodes[i];
+        expected_cost = cost;
+      }
+    }
+    EXPECT_EQ(expected_prev, rnode->prev) << rnode->lid;
+    EXPECT_EQ(expected_cost + rnode->wcost, rnode->cost) << rnode->lid;
+    if (rnode->lid == kRightLids[0]) {
+      EXPECT_EQ(lnodes[1], rnode->prev);
+    }
+  }
+}
+
 TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   // "あ..." (100 times)
   const string kA100 =
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "converter/candidate_filter.h"
@@ -43,6 +44,10 @@
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
 
+DEFINE_bool(nbest_bucket_agenda, false,
+            "If true, the N-best generator uses the bucket queue instead of "
+            "the binary heap for its agenda.");
+
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::SuppressionDictionary;
 
@@ -52,6 +57,13 @@ namespace {
 const int kFreeListSize = 512;
 const int kCostDiff = 3453;   // log prob of 1/1000
 
+// The parameters of the bucket queue agenda.  A bucket covers
+// 2^kBucketShift of costs, and the buckets start kBucketMargin buckets below
+// the first element.
+const size_t kNumBuckets = 512;
+const int kBucketShift = 6;
+const int kBucketMargin = 8;
+
 }  // namespace
 
 using converter::CandidateFilter;
@@ -92,18 +104,68 @@ struct NBestGenerator::QueueElementComparator {
   }
 };
 
+NBestGenerator::Agenda::Agenda(Type type)
+    : buckets_(type == BUCKET_QUEUE ? kNumBuckets : 1),
+      size_(0), min_bucket_(0), max_bucket_(0), base_cost_(0) {
+}
+
+inline size_t NBestGenerator::Agenda::GetBucketIndex(int32 cost) {
+  if (buckets_.size() == 1) {
+    return 0;
+  }
+  if (size_ == 0) {
+    // All the buckets are empty, so the range can be moved freely.
+    base_cost_ = cost - kBucketMargin * (1 << kBucketShift);
+  }
+  if (cost < base_cost_) {
+    return 0;
+  }
+  const size_t index = static_cast<size_t>(cost - base_cost_) >> kBucketShift;
+  return std::min(index, buckets_.size() - 1);
+}
+
+void NBestGenerator::Agenda::Clear() {
+  if (size_ > 0) {
+    for (size_t i = min_bucket_; i <= max_bucket_; ++i) {
+      buckets_[i].clear();
+    }
+  }
+  size_ = 0;
+}
+
+void NBestGenerator::Agenda::Reserve(int size) {
+  if (buckets_.size() == 1) {
+    buckets_[0].reserve(size);
+  }
+}
+
 inline void NBestGenerator::Agenda::Push(
     const NBestGenerator::QueueElement *element) {
-  priority_queue_.push_back(element);
-  std::push_heap(priority_queue_.begin(), priority_queue_.end(),
-                 QueueElementComparator());
+  const size_t index = GetBucketIndex(element->fx);
+  vector<const QueueElement*> &bucket = buckets_[index];
+  bucket.push_back(element);
+  std::push_heap(bucket.begin(), bucket.end(), QueueElementComparator());
+  if (size_ == 0) {
+    min_bucket_ = max_bucket_ = index;
+  } else if (index < min_bucket_) {
+    min_bucket_ = index;
+  } else if (index > max_bucket_) {
+    max_bucket_ = index;
+  }
+  ++size_;
 }
 
 inline void NBestGenerator::Agenda::Pop() {
-  DCHECK(!priority_queue_.empty());
-  std::pop_heap(priority_queue_.begin(), priority_queue_.end(),
-                QueueElementComparator());
-  priority_queue_.pop_back();
+  DCHECK(!IsEmpty());
+  vector<const QueueElement*> &bucket = buckets_[min_bucket_];
+  std::pop_heap(bucket.begin(), bucket.end(), QueueElementComparator());
+  bucket.pop_back();
+  --size_;
+  if (size_ > 0) {
+    while (buckets_[min_bucket_].empty()) {
+      ++min_bucket_;
+    }
+  }
 }
 
 NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
@@ -117,6 +179,8 @@ NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
       segmenter_(segmenter), connector_(connector), pos_matcher_(pos_matcher),
       lattice_(lattice),
       begin_node_(NULL), end_node_(NULL),
+      agenda_(FLAGS_nbest_bucket_agenda ? Agenda::BUCKET_QUEUE
+                                        : Agenda::BINARY_HEAP),
       freelist_(kFreeListSize),
       filter_(new CandidateFilter(
           suppression_dic, pos_matcher, suggestion_filter,
@@ -141,7 +205,8 @@ NBestGenerator::~NBestGenerator() {
 void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
                            const BoundaryCheckMode mode) {
   agenda_.Clear();
-  freelist_.Free();
+  // Keeps the allocated elements for the next enumeration.
+  freelist_.Reset();
   filter_->Reset();
   viterbi_result_checked_ = false;
   check_mode_ = mode;
@@ -115,31 +115,48 @@ class NBestGenerator {
 
   // This is just a priority_queue of const QueueElement*, but supports
   // more operations in addition to std::priority_queue.
+  //
+  // With BUCKET_QUEUE, the elements are distributed by their costs into
+  // buckets of a fixed width, each of which is a small binary heap, and the
+  // lowest non-empty bucket is tracked.  The costs are bounded integers, so
+  // most of the elements fall into the buckets near the top and push/pop
+  // touch only a few elements.  The costs below or above the range of the
+  // buckets are clamped into the first or the last bucket, which keeps the
+  // order exact.  Only the order of the elements with the same cost may
+  // differ from BINARY_HEAP.  The storage is kept across Clear().
   class Agenda {
    public:
-    Agenda() {
-    }
+    enum Type {
+      BINARY_HEAP,
+      BUCKET_QUEUE,
+    };
+
+    explicit Agenda(Type type);
     ~Agenda() {
     }
 
     const QueueElement *Top() const {
-      return priority_queue_.front();
+      return buckets_[min_bucket_].front();
     }
     bool IsEmpty() const {
-      return priority_queue_.empty();
-    }
-    void Clear() {
-      priority_queue_.clear();
-    }
-    void Reserve(int size) {
-      priority_queue_.reserve(size);
+      return size_ == 0;
     }
+    void Clear();
+    void Reserve(int size);
 
     void Push(const QueueElement *element);
     void Pop();
 
    private:
-    vector<const QueueElement*> priority_queue_;
+    size_t GetBucketIndex(int32 cost);
+
+    vector<vector<const QueueElement*> > buckets_;
+    size_t size_;
+    size_t min_bucket_;
+    size_t max_bucket_;
+    // The cost at the bottom of the first bucket, which is determined by the
+    // first element after Clear().
+    int32 base_cost_;
 
     DISALLOW_COPY_AND_ASSIGN(Agenda);
   };
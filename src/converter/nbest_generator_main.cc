@@ -0,0 +1,180 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures the throughput of the N-best candidate generation of
+// ImmutableConverter on the data set for testing.  The sentences are read
+// from --sentences_file (e.g. data/test/stress_test/sentences.txt), one
+// reading per line.
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "converter/connector.h"
+#include "converter/immutable_converter.h"
+#include "converter/segmenter.h"
+#include "converter/segments.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "dictionary/dictionary_impl.h"
+#include "dictionary/pos_group.h"
+#include "dictionary/suffix_dictionary.h"
+#include "dictionary/suppression_dictionary.h"
+#include "dictionary/system/system_dictionary.h"
+#include "dictionary/system/value_dictionary.h"
+#include "dictionary/user_dictionary_stub.h"
+#include "prediction/suggestion_filter.h"
+
+DEFINE_string(sentences_file, "", "file of the readings to convert");
+DEFINE_string(candidates_sizes, "50,200",
+              "comma separated numbers of the candidates to expand");
+DEFINE_int32(iterations, 3, "number of iterations over the sentences");
+DECLARE_bool(nbest_bucket_agenda);
+
+namespace {
+
+using mozc::Connector;
+using mozc::ImmutableConverterImpl;
+using mozc::Segmenter;
+using mozc::Segments;
+using mozc::SuggestionFilter;
+using mozc::dictionary::DictionaryImpl;
+using mozc::dictionary::PosGroup;
+using mozc::dictionary::SuffixDictionary;
+using mozc::dictionary::SuppressionDictionary;
+using mozc::dictionary::SystemDictionary;
+using mozc::dictionary::UserDictionaryStub;
+using mozc::dictionary::ValueDictionary;
+
+// Returns the number of the generated candidates per second in the fastest
+// iteration.
+double Run(const ImmutableConverterImpl &converter,
+           const vector<string> &sentences, size_t candidates_size) {
+  double result = 0.0;
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    size_t num_candidates = 0;
+    mozc::Stopwatch stopwatch;
+    for (size_t j = 0; j < sentences.size(); ++j) {
+      Segments segments;
+      segments.set_request_type(Segments::CONVERSION);
+      segments.set_max_conversion_candidates_size(candidates_size);
+      segments.add_segment()->set_key(sentences[j]);
+      stopwatch.Start();
+      const bool converted = converter.Convert(&segments);
+      stopwatch.Stop();
+      if (!converted) {
+        continue;
+      }
+      for (size_t k = 0; k < segments.conversion_segments_size(); ++k) {
+        num_candidates += segments.conversion_segment(k).candidates_size();
+      }
+    }
+    result = std::max(result, num_candidates * 1000000.0 /
+                                  stopwatch.GetElapsedMicroseconds());
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  vector<string> sentences;
+  mozc::InputFileStream ifs(FLAGS_sentences_file.c_str());
+  string line;
+  while (getline(ifs, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    sentences.push_back(line);
+  }
+  CHECK(!sentences.empty()) << "No sentence in " << FLAGS_sentences_file;
+
+  const mozc::testing::MockDataManager data_manager;
+  const mozc::dictionary::POSMatcher *pos_matcher =
+      data_manager.GetPOSMatcher();
+  SuppressionDictionary suppression_dictionary;
+  UserDictionaryStub user_dictionary;
+  const char *dictionary_data = NULL;
+  int dictionary_size = 0;
+  data_manager.GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+  SystemDictionary *sysdic =
+      SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+  DictionaryImpl dictionary(
+      sysdic,  // DictionaryImpl takes the ownership
+      new ValueDictionary(*pos_matcher, &sysdic->value_trie()),
+      &user_dictionary, &suppression_dictionary, pos_matcher);
+  mozc::StringPiece suffix_key_array_data, suffix_value_array_data;
+  const uint32 *token_array = NULL;
+  data_manager.GetSuffixDictionaryData(&suffix_key_array_data,
+                                       &suffix_value_array_data,
+                                       &token_array);
+  SuffixDictionary suffix_dictionary(suffix_key_array_data,
+                                     suffix_value_array_data, token_array);
+  std::unique_ptr<const Connector> connector(
+      Connector::CreateFromDataManager(data_manager));
+  std::unique_ptr<const Segmenter> segmenter(
+      Segmenter::CreateFromDataManager(data_manager));
+  const PosGroup pos_group(data_manager.GetPosGroupData());
+  const char *filter_data = NULL;
+  size_t filter_size = 0;
+  data_manager.GetSuggestionFilterData(&filter_data, &filter_size);
+  const SuggestionFilter suggestion_filter(filter_data, filter_size);
+  const ImmutableConverterImpl converter(
+      &dictionary, &suffix_dictionary, &suppression_dictionary,
+      connector.get(), segmenter.get(), pos_matcher, &pos_group,
+      &suggestion_filter);
+
+  vector<string> sizes;
+  mozc::Util::SplitStringUsing(FLAGS_candidates_sizes, ",", &sizes);
+  // Warms up the caches of the dictionary and the connector.
+  Run(converter, sentences, 1);
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    const size_t candidates_size = atoi(sizes[i].c_str());
+    FLAGS_nbest_bucket_agenda = false;
+    const double binary_heap = Run(converter, sentences, candidates_size);
+    FLAGS_nbest_bucket_agenda = true;
+    const double bucket_queue = Run(converter, sentences, candidates_size);
+    std::cout << candidates_size << " candidates: binary heap "
+              << binary_heap << " candidates/s, bucket queue "
+              << bucket_queue << " candidates/s (" << bucket_queue / binary_heap
+              << "x)" << std::endl;
+  }
+
+  return 0;
+}
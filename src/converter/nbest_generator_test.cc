@@ -29,9 +29,12 @@
 
 #include "converter/nbest_generator.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/system_util.h"
@@ -55,6 +58,8 @@
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
+DECLARE_bool(nbest_bucket_agenda);
+
 using mozc::dictionary::DictionaryImpl;
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
@@ -423,4 +428,75 @@ TEST_F(NBestGeneratorTest, InnerSegmentBoundary) {
             content_values[2]);
 }
 
+TEST_F(NBestGeneratorTest, BucketQueueAgenda) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  // "わたしのなまえはなかのです"
+  const string kText = ("\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae"
+                        "\xe3\x81\xaa\xe3\x81\xbe\xe3\x81\x88\xe3\x81\xaf"
+                        "\xe3\x81\xaa\xe3\x81\x8b\xe3\x81\xae\xe3\x81\xa7"
+                        "\xe3\x81\x99");
+  {
+    Segment *segment = segments.add_segment();
+    segment->set_segment_type(Segment::FREE);
+    segment->set_key(kText);
+  }
+
+  Lattice lattice;
+  lattice.SetKey(kText);
+  const ConversionRequest request;
+  converter->MakeLattice(request, &segments, &lattice);
+
+  vector<uint16> group;
+  converter->MakeGroup(segments, &group);
+  converter->Viterbi(segments, &lattice);
+
+  const bool kSingleSegment = true;  // For realtime conversion
+  const Node *begin_node = lattice.bos_nodes();
+  const Node *end_node = GetEndNode(
+      *converter, segments, *begin_node, group, kSingleSegment);
+
+  const bool original_bucket_agenda = FLAGS_nbest_bucket_agenda;
+  FLAGS_nbest_bucket_agenda = false;
+  std::unique_ptr<NBestGenerator> binary_heap_generator(
+      data_and_converter->CreateNBestGenerator(&lattice));
+  FLAGS_nbest_bucket_agenda = true;
+  std::unique_ptr<NBestGenerator> bucket_queue_generator(
+      data_and_converter->CreateNBestGenerator(&lattice));
+  FLAGS_nbest_bucket_agenda = original_bucket_agenda;
+
+  Segment expected;
+  binary_heap_generator->Reset(begin_node, end_node, NBestGenerator::ONLY_EDGE);
+  GatherCandidates(
+      50, Segments::CONVERSION, binary_heap_generator.get(), &expected);
+  ASSERT_LT(1, expected.candidates_size());
+  vector<string> expected_values;
+  for (size_t i = 0; i < expected.candidates_size(); ++i) {
+    expected_values.push_back(expected.candidate(i).value);
+  }
+  std::sort(expected_values.begin(), expected_values.end());
+
+  // The candidates are enumerated in the same order of the costs, also after
+  // the generator is reset and reuses its elements.
+  for (int trial = 0; trial < 2; ++trial) {
+    Segment actual;
+    bucket_queue_generator->Reset(begin_node, end_node,
+                                  NBestGenerator::ONLY_EDGE);
+    GatherCandidates(
+        50, Segments::CONVERSION, bucket_queue_generator.get(), &actual);
+    ASSERT_EQ(expected.candidates_size(), actual.candidates_size());
+    vector<string> actual_values;
+    for (size_t i = 0; i < actual.candidates_size(); ++i) {
+      EXPECT_EQ(expected.candidate(i).cost, actual.candidate(i).cost);
+      actual_values.push_back(actual.candidate(i).value);
+    }
+    std::sort(actual_values.begin(), actual_values.end());
+    EXPECT_EQ(expected_values, actual_values);
+  }
+}
+
 }  // namespace mozc
@@ -466,6 +466,7 @@ Segments::Segments()
   : max_history_segments_size_(0),
     max_prediction_candidates_size_(0),
     max_conversion_candidates_size_(kMaxConversionCandidatesSize),
+    initial_conversion_candidates_size_(0),
     resized_(false),
     user_history_enabled_(true),
     request_type_(Segments::CONVERSION),
@@ -602,9 +603,12 @@ void Segments::Clear() {
 
 void Segments::CopyFrom(const Segments &src) {
   Clear();
+  expansion_state_.reset();
   max_history_segments_size_ = src.max_history_segments_size();
   max_prediction_candidates_size_ = src.max_prediction_candidates_size();
   max_conversion_candidates_size_ = src.max_conversion_candidates_size();
+  initial_conversion_candidates_size_ =
+      src.initial_conversion_candidates_size();
   resized_ = src.resized();
   user_history_enabled_ = src.user_history_enabled();
 
@@ -681,6 +685,14 @@ void Segments::set_max_conversion_candidates_size(size_t size) {
   max_conversion_candidates_size_ = size;
 }
 
+size_t Segments::initial_conversion_candidates_size() const {
+  return initial_conversion_candidates_size_;
+}
+
+void Segments::set_initial_conversion_candidates_size(size_t size) {
+  initial_conversion_candidates_size_ = size;
+}
+
 void Segments::clear_revert_entries() {
   revert_entries_.clear();
 }
@@ -711,6 +723,19 @@ Lattice *Segments::mutable_cached_lattice() {
   return cached_lattice_.get();
 }
 
+void Segments::ReleaseCachedLattice() {
+  expansion_state_.reset();
+  cached_lattice_.reset(new Lattice());
+}
+
+Segments::ExpansionState *Segments::mutable_expansion_state() {
+  return expansion_state_.get();
+}
+
+void Segments::set_expansion_state(ExpansionState *state) {
+  expansion_state_.reset(state);
+}
+
 string Segments::DebugString() const {
   stringstream os;
   os << "{" << std::endl;
@@ -465,6 +465,13 @@ class Segments {
   void set_max_conversion_candidates_size(size_t size);
   size_t max_conversion_candidates_size() const;
 
+  // If non-zero, the converter generates only this many candidates for each
+  // conversion segment at first, and the rest on demand by
+  // ConverterInterface::ExpandSegmentCandidates().  Default setting is 0,
+  // i.e., all the candidates are generated at once.
+  void set_initial_conversion_candidates_size(size_t size);
+  size_t initial_conversion_candidates_size() const;
+
   bool resized() const;
   void set_resized(bool resized);
 
@@ -487,6 +494,21 @@ class Segments {
   // setter
   Lattice *mutable_cached_lattice();
 
+  // Releases the nodes of the cached lattice.  The lattice is rebuilt by the
+  // next conversion.
+  void ReleaseCachedLattice();
+
+  // Opaque state of the converter to expand the candidates on demand.  As it
+  // refers to the cached lattice, it is released with the lattice.  It is
+  // also released by CopyFrom() and is never copied.
+  class ExpansionState {
+   public:
+    virtual ~ExpansionState() {}
+  };
+  ExpansionState *mutable_expansion_state();
+  // Takes the ownership of |state|.
+  void set_expansion_state(ExpansionState *state);
+
   Segments();
   virtual ~Segments();
 
@@ -494,6 +516,7 @@ class Segments {
   size_t max_history_segments_size_;
   size_t max_prediction_candidates_size_;
   size_t max_conversion_candidates_size_;
+  size_t initial_conversion_candidates_size_;
   bool resized_;
   bool user_history_enabled_;
 
@@ -502,6 +525,7 @@ class Segments {
   deque<Segment *> segments_;
   vector<RevertEntry> revert_entries_;
   std::unique_ptr<Lattice> cached_lattice_;
+  std::unique_ptr<ExpansionState> expansion_state_;
 
   DISALLOW_COPY_AND_ASSIGN(Segments);
 };
@@ -29,11 +29,8 @@
 
 #include "dictionary/file/codec.h"
 
-#include <climits>
-
 #include "base/logging.h"
 #include "base/port.h"
-#include "base/util.h"
 #include "dictionary/file/codec_interface.h"
 #include "dictionary/file/codec_util.h"
 #include "dictionary/file/section.h"
@@ -111,11 +108,12 @@ bool DictionaryFileCodec::ReadSections(
   return true;
 }
 
-// Write padding
+// Write padding.  Zero bytes are used so that the same input always yields
+// the same image.
 void DictionaryFileCodec::Pad4(int length, ostream *ofs) {
   DCHECK(ofs);
   for (int i = length; (i % 4) != 0; ++i) {
-    (*ofs) << static_cast<char>(Util::Random(CHAR_MAX));
+    (*ofs) << '\0';
   }
 }
 
@@ -33,6 +33,9 @@
 //  --input="dictionary0.txt dictionary1.txt"
 //  --output="output.h"
 //  --make_header
+//
+// The dictionary is built on the default thread pool.  --thread_pool_size=0
+// builds it on the calling thread only; the output is the same for any size.
 
 #include <memory>
 #include <string>
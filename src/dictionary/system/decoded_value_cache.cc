@@ -0,0 +1,152 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/system/decoded_value_cache.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+const size_t kNumDataWords = DecodedValueCache::kMaxValueSize / sizeof(uint64);
+
+int RoundUpToPowerOfTwo(int n) {
+  int result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+const size_t DecodedValueCache::kMaxValueSize;
+
+// The slot is written as follows, like seqlock:
+//   1. |sequence| is incremented to an odd number.
+//   2. |id|, |length| and |data| are written.
+//   3. |sequence| is incremented to an even number.
+// A reader reads the members between two loads of |sequence|, and discards
+// them unless the sequence numbers are the same even number.  All the members
+// are atomic so that the racy reads are well-defined.
+struct DecodedValueCache::Slot {
+  Slot() : sequence(0), id(-1), length(0) {
+    for (size_t i = 0; i < kNumDataWords; ++i) {
+      data[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint32> sequence;
+  std::atomic<int32> id;
+  std::atomic<uint32> length;
+  std::atomic<uint64> data[kNumDataWords];
+};
+
+DecodedValueCache::Stats::Stats() : hits(0), misses(0) {}
+
+DecodedValueCache::DecodedValueCache(int size)
+    : size_(RoundUpToPowerOfTwo(size)),
+      slots_(new Slot[size_]),
+      hits_(0),
+      misses_(0) {
+  DCHECK_GT(size, 0);
+}
+
+DecodedValueCache::~DecodedValueCache() {}
+
+bool DecodedValueCache::Lookup(int id, char *buffer,
+                               StringPiece *value) const {
+  const Slot &slot = slots_[id & (size_ - 1)];
+  const uint32 sequence = slot.sequence.load(std::memory_order_acquire);
+  if ((sequence & 1) == 0 && slot.id.load(std::memory_order_relaxed) == id) {
+    const uint32 length = slot.length.load(std::memory_order_relaxed);
+    if (length <= kMaxValueSize) {
+      uint64 words[kNumDataWords];
+      const size_t num_words = (length + sizeof(uint64) - 1) / sizeof(uint64);
+      for (size_t i = 0; i < num_words; ++i) {
+        words[i] = slot.data[i].load(std::memory_order_relaxed);
+      }
+      // Check that the slot was not overwritten while being read.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        memcpy(buffer, words, length);
+        value->set(buffer, length);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void DecodedValueCache::Insert(int id, StringPiece value) const {
+  if (value.size() > kMaxValueSize) {
+    return;
+  }
+  Slot &slot = slots_[id & (size_ - 1)];
+  uint32 sequence = slot.sequence.load(std::memory_order_relaxed);
+  if ((sequence & 1) != 0 ||
+      !slot.sequence.compare_exchange_strong(sequence, sequence + 1,
+                                             std::memory_order_relaxed)) {
+    // Another thread is writing the slot.
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint64 words[kNumDataWords] = {};
+  memcpy(words, value.data(), value.size());
+  const size_t num_words =
+      (value.size() + sizeof(uint64) - 1) / sizeof(uint64);
+  for (size_t i = 0; i < num_words; ++i) {
+    slot.data[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.id.store(id, std::memory_order_relaxed);
+  slot.length.store(value.size(), std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+DecodedValueCache::Stats DecodedValueCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void DecodedValueCache::ClearStats() {
+  hits_.store(0, std::memory_order_relaxed);
+  misses_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace dictionary
+}  // namespace mozc
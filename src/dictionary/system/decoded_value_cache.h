@@ -0,0 +1,96 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
+#define MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
+
+#include <atomic>
+#include <memory>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+namespace dictionary {
+
+// A bounded cache from the id in the value trie to the decoded value, so that
+// the values of the frequent tokens, e.g., particles, are not restored from the
+// value trie and decoded over and over.
+//
+// The cache is direct mapped, and each slot is guarded by a sequence number
+// instead of a lock: Lookup() fails if the slot is being overwritten, and
+// Insert() gives up if another thread is writing the slot.  Thus all the
+// methods are thread-safe and never block, and the cache can be shared by the
+// concurrent lookups of SystemDictionary.  The values longer than
+// kMaxValueSize are not cached.
+class DecodedValueCache {
+ public:
+  static const size_t kMaxValueSize = 48;
+
+  struct Stats {
+    Stats();
+
+    uint64 hits;
+    uint64 misses;
+  };
+
+  // |size| is the number of slots, which is rounded up to a power of 2.  Each
+  // slot takes 64 bytes.
+  explicit DecodedValueCache(int size);
+  ~DecodedValueCache();
+
+  int size() const { return size_; }
+
+  // Looks up the value of |id|.  As the cache may be overwritten by other
+  // threads, the value is copied to |buffer|, which needs to be kMaxValueSize
+  // bytes at least, and |value| points to it.  Returns false on miss.
+  bool Lookup(int id, char *buffer, StringPiece *value) const;
+
+  // Stores |value| as the value of |id|, replacing the value in the slot.
+  void Insert(int id, StringPiece value) const;
+
+  Stats GetStats() const;
+  void ClearStats();
+
+ private:
+  struct Slot;
+
+  const int size_;
+  std::unique_ptr<Slot[]> slots_;
+  mutable std::atomic<uint64> hits_;
+  mutable std::atomic<uint64> misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecodedValueCache);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_SYSTEM_DECODED_VALUE_CACHE_H_
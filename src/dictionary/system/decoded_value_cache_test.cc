@@ -0,0 +1,122 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/system/decoded_value_cache.h"
+
+#include <string>
+
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "base/thread_pool.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+TEST(DecodedValueCacheTest, LookupAndInsert) {
+  DecodedValueCache cache(8);
+  char buffer[DecodedValueCache::kMaxValueSize];
+  StringPiece value;
+
+  EXPECT_FALSE(cache.Lookup(3, buffer, &value));
+  cache.Insert(3, "\xE3\x81\xAF");  // "は"
+  ASSERT_TRUE(cache.Lookup(3, buffer, &value));
+  EXPECT_EQ("\xE3\x81\xAF", value);
+  EXPECT_EQ(buffer, value.data());
+
+  // The empty value is cached, too.
+  cache.Insert(4, "");
+  ASSERT_TRUE(cache.Lookup(4, buffer, &value));
+  EXPECT_TRUE(value.empty());
+
+  // Another id mapped to the same slot replaces the value.
+  cache.Insert(3 + 8, "value");
+  EXPECT_FALSE(cache.Lookup(3, buffer, &value));
+  ASSERT_TRUE(cache.Lookup(3 + 8, buffer, &value));
+  EXPECT_EQ("value", value);
+
+  const DecodedValueCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+
+  cache.ClearStats();
+  EXPECT_EQ(0, cache.GetStats().hits);
+  EXPECT_EQ(0, cache.GetStats().misses);
+}
+
+TEST(DecodedValueCacheTest, Size) {
+  EXPECT_EQ(1, DecodedValueCache(1).size());
+  EXPECT_EQ(8, DecodedValueCache(5).size());
+  EXPECT_EQ(4096, DecodedValueCache(4096).size());
+}
+
+TEST(DecodedValueCacheTest, LongValueIsNotCached) {
+  DecodedValueCache cache(16);
+  char buffer[DecodedValueCache::kMaxValueSize];
+  StringPiece value;
+
+  const string max_value(DecodedValueCache::kMaxValueSize, 'a');
+  cache.Insert(1, max_value);
+  ASSERT_TRUE(cache.Lookup(1, buffer, &value));
+  EXPECT_EQ(max_value, value);
+
+  // The value in the slot is kept.
+  cache.Insert(1, max_value + "a");
+  ASSERT_TRUE(cache.Lookup(1, buffer, &value));
+  EXPECT_EQ(max_value, value);
+}
+
+TEST(DecodedValueCacheTest, ConcurrentAccess) {
+  // Many ids share a few slots, so that the threads race on each slot.  A hit
+  // must always return the value of the id.
+  DecodedValueCache cache(4);
+  ThreadPool pool(3, "DecodedValueCacheTest");
+  const int kNumIds = 64;
+  ThreadPool::ParallelFor(&pool, 0, 20000, [&cache](int i) {
+    const int id = (i * 7) % kNumIds;
+    const string expected =
+        NumberUtil::SimpleItoa(id) + string(id % 40, 'x');
+    char buffer[DecodedValueCache::kMaxValueSize];
+    StringPiece value;
+    if (cache.Lookup(id, buffer, &value)) {
+      EXPECT_EQ(expected, value);
+    } else {
+      cache.Insert(id, expected);
+    }
+  });
+  const DecodedValueCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(20000, stats.hits + stats.misses);
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -56,6 +56,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
@@ -65,16 +66,19 @@
 #include "dictionary/file/codec_factory.h"
 #include "dictionary/file/dictionary_file.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/decoded_value_cache.h"
 #include "dictionary/system/token_decode_iterator.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
+#include "storage/shared_index_file.h"
 
 namespace mozc {
 namespace dictionary {
 
 using mozc::storage::louds::BitVectorBasedArray;
 using mozc::storage::louds::LoudsTrie;
+using mozc::storage::SharedIndexFile;
 
 namespace {
 
@@ -418,7 +422,7 @@ struct SystemDictionary::Builder::Specification {
                 const SystemDictionaryCodecInterface *codec,
                 const DictionaryFileCodecInterface *file_codec)
       : type(t), filename(fn), ptr(p), len(l), options(o), codec(codec),
-        file_codec(file_codec) {}
+        file_codec(file_codec), value_cache_size(0) {}
 
   InputType type;
 
@@ -432,6 +436,8 @@ struct SystemDictionary::Builder::Specification {
   Options options;
   const SystemDictionaryCodecInterface *codec;
   const DictionaryFileCodecInterface *file_codec;
+  string shared_index_directory;
+  int value_cache_size;
 };
 
 SystemDictionary::Builder::Builder(const string &filename)
@@ -456,6 +462,18 @@ SystemDictionary::Builder &SystemDictionary::Builder::SetCodec(
   return *this;
 }
 
+SystemDictionary::Builder &SystemDictionary::Builder::SetSharedIndexDirectory(
+    const string &directory) {
+  spec_->shared_index_directory = directory;
+  return *this;
+}
+
+SystemDictionary::Builder &SystemDictionary::Builder::SetValueCacheSize(
+    int size) {
+  spec_->value_cache_size = size;
+  return *this;
+}
+
 SystemDictionary *SystemDictionary::Builder::Build() {
   if (spec_->codec == nullptr) {
     spec_->codec = SystemDictionaryCodecFactory::GetCodec();
@@ -493,11 +511,17 @@ SystemDictionary *SystemDictionary::Builder::Build() {
   }
 
   if (!instance->OpenDictionaryFile(
-          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
+          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0,
+          spec_->shared_index_directory)) {
     LOG(ERROR) << "Failed to create system dictionary";
     return nullptr;
   }
 
+  if (spec_->value_cache_size > 0) {
+    instance->value_cache_.reset(
+        new DecodedValueCache(spec_->value_cache_size));
+  }
+
   return instance.release();
 }
 
@@ -510,11 +534,62 @@ SystemDictionary::SystemDictionary(
 
 SystemDictionary::~SystemDictionary() {}
 
-bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
+DecodedValueCache::Stats SystemDictionary::GetValueCacheStats() const {
+  if (value_cache_ == nullptr) {
+    return DecodedValueCache::Stats();
+  }
+  return value_cache_->GetStats();
+}
+
+void SystemDictionary::ClearValueCacheStats() {
+  if (value_cache_ != nullptr) {
+    value_cache_->ClearStats();
+  }
+}
+
+bool SystemDictionary::OpenDictionaryFile(
+    bool enable_reverse_lookup_index, const string &shared_index_directory) {
   int len;
 
+  int key_image_size = 0;
   const uint8 *key_image = reinterpret_cast<const uint8 *>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForKey(), &len));
+      dictionary_file_->GetSection(codec_->GetSectionNameForKey(),
+                                   &key_image_size));
+  int value_image_size = 0;
+  const uint8 *value_image = reinterpret_cast<const uint8 *>(
+      dictionary_file_->GetSection(codec_->GetSectionNameForValue(),
+                                   &value_image_size));
+  if (shared_index_directory.empty() ||
+      !OpenTriesWithSharedIndex(key_image, key_image_size,
+                                value_image, value_image_size,
+                                shared_index_directory)) {
+    if (!OpenTries(key_image, value_image)) {
+      return false;
+    }
+  }
+
+  BuildHiraganaExpansionTable(*codec_, &hiragana_expansion_table_);
+
+  const unsigned char *token_image = reinterpret_cast<const unsigned char *>(
+      dictionary_file_->GetSection(codec_->GetSectionNameForTokens(), &len));
+  token_array_.Open(token_image);
+
+  frequent_pos_ = reinterpret_cast<const uint32*>(
+      dictionary_file_->GetSection(codec_->GetSectionNameForPos(), &len));
+  if (frequent_pos_ == nullptr) {
+    LOG(ERROR) << "can not find frequent pos section";
+    return false;
+  }
+
+  if (enable_reverse_lookup_index) {
+    InitReverseLookupIndex();
+  }
+
+  return true;
+}
+
+bool SystemDictionary::OpenTries(const uint8 *key_image,
+                                 const uint8 *value_image) {
   if (!key_trie_.Open(key_image,
                       kKeyTrieLb0CacheSize,
                       kKeyTrieLb1CacheSize,
@@ -524,11 +599,6 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     LOG(ERROR) << "cannot open key trie";
     return false;
   }
-
-  BuildHiraganaExpansionTable(*codec_, &hiragana_expansion_table_);
-
-  const uint8 *value_image = reinterpret_cast<const uint8 *>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForValue(), &len));
   if (!value_trie_.Open(value_image,
                         kValueTrieLb0CacheSize,
                         kValueTrieLb1CacheSize,
@@ -538,23 +608,62 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     LOG(ERROR) << "can not open value trie";
     return false;
   }
+  return true;
+}
 
-  const unsigned char *token_image = reinterpret_cast<const unsigned char *>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForTokens(), &len));
-  token_array_.Open(token_image);
+bool SystemDictionary::OpenTriesWithSharedIndex(const uint8 *key_image,
+                                                int key_image_size,
+                                                const uint8 *value_image,
+                                                int value_image_size,
+                                                const string &directory) {
+  // The index image is determined by the trie images and the cache sizes, so
+  // the file is keyed by them.
+  const uint64 key_source[] = {
+    Hash::Fingerprint(StringPiece(reinterpret_cast<const char *>(key_image),
+                                  key_image_size)),
+    Hash::Fingerprint(StringPiece(reinterpret_cast<const char *>(value_image),
+                                  value_image_size)),
+    kKeyTrieLb0CacheSize, kKeyTrieLb1CacheSize, kKeyTrieSelect0CacheSize,
+    kKeyTrieSelect1CacheSize, kKeyTrieTermvecCacheSize,
+    kValueTrieLb0CacheSize, kValueTrieLb1CacheSize, kValueTrieSelect0CacheSize,
+    kValueTrieSelect1CacheSize, kValueTrieTermvecCacheSize,
+  };
+  const uint64 key = Hash::Fingerprint(StringPiece(
+      reinterpret_cast<const char *>(key_source), sizeof(key_source)));
+
+  shared_index_.reset(new SharedIndexFile);
+  if (shared_index_->Open(directory, key)) {
+    StringPiece index_image = shared_index_->image();
+    if (key_trie_.OpenWithIndexImage(key_image, &index_image) &&
+        value_trie_.OpenWithIndexImage(value_image, &index_image)) {
+      return true;
+    }
+    LOG(WARNING) << "Shared index doesn't match. Rebuilding it";
+  }
 
-  frequent_pos_ = reinterpret_cast<const uint32*>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForPos(), &len));
-  if (frequent_pos_ == nullptr) {
-    LOG(ERROR) << "can not find frequent pos section";
+  // Builds the indexes on the heap, and replaces them with the shared file.
+  if (!OpenTries(key_image, value_image)) {
+    shared_index_.reset();
     return false;
   }
-
-  if (enable_reverse_lookup_index) {
-    InitReverseLookupIndex();
+  string image;
+  key_trie_.SerializeIndex(&image);
+  value_trie_.SerializeIndex(&image);
+  if (!shared_index_->Create(directory, key, image)) {
+    // Keeps using the indexes on the heap.
+    LOG(WARNING) << "Cannot create shared index in " << directory;
+    shared_index_.reset();
+    return true;
   }
-
-  return true;
+  StringPiece index_image = shared_index_->image();
+  if (key_trie_.OpenWithIndexImage(key_image, &index_image) &&
+      value_trie_.OpenWithIndexImage(value_image, &index_image)) {
+    return true;
+  }
+  // The caller builds the indexes on the heap again.
+  LOG(ERROR) << "Cannot open the created shared index in " << directory;
+  shared_index_.reset();
+  return false;
 }
 
 void SystemDictionary::InitReverseLookupIndex() {
@@ -610,8 +719,8 @@ bool SystemDictionary::HasValue(StringPiece value) const {
   const uint8 *encoded_tokens_ptr = GetTokenArrayPtr(token_array_, key_id);
 
   // Check tokens.
-  for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
-                                encoded_tokens_ptr);
+  for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                frequent_pos_, key, encoded_tokens_ptr);
        !iter.Done(); iter.Next()) {
     const Token *token = iter.Get().token;
     if (value == token->value) {
@@ -774,7 +883,7 @@ void SystemDictionary::LookupPredictive(
     }
 
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
-    for (TokenDecodeIterator iter(codec_, value_trie_,
+    for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
                                   frequent_pos_, actual_key,
                                   GetTokenArrayPtr(token_array_, key_id));
          !iter.Done(); iter.Next()) {
@@ -797,7 +906,7 @@ namespace {
 // An implementation of prefix search without key expansion.  Runs |callback|
 // for prefixes of |encoded_key| in |key_trie|.
 // Args:
-//   key_trie, value_trie, token_array, codec, frequent_pos:
+//   key_trie, value_trie, value_cache, token_array, codec, frequent_pos:
 //     Members in SystemDictionary.
 //   key:
 //     The head address of the original key before applying codec.
@@ -811,6 +920,7 @@ namespace {
 template <typename Func>
 void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
                              const LoudsTrie &value_trie,
+                             const DecodedValueCache *value_cache,
                              const BitVectorBasedArray &token_array,
                              const SystemDictionaryCodecInterface *codec,
                              const uint32 *frequent_pos,
@@ -852,7 +962,8 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
     }
 
     const int key_id = key_trie.GetKeyIdOfTerminalNode(node);
-    for (TokenDecodeIterator iter(codec, value_trie, frequent_pos, prefix,
+    for (TokenDecodeIterator iter(codec, value_trie, value_cache,
+                                  frequent_pos, prefix,
                                   GetTokenArrayPtr(token_array, key_id));
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
@@ -959,8 +1070,8 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     }
 
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
-    for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
-                                  *actual_prefix,
+    for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                  frequent_pos_, *actual_prefix,
                                   GetTokenArrayPtr(token_array_, key_id));
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
@@ -1008,9 +1119,9 @@ void SystemDictionary::LookupPrefix(
   codec_->EncodeKey(key, &encoded_key);
 
   if (!conversion_request.IsKanaModifierInsensitiveConversion()) {
-    RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                            frequent_pos_, key.data(), encoded_key, callback,
-                            SelectAllTokens());
+    RunCallbackOnEachPrefix(key_trie_, value_trie_, value_cache_.get(),
+                            token_array_, codec_, frequent_pos_, key.data(),
+                            encoded_key, callback, SelectAllTokens());
     return;
   }
 
@@ -1039,7 +1150,8 @@ void SystemDictionary::LookupExact(
   }
 
   // Callback on each token.
-  for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
+  for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                frequent_pos_, key,
                                 GetTokenArrayPtr(token_array_, key_id));
        !iter.Done(); iter.Next()) {
     if (callback->OnToken(key, key, *iter.Get().token) !=
@@ -1147,9 +1259,9 @@ void SystemDictionary::RegisterReverseLookupTokensForT13N(
   string hiragana_value, encoded_key;
   Util::KatakanaToHiragana(value, &hiragana_value);
   codec_->EncodeKey(hiragana_value, &encoded_key);
-  RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                          frequent_pos_, hiragana_value.data(),
-                          encoded_key, callback,
+  RunCallbackOnEachPrefix(key_trie_, value_trie_, value_cache_.get(),
+                          token_array_, codec_, frequent_pos_,
+                          hiragana_value.data(), encoded_key, callback,
                           FilterTokenForRegisterReverseLookupTokensForT13N());
 }
 
@@ -1219,8 +1331,8 @@ void SystemDictionary::RegisterReverseLookupResults(
         continue;
       }
       for (TokenDecodeIterator iter(
-               codec_, value_trie_, frequent_pos_, tokens_key,
-               encoded_tokens_ptr  + reverse_result.tokens_offset);
+               codec_, value_trie_, value_cache_.get(), frequent_pos_,
+               tokens_key, encoded_tokens_ptr  + reverse_result.tokens_offset);
            !iter.Done(); iter.Next()) {
         const TokenInfo &token_info = iter.Get();
         if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
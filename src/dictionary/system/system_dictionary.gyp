@@ -48,6 +48,16 @@
         'key_expansion_table.h',
       ],
     },
+    {
+      'target_name': 'decoded_value_cache',
+      'type': 'static_library',
+      'sources': [
+        'decoded_value_cache.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base_core',
+      ],
+    },
     {
       'target_name': 'system_dictionary',
       'type': 'static_library',
@@ -59,9 +69,11 @@
         '../../request/request.gyp:conversion_request',
         '../../storage/louds/louds.gyp:bit_vector_based_array',
         '../../storage/louds/louds.gyp:louds_trie',
+        '../../storage/storage.gyp:storage',
         '../dictionary_base.gyp:text_dictionary_loader',
         '../file/dictionary_file.gyp:codec_factory',
         '../file/dictionary_file.gyp:dictionary_file',
+        'decoded_value_cache',
         'key_expansion_table',
         'system_dictionary_codec',
       ],
@@ -40,12 +40,17 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/file/codec_interface.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/decoded_value_cache.h"
 #include "dictionary/system/key_expansion_table.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
 
 namespace mozc {
+namespace storage {
+class SharedIndexFile;
+}  // namespace storage
+
 namespace dictionary {
 
 class DictionaryFile;
@@ -87,6 +92,16 @@ class SystemDictionary : public DictionaryInterface {
     // Doesn't take the ownership of |codec|.
     Builder &SetCodec(const SystemDictionaryCodecInterface *codec);
 
+    // Sets the directory for the rank/select indexes of the tries shared with
+    // other processes (default: empty, i.e., the indexes are built on the
+    // heap). The index file for the dictionary is created in the directory
+    // if it doesn't exist; see storage::SharedIndexFile.
+    Builder &SetSharedIndexDirectory(const string &directory);
+
+    // Sets the number of the decoded values cached by the id in the value
+    // trie (default: 0, i.e., no cache).  See DecodedValueCache.
+    Builder &SetValueCacheSize(int size);
+
     // Builds and returns system dictionary.
     SystemDictionary *Build();
 
@@ -100,6 +115,11 @@ class SystemDictionary : public DictionaryInterface {
 
   const storage::louds::LoudsTrie &value_trie() const { return value_trie_; }
 
+  // Returns the statistics of the decoded value cache, which are zero if the
+  // cache is disabled.
+  DecodedValueCache::Stats GetValueCacheStats() const;
+  void ClearValueCacheStats();
+
   // Implementation of DictionaryInterface.
   virtual bool HasKey(StringPiece key) const;
   virtual bool HasValue(StringPiece value) const;
@@ -130,7 +150,13 @@ class SystemDictionary : public DictionaryInterface {
 
   explicit SystemDictionary(const SystemDictionaryCodecInterface *codec,
                             const DictionaryFileCodecInterface *file_codec);
-  bool OpenDictionaryFile(bool enable_reverse_lookup_index);
+  bool OpenDictionaryFile(bool enable_reverse_lookup_index,
+                          const string &shared_index_directory);
+  bool OpenTries(const uint8 *key_image, const uint8 *value_image);
+  bool OpenTriesWithSharedIndex(const uint8 *key_image, int key_image_size,
+                                const uint8 *value_image,
+                                int value_image_size,
+                                const string &directory);
 
   void RegisterReverseLookupTokensForT13N(StringPiece value,
                                           Callback *callback) const;
@@ -166,8 +192,10 @@ class SystemDictionary : public DictionaryInterface {
   const SystemDictionaryCodecInterface *codec_;
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
+  std::unique_ptr<storage::SharedIndexFile> shared_index_;
   mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
+  std::unique_ptr<DecodedValueCache> value_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionary);
 };
@@ -32,12 +32,15 @@
 #include <algorithm>
 #include <climits>
 #include <cstring>
+#include <functional>
 #include <sstream>
 #include <unordered_set>
+#include <utility>
 
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
@@ -54,6 +57,9 @@ DEFINE_bool(preserve_intermediate_dictionary, false,
             "preserve inetemediate dictionary file.");
 DEFINE_int32(min_key_length_to_use_small_cost_encoding, 6,
              "minimum key length to use 1 byte cost encoding.");
+DEFINE_bool(use_tail_for_value_trie, false,
+            "store the unique suffixes of the values as the tails in the "
+            "value trie.");
 
 namespace mozc {
 namespace dictionary {
@@ -79,6 +85,78 @@ struct TokenGreaterThan {
   }
 };
 
+// The inputs smaller than this are processed on the calling thread.
+const size_t kMinParallelSize = 4096;
+
+// Returns the number of tasks to split |size| elements into.
+size_t GetNumTasks(const ThreadPool *pool, size_t size) {
+  if (pool == NULL || size < kMinParallelSize) {
+    return 1;
+  }
+  return std::min(size / kMinParallelSize + 1,
+                  static_cast<size_t>(pool->num_threads() + 1));
+}
+
+// Calls |func| for each index in [0, size) on |pool|.  Each task handles a
+// contiguous range of the indices.
+void ParallelForEach(ThreadPool *pool, size_t size,
+                     const std::function<void(size_t)> &func) {
+  const size_t num_tasks = GetNumTasks(pool, size);
+  ThreadPool::ParallelFor(
+      pool, 0, static_cast<int>(num_tasks), [&](int task) {
+        const size_t end = size * (task + 1) / num_tasks;
+        for (size_t i = size * task / num_tasks; i < end; ++i) {
+          func(i);
+        }
+      });
+}
+
+// Sorts |elements| with |comp| on |pool|.  The chunks are sorted in parallel
+// and then merged pairwise, which gives exactly the same result as
+// std::stable_sort() since std::merge() takes equivalent elements from the
+// first range first.
+template <typename T, typename Compare>
+void ParallelStableSort(ThreadPool *pool, vector<T> *elements, Compare comp) {
+  const size_t size = elements->size();
+  const size_t num_chunks = GetNumTasks(pool, size);
+  if (num_chunks == 1) {
+    std::stable_sort(elements->begin(), elements->end(), comp);
+    return;
+  }
+  vector<size_t> bounds;
+  for (size_t i = 0; i <= num_chunks; ++i) {
+    bounds.push_back(size * i / num_chunks);
+  }
+  ThreadPool::ParallelFor(
+      pool, 0, static_cast<int>(num_chunks), [&](int i) {
+        std::stable_sort(elements->begin() + bounds[i],
+                         elements->begin() + bounds[i + 1], comp);
+      });
+
+  vector<T> buffer(size);
+  while (bounds.size() > 2) {
+    const size_t num_runs = bounds.size() - 1;
+    ThreadPool::ParallelFor(
+        pool, 0, static_cast<int>((num_runs + 1) / 2), [&](int i) {
+          const size_t begin = bounds[2 * i];
+          const size_t mid = bounds[std::min<size_t>(2 * i + 1, num_runs)];
+          const size_t end = bounds[std::min<size_t>(2 * i + 2, num_runs)];
+          std::merge(elements->begin() + begin, elements->begin() + mid,
+                     elements->begin() + mid, elements->begin() + end,
+                     buffer.begin() + begin, comp);
+        });
+    elements->swap(buffer);
+    vector<size_t> merged_bounds;
+    for (size_t i = 0; i < bounds.size(); i += 2) {
+      merged_bounds.push_back(bounds[i]);
+    }
+    if (merged_bounds.back() != size) {
+      merged_bounds.push_back(size);
+    }
+    bounds.swap(merged_bounds);
+  }
+}
+
 void WriteSectionToFile(const DictionaryFileSection &section,
                         const string &filename) {
   OutputFileStream ofs(filename.c_str(), ios::binary | ios::out);
@@ -88,7 +166,7 @@ void WriteSectionToFile(const DictionaryFileSection &section,
 }  // namespace
 
 SystemDictionaryBuilder::SystemDictionaryBuilder()
-    : value_trie_builder_(new LoudsTrieBuilder),
+    : value_trie_builder_(new LoudsTrieBuilder(FLAGS_use_tail_for_value_trie)),
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(SystemDictionaryCodecFactory::GetCodec()) {}
@@ -96,7 +174,7 @@ SystemDictionaryBuilder::SystemDictionaryBuilder()
 // This class does not have the ownership of |codec|.
 SystemDictionaryBuilder::SystemDictionaryBuilder(
     const SystemDictionaryCodecInterface *codec)
-    : value_trie_builder_(new LoudsTrieBuilder),
+    : value_trie_builder_(new LoudsTrieBuilder(FLAGS_use_tail_for_value_trie)),
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(codec) {}
@@ -104,12 +182,22 @@ SystemDictionaryBuilder::SystemDictionaryBuilder(
 SystemDictionaryBuilder::~SystemDictionaryBuilder() {}
 
 void SystemDictionaryBuilder::BuildFromTokens(const vector<Token *> &tokens) {
+  // The steps are parallelized on the default thread pool in a way that
+  // doesn't change the output.
+  ThreadPool *pool = ThreadPool::GetDefault();
+
   KeyInfoList key_info_list;
   ReadTokens(tokens, &key_info_list);
 
   BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+  // The value trie and the key trie are independent of each other.
+  ThreadPool::ParallelFor(pool, 0, 2, [&](int i) {
+    if (i == 0) {
+      BuildValueTrie(key_info_list);
+    } else {
+      BuildKeyTrie(key_info_list);
+    }
+  });
 
   SetIdForValue(&key_info_list);
   SetIdForKey(&key_info_list);
@@ -230,6 +318,7 @@ void SystemDictionaryBuilder::ReadTokens(const vector<Token *> &tokens,
   //    [Token 1(key:aaa)][Token 2(key:aaa)][Token 3(key:abc)][...]
   // 2. Group Token(s) by Token::Key and convert them into KeyInfo.
   //    [KeyInfo(key:aaa)[Token 1][Token 2]][KeyInfo(key:abc)[Token 3]][...]
+  ThreadPool *pool = ThreadPool::GetDefault();
 
   // Step 1.
   typedef vector<Token *> ReduceBuffer;
@@ -242,8 +331,7 @@ void SystemDictionaryBuilder::ReadTokens(const vector<Token *> &tokens,
     CHECK(!token->value.empty()) << "empty value string in input";
     reduce_buffer.push_back(token);
   }
-  std::stable_sort(reduce_buffer.begin(), reduce_buffer.end(),
-                   TokenPtrLessThan());
+  ParallelStableSort(pool, &reduce_buffer, TokenPtrLessThan());
 
   // Step 2.
   key_info_list->clear();
@@ -256,14 +344,20 @@ void SystemDictionaryBuilder::ReadTokens(const vector<Token *> &tokens,
        iter != reduce_buffer.end(); ++iter) {
     Token *token = *iter;
     if (last_key_info.key != token->key) {
-      key_info_list->push_back(last_key_info);
+      key_info_list->push_back(std::move(last_key_info));
       last_key_info = KeyInfo();
       last_key_info.key = token->key;
     }
     last_key_info.tokens.push_back(TokenInfo(token));
-    last_key_info.tokens.back().value_type = GetValueType(token);
   }
-  key_info_list->push_back(last_key_info);
+  key_info_list->push_back(std::move(last_key_info));
+
+  ParallelForEach(pool, key_info_list->size(), [key_info_list](size_t i) {
+    vector<TokenInfo> &token_infos = (*key_info_list)[i].tokens;
+    for (size_t j = 0; j < token_infos.size(); ++j) {
+      token_infos[j].value_type = GetValueType(token_infos[j].token);
+    }
+  });
 }
 
 void SystemDictionaryBuilder::BuildFrequentPos(
@@ -339,84 +433,85 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    for (size_t i = 0; i < itr->tokens.size(); ++i) {
-      TokenInfo *token_info = &(itr->tokens[i]);
-      string value_str;
-      codec_->EncodeValue(token_info->token->value, &value_str);
-      token_info->id_in_value_trie =
-          value_trie_builder_->GetId(value_str);
-    }
-  }
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+          TokenInfo *token_info = &(key_info->tokens[i]);
+          string value_str;
+          codec_->EncodeValue(token_info->token->value, &value_str);
+          token_info->id_in_value_trie =
+              value_trie_builder_->GetId(value_str);
+        }
+      });
 }
 
 void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    std::sort(key_info->tokens.begin(), key_info->tokens.end(),
-              TokenGreaterThan());
-  }
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        std::sort(key_info->tokens.begin(), key_info->tokens.end(),
+                  TokenGreaterThan());
+      });
 }
 
 void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    if (HasHomonymsInSamePos(*key_info)) {
-      continue;
-    }
-    for (size_t i = 0; i < key_info->tokens.size(); ++i) {
-      TokenInfo *token_info = &key_info->tokens[i];
-      const int key_len = Util::CharsLen(token_info->token->key);
-      if (key_len >= FLAGS_min_key_length_to_use_small_cost_encoding) {
-        token_info->cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
-      }
-    }
-  }
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        if (HasHomonymsInSamePos(*key_info)) {
+          return;
+        }
+        for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+          TokenInfo *token_info = &key_info->tokens[i];
+          const int key_len = Util::CharsLen(token_info->token->key);
+          if (key_len >= FLAGS_min_key_length_to_use_small_cost_encoding) {
+            token_info->cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
+          }
+        }
+      });
 }
 
 void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    for (size_t i = 0; i < key_info->tokens.size(); ++i) {
-      TokenInfo *token_info = &(key_info->tokens[i]);
-      const uint32 pos = GetCombinedPos(token_info->token->lid,
-                                        token_info->token->rid);
-      map<uint32, int>::const_iterator itr = frequent_pos_.find(pos);
-      if (itr != frequent_pos_.end()) {
-        token_info->pos_type = TokenInfo::FREQUENT_POS;
-        token_info->id_in_frequent_pos_map = itr->second;
-      }
-      if (i >= 1) {
-        const TokenInfo &prev_token_info = key_info->tokens[i - 1];
-        const uint32 prev_pos = GetCombinedPos(prev_token_info.token->lid,
-                                               prev_token_info.token->rid);
-        if (prev_pos == pos) {
-          // we can overwrite FREQUENT_POS
-          token_info->pos_type = TokenInfo::SAME_AS_PREV_POS;
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+          TokenInfo *token_info = &(key_info->tokens[i]);
+          const uint32 pos = GetCombinedPos(token_info->token->lid,
+                                            token_info->token->rid);
+          map<uint32, int>::const_iterator itr = frequent_pos_.find(pos);
+          if (itr != frequent_pos_.end()) {
+            token_info->pos_type = TokenInfo::FREQUENT_POS;
+            token_info->id_in_frequent_pos_map = itr->second;
+          }
+          if (i >= 1) {
+            const TokenInfo &prev_token_info = key_info->tokens[i - 1];
+            const uint32 prev_pos = GetCombinedPos(
+                prev_token_info.token->lid, prev_token_info.token->rid);
+            if (prev_pos == pos) {
+              // we can overwrite FREQUENT_POS
+              token_info->pos_type = TokenInfo::SAME_AS_PREV_POS;
+            }
+          }
         }
-      }
-    }
-  }
+      });
 }
 
 void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    for (size_t i = 1; i < key_info->tokens.size(); ++i) {
-      const TokenInfo *prev_token_info = &(key_info->tokens[i - 1]);
-      TokenInfo *token_info = &(key_info->tokens[i]);
-      if (token_info->value_type != TokenInfo::AS_IS_HIRAGANA &&
-          token_info->value_type != TokenInfo::AS_IS_KATAKANA &&
-          (token_info->token->value == prev_token_info->token->value)) {
-        token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
-      }
-    }
-  }
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        for (size_t i = 1; i < key_info->tokens.size(); ++i) {
+          const TokenInfo *prev_token_info = &(key_info->tokens[i - 1]);
+          TokenInfo *token_info = &(key_info->tokens[i]);
+          if (token_info->value_type != TokenInfo::AS_IS_HIRAGANA &&
+              token_info->value_type != TokenInfo::AS_IS_KATAKANA &&
+              (token_info->token->value == prev_token_info->token->value)) {
+            token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
+          }
+        }
+      });
 }
 
 void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
@@ -430,14 +525,13 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    string key_str;
-    codec_->EncodeKey(key_info->key, &key_str);
-    key_info->id_in_key_trie =
-        key_trie_builder_->GetId(key_str);
-  }
+  ParallelForEach(
+      ThreadPool::GetDefault(), key_info_list->size(), [&](size_t k) {
+        KeyInfo *key_info = &(*key_info_list)[k];
+        string key_str;
+        codec_->EncodeKey(key_info->key, &key_str);
+        key_info->id_in_key_trie = key_trie_builder_->GetId(key_str);
+      });
 }
 
 void SystemDictionaryBuilder::BuildTokenArray(
@@ -455,11 +549,22 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (size_t i = 0; i < id_to_keyinfo_table.size(); ++i) {
-      const KeyInfo &key_info = *id_to_keyinfo_table[i];
-      string tokens_str;
-      codec_->EncodeTokens(key_info.tokens, &tokens_str);
-      token_array_builder_->Add(tokens_str);
+    // The tokens are encoded in parallel block by block, and added in the
+    // order of the ids.
+    const size_t kBlockSize = 1 << 16;
+    vector<string> tokens_strs;
+    for (size_t begin = 0; begin < id_to_keyinfo_table.size();
+         begin += kBlockSize) {
+      const size_t size =
+          std::min(kBlockSize, id_to_keyinfo_table.size() - begin);
+      tokens_strs.resize(size);
+      ParallelForEach(ThreadPool::GetDefault(), size, [&](size_t i) {
+        codec_->EncodeTokens(id_to_keyinfo_table[begin + i]->tokens,
+                             &tokens_strs[i]);
+      });
+      for (size_t i = 0; i < size; ++i) {
+        token_array_builder_->Add(tokens_strs[i]);
+      }
     }
   }
 
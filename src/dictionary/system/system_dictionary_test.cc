@@ -32,6 +32,8 @@
 #include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -41,6 +43,7 @@
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "data_manager/user_pos_manager.h"
@@ -75,6 +78,7 @@ DEFINE_int32(dictionary_test_size, 100000,
 DEFINE_int32(dictionary_reverse_lookup_test_size, kDefaultReverseLookupTestSize,
              "Number of tokens to run reverse lookup test.");
 DECLARE_int32(min_key_length_to_use_small_cost_encoding);
+DECLARE_bool(use_tail_for_value_trie);
 
 namespace mozc {
 namespace dictionary {
@@ -328,6 +332,44 @@ TEST_F(SystemDictionaryTest, NormalWord) {
   EXPECT_TRUE(callback.tokens().empty());
 }
 
+TEST_F(SystemDictionaryTest, SharedIndex) {
+  vector<Token *> source_tokens;
+  unique_ptr<Token> t0(new Token);
+  // "あ"
+  t0->key = "\xe3\x81\x82";
+  // "亜"
+  t0->value = "\xe4\xba\x9c";
+  t0->cost = 100;
+  t0->lid = 50;
+  t0->rid = 70;
+  source_tokens.push_back(t0.get());
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+
+  const string index_dir =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "shared_index");
+  if (!FileUtil::DirectoryExists(index_dir)) {
+    ASSERT_TRUE(FileUtil::CreateDirectory(index_dir));
+  }
+
+  // The first instance creates the index file and the second one maps it.
+  for (int i = 0; i < 2; ++i) {
+    unique_ptr<SystemDictionary> system_dic(
+        SystemDictionary::Builder(dic_fn_)
+            .SetSharedIndexDirectory(index_dir)
+            .Build());
+    ASSERT_TRUE(system_dic.get() != NULL)
+        << "Failed to open dictionary source:" << dic_fn_;
+
+    CollectTokenCallback callback;
+    system_dic->LookupPrefix(
+        "\xE3\x81\x82\xE3\x81\x84\xE3\x81\x86",  // "あいう"
+        convreq_, &callback);
+    ASSERT_EQ(1, callback.tokens().size());
+    EXPECT_TOKEN_EQ(*t0, callback.tokens().front());
+    EXPECT_TRUE(system_dic->HasValue(t0->value));
+  }
+}
+
 TEST_F(SystemDictionaryTest, SameWord) {
   vector<Token> tokens(4);
 
@@ -373,6 +415,27 @@ TEST_F(SystemDictionaryTest, SameWord) {
   EXPECT_TOKENS_EQ_UNORDERED(source_tokens, callback.tokens());
 }
 
+TEST_F(SystemDictionaryTest, ParallelBuildIsDeterministic) {
+  const vector<Token *> &source_tokens = text_dict_->tokens();
+  ASSERT_LT(10000, source_tokens.size());
+
+  // The dictionary built in parallel is byte-identical to the one built on
+  // the calling thread only.
+  string images[2];
+  for (int i = 0; i < 2; ++i) {
+    ThreadPool pool(i == 0 ? 0 : 3, "SystemDictionaryTest");
+    ThreadPool::SetDefaultForTesting(&pool);
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(source_tokens);
+    std::ostringstream stream;
+    builder.WriteToStream("", &stream);
+    images[i] = stream.str();
+    ThreadPool::SetDefaultForTesting(nullptr);
+  }
+  EXPECT_FALSE(images[0].empty());
+  EXPECT_TRUE(images[0] == images[1]);
+}
+
 TEST_F(SystemDictionaryTest, LookupAllWords) {
   const vector<Token *> &source_tokens = text_dict_->tokens();
   BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
@@ -391,6 +454,93 @@ TEST_F(SystemDictionaryTest, LookupAllWords) {
   }
 }
 
+TEST_F(SystemDictionaryTest, ValueCache) {
+  const vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> plain_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(plain_dic.get() != NULL);
+  unique_ptr<SystemDictionary> cached_dic(
+      SystemDictionary::Builder(dic_fn_).SetValueCacheSize(256).Build());
+  ASSERT_TRUE(cached_dic.get() != NULL);
+
+  // The same tokens are looked up with the cache, whether the values are
+  // cached or not.  The second round hits the cache more.
+  const size_t kNumKeys = min<size_t>(source_tokens.size(), 1000);
+  for (int round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      CollectTokenCallback expected, actual;
+      plain_dic->LookupPrefix(source_tokens[i]->key, convreq_, &expected);
+      cached_dic->LookupPrefix(source_tokens[i]->key, convreq_, &actual);
+      ASSERT_EQ(expected.tokens().size(), actual.tokens().size());
+      for (size_t j = 0; j < expected.tokens().size(); ++j) {
+        EXPECT_TOKEN_EQ(expected.tokens()[j], actual.tokens()[j]);
+      }
+    }
+  }
+
+  const DecodedValueCache::Stats stats = cached_dic->GetValueCacheStats();
+  EXPECT_GT(stats.hits, 0);
+  EXPECT_GT(stats.misses, 0);
+  EXPECT_EQ(0, plain_dic->GetValueCacheStats().hits);
+  EXPECT_EQ(0, plain_dic->GetValueCacheStats().misses);
+
+  cached_dic->ClearValueCacheStats();
+  EXPECT_EQ(0, cached_dic->GetValueCacheStats().hits);
+  EXPECT_EQ(0, cached_dic->GetValueCacheStats().misses);
+}
+
+TEST_F(SystemDictionaryTest, ValueTrieWithTail) {
+  const vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> plain_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(plain_dic.get() != NULL);
+  EXPECT_FALSE(plain_dic->value_trie().has_tail());
+
+  const string tail_dic_fn =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "mozc_tail.dic");
+  {
+    FLAGS_use_tail_for_value_trie = true;
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(source_tokens);
+    builder.WriteToFile(tail_dic_fn);
+    FLAGS_use_tail_for_value_trie = false;
+  }
+  unique_ptr<SystemDictionary> tail_dic(
+      SystemDictionary::Builder(tail_dic_fn).Build());
+  ASSERT_TRUE(tail_dic.get() != NULL);
+  EXPECT_TRUE(tail_dic->value_trie().has_tail());
+
+  for (size_t i = 0; i < source_tokens.size(); ++i) {
+    const Token &token = *source_tokens[i];
+    CheckTokenExistenceCallback callback(&token);
+    tail_dic->LookupPrefix(token.key, convreq_, &callback);
+    EXPECT_TRUE(callback.found()) << "Token was not found: "
+                                  << PrintToken(token);
+    EXPECT_TRUE(tail_dic->HasValue(token.value)) << token.value;
+  }
+
+  // The reverse lookup, which runs the prefix search on the value trie,
+  // finds the same tokens.  They are compared as sets because the number of
+  // duplicates depends on the order of the tokens, which is sorted by the
+  // value ids.
+  int size = FLAGS_dictionary_reverse_lookup_test_size;
+  for (size_t i = 0; size > 0 && i < source_tokens.size(); ++i, --size) {
+    CollectTokenCallback callbacks[2];
+    plain_dic->LookupReverse(source_tokens[i]->value, convreq_, &callbacks[0]);
+    tail_dic->LookupReverse(source_tokens[i]->value, convreq_, &callbacks[1]);
+    set<string> token_sets[2];
+    for (int j = 0; j < 2; ++j) {
+      for (size_t k = 0; k < callbacks[j].tokens().size(); ++k) {
+        token_sets[j].insert(PrintToken(callbacks[j].tokens()[k]));
+      }
+    }
+    EXPECT_EQ(token_sets[0], token_sets[1]) << source_tokens[i]->value;
+  }
+  FileUtil::Unlink(tail_dic_fn);
+}
+
 TEST_F(SystemDictionaryTest, SimpleLookupPrefix) {
   // "は"
   const string k0 = "\xe3\x81\xaf";
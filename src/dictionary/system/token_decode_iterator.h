@@ -38,6 +38,7 @@
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/decoded_value_cache.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/louds_trie.h"
 
@@ -46,8 +47,10 @@ namespace dictionary {
 
 class TokenDecodeIterator {
  public:
+  // |value_cache| may be nullptr.
   TokenDecodeIterator(const SystemDictionaryCodecInterface *codec,
                       const storage::louds::LoudsTrie &value_trie,
+                      const DecodedValueCache *value_cache,
                       const uint32 *frequent_pos,
                       StringPiece key,
                       const uint8 *ptr);
@@ -68,12 +71,23 @@ class TokenDecodeIterator {
 
   void LookupValue(int id, string *value) const {
     char buffer[storage::louds::LoudsTrie::kMaxDepth + 1];
+    if (value_cache_ != nullptr) {
+      StringPiece cached_value;
+      if (value_cache_->Lookup(id, buffer, &cached_value)) {
+        value->assign(cached_value.data(), cached_value.size());
+        return;
+      }
+    }
     const StringPiece encoded_value = value_trie_->RestoreKeyString(id, buffer);
     codec_->DecodeValue(encoded_value, value);
+    if (value_cache_ != nullptr) {
+      value_cache_->Insert(id, *value);
+    }
   }
 
   const SystemDictionaryCodecInterface *codec_;
   const storage::louds::LoudsTrie *value_trie_;
+  const DecodedValueCache *value_cache_;
   const uint32 *frequent_pos_;
 
   const StringPiece key_;
@@ -94,11 +108,13 @@ class TokenDecodeIterator {
 inline TokenDecodeIterator::TokenDecodeIterator(
     const SystemDictionaryCodecInterface *codec,
     const storage::louds::LoudsTrie &value_trie,
+    const DecodedValueCache *value_cache,
     const uint32 *frequent_pos,
     StringPiece key,
     const uint8 *ptr)
     : codec_(codec),
       value_trie_(&value_trie),
+      value_cache_(value_cache),
       frequent_pos_(frequent_pos),
       key_(key),
       state_(HAS_NEXT),
@@ -151,6 +151,56 @@ TEST_F(ValueDictionaryTest, LookupPredictive) {
   }
 }
 
+TEST_F(ValueDictionaryTest, LookupPredictiveWithTail) {
+  louds_trie_builder_.reset(new LoudsTrieBuilder(true));
+  AddValue("google");
+  AddValue("we");
+  AddValue("word");
+  AddValue("world");
+  std::unique_ptr<ValueDictionary> dictionary(BuildValueDictionary());
+  ASSERT_TRUE(louds_trie_->has_tail());
+
+  Token token_google, token_word, token_world;
+  InitToken("google", &token_google);
+  InitToken("word", &token_word);
+  InitToken("world", &token_world);
+
+  {
+    // The key ends in the tail of "google".
+    CollectTokenCallback callback;
+    dictionary->LookupPredictive("goo", convreq_, &callback);
+    vector<Token *> expected;
+    expected.push_back(&token_google);
+    EXPECT_TOKENS_EQ_UNORDERED(expected, callback.tokens());
+  }
+  {
+    CollectTokenCallback callback;
+    dictionary->LookupPredictive("wor", convreq_, &callback);
+    vector<Token *> expected;
+    expected.push_back(&token_word);
+    expected.push_back(&token_world);
+    EXPECT_TOKENS_EQ_UNORDERED(expected, callback.tokens());
+  }
+  {
+    CollectTokenCallback callback;
+    dictionary->LookupPredictive("worl", convreq_, &callback);
+    vector<Token *> expected;
+    expected.push_back(&token_world);
+    EXPECT_TOKENS_EQ_UNORDERED(expected, callback.tokens());
+  }
+  {
+    CollectTokenCallback callback;
+    dictionary->LookupPredictive("goal", convreq_, &callback);
+    EXPECT_TRUE(callback.tokens().empty());
+  }
+  {
+    CollectTokenCallback callback;
+    dictionary->LookupExact("google", convreq_, &callback);
+    ASSERT_EQ(1, callback.tokens().size());
+    EXPECT_EQ("google", callback.tokens()[0].value);
+  }
+}
+
 TEST_F(ValueDictionaryTest, LookupExact) {
   AddValue("we");
   AddValue("war");
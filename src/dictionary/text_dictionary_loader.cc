@@ -47,6 +47,7 @@
 #include "base/number_util.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
@@ -58,6 +59,9 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
+// The number of the lines parsed in parallel at once.
+const size_t kParseBatchSize = 1 << 16;
+
 // Functor to sort a sequence of Tokens first by value and then by key.
 struct OrderByValueThenByKey {
   bool operator()(const Token *l, const Token *r) const {
@@ -167,17 +171,42 @@ void TextDictionaryLoader::LoadWithLineLimit(
     tokens_.reserve(limit);
   }
 
-  // Read system dictionary.
+  // Read system dictionary.  The lines are parsed in parallel batch by batch,
+  // keeping their order.
   {
+    ThreadPool *pool = ThreadPool::GetDefault();
     InputMultiFile file(dictionary_filename);
+    vector<string> lines;
     string line;
-    while (limit > 0 && file.ReadLine(&line)) {
-      Util::ChopReturns(&line);
-      Token *token = ParseTSVLine(line);
-      if (token) {
-        tokens_.push_back(token);
-        --limit;
+    bool eof = false;
+    while (limit > 0 && !eof) {
+      const size_t batch_size =
+          std::min(kParseBatchSize, static_cast<size_t>(limit));
+      lines.clear();
+      while (lines.size() < batch_size && file.ReadLine(&line)) {
+        Util::ChopReturns(&line);
+        lines.push_back(line);
+      }
+      eof = lines.size() < batch_size;
+
+      std::unique_ptr<Token[]> block(new Token[lines.size()]);
+      vector<char> parsed(lines.size());
+      const int num_tasks = static_cast<int>(std::min(
+          lines.size() / 1024 + 1,
+          static_cast<size_t>(pool->num_threads() + 1)));
+      ThreadPool::ParallelFor(pool, 0, num_tasks, [&](int task) {
+        const size_t end = lines.size() * (task + 1) / num_tasks;
+        for (size_t i = lines.size() * task / num_tasks; i < end; ++i) {
+          parsed[i] = ParseTSVLine(lines[i], &block[i]);
+        }
+      });
+      for (size_t i = 0; i < lines.size(); ++i) {
+        if (parsed[i]) {
+          tokens_.push_back(&block[i]);
+          --limit;
+        }
       }
+      token_blocks_.push_back(std::move(block));
     }
     LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
   }
@@ -199,11 +228,8 @@ void TextDictionaryLoader::LoadWithLineLimit(
   vector<Token *> reading_correction_tokens;
   LoadReadingCorrectionTokens(reading_correction_filename, tokens_,
                               &limit, &reading_correction_tokens);
-  const size_t tokens_size = tokens_.size();
-  tokens_.resize(tokens_size + reading_correction_tokens.size());
   for (size_t i = 0; i < reading_correction_tokens.size(); ++i) {
-    // |tokens_| takes the ownership of each allocated token.
-    tokens_[tokens_size + i] = reading_correction_tokens[i];
+    AddToken(reading_correction_tokens[i]);
   }
 }
 
@@ -296,7 +322,9 @@ void TextDictionaryLoader::LoadReadingCorrectionTokens(
 }
 
 void TextDictionaryLoader::Clear() {
-  STLDeleteElements(&tokens_);
+  tokens_.clear();
+  token_blocks_.clear();
+  STLDeleteElements(&owned_tokens_);
 }
 
 void TextDictionaryLoader::CollectTokens(vector<Token *> *res) const {
@@ -305,18 +333,16 @@ void TextDictionaryLoader::CollectTokens(vector<Token *> *res) const {
   res->insert(res->end(), tokens_.begin(), tokens_.end());
 }
 
-Token *TextDictionaryLoader::ParseTSVLine(StringPiece line) const {
+bool TextDictionaryLoader::ParseTSVLine(StringPiece line, Token *token) const {
   vector<StringPiece> columns;
   Util::SplitStringUsing(line, "\t", &columns);
-  return ParseTSV(columns);
+  return ParseTSV(columns, token);
 }
 
-Token *TextDictionaryLoader::ParseTSV(
-    const vector<StringPiece> &columns) const {
+bool TextDictionaryLoader::ParseTSV(const vector<StringPiece> &columns,
+                                    Token *token) const {
   CHECK_LE(5, columns.size()) << "Lack of columns: " << columns.size();
 
-  std::unique_ptr<Token> token(new Token);
-
   // Parse key, lid, rid, cost, value.
   Util::NormalizeVoicedSoundMark(columns[0], &token->key);
   CHECK(SafeStrToInt(columns[1], &token->lid))
@@ -330,10 +356,10 @@ Token *TextDictionaryLoader::ParseTSV(
   // Optionally, label (SPELLING_CORRECTION, ZIP_CODE, etc.) may be provided in
   // column 6.
   if (columns.size() > 5) {
-    CHECK(RewriteSpecialToken(token.get(), columns[5]))
+    CHECK(RewriteSpecialToken(token, columns[5]))
         << "Invalid label: " << columns[5];
   }
-  return token.release();
+  return true;
 }
 
 }  // namespace dictionary
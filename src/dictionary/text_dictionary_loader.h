@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 #define MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -55,7 +56,9 @@ class TextDictionaryLoader {
   // The reading correction file is optional and can be an empty string.  Note
   // that the tokens loaded so far are all cleared and that this class takes the
   // ownership of the loaded tokens, i.e., they are deleted on destruction of
-  // this loader instance.
+  // this loader instance.  The lines of the dictionary files are parsed in
+  // parallel on the default thread pool, and the tokens are in the order of
+  // the lines.
   void Load(const string &dictionary_filename,
             const string &reading_correction_filename);
 
@@ -71,6 +74,7 @@ class TextDictionaryLoader {
   // Adds a token.  The ownership is taken by the loader.
   void AddToken(Token *token) {
     tokens_.push_back(token);
+    owned_tokens_.push_back(token);
   }
 
   const vector<Token *> &tokens() const {
@@ -83,8 +87,11 @@ class TextDictionaryLoader {
   void CollectTokens(vector<Token *> *res) const;
 
  protected:
-  // Allows derived classes to implement custom filtering rules.
-  virtual Token *ParseTSV(const vector<StringPiece> &columns) const;
+  // Parses the columns into |token|.  Returns false if the line is filtered
+  // out.  Allows derived classes to implement custom filtering rules.  Called
+  // from multiple threads concurrently.
+  virtual bool ParseTSV(const vector<StringPiece> &columns,
+                        Token *token) const;
 
   const POSMatcher *pos_matcher_;
 
@@ -103,9 +110,14 @@ class TextDictionaryLoader {
   // Otherwise, the method returns false.
   bool RewriteSpecialToken(Token *token, StringPiece label) const;
 
-  Token *ParseTSVLine(StringPiece line) const;
+  bool ParseTSVLine(StringPiece line, Token *token) const;
 
   vector<Token *> tokens_;
+  // The tokens parsed from the dictionary files are allocated in blocks
+  // rather than one by one.
+  vector<std::unique_ptr<Token[]>> token_blocks_;
+  // The other tokens, which are allocated one by one.
+  vector<Token *> owned_tokens_;
 
   FRIEND_TEST(TextDictionaryLoaderTest, RewriteSpecialTokenTest);
 };
@@ -33,6 +33,8 @@
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/number_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "data_manager/scoped_data_manager_initializer_for_testing.h"
 #include "data_manager/user_pos_manager.h"
@@ -260,5 +262,40 @@ TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   EXPECT_EQ(30 + 2302, tokens[3]->cost);
 }
 
+TEST_F(TextDictionaryLoaderTest, ParallelLoadTest) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "large.tsv");
+  const int kNumLines = 100000;
+  {
+    OutputFileStream ofs(filename.c_str());
+    for (int i = 0; i < kNumLines; ++i) {
+      ofs << "key" << i << "\t" << i % 10 << "\t" << i % 20 << "\t" << i
+          << "\tvalue" << i << "\n";
+    }
+  }
+
+  ThreadPool pool(3, "TextDictionaryLoaderTest");
+  ThreadPool::SetDefaultForTesting(&pool);
+  unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+  loader->Load(filename, "");
+  ThreadPool::SetDefaultForTesting(nullptr);
+
+  const vector<Token *> &tokens = loader->tokens();
+  ASSERT_EQ(kNumLines, tokens.size());
+  for (int i = 0; i < kNumLines; ++i) {
+    const string suffix = NumberUtil::SimpleItoa(i);
+    EXPECT_EQ("key" + suffix, tokens[i]->key);
+    EXPECT_EQ("value" + suffix, tokens[i]->value);
+    EXPECT_EQ(i % 10, tokens[i]->lid);
+    EXPECT_EQ(i % 20, tokens[i]->rid);
+    EXPECT_EQ(i, tokens[i]->cost);
+  }
+
+  // The line limit is respected across the batches.
+  loader->LoadWithLineLimit(filename, "", kNumLines - 1);
+  EXPECT_EQ(kNumLines - 1, loader->tokens().size());
+
+  FileUtil::Unlink(filename);
+}
+
 }  // namespace dictionary
 }  // namespace mozc
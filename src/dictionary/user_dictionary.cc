@@ -42,7 +42,7 @@
 #include "base/mutex.h"
 #include "base/singleton.h"
 #include "base/stl_util.h"
-#include "base/thread.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
@@ -205,17 +205,27 @@ MOZC_CLANG_POP_WARNING();
   SuppressionDictionary *suppression_dictionary_;
 };
 
-class UserDictionary::UserDictionaryReloader : public Thread {
+// Reloads the user dictionary on the default thread pool.
+class UserDictionary::UserDictionaryReloader {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
       : modified_at_(0), auto_register_mode_(false), dic_(dic) {
     DCHECK(dic_);
   }
 
-  virtual ~UserDictionaryReloader() {
+  ~UserDictionaryReloader() {
     Join();
   }
 
+  // Returns true while the reload is queued or running.
+  bool IsRunning() const {
+    return !task_.IsDone();
+  }
+
+  void Join() {
+    task_.Wait();
+  }
+
   void StartAutoRegistration(const string &key,
                              const string &value,
                              user_dictionary::UserDictionary::PosType pos) {
@@ -226,7 +236,7 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       value_ = value;
       pos_ = pos;
     }
-    Start("UserDictionaryReloader");
+    Start();
   }
 
   // When the user dictionary exists AND the modification time has been updated,
@@ -246,10 +256,15 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       return;
     }
     modified_at_ = modification_time;
-    Start("UserDictionaryReloader");
+    Start();
+  }
+
+ private:
+  void Start() {
+    task_ = ThreadPool::GetDefault()->Submit([this]() { Run(); });
   }
 
-  virtual void Run() {
+  void Run() {
     std::unique_ptr<UserDictionaryStorage> storage(new UserDictionaryStorage(
         Singleton<UserDictionaryFileManager>::get()->GetFileName()));
 
@@ -277,7 +292,7 @@ class UserDictionary::UserDictionaryReloader : public Thread {
     dic_->Load(*(storage.get()));
   }
 
- private:
+  TaskHandle task_;
   FileTimeStamp modified_at_;
   Mutex mutex_;
   bool auto_register_mode_;
@@ -298,7 +313,8 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
-      mutex_(new ReaderWriterMutex) {
+      mutex_(new ReaderWriterMutex),
+      generation_(0) {
   DCHECK(user_pos_.get());
   DCHECK(pos_matcher_);
   DCHECK(suppression_dictionary_);
@@ -573,9 +589,14 @@ void UserDictionary::Swap(TokensIndex *new_tokens) {
     scoped_writer_lock l(mutex_.get());
     tokens_ = new_tokens;
   }
+  generation_.fetch_add(1);
   delete old_tokens;
 }
 
+uint64 UserDictionary::generation() const {
+  return generation_.load();
+}
+
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
   size_t size = 0;
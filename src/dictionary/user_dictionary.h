@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -92,6 +93,11 @@ class UserDictionary : public DictionaryInterface {
   // Waits until reloader finishes
   void WaitForReloader();
 
+  // Returns the number of times the tokens have been replaced by Load() and
+  // Reload().  A result looked up from this dictionary is up to date while the
+  // generation is unchanged.
+  uint64 generation() const;
+
   // Adds new word to auto registered dictionary and reload asynchronously.
   // Note that this method will not guarantee that
   // new word is added successfully, since the actual
@@ -119,6 +125,7 @@ class UserDictionary : public DictionaryInterface {
   SuppressionDictionary *suppression_dictionary_;
   TokensIndex *tokens_;
   mutable std::unique_ptr<ReaderWriterMutex> mutex_;
+  std::atomic<uint64> generation_;
 
   friend class UserDictionaryTest;
   DISALLOW_COPY_AND_ASSIGN(UserDictionary);
@@ -29,6 +29,7 @@
 
 #include "engine/engine.h"
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "converter/connector.h"
@@ -66,6 +67,18 @@ using mozc::dictionary::UserDictionary;
 using mozc::dictionary::UserPOS;
 using mozc::dictionary::ValueDictionary;
 
+DEFINE_string(shared_dictionary_index_dir, "",
+              "directory for the system dictionary indexes shared among "
+              "server processes. The index shared among the users is "
+              "generated by gen_shared_dictionary_index_main run as root. "
+              "If empty, they are built on the heap.");
+DEFINE_int32(system_dictionary_value_cache_size, 4096,
+             "number of the decoded values of the system dictionary cached "
+             "by the id. 0 disables the cache.");
+DEFINE_int32(conversion_result_cache_size, 0,
+             "number of the conversion results cached for the same key, "
+             "context and user data. 0 disables the cache.");
+
 namespace mozc {
 namespace {
 
@@ -159,7 +172,10 @@ void Engine::Init(
   data_manager->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
 
   SystemDictionary *sysdic =
-      SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+      SystemDictionary::Builder(dictionary_data, dictionary_size)
+          .SetSharedIndexDirectory(FLAGS_shared_dictionary_index_dir)
+          .SetValueCacheSize(FLAGS_system_dictionary_value_cache_size)
+          .Build();
   dictionary_.reset(new DictionaryImpl(
       sysdic,  // DictionaryImpl takes the ownership
       new ValueDictionary(*data_manager->GetPOSMatcher(),
@@ -254,6 +270,10 @@ void Engine::Init(
                        predictor_,
                        rewriter_,
                        immutable_converter_.get());
+  if (FLAGS_conversion_result_cache_size > 0) {
+    converter_impl->EnableConversionResultCache(
+        FLAGS_conversion_result_cache_size, user_dictionary_.get());
+  }
 
   user_data_manager_.reset(new UserDataManagerImpl(predictor_, rewriter_));
 }
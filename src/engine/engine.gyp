@@ -125,6 +125,17 @@
         'engine',
       ],
     },
+    {
+      'target_name': 'gen_shared_dictionary_index_main',
+      'type': 'executable',
+      'sources': [
+        'gen_shared_dictionary_index_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        'engine_factory',
+      ],
+    },
     {
       'target_name': 'engine_factory',
       'type': 'none',
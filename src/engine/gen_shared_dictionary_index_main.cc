@@ -0,0 +1,84 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Generates the system dictionary index file shared by the server processes
+// of all the users on the host.
+//
+// Server processes running as normal users map only the files owned by root
+// or by themselves (see storage::SharedIndexFile), so the file shared among
+// the users is generated by this program run as root, e.g., at installation
+// or after updating the data set:
+//
+// sudo gen_shared_dictionary_index_main
+//  --shared_dictionary_index_dir=/var/cache/mozc
+//
+// The servers are then started with the same --shared_dictionary_index_dir.
+// The directory should not be writable by the normal users.
+
+#ifndef OS_WIN
+#include <unistd.h>
+#endif  // OS_WIN
+
+#include <memory>
+
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
+
+DECLARE_string(shared_dictionary_index_dir);
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  if (FLAGS_shared_dictionary_index_dir.empty()) {
+    LOG(ERROR) << "--shared_dictionary_index_dir is not specified";
+    return 1;
+  }
+  if (!mozc::FileUtil::DirectoryExists(FLAGS_shared_dictionary_index_dir)) {
+    LOG(ERROR) << "No such directory: " << FLAGS_shared_dictionary_index_dir;
+    return 1;
+  }
+#ifndef OS_WIN
+  if (::geteuid() != 0) {
+    LOG(WARNING) << "Not running as root. The generated file is used only by "
+                 << "the current user";
+  }
+#endif  // OS_WIN
+
+  // The system dictionary creates the index file if it doesn't exist.
+  std::unique_ptr<mozc::EngineInterface> engine(
+      mozc::EngineFactory::Create());
+  CHECK(engine.get());
+
+  return 0;
+}
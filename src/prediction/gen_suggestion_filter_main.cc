@@ -46,6 +46,9 @@ DEFINE_bool(header, true,
             "make header file instead of raw bloom filter");
 DEFINE_string(name, "SuggestionFilterData",
               "name for variable name in the header file");
+DEFINE_bool(blocked_layout, false,
+            "use cache-line-blocked bloom filter layout, where all the "
+            "probes of a word fall in one 64-byte block");
 
 namespace {
 void ReadWords(const string &name, vector<uint64> *words) {
@@ -91,8 +94,10 @@ int main(int argc, char **argv) {
 
   LOG(INFO) << "num_bytes: " << num_bytes;
 
+  const ExistenceFilter::Layout layout = FLAGS_blocked_layout ?
+      ExistenceFilter::BLOCKED_LAYOUT : ExistenceFilter::CLASSIC_LAYOUT;
   std::unique_ptr<ExistenceFilter> filter(
-      ExistenceFilter::CreateOptimal(num_bytes, words.size()));
+      ExistenceFilter::CreateOptimal(num_bytes, words.size(), layout));
   for (size_t i = 0; i < words.size(); ++i) {
     filter->Insert(words[i]);
   }
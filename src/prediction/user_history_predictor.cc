@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cctype>
 #include <climits>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -41,7 +42,8 @@
 #include "base/flags.h"
 #include "base/hash.h"
 #include "base/logging.h"
-#include "base/thread.h"
+#include "base/stopwatch.h"
+#include "base/thread_pool.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -55,6 +57,7 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/variants_rewriter.h"
+#include "storage/encrypted_journal.h"
 #include "storage/encrypted_string_storage.h"
 #include "storage/lru_cache.h"
 #include "usage_stats/usage_stats.h"
@@ -112,9 +115,20 @@ const char kFileName[] = "user://history.db";
 const char kFileName[] = "user://.history.db";
 #endif
 
+// The changes since the last snapshot are appended to this file, which is
+// placed next to the history.
+const char kJournalSuffix[] = ".journal";
+
+// The changes are appended to the journal until it grows larger than the
+// snapshot or this size.
+const size_t kMinJournalSizeToCompact = 64 * 1024;
+
 // Uses '\t' as a key/value delimiter
 const char kDelimiter[] = "\t";
 
+// The version of the fingerprints of next entries saved in the file.
+const Hash::FingerprintVersion kFingerprintVersion = Hash::FINGERPRINT_FAST;
+
 // "絵文字"
 const char kEmojiDescription[] = "\xE7\xB5\xB5\xE6\x96\x87\xE5\xAD\x97";
 
@@ -360,42 +374,6 @@ UserHistoryPredictor::EntryPriorityQueue::NewEntry() {
   return pool_.Alloc();
 }
 
-class UserHistoryPredictorSyncer : public Thread {
- public:
-  enum RequestType {
-    LOAD,
-    SAVE
-  };
-
-  UserHistoryPredictorSyncer(UserHistoryPredictor *predictor,
-                             RequestType type)
-      : predictor_(predictor), type_(type) {
-    DCHECK(predictor_);
-  }
-
-  virtual void Run() {
-    switch (type_) {
-      case LOAD:
-        VLOG(1) << "Executing Reload method";
-        predictor_->Load();
-        break;
-      case SAVE:
-        VLOG(1) << "Executing Sync method";
-        predictor_->Save();
-        break;
-      default:
-        LOG(ERROR) << "Unknown request: " << static_cast<int>(type_);
-    }
-  }
-
-  virtual ~UserHistoryPredictorSyncer() {
-    Join();
-  }
-
-  UserHistoryPredictor *predictor_;
-  RequestType type_;
-};
-
 UserHistoryPredictor::UserHistoryPredictor(
     const DictionaryInterface *dictionary,
     const POSMatcher *pos_matcher,
@@ -407,7 +385,11 @@ UserHistoryPredictor::UserHistoryPredictor(
       predictor_name_("UserHistoryPredictor"),
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
-      dic_(new DicCache(UserHistoryPredictor::cache_size())) {
+      dic_(new DicCache(UserHistoryPredictor::cache_size())),
+      should_write_snapshot_(true),
+      generation_(0),
+      snapshot_size_(0),
+      sync_stats_() {
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
 }
@@ -429,10 +411,8 @@ uint16 UserHistoryPredictor::revert_id() {
 }
 
 void UserHistoryPredictor::WaitForSyncer() {
-  if (syncer_.get() != nullptr) {
-    syncer_->Join();
-    syncer_.reset();
-  }
+  syncer_.Wait();
+  syncer_ = TaskHandle();
 }
 
 bool UserHistoryPredictor::WaitForSyncerForTest() {
@@ -441,14 +421,10 @@ bool UserHistoryPredictor::WaitForSyncerForTest() {
 }
 
 bool UserHistoryPredictor::CheckSyncerAndDelete() const {
-  if (syncer_.get() != nullptr) {
-    if (syncer_->IsRunning()) {
-      return false;
-    } else {
-      syncer_.reset();
-    }
+  if (!syncer_.IsDone()) {
+    return false;
   }
-
+  syncer_ = TaskHandle();
   return true;
 }
 
@@ -467,10 +443,10 @@ bool UserHistoryPredictor::AsyncLoad() {
     return true;
   }
 
-  syncer_.reset(new UserHistoryPredictorSyncer(
-      this,
-      UserHistoryPredictorSyncer::LOAD));
-  syncer_->Start("UserHistoryPredictor:Load");
+  syncer_ = ThreadPool::GetDefault()->Submit([this]() {
+    VLOG(1) << "Executing Reload method";
+    return Load();
+  });
 
   return true;
 }
@@ -484,10 +460,25 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  syncer_.reset(new UserHistoryPredictorSyncer(
-      this,
-      UserHistoryPredictorSyncer::SAVE));
-  syncer_->Start("UserHistoryPredictor:Save");
+  updated_ = false;
+  if (ShouldWriteSnapshot()) {
+    dirty_fps_.clear();
+    promoted_fps_.clear();
+    syncer_ = ThreadPool::GetDefault()->Submit([this]() {
+      VLOG(1) << "Executing Sync method";
+      return WriteSnapshot();
+    });
+    return true;
+  }
+
+  // The changes are collected on this thread, which modifies |dic_|, and
+  // only the small record is written by the syncer.
+  string record;
+  TakeChanges(&record);
+  syncer_ = ThreadPool::GetDefault()->Submit([this, record]() {
+    VLOG(1) << "Executing Sync method";
+    return AppendToJournal(record);
+  });
 
   return true;
 }
@@ -501,6 +492,12 @@ bool UserHistoryPredictor::Load() {
     return false;
   }
 
+  bool migrated = false;
+  if (history.fingerprint_version() != kFingerprintVersion) {
+    MigrateFingerprints(&history);
+    migrated = true;
+  }
+
   for (size_t i = 0; i < history.entries_size(); ++i) {
     dic_->Insert(EntryFingerprint(history.entries(i)),
                  history.entries(i));
@@ -508,14 +505,132 @@ bool UserHistoryPredictor::Load() {
 
   VLOG(1) << "Loaded user histroy, size=" << history.entries_size();
 
+  generation_ = history.generation();
+  snapshot_size_ = history.ByteSize();
+
+  // The journal is written only after a snapshot of the current fingerprint
+  // version, so a migrated history has no journal to apply.
+  vector<string> records;
+  if (migrated ||
+      !journal_.Open(filename + kJournalSuffix, generation_, &records) ||
+      !ApplyJournal(records)) {
+    return true;
+  }
+
+  VLOG(1) << "Applied " << records.size() << " records of the journal";
+  should_write_snapshot_ = false;
+
+  return true;
+}
+
+bool UserHistoryPredictor::ApplyJournal(const vector<string> &records) {
+  user_history_predictor::UserHistory history;
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (!history.ParseFromString(records[i])) {
+      LOG(ERROR) << "broken record of the journal";
+      return false;
+    }
+    for (size_t j = 0; j < history.changes_size(); ++j) {
+      const Change &change = history.changes(j);
+      if (!change.has_entry()) {
+        dic_->Erase(change.fp());
+        continue;
+      }
+      Entry *entry = change.promoted() ?
+          nullptr : dic_->MutableLookupWithoutInsert(change.fp());
+      if (entry == nullptr) {
+        DicElement *e = dic_->Insert(change.fp());
+        if (e == nullptr) {
+          continue;
+        }
+        entry = &e->value;
+      }
+      entry->CopyFrom(change.entry());
+    }
+  }
   return true;
 }
 
 bool UserHistoryPredictor::Save() {
-  if (!updated_) {
+  if (!updated_ && !should_write_snapshot_) {
     return true;
   }
 
+  updated_ = false;
+  if (ShouldWriteSnapshot()) {
+    dirty_fps_.clear();
+    promoted_fps_.clear();
+    return WriteSnapshot();
+  }
+
+  string record;
+  TakeChanges(&record);
+  return AppendToJournal(record);
+}
+
+bool UserHistoryPredictor::ShouldWriteSnapshot() const {
+  // Replaying a journal larger than the snapshot costs more than loading the
+  // snapshot.
+  return should_write_snapshot_ ||
+      journal_.size() >= max(kMinJournalSizeToCompact, snapshot_size_);
+}
+
+void UserHistoryPredictor::TakeChanges(string *record) {
+  DCHECK(record);
+  user_history_predictor::UserHistory history;
+
+  // The entries moved to the head since the last sync are at the head of
+  // |dic_|.  They are written from the older one so that the replay
+  // reproduces the order of |dic_|.
+  vector<const DicElement *> promoted;
+  set<uint32> promoted_in_order;
+  for (const DicElement *elm = dic_->Head();
+       elm != nullptr && promoted_fps_.count(elm->key) > 0;
+       elm = elm->next) {
+    promoted.push_back(elm);
+    promoted_in_order.insert(elm->key);
+  }
+
+  for (set<uint32>::const_iterator it = dirty_fps_.begin();
+       it != dirty_fps_.end(); ++it) {
+    if (promoted_in_order.count(*it) > 0) {
+      continue;
+    }
+    Change *change = history.add_changes();
+    change->set_fp(*it);
+    const Entry *entry = dic_->LookupWithoutInsert(*it);
+    if (entry != nullptr) {
+      change->mutable_entry()->CopyFrom(*entry);
+    }
+  }
+  for (vector<const DicElement *>::const_reverse_iterator it =
+           promoted.rbegin(); it != promoted.rend(); ++it) {
+    Change *change = history.add_changes();
+    change->set_fp((*it)->key);
+    change->mutable_entry()->CopyFrom((*it)->value);
+    change->set_promoted(true);
+  }
+
+  dirty_fps_.clear();
+  promoted_fps_.clear();
+  history.SerializeToString(record);
+}
+
+bool UserHistoryPredictor::AppendToJournal(const string &record) {
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const size_t journal_size = journal_.size();
+  if (!journal_.Append(vector<string>(1, record))) {
+    LOG(ERROR) << "cannot append to the journal of the user history";
+    // The whole history is written at the next sync instead.
+    should_write_snapshot_ = true;
+    return false;
+  }
+  UpdateSyncStats(false, journal_.size() - journal_size,
+                  static_cast<uint64>(stopwatch.GetElapsedMicroseconds()));
+  return true;
+}
+
+bool UserHistoryPredictor::WriteSnapshot() {
   // Do not check incognito_mode or use_history_suggest in Config here.
   // The input data should not have been inserted when those flags are on.
 
@@ -524,12 +639,15 @@ bool UserHistoryPredictor::Save() {
     return true;
   }
 
+  Stopwatch stopwatch = Stopwatch::StartNew();
   const string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
   for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
     history.add_entries()->CopyFrom(elm->value);
   }
+  history.set_fingerprint_version(kFingerprintVersion);
+  history.set_generation(generation_ + 1);
 
   // Updates usage stats here.
   UsageStats::SetInteger(
@@ -538,14 +656,65 @@ bool UserHistoryPredictor::Save() {
 
   if (!history.Save()) {
     LOG(ERROR) << "UserHistoryStorage::Save() failed";
+    should_write_snapshot_ = true;
     return false;
   }
 
-  updated_ = false;
+  generation_ = history.generation();
+  snapshot_size_ = history.ByteSize();
+  should_write_snapshot_ = false;
+
+  // The journal of the previous generation is ignored from now on, so
+  // failing to reset it only costs a snapshot at the next sync.
+  if (journal_.filename().empty()) {
+    vector<string> unused_records;
+    journal_.Open(filename + kJournalSuffix, generation_, &unused_records);
+  }
+  if (!journal_.Reset(generation_)) {
+    LOG(ERROR) << "cannot reset the journal of the user history";
+    should_write_snapshot_ = true;
+  }
 
+  UpdateSyncStats(true, snapshot_size_,
+                  static_cast<uint64>(stopwatch.GetElapsedMicroseconds()));
   return true;
 }
 
+void UserHistoryPredictor::MarkUpdated(uint32 fp) {
+  dirty_fps_.insert(fp);
+}
+
+void UserHistoryPredictor::MarkPromoted(uint32 fp) {
+  dirty_fps_.insert(fp);
+  promoted_fps_.insert(fp);
+}
+
+void UserHistoryPredictor::MarkErased(uint32 fp) {
+  dirty_fps_.insert(fp);
+  promoted_fps_.erase(fp);
+}
+
+void UserHistoryPredictor::UpdateSyncStats(bool snapshot,
+                                           size_t bytes_written,
+                                           uint64 usec) {
+  if (snapshot) {
+    ++sync_stats_.snapshot_syncs;
+  } else {
+    ++sync_stats_.journal_syncs;
+  }
+  sync_stats_.total_bytes_written += bytes_written;
+  sync_stats_.max_bytes_written =
+      max<uint64>(sync_stats_.max_bytes_written, bytes_written);
+  sync_stats_.total_sync_usec += usec;
+  sync_stats_.max_sync_usec = max(sync_stats_.max_sync_usec, usec);
+  VLOG(1) << "Synced user history: " << bytes_written << " bytes in "
+          << usec << " usec" << (snapshot ? " (snapshot)" : "");
+}
+
+UserHistoryPredictor::SyncStats UserHistoryPredictor::GetSyncStats() const {
+  return sync_stats_;
+}
+
 bool UserHistoryPredictor::ClearAllHistory() {
   // Waits until syncer finishes
   WaitForSyncer();
@@ -554,6 +723,9 @@ bool UserHistoryPredictor::ClearAllHistory() {
   // Renews DicCache as LRUCache tries to reuse the internal value by
   // using FreeList
   dic_.reset(new DicCache(UserHistoryPredictor::cache_size()));
+  dirty_fps_.clear();
+  promoted_fps_.clear();
+  should_write_snapshot_ = true;
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -589,6 +761,7 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
     if (!dic_->Erase(keys[i])) {
       LOG(ERROR) << "cannot erase " << keys[i];
     }
+    MarkErased(keys[i]);
   }
 
   // Inserts a dummy event entry.
@@ -672,6 +845,7 @@ UserHistoryPredictor::RemoveNgramChain(const string &target_key,
           // |entry| is the second-to-the-last node. So cut the link to the
           // child entry.
           EraseNextEntries(fp, entry);
+          MarkUpdated(EntryFingerprint(*entry));
           return DONE;
         default:
           break;
@@ -711,11 +885,13 @@ bool UserHistoryPredictor::ClearHistoryEntry(const string &key,
   {
     // Finds the history entry that has the exactly same key and value and has
     // not been removed yet. If exists, remove it.
-    Entry *entry = dic_->MutableLookupWithoutInsert(Fingerprint(key, value));
+    const uint32 fp = Fingerprint(key, value);
+    Entry *entry = dic_->MutableLookupWithoutInsert(fp);
     if (entry != nullptr && !entry->removed()) {
       entry->set_suggestion_freq(0);
       entry->set_conversion_freq(0);
       entry->set_removed(true);
+      MarkUpdated(fp);
       // We don't clear entry->next_entries() so that we can generate prediction
       // by chaining.
       deleted = true;
@@ -1570,6 +1746,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
     VLOG(2) << "insert failed";
     return;
   }
+  MarkPromoted(dic_key);
 
   Entry *entry = &(e->value);
   DCHECK(entry);
@@ -1633,6 +1810,7 @@ void UserHistoryPredictor::Insert(const string &key,
     VLOG(2) << "insert failed";
     return;
   }
+  MarkPromoted(dic_key);
 
   Entry *entry = &(e->value);
   DCHECK(entry);
@@ -1932,8 +2110,11 @@ void UserHistoryPredictor::InsertHistory(RequestType request_type,
          Util::CharsLen(conversion_segment.value) > 1)) {
       return;
     }
-    Entry *history_entry = dic_->MutableLookupWithoutInsert(
-        LearningSegmentFingerprint(history_segment));
+    const uint32 history_fp = LearningSegmentFingerprint(history_segment);
+    Entry *history_entry = dic_->MutableLookupWithoutInsert(history_fp);
+    if (history_entry != nullptr) {
+      MarkUpdated(history_fp);
+    }
     NextEntry next_entry;
     if (segments->request_type() == Segments::CONVERSION) {
       next_entry.set_entry_fp(LearningSegmentFingerprint(conversion_segment));
@@ -1964,6 +2145,8 @@ void UserHistoryPredictor::Revert(Segments *segments) {
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
       VLOG(2) << "Erasing the key: " << StringToUint32(revert_entry.key);
       dic_->Erase(StringToUint32(revert_entry.key));
+      MarkErased(StringToUint32(revert_entry.key));
+      updated_ = true;
     }
   }
 }
@@ -2057,15 +2240,57 @@ uint32 UserHistoryPredictor::Fingerprint(const string &key,
                                          const string &value,
                                          EntryType type) {
   if (type == Entry::DEFAULT_ENTRY) {
-    // Since we have already used the fingerprint function for next entries and
-    // next entries are saved in user's local machine, we are not able
-    // to change the Fingerprint function for the old key/value type.
-    return Hash::Fingerprint32(key + kDelimiter + value);
+    // The fingerprints of next entries are saved in user's local machine.
+    // They are migrated by MigrateFingerprints() on load when the version
+    // is changed.
+    return Hash::Fingerprint32WithVersion(key + kDelimiter + value,
+                                          kFingerprintVersion);
   } else {
     return Hash::Fingerprint32(static_cast<uint8>(type));
   }
 }
 
+// static
+void UserHistoryPredictor::MigrateFingerprints(
+    user_history_predictor::UserHistory *history) {
+  const Hash::FingerprintVersion old_version =
+      static_cast<Hash::FingerprintVersion>(history->fingerprint_version());
+  VLOG(1) << "Migrating the fingerprints of the user history from "
+          << old_version << " to " << kFingerprintVersion;
+
+  map<uint32, uint32> fp_map;
+  if (old_version == Hash::FINGERPRINT_LOOKUP2 ||
+      old_version == Hash::FINGERPRINT_FAST) {
+    for (size_t i = 0; i < history->entries_size(); ++i) {
+      const Entry &entry = history->entries(i);
+      const string str = entry.key() + kDelimiter + entry.value();
+      fp_map[Hash::Fingerprint32WithVersion(str, old_version)] =
+          Hash::Fingerprint32WithVersion(str, kFingerprintVersion);
+    }
+  } else {
+    // All the next entries are dropped since they can't be restored.
+    LOG(WARNING) << "Unknown fingerprint version: " << old_version;
+  }
+
+  // The next entries pointing to the removed entries are dropped.
+  for (size_t i = 0; i < history->entries_size(); ++i) {
+    Entry *entry = history->mutable_entries(i);
+    int size = 0;
+    for (size_t j = 0; j < entry->next_entries_size(); ++j) {
+      map<uint32, uint32>::const_iterator it =
+          fp_map.find(entry->next_entries(j).entry_fp());
+      if (it == fp_map.end()) {
+        continue;
+      }
+      entry->mutable_next_entries(size++)->set_entry_fp(it->second);
+    }
+    while (entry->next_entries_size() > size) {
+      entry->mutable_next_entries()->RemoveLast();
+    }
+  }
+  history->set_fingerprint_version(kFingerprintVersion);
+}
+
 // static
 uint32 UserHistoryPredictor::Fingerprint(const string &key,
                                          const string &value) {
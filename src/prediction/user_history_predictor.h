@@ -39,12 +39,14 @@
 
 #include "base/freelist.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
 #include "base/trie.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
 #include "prediction/user_history_predictor.pb.h"
+#include "storage/encrypted_journal.h"
 #include "storage/lru_cache.h"
 // for FRIEND_TEST
 #include "testing/base/public/gunit_prod.h"
@@ -58,7 +60,6 @@ class StringStorageInterface;
 class ConversionRequest;
 class Segment;
 class Segments;
-class UserHistoryPredictorSyncer;
 
 // Added serialization method for UserHistory.
 class UserHistoryStorage : public mozc::user_history_predictor::UserHistory {
@@ -133,6 +134,7 @@ class UserHistoryPredictor : public PredictorInterface {
   typedef user_history_predictor::UserHistory::Entry Entry;
   typedef user_history_predictor::UserHistory::NextEntry NextEntry;
   typedef user_history_predictor::UserHistory::Entry::EntryType EntryType;
+  typedef user_history_predictor::UserHistory::Change Change;
 
   // Returns fingerprints from various object.
   static uint32 Fingerprint(const string &key, const string &value);
@@ -141,12 +143,33 @@ class UserHistoryPredictor : public PredictorInterface {
   static uint32 EntryFingerprint(const Entry &entry);
   static uint32 SegmentFingerprint(const Segment &segment);
 
+  // Rewrites the fingerprints of the next entries in |history| saved with the
+  // older Hash::FingerprintVersion.
+  static void MigrateFingerprints(user_history_predictor::UserHistory *history);
+
   // Returns the size of cache.
   static uint32 cache_size();
 
   // Returns the size of next entries.
   static uint32 max_next_entries_size();
 
+  // Statistics of the syncs to the local file.
+  struct SyncStats {
+    // The number of syncs which appended the changes to the journal, and
+    // which wrote the whole history as a snapshot.
+    uint64 journal_syncs;
+    uint64 snapshot_syncs;
+    // The bytes written to the files.
+    uint64 total_bytes_written;
+    uint64 max_bytes_written;
+    // The time spent to write the files, in microseconds.
+    uint64 total_sync_usec;
+    uint64 max_sync_usec;
+  };
+
+  // Returns the statistics of the syncs finished so far.
+  SyncStats GetSyncStats() const;
+
  private:
   struct SegmentForLearning {
     string key;
@@ -204,7 +227,6 @@ class UserHistoryPredictor : public PredictorInterface {
     vector<SegmentForLearning> conversion_segments_;
   };
 
-  friend class UserHistoryPredictorSyncer;
   friend class UserHistoryPredictorTest;
 
   FRIEND_TEST(UserHistoryPredictorTest, UserHistoryPredictorTest);
@@ -230,6 +252,7 @@ class UserHistoryPredictor : public PredictorInterface {
   FRIEND_TEST(UserHistoryPredictorTest, Regression2843775);
   FRIEND_TEST(UserHistoryPredictorTest, DuplicateString);
   FRIEND_TEST(UserHistoryPredictorTest, SyncTest);
+  FRIEND_TEST(UserHistoryPredictorTest, SyncAppendsChangesToJournal);
   FRIEND_TEST(UserHistoryPredictorTest, GetMatchTypeTest);
   FRIEND_TEST(UserHistoryPredictorTest, FingerPrintTest);
   FRIEND_TEST(UserHistoryPredictorTest, Uint32ToStringTest);
@@ -304,15 +327,42 @@ class UserHistoryPredictor : public PredictorInterface {
   // Loads user history data to LRU from local file
   bool Load();
 
-  // Saves user history data in LRU to local file
+  // Applies the changes in the records of the journal to LRU.
+  bool ApplyJournal(const vector<string> &records);
+
+  // Saves user history data in LRU to local file.  The changes since the last
+  // sync are appended to the journal, which is compacted into a snapshot
+  // once it grows as large as the snapshot.
   bool Save();
 
-  // non-blocking version of Load
-  // This makes a new thread and call Load()
+  // Returns true if the next sync should write the whole history as a new
+  // snapshot instead of appending the changes to the journal.
+  bool ShouldWriteSnapshot() const;
+
+  // Serializes the changes of LRU since the last sync into |record|, and
+  // forgets them.
+  void TakeChanges(string *record);
+
+  // Appends |record| to the journal.
+  bool AppendToJournal(const string &record);
+
+  // Writes the whole history as a new snapshot and resets the journal.
+  bool WriteSnapshot();
+
+  // Records the entry of |fp| in LRU is modified, moved to the head, or
+  // erased, so that the next sync appends it to the journal.
+  void MarkUpdated(uint32 fp);
+  void MarkPromoted(uint32 fp);
+  void MarkErased(uint32 fp);
+
+  void UpdateSyncStats(bool snapshot, size_t bytes_written, uint64 usec);
+
+  // non-blocking version of Save
+  // This calls Save() on the default thread pool.
   bool AsyncSave();
 
-  // non-blocking version of Sync
-  // This makes a new thread and call Save()
+  // non-blocking version of Load
+  // This calls Load() on the default thread pool.
   bool AsyncLoad();
 
   // Waits until syncer finishes.
@@ -537,7 +587,22 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   bool updated_;
   std::unique_ptr<DicCache> dic_;
-  mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
+  // The pending or running Load() or Save() on the default thread pool.
+  mutable TaskHandle syncer_;
+
+  // The keys of |dic_| changed since the last sync, and the subset of them
+  // moved to the head of |dic_|.
+  set<uint32> dirty_fps_;
+  set<uint32> promoted_fps_;
+
+  // The following members are used by the syncer, and by this thread only
+  // when the syncer is not running.
+  bool should_write_snapshot_;
+  // The generation and the serialized size of the last snapshot.
+  uint64 generation_;
+  size_t snapshot_size_;
+  storage::EncryptedJournal journal_;
+  SyncStats sync_stats_;
 };
 
 }  // namespace mozc
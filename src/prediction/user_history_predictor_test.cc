@@ -34,6 +34,7 @@
 #include <string>
 
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/password_manager.h"
@@ -2093,6 +2094,60 @@ TEST_F(UserHistoryPredictorTest, SyncTest) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, SyncAppendsChangesToJournal) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  // ASCII values are not learned as they could be privacy sensitive.
+  const string kValue = "\xE5\x80\xA4";  // "値"
+  Segments segments;
+  for (int i = 0; i < 100; ++i) {
+    const string number = NumberUtil::SimpleItoa(i);
+    segments.Clear();
+    MakeSegmentsForConversion("key" + number, &segments);
+    AddCandidate(kValue + number, &segments);
+    predictor->Finish(*convreq_, &segments);
+  }
+  predictor->Sync();
+  predictor->WaitForSyncer();
+  // ClearAllHistory() wrote a snapshot, and the changes after it are
+  // appended to the journal.
+  const UserHistoryPredictor::SyncStats stats1 = predictor->GetSyncStats();
+  EXPECT_EQ(1, stats1.snapshot_syncs);
+  EXPECT_EQ(1, stats1.journal_syncs);
+
+  // A sync of a few changes writes only them.
+  segments.Clear();
+  MakeSegmentsForConversion("key10", &segments);
+  AddCandidate(kValue + "10", &segments);
+  predictor->Finish(*convreq_, &segments);
+  EXPECT_TRUE(predictor->ClearHistoryEntry("key20", kValue + "20"));
+  predictor->Sync();
+  predictor->WaitForSyncer();
+  const UserHistoryPredictor::SyncStats stats2 = predictor->GetSyncStats();
+  EXPECT_EQ(2, stats2.journal_syncs);
+  EXPECT_EQ(1, stats2.snapshot_syncs);
+  EXPECT_LT((stats2.total_bytes_written - stats1.total_bytes_written) * 10,
+            stats1.max_bytes_written);
+
+  // The snapshot and the journal are restored in the same LRU order.  The
+  // keys are not compared as the snapshot is keyed by EntryFingerprint(),
+  // which differs from the key of the CLEAN_ALL_EVENT entry.
+  vector<string> entries;
+  for (const UserHistoryPredictor::DicElement *elm = predictor->dic_->Head();
+       elm != nullptr; elm = elm->next) {
+    entries.push_back(elm->value.SerializeAsString());
+  }
+  predictor->dic_->Clear();
+  ASSERT_TRUE(predictor->Load());
+  const UserHistoryPredictor::DicElement *elm = predictor->dic_->Head();
+  for (size_t i = 0; i < entries.size(); ++i, elm = elm->next) {
+    ASSERT_NE(nullptr, elm);
+    EXPECT_EQ(entries[i], elm->value.SerializeAsString());
+  }
+  EXPECT_EQ(nullptr, elm);
+  EXPECT_TRUE(IsSuggested(predictor, "key10", kValue + "10"));
+  EXPECT_FALSE(IsSuggested(predictor, "key2", kValue + "20"));
+}
+
 TEST_F(UserHistoryPredictorTest, GetMatchTypeTest) {
   EXPECT_EQ(UserHistoryPredictor::NO_MATCH,
             UserHistoryPredictor::GetMatchType("test", ""));
@@ -2176,6 +2231,32 @@ TEST_F(UserHistoryPredictorTest, FingerPrintTest) {
   EXPECT_EQ(segment_fp, segment_fp2);
 }
 
+TEST_F(UserHistoryPredictorTest, MigrateFingerprints) {
+  // The history saved with the legacy fingerprints has no version.
+  user_history_predictor::UserHistory history;
+  UserHistoryPredictor::Entry *entry1 = history.add_entries();
+  entry1->set_key("abc");
+  entry1->set_value("ABC");
+  UserHistoryPredictor::Entry *entry2 = history.add_entries();
+  entry2->set_key("def");
+  entry2->set_value("DEF");
+  entry1->add_next_entries()->set_entry_fp(Hash::Fingerprint32("def\tDEF"));
+  entry1->add_next_entries()->set_entry_fp(Hash::Fingerprint32("ghi\tGHI"));
+  entry2->add_next_entries()->set_entry_fp(Hash::Fingerprint32("abc\tABC"));
+  EXPECT_EQ(Hash::FINGERPRINT_LOOKUP2, history.fingerprint_version());
+
+  UserHistoryPredictor::MigrateFingerprints(&history);
+  EXPECT_EQ(Hash::FINGERPRINT_FAST, history.fingerprint_version());
+
+  // The next entry pointing to the unknown entry is dropped.
+  ASSERT_EQ(1, history.entries(0).next_entries_size());
+  EXPECT_EQ(UserHistoryPredictor::Fingerprint("def", "DEF"),
+            history.entries(0).next_entries(0).entry_fp());
+  ASSERT_EQ(1, history.entries(1).next_entries_size());
+  EXPECT_EQ(UserHistoryPredictor::Fingerprint("abc", "ABC"),
+            history.entries(1).next_entries(0).entry_fp());
+}
+
 TEST_F(UserHistoryPredictorTest, Uint32ToStringTest) {
   EXPECT_EQ(123,
             UserHistoryPredictor::StringToUint32(
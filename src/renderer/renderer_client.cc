@@ -41,6 +41,7 @@
 #include "base/run_level.h"
 #include "base/system_util.h"
 #include "base/thread.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
@@ -316,6 +317,104 @@ class RendererLauncher : public RendererLauncherInterface,
   Mutex pending_command_mutex_;
 };
 
+// Sends the latest UPDATE command on the default thread pool.  While a
+// command is being sent, newer commands overwrite the pending one instead of
+// being queued, since the renderer only needs to paint the latest state.
+class RendererClient::AsyncCommandSender {
+ public:
+  explicit AsyncCommandSender(RendererClient *client)
+      : client_(client),
+        has_pending_command_(false),
+        scheduled_(false),
+        stopped_(false) {}
+
+  ~AsyncCommandSender() {
+    Stop();
+  }
+
+  void Post(const commands::RendererCommand &command) {
+    scoped_lock l(&mutex_);
+    pending_command_.CopyFrom(command);
+    has_pending_command_ = true;
+    if (!scheduled_ && !stopped_) {
+      Schedule();
+    }
+  }
+
+  void Discard() {
+    scoped_lock l(&mutex_);
+    has_pending_command_ = false;
+  }
+
+  // Sends the pending command from the current thread.  As |send_mutex_| is
+  // held first, a command being sent by the pool is also finished when this
+  // method returns.
+  void Flush() {
+    scoped_lock send_lock(&client_->send_mutex_);
+    commands::RendererCommand command;
+    if (TakePendingCommand(&command)) {
+      client_->SendCommand(command);
+    }
+  }
+
+  // Waits for the command being sent and sends the pending one.
+  void Stop() {
+    TaskHandle task;
+    {
+      scoped_lock l(&mutex_);
+      stopped_ = true;
+      task = task_;
+    }
+    task.Cancel();
+    task.Wait();
+    Flush();
+  }
+
+ private:
+  // Requires |mutex_|.
+  void Schedule() {
+    scheduled_ = true;
+    task_ = ThreadPool::GetDefault()->Submit([this]() { Send(); });
+  }
+
+  void Send() {
+    {
+      scoped_lock send_lock(&client_->send_mutex_);
+      commands::RendererCommand command;
+      if (TakePendingCommand(&command)) {
+        client_->SendCommand(command);
+      }
+    }
+    scoped_lock l(&mutex_);
+    scheduled_ = false;
+    // A command posted while sending is sent by a new task, so that a stream
+    // of updates does not occupy a worker.
+    if (has_pending_command_ && !stopped_) {
+      Schedule();
+    }
+  }
+
+  bool TakePendingCommand(commands::RendererCommand *command) {
+    scoped_lock l(&mutex_);
+    if (!has_pending_command_) {
+      return false;
+    }
+    command->Swap(&pending_command_);
+    has_pending_command_ = false;
+    return true;
+  }
+
+  RendererClient *client_;
+  Mutex mutex_;
+  commands::RendererCommand pending_command_;
+  bool has_pending_command_;
+  bool scheduled_;
+  bool stopped_;
+  TaskHandle task_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncCommandSender);
+};
+
 RendererClient::RendererClient()
     : is_window_visible_(false),
       disable_renderer_path_check_(false),
@@ -336,6 +435,8 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  // Sends the pending command so that |is_window_visible_| is up to date.
+  async_sender_.reset();
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -399,6 +500,19 @@ bool RendererClient::Shutdown(bool force) {
   return true;
 }
 
+void RendererClient::EnableAsyncMode() {
+  if (async_sender_.get() != NULL) {
+    return;
+  }
+  async_sender_.reset(new AsyncCommandSender(this));
+}
+
+void RendererClient::FlushAsyncCommand() {
+  if (async_sender_.get() != NULL) {
+    async_sender_->Flush();
+  }
+}
+
 void RendererClient::DisableRendererServerCheck() {
   disable_renderer_path_check_ = true;
 }
@@ -422,6 +536,26 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return false;
   }
 
+  if (async_sender_.get() != NULL) {
+    switch (command.type()) {
+      case commands::RendererCommand::UPDATE:
+        async_sender_->Post(command);
+        return true;
+      case commands::RendererCommand::SHUTDOWN:
+        // Pending updates are obsolete.
+        async_sender_->Discard();
+        break;
+      default:
+        async_sender_->Flush();
+        break;
+    }
+  }
+
+  scoped_lock l(&send_mutex_);
+  return SendCommand(command);
+}
+
+bool RendererClient::SendCommand(const commands::RendererCommand &command) {
   if (!renderer_launcher_interface_->CanConnect()) {
     renderer_launcher_interface_->SetPendingCommand(command);
     // Check CanConnect() again, as the status might be changed
@@ -30,9 +30,11 @@
 #ifndef MOZC_RENDERER_RENDERER_CLIENT_H_
 #define MOZC_RENDERER_RENDERER_CLIENT_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "renderer/renderer_interface.h"
 
@@ -115,8 +117,23 @@ class RendererClient : public RendererInterface {
   // Otherwise command::RendererCommand::SHUDDOWN is used.
   bool Shutdown(bool force);
 
+  // Sends |command| to the renderer. In the asynchronous mode, UPDATE
+  // commands are handed to the sender thread and this method returns true
+  // without waiting for the IPC.
   bool ExecCommand(const commands::RendererCommand &command);
 
+  // Enables the asynchronous mode, where UPDATE commands are sent from a
+  // dedicated thread. The thread holds a single pending command, and a new
+  // command overwrites the pending one, so the renderer receives only the
+  // latest update when the caller issues them faster than the IPC. Other
+  // commands are still sent from the caller's thread after the pending
+  // command is sent (NOOP) or discarded (SHUTDOWN).
+  void EnableAsyncMode();
+
+  // Blocks until the pending command of the asynchronous mode, if any, is
+  // sent. Does nothing in the synchronous mode.
+  void FlushAsyncCommand();
+
   // Don't check the renderer server path.
   // DO NOT call it except for testing
   void DisableRendererServerCheck();
@@ -125,11 +142,18 @@ class RendererClient : public RendererInterface {
   void set_suppress_error_dialog(bool suppress);
 
  private:
+  class AsyncCommandSender;
+
+  // Sends |command| from the current thread.
+  bool SendCommand(const commands::RendererCommand &command);
+
   IPCClientInterface *CreateIPCClient() const;
 
-  bool is_window_visible_;
+  // Updated in SendCommand(), which may run on the sender thread, and read
+  // without |send_mutex_| by the caller thread.
+  std::atomic<bool> is_window_visible_;
   bool disable_renderer_path_check_;
-  int  version_mismatch_nums_;
+  std::atomic<int> version_mismatch_nums_;
   string name_;
   string renderer_path_;
 
@@ -137,6 +161,10 @@ class RendererClient : public RendererInterface {
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  // Serializes SendCommand() between the caller and the sender thread.
+  Mutex send_mutex_;
+  std::unique_ptr<AsyncCommandSender> async_sender_;
 };
 
 }  // namespace renderer
@@ -32,8 +32,10 @@
 #include <string>
 
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
@@ -213,6 +215,69 @@ class TestRendererLauncher : public RendererLauncherInterface {
   bool can_connect_;
   bool set_pending_command_called_;
 };
+
+// Emulates a renderer which takes |delay_msec| to process a command, and
+// records the commands it received.
+class RecordingIPCClientFactory : public IPCClientFactoryInterface {
+ public:
+  explicit RecordingIPCClientFactory(int delay_msec)
+      : delay_msec_(delay_msec), num_calls_(0), last_output_id_(-1) {}
+  ~RecordingIPCClientFactory() {}
+
+  virtual IPCClientInterface *NewClient(const string &name,
+                                        const string &path_name) {
+    return new Client(this);
+  }
+
+  virtual IPCClientInterface *NewClient(const string &name) {
+    return new Client(this);
+  }
+
+  int num_calls() {
+    scoped_lock l(&mutex_);
+    return num_calls_;
+  }
+
+  int64 last_output_id() {
+    scoped_lock l(&mutex_);
+    return last_output_id_;
+  }
+
+ private:
+  class Client : public IPCClientInterface {
+   public:
+    explicit Client(RecordingIPCClientFactory *factory)
+        : factory_(factory), version_(Version::GetMozcVersion()) {}
+
+    virtual bool Connected() const { return true; }
+    virtual uint32 GetServerProtocolVersion() const {
+      return IPC_PROTOCOL_VERSION;
+    }
+    virtual const string &GetServerProductVersion() const { return version_; }
+    virtual uint32 GetServerProcessId() const { return 0; }
+    virtual IPCErrorType GetLastIPCError() const { return IPC_NO_ERROR; }
+
+    virtual bool Call(const char *request, size_t request_size,
+                      char *response, size_t *response_size, int32 timeout) {
+      commands::RendererCommand command;
+      EXPECT_TRUE(command.ParseFromArray(request, request_size));
+      Util::Sleep(factory_->delay_msec_);
+      scoped_lock l(&factory_->mutex_);
+      ++factory_->num_calls_;
+      factory_->last_output_id_ = command.output().id();
+      return true;
+    }
+
+   private:
+    RecordingIPCClientFactory *factory_;
+    const string version_;
+  };
+
+  const int delay_msec_;
+  Mutex mutex_;
+  int num_calls_;
+  int64 last_output_id_;
+};
 }  // namespace
 
 TEST(RendererClient, InvalidTest) {
@@ -588,5 +653,99 @@ TEST(RendererClient, SetPendingCommandTest) {
     EXPECT_FALSE(launcher.is_set_pending_command_called());
   }
 }
+
+TEST(RendererClient, AsyncModeCoalescesUpdates) {
+  const int kNumCommands = 500;
+  const int kRendererDelayMsec = 2;
+
+  RecordingIPCClientFactory factory(kRendererDelayMsec);
+  TestRendererLauncher launcher;
+  launcher.set_can_connect(true);
+
+  RendererClient client;
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.EnableAsyncMode();
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+
+  Stopwatch exec_stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < kNumCommands; ++i) {
+    command.mutable_output()->set_id(i);
+    EXPECT_TRUE(client.ExecCommand(command));
+  }
+  exec_stopwatch.Stop();
+
+  // Measures the lag from the last ExecCommand() to the renderer.
+  Stopwatch lag_stopwatch = Stopwatch::StartNew();
+  while (factory.last_output_id() != kNumCommands - 1 &&
+         lag_stopwatch.GetElapsedMilliseconds() < 10000) {
+    Util::Sleep(1);
+  }
+  lag_stopwatch.Stop();
+  EXPECT_EQ(kNumCommands - 1, factory.last_output_id());
+
+  // The caller doesn't wait for the renderer, and obsolete commands are
+  // dropped.
+  EXPECT_LT(factory.num_calls(), kNumCommands);
+  LOG(INFO) << "ExecCommand: " << kNumCommands << " commands in "
+            << exec_stopwatch.GetElapsedMilliseconds() << " msec, "
+            << "IPC calls: " << factory.num_calls() << ", "
+            << "lag: " << lag_stopwatch.GetElapsedMilliseconds() << " msec";
+
+  // NOOP is sent synchronously after the pending update.
+  const int num_calls = factory.num_calls();
+  command.mutable_output()->set_id(kNumCommands);
+  EXPECT_TRUE(client.ExecCommand(command));
+  commands::RendererCommand noop;
+  noop.set_type(commands::RendererCommand::NOOP);
+  noop.mutable_output()->set_id(kNumCommands + 1);
+  EXPECT_TRUE(client.ExecCommand(noop));
+  EXPECT_EQ(num_calls + 2, factory.num_calls());
+  EXPECT_EQ(kNumCommands + 1, factory.last_output_id());
+}
+
+TEST(RendererClient, AsyncModeFlush) {
+  RecordingIPCClientFactory factory(0);
+  TestRendererLauncher launcher;
+  launcher.set_can_connect(true);
+
+  RendererClient client;
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.EnableAsyncMode();
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  for (int i = 0; i < 10; ++i) {
+    command.mutable_output()->set_id(i);
+    EXPECT_TRUE(client.ExecCommand(command));
+    client.FlushAsyncCommand();
+    EXPECT_EQ(i, factory.last_output_id());
+  }
+  EXPECT_EQ(10, factory.num_calls());
+}
+
+TEST(RendererClient, SyncModeSendsAllUpdates) {
+  const int kNumCommands = 100;
+  RecordingIPCClientFactory factory(0);
+  TestRendererLauncher launcher;
+  launcher.set_can_connect(true);
+
+  RendererClient client;
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  for (int i = 0; i < kNumCommands; ++i) {
+    command.mutable_output()->set_id(i);
+    EXPECT_TRUE(client.ExecCommand(command));
+  }
+  EXPECT_EQ(kNumCommands, factory.num_calls());
+  EXPECT_EQ(kNumCommands - 1, factory.last_output_id());
+}
 }  // namespace renderer
 }  // namespace mozc
@@ -1869,6 +1869,16 @@ bool IsValidDateInThisYear(uint32 month, uint32 day) {
   }
   return IsValidDate(t_st.tm_year + 1900, month, day);
 }
+
+// Returns true if |key| is the key of one of |data|.
+bool HasDateKey(const DateData *data, size_t size, const string &key) {
+  for (size_t i = 0; i < size; ++i) {
+    if (key == data[i].key) {
+      return true;
+    }
+  }
+  return false;
+}
 }  // namespace
 
 // convert AD to Japanese ERA.
@@ -2477,4 +2487,27 @@ bool DateRewriter::Rewrite(const ConversionRequest &request,
 
   return modified;
 }
+
+bool DateRewriter::IsVolatile(const ConversionRequest &request,
+                              const Segments &segments) const {
+  if (!request.config().use_date_conversion()) {
+    return false;
+  }
+  // The candidates for these keys are made from the current time.  The other
+  // rewrites depend on it only in whether Feb 29 is valid in this year, which
+  // is ignored here.
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const string &key = segments.conversion_segment(i).key();
+    if (HasDateKey(kDateData, arraysize(kDateData), key) ||
+        HasDateKey(kWeekDayData, arraysize(kWeekDayData), key) ||
+        HasDateKey(kMonthData, arraysize(kMonthData), key) ||
+        HasDateKey(kYearData, arraysize(kYearData), key) ||
+        HasDateKey(kCurrentTimeData, arraysize(kCurrentTimeData), key) ||
+        HasDateKey(kDateAndCurrentTimeData,
+                   arraysize(kDateAndCurrentTimeData), key)) {
+      return true;
+    }
+  }
+  return false;
+}
 }  // namespace mozc
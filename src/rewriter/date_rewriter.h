@@ -58,6 +58,9 @@ class DateRewriter : public RewriterInterface  {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
+  virtual bool IsVolatile(const ConversionRequest &request,
+                          const Segments &segments) const;
+
  private:
   FRIEND_TEST(DateRewriterTest, ADToERA);
   FRIEND_TEST(DateRewriterTest, ERAToAD);
@@ -1307,4 +1307,29 @@ TEST_F(DateRewriterTest, RelationWithUserHistoryRewriterTest) {
   EXPECT_TRUE(ContainCandidate(segments, "\xE5\xB9\xB3\xE6\x88\x90\x32\x33"));
 }
 
+TEST_F(DateRewriterTest, IsVolatile) {
+  DateRewriter rewriter;
+  Segments segments;
+  const ConversionRequest request;
+
+  // "きょう/今日"
+  InitSegment("\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86",
+              "\xE4\xBB\x8A\xE6\x97\xA5", &segments);
+  EXPECT_TRUE(rewriter.IsVolatile(request, segments));
+
+  // "わたし/私"
+  InitSegment("\xE3\x82\x8F\xE3\x81\x9F\xE3\x81\x97",
+              "\xE7\xA7\x81", &segments);
+  EXPECT_FALSE(rewriter.IsVolatile(request, segments));
+
+  // Not volatile when the date conversion is disabled.
+  config::Config config;
+  config.set_use_date_conversion(false);
+  ConversionRequest no_date_request;
+  no_date_request.set_config(&config);
+  InitSegment("\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86",
+              "\xE4\xBB\x8A\xE6\x97\xA5", &segments);
+  EXPECT_FALSE(rewriter.IsVolatile(no_date_request, segments));
+}
+
 }  // namespace mozc
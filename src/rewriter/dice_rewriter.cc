@@ -47,6 +47,9 @@ const int kDiceFaces = 6;
 // Last candidate index of one page.
 const size_t kLastCandidateIndex = 8;
 
+// "さいころ"
+const char kDiceKey[] = "\xE3\x81\x95\xE3\x81\x84\xE3\x81\x93\xE3\x82\x8D";
+
 // Insert a dice number into the |segment|
 // The number indicated by |top_face_number| is inserted at
 // |insert_pos|. Return false if insersion is failed.
@@ -102,8 +105,7 @@ bool DiceRewriter::Rewrite(const ConversionRequest &request,
     return false;
   }
 
-  // "さいころ"
-  if (key != "\xE3\x81\x95\xE3\x81\x84\xE3\x81\x93\xE3\x82\x8D") {
+  if (key != kDiceKey) {
     return false;
   }
 
@@ -116,4 +118,11 @@ bool DiceRewriter::Rewrite(const ConversionRequest &request,
                          insert_pos,
                          segments->mutable_conversion_segment(0));
 }
+
+bool DiceRewriter::IsVolatile(const ConversionRequest &request,
+                              const Segments &segments) const {
+  // The dice is rolled every time.
+  return segments.conversion_segments_size() == 1 &&
+         segments.conversion_segment(0).key() == kDiceKey;
+}
 }  // namespace mozc
@@ -51,6 +51,10 @@ namespace {
 
 #include "rewriter/emoticon_rewriter_data.h"
 
+// "ふくわらい", for which an emoticon is chosen randomly.
+const char kFukuwaraiKey[] =
+    "\xE3\x81\xB5\xE3\x81\x8F\xE3\x82\x8F\xE3\x82\x89\xE3\x81\x84";
+
 class EmoticonDictionary {
  public:
   EmoticonDictionary()
@@ -204,8 +208,7 @@ bool RewriteCandidate(Segments *segments) {
       value_size = token->value_size;
       initial_insert_pos = 4;
       initial_insert_size = 6;
-    } else if (key == "\xE3\x81\xB5\xE3\x81\x8F\xE3\x82\x8F"
-               "\xE3\x82\x89\xE3\x81\x84") {   // "ふくわらい"
+    } else if (key == kFukuwaraiKey) {
       // Choose one emoticon randomly from the dictionary.
       // TODO(taku): want to make it "generate" more funny emoticon.
       const EmbeddedDictionary::Token *token
@@ -266,4 +269,17 @@ bool EmoticonRewriter::Rewrite(const ConversionRequest &request,
   }
   return RewriteCandidate(segments);
 }
+
+bool EmoticonRewriter::IsVolatile(const ConversionRequest &request,
+                                  const Segments &segments) const {
+  if (!request.config().use_emoticon_conversion()) {
+    return false;
+  }
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    if (segments.conversion_segment(i).key() == kFukuwaraiKey) {
+      return true;
+    }
+  }
+  return false;
+}
 }  // namespace mozc
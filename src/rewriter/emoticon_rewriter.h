@@ -46,6 +46,9 @@ class EmoticonRewriter : public RewriterInterface  {
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
+
+  virtual bool IsVolatile(const ConversionRequest &request,
+                          const Segments &segments) const;
 };
 
 }  // namespace mozc
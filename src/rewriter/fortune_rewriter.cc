@@ -54,6 +54,9 @@ enum FortuneType {
   NUM_FORTUNE_TYPES            = 6,
 };
 
+// "おみくじ"
+const char kFortuneKey[] = "\xE3\x81\x8A\xE3\x81\xBF\xE3\x81\x8F\xE3\x81\x98";
+
 const int kMaxLevel = 100;
 const int kNormalLevels[]     = { 20, 40, 60, 80, 90 };
 const int kNewYearLevels[]    = { 30, 60, 80, 90, 95 };
@@ -196,8 +199,7 @@ bool FortuneRewriter::Rewrite(const ConversionRequest &request,
     return false;
   }
 
-  // "おみくじ"
-  if (key != "\xE3\x81\x8A\xE3\x81\xBF\xE3\x81\x8F\xE3\x81\x98") {
+  if (key != kFortuneKey) {
     return false;
   }
   FortuneData *fortune_data = Singleton<FortuneData>::get();
@@ -207,4 +209,11 @@ bool FortuneRewriter::Rewrite(const ConversionRequest &request,
                          segment.candidates_size(),
                          segments->mutable_conversion_segment(0));
 }
+
+bool FortuneRewriter::IsVolatile(const ConversionRequest &request,
+                                 const Segments &segments) const {
+  // The fortune changes every day.
+  return segments.conversion_segments_size() == 1 &&
+         segments.conversion_segment(0).key() == kFortuneKey;
+}
 }  // namespace mozc
@@ -44,6 +44,9 @@ class FortuneRewriter : public RewriterInterface  {
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
+
+  virtual bool IsVolatile(const ConversionRequest &request,
+                          const Segments &segments) const;
 };
 
 }  // namespace mozc
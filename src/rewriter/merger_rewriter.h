@@ -104,6 +104,26 @@ class MergerRewriter : public RewriterInterface {
     return result;
   }
 
+  virtual bool IsVolatile(const ConversionRequest &request,
+                          const Segments &segments) const {
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      if (rewriters_[i]->IsVolatile(request, segments)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The generations never decrease, so the sum is changed whenever one of
+  // them is changed.
+  virtual uint64 GetLearningGeneration() const {
+    uint64 generation = 0;
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      generation += rewriters_[i]->GetLearningGeneration();
+    }
+    return generation;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -32,6 +32,7 @@
 
 #include <cstddef>  // for size_t
 
+#include "base/port.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -59,6 +60,22 @@ class RewriterInterface {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
+  // Returns true if Rewrite() may give a different result for the same
+  // |segments| next time, e.g., as it depends on the current time or a random
+  // number.  |segments| is the result of the rewrite.  Such a result is never
+  // reused by the cache of the converter.
+  virtual bool IsVolatile(const ConversionRequest &request,
+                          const Segments &segments) const {
+    return false;
+  }
+
+  // Returns a number which is changed whenever the learned data used by
+  // Rewrite() is changed, e.g., by Finish(), Reload() or Clear().  The cache
+  // of the converter reuses a result only while the number is unchanged.
+  virtual uint64 GetLearningGeneration() const {
+    return 0;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -111,7 +111,8 @@ class LengthArray {
 UserBoundaryHistoryRewriter::UserBoundaryHistoryRewriter(
     const ConverterInterface *parent_converter)
     : parent_converter_(parent_converter),
-      storage_(new LRUStorage) {
+      storage_(new LRUStorage),
+      generation_(0) {
   DCHECK(parent_converter_);
   Reload();
 }
@@ -146,7 +147,11 @@ void UserBoundaryHistoryRewriter::Finish(const ConversionRequest &request,
   }
 
   if (segments->resized()) {
+    const uint64 storage_generation = storage_->generation();
     ResizeOrInsert(segments, request, INSERT);
+    if (storage_->generation() != storage_generation) {
+      generation_.fetch_add(1);
+    }
 #ifdef OS_ANDROID
     // TODO(hidehiko): UsageStats requires some functionalities, e.g. network,
     // which are not needed for mozc's main features.
@@ -202,6 +207,7 @@ bool UserBoundaryHistoryRewriter::Reload() {
                               kValueSize, kLRUSize, kSeedValue)) {
     LOG(WARNING) << "cannot initialize UserBoundaryHistoryRewriter";
     storage_.reset();
+    generation_.fetch_add(1);
     return false;
   }
 
@@ -213,6 +219,7 @@ bool UserBoundaryHistoryRewriter::Reload() {
     storage_->Merge(merge_pending_file.c_str());
     FileUtil::Unlink(merge_pending_file);
   }
+  generation_.fetch_add(1);
 
   return true;
 }
@@ -328,7 +335,12 @@ void UserBoundaryHistoryRewriter::Clear() {
   if (storage_.get() != NULL) {
     VLOG(1) << "Clearing user segment data";
     storage_->Clear();
+    generation_.fetch_add(1);
   }
 }
 
+uint64 UserBoundaryHistoryRewriter::GetLearningGeneration() const {
+  return generation_.load();
+}
+
 }  // namespace mozc
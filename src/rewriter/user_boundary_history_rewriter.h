@@ -30,6 +30,7 @@
 #ifndef MOZC_REWRITER_USER_BOUNDARY_HISTORY_REWRITER_H_
 #define MOZC_REWRITER_USER_BOUNDARY_HISTORY_REWRITER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -63,12 +64,16 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
 
   virtual void Clear();
 
+  virtual uint64 GetLearningGeneration() const;
+
  private:
   bool ResizeOrInsert(Segments *segments, const ConversionRequest &request,
                       int type) const;
 
   const ConverterInterface *parent_converter_;
   std::unique_ptr<mozc::storage::LRUStorage> storage_;
+  // Incremented after |storage_| is changed.
+  std::atomic<uint64> generation_;
 };
 
 }  // namespace mozc
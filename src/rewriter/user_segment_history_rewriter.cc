@@ -523,7 +523,8 @@ UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
     const PosGroup *pos_group)
     : storage_(new LRUStorage),
       pos_matcher_(pos_matcher),
-      pos_group_(pos_group) {
+      pos_group_(pos_group),
+      generation_(0) {
   Reload();
 
   CHECK_EQ(sizeof(uint32), sizeof(FeatureValue));
@@ -803,6 +804,7 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
     return;
   }
 
+  const uint64 storage_generation = storage_->generation();
   for (size_t i = segments->history_segments_size();
        i < segments->segments_size(); ++i) {
     const Segment &segment = segments->segment(i);
@@ -819,6 +821,10 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
     InsertTriggerKey(segment);
     RememberFirstCandidate(*segments, i);
   }
+  // Committing the candidates learned in the same second changes nothing.
+  if (storage_->generation() != storage_generation) {
+    generation_.fetch_add(1);
+  }
   // update usage stats here
   usage_stats::UsageStats::SetInteger("UserSegmentHistoryEntrySize",
                                       static_cast<int>(storage_->used_size()));
@@ -830,6 +836,7 @@ bool UserSegmentHistoryRewriter::Reload() {
                               kValueSize, kLRUSize, kSeedValue)) {
     LOG(WARNING) << "cannot initialize UserSegmentHistoryRewriter";
     storage_.reset();
+    generation_.fetch_add(1);
     return false;
   }
 
@@ -841,6 +848,7 @@ bool UserSegmentHistoryRewriter::Reload() {
     storage_->Merge(merge_pending_file.c_str());
     FileUtil::Unlink(merge_pending_file);
   }
+  generation_.fetch_add(1);
 
   return true;
 }
@@ -1030,9 +1038,14 @@ void UserSegmentHistoryRewriter::Clear() {
   if (storage_.get() != NULL) {
     VLOG(1) << "Clearing user segment data";
     storage_->Clear();
+    generation_.fetch_add(1);
   }
 }
 
+uint64 UserSegmentHistoryRewriter::GetLearningGeneration() const {
+  return generation_.load();
+}
+
 bool UserSegmentHistoryRewriter::IsPunctuation(
     const Segment &seg,
     const Segment::Candidate &candidate) const {
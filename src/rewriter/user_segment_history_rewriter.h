@@ -30,6 +30,7 @@
 #ifndef MOZC_REWRITER_USER_SEGMENT_HISTORY_REWRITER_H_
 #define MOZC_REWRITER_USER_SEGMENT_HISTORY_REWRITER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -65,6 +66,8 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   virtual void Clear();
 
+  virtual uint64 GetLearningGeneration() const;
+
  private:
   bool IsAvailable(const ConversionRequest &request,
                    const Segments &segments) const;
@@ -101,6 +104,8 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
   std::unique_ptr<storage::LRUStorage> storage_;
   const dictionary::POSMatcher *pos_matcher_;
   const dictionary::PosGroup *pos_group_;
+  // Incremented after |storage_| is changed.
+  std::atomic<uint64> generation_;
 };
 
 }  // namespace mozc
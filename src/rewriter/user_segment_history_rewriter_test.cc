@@ -429,6 +429,40 @@ TEST_F(UserSegmentHistoryRewriterTest, BasicTest) {
   }
 }
 
+TEST_F(UserSegmentHistoryRewriterTest, LearningGeneration) {
+  Segments segments;
+  std::unique_ptr<UserSegmentHistoryRewriter> rewriter(
+      CreateUserSegmentHistoryRewriter());
+
+  rewriter->Clear();
+
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  InitSegments(&segments, 1);
+  segments.mutable_segment(0)->move_candidate(2, 0);
+  segments.mutable_segment(0)->mutable_candidate(0)->attributes
+      |= Segment::Candidate::RERANKED;
+  segments.mutable_segment(0)->set_segment_type(Segment::FIXED_VALUE);
+  uint64 generation = rewriter->GetLearningGeneration();
+  rewriter->Finish(request_, &segments);
+  EXPECT_NE(generation, rewriter->GetLearningGeneration());
+
+  // Learning the same candidate in the same second changes nothing.
+  generation = rewriter->GetLearningGeneration();
+  rewriter->Finish(request_, &segments);
+  EXPECT_EQ(generation, rewriter->GetLearningGeneration());
+
+  // The last access time is updated.
+  clock.PutClockForward(1, 0);
+  rewriter->Finish(request_, &segments);
+  EXPECT_NE(generation, rewriter->GetLearningGeneration());
+
+  generation = rewriter->GetLearningGeneration();
+  rewriter->Clear();
+  EXPECT_NE(generation, rewriter->GetLearningGeneration());
+}
+
 // Test for Issue 2155278
 TEST_F(UserSegmentHistoryRewriterTest, SequenceTest) {
   Segments segments;
@@ -567,6 +567,10 @@ void VariantsRewriter::Clear() {
   CharacterFormManager::GetCharacterFormManager()->ClearHistory();
 }
 
+uint64 VariantsRewriter::GetLearningGeneration() const {
+  return CharacterFormManager::GetCharacterFormManager()->generation();
+}
+
 bool VariantsRewriter::Rewrite(const ConversionRequest &request,
                                Segments *segments) const {
   CHECK(segments);
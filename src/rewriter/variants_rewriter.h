@@ -61,6 +61,8 @@ class VariantsRewriter : public RewriterInterface {
                        Segments *segments) const;
   virtual void Finish(const ConversionRequest &request, Segments *segments);
   virtual void Clear();
+  // The learned character forms are stored by CharacterFormManager.
+  virtual uint64 GetLearningGeneration() const;
 
   // Used by UserSegmentHistoryRewriter.
   // TODO(noriyukit): I'd be better to prepare some utility for rewriters.
@@ -0,0 +1,314 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/internal/conversion_prefetcher.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/singleton.h"
+#include "base/stopwatch.h"
+#include "composer/composer.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace session {
+
+namespace {
+
+class SharedState {
+ public:
+  SharedState()
+      : owner(std::thread::id()),
+        generation(0),
+        scheduled(0),
+        converted(0),
+        cancelled(0),
+        skipped(0),
+        hits(0),
+        misses(0),
+        wasted(0),
+        wasted_usec(0) {}
+
+  // The converter lock and the thread holding it.  A prefetch task run by
+  // the owner itself, e.g. while it waits for a task on a single-thread
+  // pool, must not try to take the lock again.
+  std::mutex converter_mutex;
+  std::atomic<std::thread::id> owner;
+
+  // Incremented on every user input.
+  std::atomic<uint64> generation;
+
+  std::atomic<uint64> scheduled;
+  std::atomic<uint64> converted;
+  std::atomic<uint64> cancelled;
+  std::atomic<uint64> skipped;
+  std::atomic<uint64> hits;
+  std::atomic<uint64> misses;
+  std::atomic<uint64> wasted;
+  std::atomic<uint64> wasted_usec;
+};
+
+SharedState *GetSharedState() {
+  return Singleton<SharedState>::get();
+}
+
+void AppendSegmentKey(const Segment &segment, string *key) {
+  key->append(segment.key());
+  key->push_back('\0');
+  if (segment.candidates_size() > 0) {
+    key->append(segment.candidate(0).value);
+  }
+  key->push_back('\0');
+}
+
+}  // namespace
+
+struct ConversionPrefetcher::Task {
+  Task() : key(0), generation(0), converted(false), elapsed_usec(0) {}
+
+  uint64 key;
+  uint64 generation;
+  commands::Request request;
+  config::Config config;
+  std::unique_ptr<composer::Composer> composer;
+  Segments segments;
+
+  // Written by the task.  Read after the task is done.
+  bool converted;
+  uint64 elapsed_usec;
+};
+
+ConversionPrefetcher::Stats::Stats()
+    : scheduled(0),
+      converted(0),
+      cancelled(0),
+      skipped(0),
+      hits(0),
+      misses(0),
+      wasted(0),
+      wasted_usec(0) {}
+
+ConversionPrefetcher::ScopedConverterLock::ScopedConverterLock() {
+  SharedState *state = GetSharedState();
+  state->converter_mutex.lock();
+  state->owner = std::this_thread::get_id();
+}
+
+ConversionPrefetcher::ScopedConverterLock::~ScopedConverterLock() {
+  SharedState *state = GetSharedState();
+  state->owner = std::thread::id();
+  state->converter_mutex.unlock();
+}
+
+ConversionPrefetcher::ConversionPrefetcher(const ConverterInterface *converter)
+    : converter_(converter) {
+  DCHECK(converter_);
+}
+
+ConversionPrefetcher::~ConversionPrefetcher() {
+  Cancel();
+}
+
+void ConversionPrefetcher::Schedule(const composer::Composer &composer,
+                                    const commands::Request &request,
+                                    const config::Config &config,
+                                    const Segments &segments,
+                                    uint32 delay_msec) {
+  Cancel();
+
+  SharedState *state = GetSharedState();
+  std::shared_ptr<Task> task(new Task);
+  task->key = GetKey(composer, request, config, segments);
+  task->generation = state->generation;
+  task->request.CopyFrom(request);
+  task->config.CopyFrom(config);
+  task->composer.reset(
+      new composer::Composer(NULL, &task->request, &task->config));
+  task->composer->CopyFrom(composer);
+  task->composer->SetRequest(&task->request);
+  task->composer->SetConfig(&task->config);
+  task->segments.CopyFrom(segments);
+  task->segments.set_request_type(Segments::CONVERSION);
+  // The state of the lazy expansion is not carried by Take(), so generates
+  // all the candidates in background.
+  task->segments.set_initial_conversion_candidates_size(0);
+
+  ++state->scheduled;
+  const ConverterInterface *converter = converter_;
+  handle_ = ThreadPool::GetDefault()->SubmitAfter(
+      delay_msec, [converter, task]() { Run(converter, task.get()); });
+  task_ = task;
+}
+
+bool ConversionPrefetcher::Take(const composer::Composer &composer,
+                                const commands::Request &request,
+                                const config::Config &config,
+                                Segments *segments) {
+  DCHECK(segments);
+  SharedState *state = GetSharedState();
+  if (!task_ || !handle_.IsDone() || !task_->converted ||
+      task_->key != GetKey(composer, request, config, *segments)) {
+    ++state->misses;
+    Cancel();
+    return false;
+  }
+  ++state->hits;
+  segments->CopyFrom(task_->segments);
+  task_.reset();
+  handle_ = TaskHandle();
+  return true;
+}
+
+void ConversionPrefetcher::Cancel() {
+  if (!task_) {
+    return;
+  }
+  SharedState *state = GetSharedState();
+  if (handle_.Cancel()) {
+    ++state->cancelled;
+  } else {
+    handle_.Wait();
+    if (task_->converted) {
+      ++state->wasted;
+      state->wasted_usec += task_->elapsed_usec;
+    }
+  }
+  task_.reset();
+  handle_ = TaskHandle();
+}
+
+// static
+void ConversionPrefetcher::OnUserInput() {
+  ++GetSharedState()->generation;
+}
+
+// static
+ConversionPrefetcher::Stats ConversionPrefetcher::GetStats() {
+  const SharedState *state = GetSharedState();
+  Stats stats;
+  stats.scheduled = state->scheduled;
+  stats.converted = state->converted;
+  stats.cancelled = state->cancelled;
+  stats.skipped = state->skipped;
+  stats.hits = state->hits;
+  stats.misses = state->misses;
+  stats.wasted = state->wasted;
+  stats.wasted_usec = state->wasted_usec;
+  return stats;
+}
+
+// static
+void ConversionPrefetcher::ClearStatsForTesting() {
+  SharedState *state = GetSharedState();
+  state->scheduled = 0;
+  state->converted = 0;
+  state->cancelled = 0;
+  state->skipped = 0;
+  state->hits = 0;
+  state->misses = 0;
+  state->wasted = 0;
+  state->wasted_usec = 0;
+}
+
+// static
+uint64 ConversionPrefetcher::GetKey(const composer::Composer &composer,
+                                    const commands::Request &request,
+                                    const config::Config &config,
+                                    const Segments &segments) {
+  string key;
+  composer.GetQueryForConversion(&key);
+  key.push_back('\0');
+  string raw;
+  composer.GetRawString(&raw);
+  key.append(raw);
+  key.push_back('\0');
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    AppendSegmentKey(segments.history_segment(i), &key);
+  }
+  key.push_back(segments.user_history_enabled() ? '1' : '0');
+  key.append(NumberUtil::SimpleItoa(
+      static_cast<uint32>(segments.max_history_segments_size())));
+  key.append(request.SerializeAsString());
+  key.append(config.SerializeAsString());
+  return Hash::Fingerprint(key);
+}
+
+// static
+void ConversionPrefetcher::Run(const ConverterInterface *converter,
+                               Task *task) {
+  SharedState *state = GetSharedState();
+  if (task->generation != state->generation) {
+    ++state->cancelled;
+    return;
+  }
+  if (state->owner == std::this_thread::get_id()) {
+    ++state->skipped;
+    return;
+  }
+  std::unique_lock<std::mutex> lock(state->converter_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // The session thread is processing a command, which most likely makes
+    // this prefetch obsolete anyway.
+    ++state->skipped;
+    return;
+  }
+  if (task->generation != state->generation) {
+    ++state->cancelled;
+    return;
+  }
+  // The conversion may wait for its own tasks, and another prefetch task run
+  // meanwhile on this thread must see that the lock is already held.
+  state->owner = std::this_thread::get_id();
+
+  const ConversionRequest conversion_request(task->composer.get(),
+                                             &task->request, &task->config);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  task->converted =
+      converter->StartConversionForRequest(conversion_request, &task->segments);
+  task->elapsed_usec = static_cast<uint64>(stopwatch.GetElapsedMicroseconds());
+  state->owner = std::thread::id();
+  if (task->converted) {
+    ++state->converted;
+  }
+  VLOG(2) << "Prefetched the conversion in " << task->elapsed_usec << " usec";
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,151 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Speculative conversion of the composition while the user is idle.
+
+#ifndef MOZC_SESSION_INTERNAL_CONVERSION_PREFETCHER_H_
+#define MOZC_SESSION_INTERNAL_CONVERSION_PREFETCHER_H_
+
+#include <memory>
+
+#include "base/port.h"
+#include "base/thread_pool.h"
+
+namespace mozc {
+
+class ConverterInterface;
+class Segments;
+
+namespace commands {
+class Request;
+}  // namespace commands
+
+namespace composer {
+class Composer;
+}  // namespace composer
+
+namespace config {
+class Config;
+}  // namespace config
+
+namespace session {
+
+// ConversionPrefetcher runs the conversion of the current composition on
+// the default thread pool after the input has been idle for a while, so that
+// the following Convert() can use the result instead of converting while the
+// user waits.  The result is keyed by the composition, the history segments,
+// the request and the config, and is used only if all of them match.
+//
+// The converter is not thread-safe.  A prefetch task runs the converter only
+// while it holds the converter lock, and SessionHandler holds the lock (see
+// ScopedConverterLock) while it evaluates a command.  Thus the converter is
+// never used by two threads at once.  A prefetch task which has not started
+// when the next user input comes in is cancelled.  A running one cannot be
+// interrupted and the input waits for it.
+class ConversionPrefetcher {
+ public:
+  // Process-wide counters.  A prefetch is wasted if it was converted but its
+  // result was never used.
+  struct Stats {
+    Stats();
+
+    uint64 scheduled;
+    uint64 converted;
+    uint64 cancelled;    // Cancelled before it started.
+    uint64 skipped;      // Not run as the converter was busy.
+    uint64 hits;
+    uint64 misses;
+    uint64 wasted;
+    uint64 wasted_usec;  // Time spent for the wasted conversions.
+  };
+
+  // Holds the converter lock while alive.
+  class ScopedConverterLock {
+   public:
+    ScopedConverterLock();
+    ~ScopedConverterLock();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ScopedConverterLock);
+  };
+
+  explicit ConversionPrefetcher(const ConverterInterface *converter);
+
+  // Cancels the pending task and waits for the running one.
+  ~ConversionPrefetcher();
+
+  // Schedules the conversion of |composer| to run after |delay_msec|
+  // milliseconds unless other user input comes in.  |segments| holds the
+  // history segments and the preferences of the conversion.  The previous
+  // prefetch is discarded.
+  void Schedule(const composer::Composer &composer,
+                const commands::Request &request,
+                const config::Config &config,
+                const Segments &segments,
+                uint32 delay_msec);
+
+  // If the prefetch for the same inputs has finished, copies its result to
+  // |segments| and returns true.  Otherwise returns false.  In both cases the
+  // prefetch is consumed.
+  bool Take(const composer::Composer &composer,
+            const commands::Request &request,
+            const config::Config &config,
+            Segments *segments);
+
+  // Discards the prefetch.
+  void Cancel();
+
+  // Cancels all the prefetch tasks which have not started yet.
+  // SessionHandler calls this on every user input.
+  static void OnUserInput();
+
+  static Stats GetStats();
+  static void ClearStatsForTesting();
+
+ private:
+  struct Task;
+
+  static uint64 GetKey(const composer::Composer &composer,
+                       const commands::Request &request,
+                       const config::Config &config,
+                       const Segments &segments);
+  static void Run(const ConverterInterface *converter, Task *task);
+
+  const ConverterInterface *converter_;
+  std::shared_ptr<Task> task_;
+  TaskHandle handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConversionPrefetcher);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_INTERNAL_CONVERSION_PREFETCHER_H_
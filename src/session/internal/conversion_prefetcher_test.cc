@@ -0,0 +1,239 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/internal/conversion_prefetcher.h"
+
+#include <memory>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "base/thread_pool.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+void SetSingleSegment(const string &key, const string &value,
+                      Segments *segments) {
+  segments->Clear();
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->key = key;
+  candidate->value = value;
+}
+
+// Runs the pending tasks of |pool| in the middle of a conversion, as a
+// conversion waiting for its own tasks does.
+class ReentrantConverterMock : public ConverterMock {
+ public:
+  explicit ReentrantConverterMock(ThreadPool *pool) : pool_(pool) {}
+
+  virtual bool StartConversionForRequest(const ConversionRequest &request,
+                                         Segments *segments) const {
+    pool_->RunUntilIdle();
+    return ConverterMock::StartConversionForRequest(request, segments);
+  }
+
+ private:
+  ThreadPool *pool_;
+};
+
+class ConversionPrefetcherTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    clock_.reset(new ClockMock(1000, 0));
+    Clock::SetClockForUnitTest(clock_.get());
+    pool_.reset(new ThreadPool(0, "ConversionPrefetcherTest"));
+    ThreadPool::SetDefaultForTesting(pool_.get());
+    ConversionPrefetcher::ClearStatsForTesting();
+
+    table_.reset(new composer::Table);
+    table_->InitializeWithRequestAndConfig(request_, config_);
+    composer_.reset(new composer::Composer(table_.get(), &request_, &config_));
+    // "あいうえお"
+    composer_->InsertCharacterPreedit(
+        "\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x81\x88\xe3\x81\x8a");
+
+    Segments result;
+    // "あいうえお", "アイウエオ"
+    SetSingleSegment(
+        "\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x81\x88\xe3\x81\x8a",
+        "\xe3\x82\xa2\xe3\x82\xa4\xe3\x82\xa6\xe3\x82\xa8\xe3\x82\xaa",
+        &result);
+    converter_.SetStartConversionForRequest(&result, true);
+    prefetcher_.reset(new ConversionPrefetcher(&converter_));
+  }
+
+  virtual void TearDown() {
+    prefetcher_.reset();
+    ThreadPool::SetDefaultForTesting(nullptr);
+    pool_.reset();
+    Clock::SetClockForUnitTest(nullptr);
+  }
+
+  void PutClockForwardMsec(uint64 msec) {
+    clock_->PutClockForwardByTicks(msec * Clock::GetFrequency() / 1000);
+  }
+
+  // Makes the following conversions return a different result.
+  void ChangeConverterResult() {
+    Segments result;
+    SetSingleSegment("x", "y", &result);
+    converter_.SetStartConversionForRequest(&result, true);
+  }
+
+  std::unique_ptr<ClockMock> clock_;
+  std::unique_ptr<ThreadPool> pool_;
+  ConverterMock converter_;
+  commands::Request request_;
+  config::Config config_;
+  std::unique_ptr<composer::Table> table_;
+  std::unique_ptr<composer::Composer> composer_;
+  std::unique_ptr<ConversionPrefetcher> prefetcher_;
+};
+
+TEST_F(ConversionPrefetcherTest, PrefetchedResultIsUsed) {
+  Segments segments;
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 10);
+  PutClockForwardMsec(9);
+  EXPECT_EQ(0, pool_->RunUntilIdle());
+  PutClockForwardMsec(1);
+  EXPECT_EQ(1, pool_->RunUntilIdle());
+  ChangeConverterResult();
+
+  ASSERT_TRUE(prefetcher_->Take(*composer_, request_, config_, &segments));
+  ASSERT_EQ(1, segments.conversion_segments_size());
+  // "アイウエオ"
+  EXPECT_EQ("\xe3\x82\xa2\xe3\x82\xa4\xe3\x82\xa6\xe3\x82\xa8\xe3\x82\xaa",
+            segments.conversion_segment(0).candidate(0).value);
+  // The prefetch is consumed.
+  EXPECT_FALSE(prefetcher_->Take(*composer_, request_, config_, &segments));
+
+  const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+  EXPECT_EQ(1, stats.scheduled);
+  EXPECT_EQ(1, stats.converted);
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.wasted);
+}
+
+TEST_F(ConversionPrefetcherTest, ResultForOtherInputIsWasted) {
+  Segments segments;
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 0);
+  EXPECT_EQ(1, pool_->RunUntilIdle());
+
+  composer_->InsertCharacterPreedit("a");
+  EXPECT_FALSE(prefetcher_->Take(*composer_, request_, config_, &segments));
+  composer_->Backspace();
+
+  // The history segments are also a part of the key.
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 0);
+  EXPECT_EQ(1, pool_->RunUntilIdle());
+  Segment *history = segments.add_segment();
+  history->set_segment_type(Segment::HISTORY);
+  history->set_key("a");
+  history->add_candidate()->value = "a";
+  EXPECT_FALSE(prefetcher_->Take(*composer_, request_, config_, &segments));
+
+  const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+  EXPECT_EQ(2, stats.converted);
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(2, stats.wasted);
+}
+
+TEST_F(ConversionPrefetcherTest, UserInputCancelsPendingPrefetch) {
+  Segments segments;
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 10);
+  ConversionPrefetcher::OnUserInput();
+  PutClockForwardMsec(10);
+  pool_->RunUntilIdle();
+  EXPECT_FALSE(prefetcher_->Take(*composer_, request_, config_, &segments));
+
+  // Rescheduling discards the previous prefetch.
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 10);
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 10);
+  PutClockForwardMsec(10);
+  EXPECT_EQ(1, pool_->RunUntilIdle());
+  EXPECT_TRUE(prefetcher_->Take(*composer_, request_, config_, &segments));
+
+  const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+  EXPECT_EQ(3, stats.scheduled);
+  EXPECT_EQ(1, stats.converted);
+  EXPECT_EQ(2, stats.cancelled);
+}
+
+TEST_F(ConversionPrefetcherTest, PrefetchIsSkippedWhileConverterIsLocked) {
+  Segments segments;
+  prefetcher_->Schedule(*composer_, request_, config_, segments, 0);
+  {
+    ConversionPrefetcher::ScopedConverterLock lock;
+    EXPECT_EQ(1, pool_->RunUntilIdle());
+  }
+  EXPECT_FALSE(prefetcher_->Take(*composer_, request_, config_, &segments));
+
+  const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+  EXPECT_EQ(1, stats.skipped);
+  EXPECT_EQ(0, stats.converted);
+}
+
+TEST_F(ConversionPrefetcherTest, PrefetchInPrefetchIsSkipped) {
+  ReentrantConverterMock converter(pool_.get());
+  Segments result;
+  SetSingleSegment("x", "y", &result);
+  converter.SetStartConversionForRequest(&result, true);
+  ConversionPrefetcher prefetcher1(&converter);
+  ConversionPrefetcher prefetcher2(&converter);
+
+  Segments segments;
+  prefetcher1.Schedule(*composer_, request_, config_, segments, 0);
+  prefetcher2.Schedule(*composer_, request_, config_, segments, 0);
+  // The second task runs inside the conversion of the first one, which holds
+  // the converter lock on the same thread.
+  pool_->RunUntilIdle();
+  EXPECT_TRUE(prefetcher1.Take(*composer_, request_, config_, &segments));
+  EXPECT_FALSE(prefetcher2.Take(*composer_, request_, config_, &segments));
+
+  const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+  EXPECT_EQ(1, stats.converted);
+  EXPECT_EQ(1, stats.skipped);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
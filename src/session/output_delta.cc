@@ -0,0 +1,208 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/output_delta.h"
+
+#include "base/logging.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace {
+
+// Serializes |message| without its focused_index to |output|.
+template <typename T>
+void SerializeWithoutFocusedIndex(T *message, string *output) {
+  if (!message->has_focused_index()) {
+    message->SerializePartialToString(output);
+    return;
+  }
+  const uint32 focused_index = message->focused_index();
+  message->clear_focused_index();
+  message->SerializePartialToString(output);
+  message->set_focused_index(focused_index);
+}
+
+template <typename T>
+void SetFocusedIndex(bool has_focused_index, uint32 focused_index,
+                     T *message) {
+  if (has_focused_index) {
+    message->set_focused_index(focused_index);
+  } else {
+    message->clear_focused_index();
+  }
+}
+
+}  // namespace
+
+OutputDeltaEncoder::OutputDeltaEncoder() : revision_(0) {}
+
+OutputDeltaEncoder::~OutputDeltaEncoder() {}
+
+// static
+bool OutputDeltaEncoder::UpdateField(bool has_field, string *serialized,
+                                     Field *last) {
+  const bool same = has_field && last->has_field &&
+                    *serialized == last->serialized;
+  last->has_field = has_field;
+  last->serialized.swap(*serialized);
+  return same;
+}
+
+void OutputDeltaEncoder::Encode(uint64 acknowledged_revision,
+                                commands::Output *output) {
+  DCHECK(output);
+  // The delta can be used only if the client has restored the previous
+  // output.
+  const bool encode_delta =
+      revision_ != 0 && acknowledged_revision == revision_;
+  ++revision_;
+  output->set_revision(revision_);
+  output->clear_delta();
+
+  commands::Output::Delta delta;
+  string serialized;
+  {
+    serialized.clear();
+    if (output->has_preedit()) {
+      output->preedit().SerializePartialToString(&serialized);
+    }
+    if (UpdateField(output->has_preedit(), &serialized, &preedit_) &&
+        encode_delta) {
+      output->clear_preedit();
+      delta.set_same_preedit(true);
+    }
+  }
+  {
+    serialized.clear();
+    if (output->has_candidates()) {
+      SerializeWithoutFocusedIndex(output->mutable_candidates(), &serialized);
+    }
+    if (UpdateField(output->has_candidates(), &serialized, &candidates_) &&
+        encode_delta) {
+      if (output->candidates().has_focused_index()) {
+        delta.set_candidates_focused_index(
+            output->candidates().focused_index());
+      }
+      output->clear_candidates();
+      delta.set_same_candidates(true);
+    }
+  }
+  {
+    serialized.clear();
+    if (output->has_all_candidate_words()) {
+      SerializeWithoutFocusedIndex(output->mutable_all_candidate_words(),
+                                   &serialized);
+    }
+    if (UpdateField(output->has_all_candidate_words(), &serialized,
+                    &all_candidate_words_) &&
+        encode_delta) {
+      if (output->all_candidate_words().has_focused_index()) {
+        delta.set_all_candidate_words_focused_index(
+            output->all_candidate_words().focused_index());
+      }
+      output->clear_all_candidate_words();
+      delta.set_same_all_candidate_words(true);
+    }
+  }
+
+  if (delta.ByteSize() > 0) {
+    delta.set_base_revision(revision_ - 1);
+    output->mutable_delta()->Swap(&delta);
+  }
+}
+
+OutputDeltaDecoder::OutputDeltaDecoder()
+    : revision_(0), last_output_(new commands::Output) {}
+
+OutputDeltaDecoder::~OutputDeltaDecoder() {}
+
+void OutputDeltaDecoder::Reset() {
+  revision_ = 0;
+  last_output_->Clear();
+}
+
+bool OutputDeltaDecoder::Decode(commands::Output *output) {
+  DCHECK(output);
+  if (!output->has_revision()) {
+    // Not encoded.
+    return true;
+  }
+
+  const commands::Output::Delta &delta = output->delta();
+  if (output->has_delta() &&
+      (revision_ == 0 || delta.base_revision() != revision_)) {
+    LOG(ERROR) << "Cannot restore the output of revision "
+               << output->revision() << " from " << delta.base_revision()
+               << ", the last revision is " << revision_;
+    output->clear_delta();
+    Reset();
+    return false;
+  }
+
+  // Restores the omitted fields from the last output, and keeps the other
+  // fields for the next output.
+  if (delta.same_preedit()) {
+    output->mutable_preedit()->CopyFrom(last_output_->preedit());
+  } else if (output->has_preedit()) {
+    last_output_->mutable_preedit()->CopyFrom(output->preedit());
+  } else {
+    last_output_->clear_preedit();
+  }
+
+  if (delta.same_candidates()) {
+    commands::Candidates *candidates = last_output_->mutable_candidates();
+    SetFocusedIndex(delta.has_candidates_focused_index(),
+                    delta.candidates_focused_index(), candidates);
+    output->mutable_candidates()->CopyFrom(*candidates);
+  } else if (output->has_candidates()) {
+    last_output_->mutable_candidates()->CopyFrom(output->candidates());
+  } else {
+    last_output_->clear_candidates();
+  }
+
+  if (delta.same_all_candidate_words()) {
+    commands::CandidateList *words =
+        last_output_->mutable_all_candidate_words();
+    SetFocusedIndex(delta.has_all_candidate_words_focused_index(),
+                    delta.all_candidate_words_focused_index(), words);
+    output->mutable_all_candidate_words()->CopyFrom(*words);
+  } else if (output->has_all_candidate_words()) {
+    last_output_->mutable_all_candidate_words()->CopyFrom(
+        output->all_candidate_words());
+  } else {
+    last_output_->clear_all_candidate_words();
+  }
+
+  output->clear_delta();
+  revision_ = output->revision();
+  return true;
+}
+
+}  // namespace mozc
@@ -0,0 +1,110 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_SESSION_OUTPUT_DELTA_H_
+#define MOZC_SESSION_OUTPUT_DELTA_H_
+
+#include <memory>
+#include <string>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace commands {
+class Output;
+}  // namespace commands
+
+// Encodes the outputs of a session as deltas from the previous output for the
+// clients with Capability::delta_output.  See commands::Output::Delta.
+// Preedit, candidates and all_candidate_words are omitted when they are the
+// same as in the previous output, which is typical while the user moves the
+// focus in a long candidate list.
+class OutputDeltaEncoder {
+ public:
+  OutputDeltaEncoder();
+  ~OutputDeltaEncoder();
+
+  // Sets the next revision to |output|.  If |acknowledged_revision| is the
+  // revision of the previous output, omits the fields that are the same as in
+  // the previous output and describes them in output->delta().
+  void Encode(uint64 acknowledged_revision, commands::Output *output);
+
+  uint64 revision() const { return revision_; }
+
+ private:
+  struct Field {
+    Field() : has_field(false) {}
+    bool has_field;
+    // The serialized field without the focused index.
+    string serialized;
+  };
+
+  // Replaces |last| with the field given by |has_field| and |serialized|.
+  // Returns true if both |last| and the new field are set and equal.
+  static bool UpdateField(bool has_field, string *serialized, Field *last);
+
+  uint64 revision_;
+  Field preedit_;
+  Field candidates_;
+  Field all_candidate_words_;
+
+  DISALLOW_COPY_AND_ASSIGN(OutputDeltaEncoder);
+};
+
+// Restores the outputs encoded by OutputDeltaEncoder on the client.
+class OutputDeltaDecoder {
+ public:
+  OutputDeltaDecoder();
+  ~OutputDeltaDecoder();
+
+  // Restores the fields omitted from |output|.  Returns false if |output| is
+  // encoded from an output this decoder hasn't restored.  In that case the
+  // omitted fields are left empty, and revision() is reset so that the server
+  // sends the next output in full.
+  bool Decode(commands::Output *output);
+
+  // Returns the revision of the last restored output, which the client sends
+  // as Input::acknowledged_output_revision, or 0 if there is no such output.
+  uint64 revision() const { return revision_; }
+
+  // Forgets the last output, e.g., when the session is recreated.
+  void Reset();
+
+ private:
+  uint64 revision_;
+  // The fields of the last restored output that can be omitted.
+  std::unique_ptr<commands::Output> last_output_;
+
+  DISALLOW_COPY_AND_ASSIGN(OutputDeltaDecoder);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_OUTPUT_DELTA_H_
@@ -0,0 +1,242 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/output_delta.h"
+
+#include <string>
+
+#include "base/port.h"
+#include "base/util.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const size_t kNumCandidates = 200;
+const size_t kPageSize = 9;
+
+// Sets up an output of the conversion focused on |focused_index| among
+// kNumCandidates candidates.
+void SetConversionOutput(uint32 focused_index, commands::Output *output) {
+  output->Clear();
+  output->set_consumed(true);
+  output->set_mode(commands::HIRAGANA);
+
+  commands::CandidateList *words = output->mutable_all_candidate_words();
+  words->set_focused_index(focused_index);
+  for (size_t i = 0; i < kNumCandidates; ++i) {
+    commands::CandidateWord *word = words->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_value(Util::StringPrintf("value%d", static_cast<int>(i)));
+  }
+
+  commands::Preedit *preedit = output->mutable_preedit();
+  preedit->set_cursor(0);
+  commands::Preedit::Segment *segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::HIGHLIGHT);
+  segment->set_value(words->candidates(focused_index).value());
+  segment->set_value_length(segment->value().size());
+
+  const uint32 page_begin = focused_index - focused_index % kPageSize;
+  commands::Candidates *candidates = output->mutable_candidates();
+  candidates->set_focused_index(focused_index);
+  candidates->set_size(kNumCandidates);
+  candidates->set_position(0);
+  for (uint32 i = page_begin;
+       i < page_begin + kPageSize && i < kNumCandidates; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_id(i);
+    candidate->set_value(words->candidates(i).value());
+  }
+}
+
+// Encodes |output| as the server does and decodes it as the client does.
+// Returns the byte size of the encoded output.
+int RoundTrip(OutputDeltaEncoder *encoder, OutputDeltaDecoder *decoder,
+              commands::Output *output) {
+  encoder->Encode(decoder->revision(), output);
+  const int size = output->ByteSize();
+  EXPECT_TRUE(decoder->Decode(output));
+  return size;
+}
+
+TEST(OutputDeltaTest, FirstOutputIsNotEncoded) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  const commands::Output expected = output;
+
+  encoder.Encode(decoder.revision(), &output);
+  EXPECT_EQ(1, output.revision());
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_TRUE(output.has_preedit());
+  EXPECT_TRUE(output.has_candidates());
+  EXPECT_TRUE(output.has_all_candidate_words());
+
+  EXPECT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(1, decoder.revision());
+  output.clear_revision();
+  EXPECT_EQ(expected.DebugString(), output.DebugString());
+}
+
+TEST(OutputDeltaTest, MoveFocus) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  const int full_size = RoundTrip(&encoder, &decoder, &output);
+
+  for (uint32 i = 1; i < kNumCandidates; ++i) {
+    SCOPED_TRACE(Util::StringPrintf("focused_index: %d", static_cast<int>(i)));
+    SetConversionOutput(i, &output);
+    const commands::Output expected = output;
+
+    encoder.Encode(decoder.revision(), &output);
+    ASSERT_TRUE(output.has_delta());
+    EXPECT_EQ(i, output.delta().base_revision());
+    // The preedit shows the focused candidate and always changes.
+    EXPECT_TRUE(output.has_preedit());
+    EXPECT_FALSE(output.delta().same_preedit());
+    // The candidate window changes only when the page changes.
+    EXPECT_EQ(i % kPageSize != 0, output.delta().same_candidates());
+    EXPECT_TRUE(output.delta().same_all_candidate_words());
+    EXPECT_FALSE(output.has_all_candidate_words());
+    EXPECT_EQ(i, output.delta().all_candidate_words_focused_index());
+    EXPECT_GT(full_size / 10, output.ByteSize());
+
+    EXPECT_TRUE(decoder.Decode(&output));
+    EXPECT_EQ(i + 1, decoder.revision());
+    EXPECT_FALSE(output.has_delta());
+    output.clear_revision();
+    EXPECT_EQ(expected.DebugString(), output.DebugString());
+  }
+}
+
+TEST(OutputDeltaTest, ClearedFieldsAreNotRestored) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  RoundTrip(&encoder, &decoder, &output);
+
+  // Commit clears the preedit and the candidates.
+  output.Clear();
+  output.set_consumed(true);
+  output.mutable_result()->set_type(commands::Result::STRING);
+  output.mutable_result()->set_value("value0");
+  RoundTrip(&encoder, &decoder, &output);
+  EXPECT_FALSE(output.has_preedit());
+  EXPECT_FALSE(output.has_candidates());
+  EXPECT_FALSE(output.has_all_candidate_words());
+
+  // The same conversion again is sent in full since the last output has no
+  // candidates.
+  SetConversionOutput(0, &output);
+  const commands::Output expected = output;
+  encoder.Encode(decoder.revision(), &output);
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_TRUE(decoder.Decode(&output));
+  output.clear_revision();
+  EXPECT_EQ(expected.DebugString(), output.DebugString());
+}
+
+TEST(OutputDeltaTest, UnacknowledgedOutput) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  RoundTrip(&encoder, &decoder, &output);
+
+  // The client lost the output of revision 2.
+  SetConversionOutput(1, &output);
+  encoder.Encode(decoder.revision(), &output);
+  EXPECT_EQ(2, output.revision());
+  EXPECT_TRUE(output.has_delta());
+
+  // The server sends the full output since the acknowledged revision is not
+  // the last one.
+  SetConversionOutput(2, &output);
+  const commands::Output expected = output;
+  encoder.Encode(decoder.revision(), &output);
+  EXPECT_EQ(3, output.revision());
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(3, decoder.revision());
+  output.clear_revision();
+  EXPECT_EQ(expected.DebugString(), output.DebugString());
+}
+
+TEST(OutputDeltaTest, DecodeMismatchedBase) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  RoundTrip(&encoder, &decoder, &output);
+
+  // The session is recreated on the client while the server keeps the old
+  // revision, e.g., the server is shared by another client.
+  decoder.Reset();
+  EXPECT_EQ(0, decoder.revision());
+  SetConversionOutput(1, &output);
+  encoder.Encode(1, &output);
+  ASSERT_TRUE(output.has_delta());
+  EXPECT_FALSE(decoder.Decode(&output));
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_EQ(0, decoder.revision());
+
+  // The decoder asks for the full output.
+  SetConversionOutput(2, &output);
+  const commands::Output expected = output;
+  encoder.Encode(decoder.revision(), &output);
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(3, decoder.revision());
+  output.clear_revision();
+  EXPECT_EQ(expected.DebugString(), output.DebugString());
+}
+
+TEST(OutputDeltaTest, NotEncodedOutput) {
+  OutputDeltaDecoder decoder;
+  commands::Output output;
+  SetConversionOutput(0, &output);
+  const commands::Output expected = output;
+  EXPECT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(0, decoder.revision());
+  EXPECT_EQ(expected.DebugString(), output.DebugString());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -56,6 +56,7 @@
 #include "session/internal/keymap_factory.h"
 #include "session/internal/keymap-inl.h"
 #include "session/internal/session_output.h"
+#include "session/output_delta.h"
 #include "session/session_converter.h"
 #include "session/session_usage_stats_util.h"
 #include "usage_stats/usage_stats.h"
@@ -205,7 +206,9 @@ ImeContext::State GetEffectiveStateForTestSendKey(
 
 // TODO(komatsu): Remove these argument by using/making singletons.
 Session::Session(EngineInterface *engine)
-    : engine_(engine), context_(new ImeContext) {
+    : engine_(engine),
+      context_(new ImeContext),
+      output_delta_encoder_(new OutputDeltaEncoder) {
   InitContext(context_.get());
 }
 
@@ -1378,6 +1381,29 @@ bool Session::MaybeSelectCandidate(commands::Command *command) {
   return context_->mutable_converter()->CandidateMoveToShortcut(shortcut);
 }
 
+void Session::EncodeOutputDelta(commands::Command *command) {
+  if (!context_->client_capability().delta_output()) {
+    return;
+  }
+  output_delta_encoder_->Encode(
+      command->input().acknowledged_output_revision(),
+      command->mutable_output());
+}
+
+void Session::Compact() {
+  if (context_->state() != ImeContext::PRECOMPOSITION &&
+      context_->state() != ImeContext::DIRECT) {
+    return;
+  }
+  context_->mutable_composer()->ReleaseUnusedMemory();
+  context_->mutable_converter()->ReleaseUnusedMemory();
+  if (prev_context_.get() != NULL) {
+    // The context for undo keeps its composition.
+    prev_context_->mutable_composer()->ReleaseUnusedMemory();
+    prev_context_->mutable_converter()->ReleaseUnusedMemory();
+  }
+}
+
 void Session::set_client_capability(const commands::Capability &capability) {
   context_->mutable_client_capability()->CopyFrom(capability);
 }
@@ -1915,6 +1941,11 @@ bool Session::Suggest(const commands::Input &input) {
     return false;
   }
 
+  // The output of an obsolete request is never shown, so its suggestion is
+  // skipped as if |request_suggestion| were false.
+  const bool obsolete =
+      input.sequence_number() < input.latest_sequence_number();
+
   // |reuqest_suggestion| is not supposed to always ensure suppressing
   // suggestion since this field is used for performance improvement
   // by skipping interim suggestions.  However, the implementation of
@@ -1926,11 +1957,12 @@ bool Session::Suggest(const commands::Input &input) {
   // cases).
   //
   // TODO(komatsu): Move the logic into SessionConverter.
-  if (input.has_request_suggestion() &&
+  if ((input.has_request_suggestion() || obsolete) &&
       input.type() == commands::Input::SEND_KEY) {
     ConversionPreferences conversion_preferences =
         context_->converter().conversion_preferences();
-    conversion_preferences.request_suggestion = input.request_suggestion();
+    conversion_preferences.request_suggestion =
+        input.request_suggestion() && !obsolete;
     return context_->mutable_converter()->SuggestWithPreferences(
         context_->composer(), conversion_preferences);
   }
@@ -51,6 +51,7 @@
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
+        'session_base.gyp:output_delta',
         'session_base.gyp:session_usage_stats_util',
         'session_internal',
       ],
@@ -61,6 +62,7 @@
       'hard_dependency': 1,
       'sources': [
         'internal/candidate_list.cc',
+        'internal/conversion_prefetcher.cc',
         'internal/ime_context.cc',
         'internal/session_output.cc',
         'internal/key_event_transformer.cc',
@@ -69,8 +71,10 @@
         '../base/base.gyp:base',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:config_handler',
+        '../converter/converter_base.gyp:segments',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../request/request.gyp:conversion_request',
       ],
     },
     {
@@ -93,6 +97,7 @@
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'session_base.gyp:generic_storage_manager',
+        'session_internal',
       ],
       'conditions': [
         ['(target_platform=="NaCl" and _toolset=="target") or target_platform=="Android"', {
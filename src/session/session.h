@@ -43,6 +43,8 @@
 #include "transliteration/transliteration.h"
 
 namespace mozc {
+class OutputDeltaEncoder;
+
 namespace commands {
 class ApplicationInfo;
 class Capability;
@@ -73,6 +75,14 @@ class Session : public SessionInterface {
   // Perform the SEND_COMMAND command defined commands.proto.
   virtual bool SendCommand(mozc::commands::Command *command);
 
+  // Encodes the output as a delta if the client has
+  // Capability::delta_output.
+  virtual void EncodeOutputDelta(mozc::commands::Command *command);
+
+  // Releases the conversion caches and the composer buffers unless a
+  // composition or a conversion is in progress.
+  virtual void Compact();
+
   // Turn on IME. Do nothing (but the keyevent is consumed) when IME is already
   // turned on.
   bool IMEOn(mozc::commands::Command *command);
@@ -280,6 +290,9 @@ class Session : public SessionInterface {
   std::unique_ptr<ImeContext> context_;
   std::unique_ptr<ImeContext> prev_context_;
 
+  // Keeps the last output sent to the client for delta encoding.
+  std::unique_ptr<OutputDeltaEncoder> output_delta_encoder_;
+
   void InitContext(ImeContext *context) const;
 
   void PushUndoContext();
@@ -117,6 +117,17 @@
         '../protocol/protocol.gyp:commands_proto',
       ],
     },
+    {
+      'target_name': 'output_delta',
+      'type': 'static_library',
+      'sources': [
+        'output_delta.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'session_usage_stats_util',
       'type': 'static_library',
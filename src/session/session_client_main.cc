@@ -43,17 +43,37 @@
 #include "engine/engine_factory.h"
 #include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
+#include "session/output_delta.h"
 #include "session/session.h"
 
 DEFINE_string(input, "", "Input file");
 DEFINE_string(output, "", "Output file");
 DEFINE_string(profile_dir, "", "Profile dir");
+DEFINE_bool(delta_output, false,
+            "Delta-encode the outputs and report the encoded sizes");
 
 namespace mozc {
 
+namespace {
+
+session::Session *CreateSession(EngineInterface *engine) {
+  session::Session *session = new session::Session(engine);
+  if (FLAGS_delta_output) {
+    commands::Capability capability;
+    capability.set_delta_output(true);
+    session->set_client_capability(capability);
+  }
+  return session;
+}
+
+}  // namespace
+
 void Loop(istream *input, ostream *output) {
   std::unique_ptr<EngineInterface> engine(EngineFactory::Create());
-  std::unique_ptr<session::Session> session(new session::Session(engine.get()));
+  std::unique_ptr<session::Session> session(CreateSession(engine.get()));
+  OutputDeltaDecoder decoder;
+  uint64 full_output_bytes = 0;
+  uint64 encoded_output_bytes = 0;
 
   commands::Command command;
   string line;
@@ -63,7 +83,8 @@ void Loop(istream *input, ostream *output) {
       continue;
     }
     if (line.empty()) {
-      session.reset(new session::Session(engine.get()));
+      session.reset(CreateSession(engine.get()));
+      decoder.Reset();
       *output << std::endl
               << "## New session" << std::endl
               << std::endl;
@@ -77,13 +98,32 @@ void Loop(istream *input, ostream *output) {
       continue;
     }
 
+    if (FLAGS_delta_output) {
+      command.mutable_input()->set_acknowledged_output_revision(
+          decoder.revision());
+    }
     if (!session->SendKey(&command)) {
       LOG(ERROR) << "Command failure";
     }
+    if (FLAGS_delta_output) {
+      full_output_bytes += command.output().ByteSize();
+      session->EncodeOutputDelta(&command);
+      encoded_output_bytes += command.output().ByteSize();
+      if (!decoder.Decode(command.mutable_output())) {
+        LOG(ERROR) << "Cannot decode the output";
+      }
+      command.mutable_output()->clear_revision();
+      command.mutable_input()->clear_acknowledged_output_revision();
+    }
 
     *output << command.DebugString();
     LOG(INFO) << command.DebugString();
   }
+
+  if (FLAGS_delta_output) {
+    std::cerr << "Output bytes: " << full_output_bytes
+              << ", delta-encoded: " << encoded_output_bytes << std::endl;
+  }
 }
 
 }  // namespace mozc
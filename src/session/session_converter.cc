@@ -38,6 +38,7 @@
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -49,6 +50,7 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
+#include "session/internal/conversion_prefetcher.h"
 #include "session/internal/session_output.h"
 #include "session/session_usage_stats_util.h"
 #include "transliteration/transliteration.h"
@@ -67,6 +69,15 @@ DEFINE_bool(use_actual_converter_for_realtime_conversion,
             "If true, use the actual (non-immutable) converter for real "
             "time conversion.");
 
+DEFINE_int32(conversion_prefetch_delay_msec, 0,
+             "If positive, the conversion of the composition is prefetched "
+             "in background after the input is idle for the milliseconds.");
+
+DEFINE_bool(lazy_candidates_expansion, false,
+            "If true, only the first two pages of the conversion candidates "
+            "are generated at first, and the rest are generated on demand "
+            "when the candidate list is paged.");
+
 namespace mozc {
 namespace session {
 
@@ -119,7 +130,8 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       candidate_list_(new CandidateList(true)),
       candidate_list_visible_(false),
       request_(request),
-      client_revision_(0) {
+      client_revision_(0),
+      prefetcher_(new ConversionPrefetcher(converter)) {
   conversion_preferences_.use_history = true;
   conversion_preferences_.max_history_size = kDefaultMaxHistorySize;
   conversion_preferences_.request_suggestion = true;
@@ -153,13 +165,26 @@ bool SessionConverter::ConvertWithPreferences(
 
   segments_->set_request_type(Segments::CONVERSION);
   SetConversionPreferences(preferences, segments_.get());
+  // Generates one page and a lookahead page at first.
+  segments_->set_initial_conversion_candidates_size(
+      FLAGS_lazy_candidates_expansion ?
+      2 * candidate_list_->page_size() : 0);
 
   const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
-    LOG(WARNING) << "StartConversionForRequest() failed";
-    ResetState();
-    return false;
+  const bool prefetched =
+      FLAGS_conversion_prefetch_delay_msec > 0 &&
+      prefetcher_->Take(composer, *request_, *config_, segments_.get());
+  if (!prefetched) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    if (!converter_->StartConversionForRequest(conversion_request,
+                                               segments_.get())) {
+      LOG(WARNING) << "StartConversionForRequest() failed";
+      ResetState();
+      return false;
+    }
+    stopwatch.Stop();
+    UsageStats::UpdateTiming("ConversionTimeUSec",
+                             stopwatch.GetElapsedMicroseconds());
   }
 
   segment_index_ = 0;
@@ -416,6 +441,8 @@ bool SessionConverter::SuggestWithPreferences(
   // Normalize the current state by resetting the previous state.
   ResetState();
 
+  MaybeSchedulePrefetch(composer, preferences);
+
   // If we are on a password field, suppress suggestion.
   if (!preferences.request_suggestion ||
       composer.GetInputFieldType() == commands::Context::PASSWORD) {
@@ -643,6 +670,41 @@ void SessionConverter::MaybeExpandPrediction(
   UpdateSelectedCandidateIndex();
 }
 
+void SessionConverter::MaybeExpandCandidates(bool expand_all) {
+  DCHECK(CheckState(PREDICTION | CONVERSION));
+  if (!CheckState(CONVERSION) ||
+      segments_->initial_conversion_candidates_size() == 0) {
+    return;
+  }
+
+  // Keeps the page next to the focused one filled so that the next paging
+  // does not wait for the expansion.
+  const size_t page_size = candidate_list_->page_size();
+  const size_t required_size = expand_all ?
+      segments_->max_conversion_candidates_size() :
+      (candidate_list_->focused_index() / page_size + 2) * page_size;
+  const Segment &segment = segments_->conversion_segment(segment_index_);
+  if (segment.candidates_size() >= required_size) {
+    return;
+  }
+
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const ConversionRequest conversion_request(NULL, request_, config_);
+  if (!converter_->ExpandSegmentCandidates(conversion_request, segments_.get(),
+                                           segment_index_, required_size)) {
+    return;
+  }
+  stopwatch.Stop();
+  UsageStats::UpdateTiming("ConversionExpansionTimeUSec",
+                           stopwatch.GetElapsedMicroseconds());
+
+  // The new candidates go before the transliterations, so the candidate list
+  // is rebuilt keeping the focus.
+  const int focused_id = candidate_list_->focused_id();
+  UpdateCandidateList();
+  candidate_list_->MoveToId(focused_id);
+}
+
 void SessionConverter::Cancel() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
@@ -658,6 +720,7 @@ void SessionConverter::Reset() {
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
   converter_->ResetConversion(segments_.get());
+  prefetcher_->Cancel();
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -668,6 +731,14 @@ void SessionConverter::Reset() {
   ResetState();
 }
 
+void SessionConverter::ReleaseUnusedMemory() {
+  if (!CheckState(COMPOSITION)) {
+    return;
+  }
+  // The history segments are kept for the next conversion.
+  segments_->ReleaseCachedLattice();
+}
+
 void SessionConverter::Commit(const composer::Composer &composer,
                               const commands::Context &context) {
   DCHECK(CheckState(PREDICTION | CONVERSION));
@@ -974,6 +1045,7 @@ void SessionConverter::CandidateNext(const composer::Composer &composer) {
   ResetResult();
 
   MaybeExpandPrediction(composer);
+  MaybeExpandCandidates(false);
   candidate_list_->MoveNext();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
@@ -984,6 +1056,7 @@ void SessionConverter::CandidateNextPage() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
+  MaybeExpandCandidates(false);
   candidate_list_->MoveNextPage();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
@@ -994,6 +1067,8 @@ void SessionConverter::CandidatePrev() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
+  // Moving backward from the first candidate wraps around to the last one.
+  MaybeExpandCandidates(candidate_list_->focused_index() == 0);
   candidate_list_->MovePrev();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
@@ -1004,6 +1079,9 @@ void SessionConverter::CandidatePrevPage() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
+  // Moving backward from the first page wraps around to the last one.
+  MaybeExpandCandidates(candidate_list_->focused_index() <
+                        candidate_list_->page_size());
   candidate_list_->MovePrevPage();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
@@ -1025,6 +1103,7 @@ void SessionConverter::CandidateMoveToId(
   DCHECK(CheckState(PREDICTION | CONVERSION));
 
   candidate_list_->MoveToId(id);
+  MaybeExpandCandidates(false);
   candidate_list_visible_ = false;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1035,6 +1114,7 @@ void SessionConverter::CandidateMoveToPageIndex(const size_t index) {
   ResetResult();
 
   candidate_list_->MoveToPageIndex(index);
+  MaybeExpandCandidates(false);
   candidate_list_visible_ = false;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1167,6 +1247,24 @@ void SessionConverter::SetConversionPreferences(
   segments->set_max_history_segments_size(preferences.max_history_size);
 }
 
+void SessionConverter::MaybeSchedulePrefetch(
+    const composer::Composer &composer,
+    const ConversionPreferences &preferences) {
+  if (FLAGS_conversion_prefetch_delay_msec <= 0) {
+    return;
+  }
+  if (composer.Empty() ||
+      composer.GetInputFieldType() == commands::Context::PASSWORD) {
+    prefetcher_->Cancel();
+    return;
+  }
+  // The preferences are applied to the segments as in
+  // ConvertWithPreferences() so that the prefetch matches the conversion.
+  SetConversionPreferences(preferences, segments_.get());
+  prefetcher_->Schedule(composer, *request_, *config_, *segments_,
+                        FLAGS_conversion_prefetch_delay_msec);
+}
+
 SessionConverter* SessionConverter::Clone() const {
   SessionConverter *session_converter =
       new SessionConverter(converter_, request_, config_);
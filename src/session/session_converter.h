@@ -56,6 +56,7 @@ class Config;
 
 namespace session {
 class CandidateList;
+class ConversionPrefetcher;
 
 // Class handling ConverterInterface with a session state.  This class
 // support stateful operations related with the converter.
@@ -127,6 +128,10 @@ class SessionConverter : public SessionConverterInterface {
   // Clears conversion segments and the context.
   virtual void Reset();
 
+  // Releases the caches for the conversion if no conversion is in progress.
+  // The context is kept.
+  virtual void ReleaseUnusedMemory();
+
   // Fixes the conversion with the current status.
   virtual void Commit(const composer::Composer &composer,
                       const commands::Context &context);
@@ -329,6 +334,11 @@ class SessionConverter : public SessionConverterInterface {
   // call StartPrediction().
   void MaybeExpandPrediction(const composer::Composer &composer);
 
+  // If the conversion candidates are generated lazily, generates the
+  // candidates up to the page next to the focused one, or all of them if
+  // |expand_all| is true.
+  void MaybeExpandCandidates(bool expand_all);
+
   // Returns the value of candidate to be used by the converter.
   string GetSelectedCandidateValue(size_t segment_index) const;
 
@@ -350,6 +360,11 @@ class SessionConverter : public SessionConverterInterface {
 
   bool IsEmptySegment(const Segment &segment) const;
 
+  // Schedules the prefetch of the conversion of |composer| if enabled by
+  // --conversion_prefetch_delay_msec.
+  void MaybeSchedulePrefetch(const composer::Composer &composer,
+                             const ConversionPreferences &preferences);
+
   // Handles selected_indices for usage stats.
   void InitializeSelectedCandidateIndices();
   void UpdateSelectedCandidateIndex();
@@ -398,6 +413,8 @@ class SessionConverter : public SessionConverterInterface {
   // OnStartComposition for details.
   int32 client_revision_;
 
+  std::unique_ptr<ConversionPrefetcher> prefetcher_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionConverter);
 };
 
@@ -152,6 +152,10 @@ class SessionConverterInterface {
   // Clear conversion segments and the context.
   virtual void Reset() = 0;
 
+  // Release the caches for the conversion if no conversion is in progress.
+  // The context is kept.
+  virtual void ReleaseUnusedMemory() = 0;
+
   // Fix the conversion with the current status.
   virtual void Commit(const composer::Composer &composer,
                       const commands::Context &context) = 0;
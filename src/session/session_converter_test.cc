@@ -40,9 +40,12 @@
 #include <string>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -53,6 +56,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/internal/candidate_list.h"
+#include "session/internal/conversion_prefetcher.h"
 #include "session/internal/keymap.h"
 #include "session/request_test_util.h"
 #include "testing/base/public/googletest.h"
@@ -62,6 +66,9 @@
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
 
+DECLARE_int32(conversion_prefetch_delay_msec);
+DECLARE_bool(lazy_candidates_expansion);
+
 namespace mozc {
 namespace session {
 
@@ -477,6 +484,99 @@ TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   EXPECT_TRUE(IsCandidateListVisible(converter));
 }
 
+TEST_F(SessionConverterTest, ConvertWithPrefetchedResult) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+  ThreadPool pool(0, "SessionConverterTest");
+  ThreadPool::SetDefaultForTesting(&pool);
+  FLAGS_conversion_prefetch_delay_msec = 10;
+  ConversionPrefetcher::ClearStatsForTesting();
+  {
+    SessionConverter converter(
+        convertermock_.get(), request_.get(), config_.get());
+    Segments segments;
+    SetAiueo(&segments);
+    FillT13Ns(&segments, composer_.get());
+    convertermock_->SetStartConversionForRequest(&segments, true);
+
+    composer_->InsertCharacterPreedit(kChars_Aiueo);
+    converter.Suggest(*composer_);
+    clock.PutClockForwardByTicks(10 * Clock::GetFrequency() / 1000);
+    EXPECT_EQ(1, pool.RunUntilIdle());
+
+    // The prefetched result is used instead of the one from the converter.
+    SetKamaboko(&segments);
+    convertermock_->SetStartConversionForRequest(&segments, true);
+    EXPECT_TRUE(converter.Convert(*composer_));
+    ASSERT_TRUE(converter.IsActive());
+    commands::Output output;
+    converter.FillOutput(*composer_, &output);
+    EXPECT_EQ(kChars_Aiueo, output.preedit().segment(0).value());
+
+    const ConversionPrefetcher::Stats stats = ConversionPrefetcher::GetStats();
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(0, stats.misses);
+  }
+  FLAGS_conversion_prefetch_delay_msec = 0;
+  ThreadPool::SetDefaultForTesting(nullptr);
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST_F(SessionConverterTest, ExpandCandidatesLazily) {
+  FLAGS_lazy_candidates_expansion = true;
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  const size_t page_size = GetCandidateList(converter).page_size();
+  Segments segments;
+  SetAiueo(&segments);
+  Segment *segment = segments.mutable_conversion_segment(0);
+  while (segment->candidates_size() < page_size + 1) {
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->key = segment->key();
+    candidate->value = "value" + NumberUtil::SimpleItoa(
+        static_cast<uint32>(segment->candidates_size()));
+  }
+  FillT13Ns(&segments, composer_.get());
+  segments.set_initial_conversion_candidates_size(2 * page_size);
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  {
+    Segments input;
+    ConversionRequest request;
+    convertermock_->GetStartConversionForRequest(&input, &request);
+    EXPECT_EQ(2 * page_size, input.initial_conversion_candidates_size());
+  }
+  // The candidates and the sub candidate list for T13N.
+  EXPECT_EQ(page_size + 2, GetCandidateList(converter).size());
+
+  // Moving to the second page expands the candidates up to the third page.
+  while (segment->candidates_size() < 3 * page_size) {
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->key = segment->key();
+    candidate->value = "value" + NumberUtil::SimpleItoa(
+        static_cast<uint32>(segment->candidates_size()));
+  }
+  convertermock_->SetExpandSegmentCandidates(&segments, true);
+  converter.CandidateNextPage();
+  {
+    Segments input;
+    size_t segment_index = 0;
+    size_t candidates_size = 0;
+    convertermock_->GetExpandSegmentCandidates(&input, &segment_index,
+                                               &candidates_size);
+    EXPECT_EQ(0, segment_index);
+    EXPECT_EQ(2 * page_size, candidates_size);
+  }
+  const CandidateList &candidate_list = GetCandidateList(converter);
+  EXPECT_EQ(3 * page_size + 1, candidate_list.size());
+  EXPECT_EQ(page_size, candidate_list.focused_id());
+  EXPECT_TRUE(candidate_list.candidate(candidate_list.size() - 1)
+              .IsSubcandidateList());
+  FLAGS_lazy_candidates_expansion = false;
+}
+
 TEST_F(SessionConverterTest, ConvertToTransliteration) {
   SessionConverter converter(
       convertermock_.get(), request_.get(), config_.get());
@@ -54,6 +54,7 @@
 #include "protocol/config.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "session/generic_storage_manager.h"
+#include "session/internal/conversion_prefetcher.h"
 #include "session/session.h"
 #include "session/session_observer_handler.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
@@ -92,12 +93,36 @@ DEFINE_int32(last_create_session_timeout, 300,
              "\"last_create_session_timeout\" sec "
              "after create session command");
 
+DEFINE_int32(cleanup_slice_msec, 1,
+             "time budget (msec) of cleanup for each command. "
+             "the rest of the sessions are checked after the next command");
+
+DEFINE_int32(compact_session_timeout, 300,
+             "release the caches of session if it is not accessed for "
+             "\"compact_session_timeout\" sec");
+
+DEFINE_int32(sync_idle_sec, 5,
+             "sync the user data when the user has not typed for "
+             "\"sync_idle_sec\" sec. requests to sync while the user is "
+             "typing are coalesced into one sync");
+
+DEFINE_int32(max_sync_delay_sec, 600,
+             "sync the user data at latest \"max_sync_delay_sec\" sec "
+             "after it is requested even if the user keeps typing");
+
 DEFINE_bool(restricted, false,
             "Launch server with restricted setting");
 
 namespace mozc {
 
 namespace {
+// Returns true if the command is sent while the user is typing.
+bool IsUserInput(commands::Input::CommandType type) {
+  return type == commands::Input::SEND_KEY ||
+         type == commands::Input::TEST_SEND_KEY ||
+         type == commands::Input::SEND_COMMAND;
+}
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -146,6 +171,11 @@ SessionHandler::SessionHandler(EngineInterface *engine)
       last_session_empty_time_(Clock::GetTime()),
       last_cleanup_time_(0),
       last_create_session_time_(0),
+      cleanup_time_(0),
+      cleanup_create_session_timeout_(0),
+      cleanup_last_command_timeout_(0),
+      last_input_time_(0),
+      sync_requested_time_(0),
       engine_(engine),
       observer_handler_(new session::SessionObserverHandler()),
       stopwatch_(new Stopwatch),
@@ -191,6 +221,9 @@ SessionHandler::SessionHandler(EngineInterface *engine)
 }
 
 SessionHandler::~SessionHandler() {
+  if (sync_requested_time_ != 0) {
+    FlushUserData();
+  }
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != NULL; element = element->next) {
@@ -243,14 +276,42 @@ void SessionHandler::SetConfig(const config::Config &config) {
 }
 
 bool SessionHandler::SyncData(commands::Command *command) {
+  RequestSync();
+  return true;
+}
+
+void SessionHandler::RequestSync() {
+  if (sync_requested_time_ == 0) {
+    sync_requested_time_ = Clock::GetTime();
+  }
+}
+
+void SessionHandler::MaybeSync() {
+  if (sync_requested_time_ == 0) {
+    return;
+  }
+  // Writing the user data while the user is typing competes for the disk
+  // with the conversion, so the sync waits for a pause of the input.
+  const uint64 current_time = Clock::GetTime();
+  const bool idle =
+      current_time >= last_input_time_ + max(0, FLAGS_sync_idle_sec);
+  const bool overdue =
+      current_time >= sync_requested_time_ + max(0, FLAGS_max_sync_delay_sec);
+  if (!idle && !overdue) {
+    return;
+  }
+  FlushUserData();
+}
+
+void SessionHandler::FlushUserData() {
   VLOG(1) << "Syncing user data";
+  sync_requested_time_ = 0;
   engine_->GetUserDataManager()->Sync();
-  return true;
 }
 
 bool SessionHandler::Shutdown(commands::Command *command) {
   VLOG(1) << "Shutdown server";
-  SyncData(command);
+  FlushUserData();
   is_available_ = false;
   UsageStats::IncrementCount("ShutDown");
   return true;
@@ -449,10 +510,19 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     return false;
   }
 
+  // Keeps the conversion prefetch tasks off the converter while the command
+  // is evaluated.
+  session::ConversionPrefetcher::ScopedConverterLock converter_lock;
+
   bool eval_succeeded = false;
   stopwatch_->Reset();
   stopwatch_->Start();
 
+  if (IsUserInput(command->input().type())) {
+    last_input_time_ = Clock::GetTime();
+    session::ConversionPrefetcher::OnUserInput();
+  }
+
   switch (command->input().type()) {
     case commands::Input::CREATE_SESSION:
       eval_succeeded = CreateSession(command);
@@ -543,6 +613,17 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   UsageStats::UpdateTiming("ElapsedTimeUSec",
                            stopwatch_->GetElapsedMicroseconds());
 
+  // Continues the cleanup started by the last CLEANUP command.
+  if (is_available_ &&
+      command->input().type() != commands::Input::CLEANUP &&
+      !cleanup_session_ids_.empty()) {
+    CleanupSlice();
+  }
+
+  if (is_available_) {
+    MaybeSync();
+  }
+
   return is_available_;
 }
 
@@ -572,6 +653,7 @@ bool SessionHandler::SendKey(commands::Command *command) {
     return false;
   }
   (*session)->SendKey(command);
+  (*session)->EncodeOutputDelta(command);
   MaybeUpdateStoredConfig(command);
   return true;
 }
@@ -584,6 +666,7 @@ bool SessionHandler::TestSendKey(commands::Command *command) {
     return false;
   }
   (*session)->TestSendKey(command);
+  (*session)->EncodeOutputDelta(command);
   return true;
 }
 
@@ -596,6 +679,7 @@ bool SessionHandler::SendCommand(commands::Command *command) {
     return false;
   }
   (*session)->SendCommand(command);
+  (*session)->EncodeOutputDelta(command);
   MaybeUpdateStoredConfig(command);
   return true;
 }
@@ -676,7 +760,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
-  engine_->GetUserDataManager()->Sync();
+  RequestSync();
   return true;
 }
 
@@ -718,35 +802,18 @@ bool SessionHandler::Cleanup(commands::Command *command) {
       suspend_time +
       max(10, min(FLAGS_last_command_timeout, 7200));
 
-  vector<SessionID> remove_ids;
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
+  // Removing sessions involves checking the client processes, which is slow
+  // with many sessions.  The sessions are checked in slices between the
+  // commands so that the key events are not blocked.
+  cleanup_session_ids_.clear();
+  for (const SessionElement *element = session_map_->Head();
        element != NULL; element = element->next) {
-    session::SessionInterface *session = element->value;
-    if (!IsApplicationAlive(session)) {
-      VLOG(2) << "Application is not alive. Removing: " << element->key;
-      remove_ids.push_back(element->key);
-    } else if (session->last_command_time() == 0) {
-      // no command is exectuted
-      if ((current_time - session->create_session_time()) >=
-          create_session_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    }
-  }
-
-  for (size_t i = 0; i < remove_ids.size(); ++i) {
-    DeleteSessionID(remove_ids[i]);
-    VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
+    cleanup_session_ids_.push_back(element->key);
   }
-
-  // Sync all data. This is a regression bug fix http://b/3033708
-  engine_->GetUserDataManager()->Sync();
+  cleanup_time_ = current_time;
+  cleanup_create_session_timeout_ = create_session_timeout;
+  cleanup_last_command_timeout_ = last_command_timeout;
+  CleanupSlice();
 
   // timeout is enabled.
   if (FLAGS_timeout > 0 &&
@@ -761,6 +828,72 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   return true;
 }
 
+void SessionHandler::CleanupSlice() {
+  // Checks at least one session for the progress.
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  const int64 budget_msec = max(0, FLAGS_cleanup_slice_msec);
+  while (!cleanup_session_ids_.empty()) {
+    // The least recently used session comes first.
+    const SessionID id = cleanup_session_ids_.back();
+    cleanup_session_ids_.pop_back();
+    CleanupSession(id);
+    if (stopwatch.GetElapsedMilliseconds() >= budget_msec) {
+      break;
+    }
+  }
+
+  if (cleanup_session_ids_.empty()) {
+    // Sync all data. This is a regression bug fix http://b/3033708
+    // The user history is saved by a background thread.
+    RequestSync();
+  }
+}
+
+uint64 SessionHandler::GetIdleTime(uint64 last_time) const {
+  // The session may be used after Cleanup() took |cleanup_time_|, as the
+  // sessions are checked after the following commands.
+  if (last_time >= cleanup_time_) {
+    return 0;
+  }
+  return cleanup_time_ - last_time;
+}
+
+void SessionHandler::CleanupSession(SessionID id) {
+  // Doesn't change the LRU order.
+  session::SessionInterface **session =
+      session_map_->MutableLookupWithoutInsert(id);
+  if (session == NULL || *session == NULL) {
+    // Already deleted.
+    return;
+  }
+
+  bool remove = false;
+  uint64 idle_time = 0;
+  if (!IsApplicationAlive(*session)) {
+    VLOG(2) << "Application is not alive. Removing: " << id;
+    remove = true;
+  } else if ((*session)->last_command_time() == 0) {
+    // no command is exectuted
+    idle_time = GetIdleTime((*session)->create_session_time());
+    remove = idle_time >= cleanup_create_session_timeout_;
+  } else {  // some commands are executed already
+    idle_time = GetIdleTime((*session)->last_command_time());
+    remove = idle_time >= cleanup_last_command_timeout_;
+  }
+
+  if (remove) {
+    DeleteSessionID(id);
+    VLOG(1) << "Session ID " << id << " is removed by server";
+    return;
+  }
+
+  if (FLAGS_compact_session_timeout >= 0 &&
+      idle_time >= static_cast<uint64>(FLAGS_compact_session_timeout)) {
+    // The caches are rebuilt when the session is used again.
+    (*session)->Compact();
+  }
+}
+
 bool SessionHandler::SendUserDictionaryCommand(commands::Command *command) {
   if (!command->input().has_user_dictionary_command()) {
     return false;
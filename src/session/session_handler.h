@@ -35,6 +35,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "composer/table.h"
@@ -128,6 +129,21 @@ class SessionHandler : public SessionHandlerInterface {
   bool ReadAllFromStorage(commands::Command *command);
   bool ClearStorage(commands::Command *command);
   bool Cleanup(commands::Command *command);
+  // Checks the sessions left by Cleanup() for a limited time, and requests to
+  // sync the user data when all the sessions are checked.
+  void CleanupSlice();
+  // Requests to sync the user data.  The requests are coalesced and the sync
+  // is deferred by MaybeSync() until the user pauses typing.
+  void RequestSync();
+  // Syncs the user data if it is requested and the user is idle, or if the
+  // request has waited for too long.
+  void MaybeSync();
+  // Syncs the user data now.
+  void FlushUserData();
+  // Removes or compacts the session of |id| if it is idle.
+  void CleanupSession(SessionID id);
+  // Returns the seconds from |last_time| to the time of the last Cleanup().
+  uint64 GetIdleTime(uint64 last_time) const;
   bool SendUserDictionaryCommand(commands::Command *command);
   bool NoOperation(commands::Command *command);
 
@@ -148,6 +164,18 @@ class SessionHandler : public SessionHandlerInterface {
   uint64 last_cleanup_time_;
   uint64 last_create_session_time_;
 
+  // The sessions to be checked by CleanupSlice() and the parameters given by
+  // Cleanup().  The sessions are checked from the back.
+  vector<SessionID> cleanup_session_ids_;
+  uint64 cleanup_time_;
+  uint64 cleanup_create_session_timeout_;
+  uint64 cleanup_last_command_timeout_;
+
+  // The time of the last key event or command, and the time of the oldest
+  // pending request to sync (0 if none).
+  uint64 last_input_time_;
+  uint64 sync_requested_time_;
+
   EngineInterface *engine_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<Stopwatch> stopwatch_;
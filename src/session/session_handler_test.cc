@@ -55,6 +55,9 @@ DECLARE_int32(max_session_size);
 DECLARE_int32(create_session_min_interval);
 DECLARE_int32(last_command_timeout);
 DECLARE_int32(last_create_session_timeout);
+DECLARE_int32(cleanup_slice_msec);
+DECLARE_int32(sync_idle_sec);
+DECLARE_int32(max_sync_delay_sec);
 
 namespace mozc {
 
@@ -199,6 +202,82 @@ TEST_F(SessionHandlerTest, LastCommandTimeout) {
   EXPECT_FALSE(IsGoodSession(&handler, id));
 }
 
+TEST_F(SessionHandlerTest, CleanupInSlices) {
+  FLAGS_last_create_session_timeout = 10;  // 10 sec
+  // Checks one session in each slice since the time budget is 0 msec.
+  const int32 cleanup_slice_msec_backup = FLAGS_cleanup_slice_msec;
+  FLAGS_cleanup_slice_msec = 0;
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  MockConverterEngine engine;
+  UserDataManagerMock *user_data_mgr_mock = new UserDataManagerMock();
+  engine.SetUserDataManager(user_data_mgr_mock);
+  SessionHandler handler(&engine);
+
+  const size_t kNumSessions = 3;
+  vector<uint64> ids;
+  for (size_t i = 0; i < kNumSessions; ++i) {
+    uint64 id = 0;
+    EXPECT_TRUE(CreateSession(&handler, &id));
+    ids.push_back(id);
+  }
+
+  clock.PutClockForward(10, 0);
+  EXPECT_TRUE(CleanUp(&handler, 0));
+  // The rest of the sessions are checked after the following commands, and
+  // the user data is synced after all the sessions are checked.
+  for (size_t i = 1; i < kNumSessions; ++i) {
+    EXPECT_EQ(0, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+  }
+  EXPECT_EQ(1, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+
+  for (size_t i = 0; i < kNumSessions; ++i) {
+    EXPECT_FALSE(IsGoodSession(&handler, ids[i]));
+  }
+  EXPECT_EQ(1, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+
+  FLAGS_cleanup_slice_msec = cleanup_slice_msec_backup;
+}
+
+TEST_F(SessionHandlerTest, CleanupInSlicesKeepsSessionUsedAfterCleanup) {
+  FLAGS_last_command_timeout = 10;  // 10 sec
+  const int32 cleanup_slice_msec_backup = FLAGS_cleanup_slice_msec;
+  FLAGS_cleanup_slice_msec = 0;
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
+  SessionHandler handler(engine.get());
+
+  const size_t kNumSessions = 3;
+  vector<uint64> ids;
+  for (size_t i = 0; i < kNumSessions; ++i) {
+    uint64 id = 0;
+    EXPECT_TRUE(CreateSession(&handler, &id));
+    ids.push_back(id);
+  }
+
+  clock.PutClockForward(5, 0);
+  EXPECT_TRUE(CleanUp(&handler, 0));
+
+  // The sessions are checked from the least recently used one, so the newer
+  // sessions are used after the time Cleanup() took but before they are
+  // checked.  They are active, not idle.
+  clock.PutClockForward(2, 0);
+  for (size_t i = kNumSessions; i > 0; --i) {
+    EXPECT_TRUE(IsGoodSession(&handler, ids[i - 1]));
+  }
+  for (size_t i = 0; i < kNumSessions; ++i) {
+    EXPECT_TRUE(IsGoodSession(&handler, ids[i]));
+  }
+
+  FLAGS_cleanup_slice_msec = cleanup_slice_msec_backup;
+}
+
 TEST_F(SessionHandlerTest, ShutdownTest) {
   std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
   SessionHandler handler(engine.get());
@@ -347,6 +426,63 @@ TEST_F(SessionHandlerTest, VerifySyncIsCalled) {
   }
 }
 
+TEST_F(SessionHandlerTest, SyncIsDeferredWhileTyping) {
+  const int32 sync_idle_sec_backup = FLAGS_sync_idle_sec;
+  const int32 max_sync_delay_sec_backup = FLAGS_max_sync_delay_sec;
+  FLAGS_sync_idle_sec = 5;
+  FLAGS_max_sync_delay_sec = 10;
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  MockConverterEngine engine;
+  UserDataManagerMock *user_data_mgr_mock = new UserDataManagerMock();
+  engine.SetUserDataManager(user_data_mgr_mock);
+  {
+    SessionHandler handler(&engine);
+    uint64 id = 0;
+    EXPECT_TRUE(CreateSession(&handler, &id));
+
+    commands::Command sync;
+    sync.mutable_input()->set_type(commands::Input::SYNC_DATA);
+    commands::Command noop;
+    noop.mutable_input()->set_type(commands::Input::NO_OPERATION);
+
+    // The requests while typing are coalesced into one sync after a pause.
+    EXPECT_TRUE(IsGoodSession(&handler, id));
+    EXPECT_TRUE(handler.EvalCommand(&sync));
+    EXPECT_TRUE(handler.EvalCommand(&sync));
+    EXPECT_EQ(0, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+    clock.PutClockForward(4, 0);
+    EXPECT_TRUE(handler.EvalCommand(&noop));
+    EXPECT_EQ(0, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+    clock.PutClockForward(1, 0);
+    EXPECT_TRUE(handler.EvalCommand(&noop));
+    EXPECT_EQ(1, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+    EXPECT_TRUE(handler.EvalCommand(&noop));
+    EXPECT_EQ(1, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+
+    // The sync is not deferred forever.
+    EXPECT_TRUE(IsGoodSession(&handler, id));
+    EXPECT_TRUE(handler.EvalCommand(&sync));
+    for (int i = 0; i < 3; ++i) {
+      clock.PutClockForward(3, 0);
+      EXPECT_TRUE(IsGoodSession(&handler, id));
+      EXPECT_EQ(1, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+    }
+    clock.PutClockForward(1, 0);
+    EXPECT_TRUE(IsGoodSession(&handler, id));
+    EXPECT_EQ(2, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+
+    // The pending request is flushed on destruction.
+    EXPECT_TRUE(handler.EvalCommand(&sync));
+    EXPECT_EQ(2, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+  }
+  EXPECT_EQ(3, user_data_mgr_mock->GetFunctionCallCount("Sync"));
+
+  FLAGS_sync_idle_sec = sync_idle_sec_backup;
+  FLAGS_max_sync_delay_sec = max_sync_delay_sec_backup;
+}
+
 const char *kStorageTestData[] = {
   "angel", "bishop", "chariot", "dragon",
 };
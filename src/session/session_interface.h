@@ -60,6 +60,15 @@ class SessionInterface {
   // Perform the SEND_COMMAND command defined commands.proto.
   virtual bool SendCommand(commands::Command *command) = 0;
 
+  // Encodes the output of |command| as a delta from the previous output if
+  // the client supports it.  Called after SendKey, TestSendKey and
+  // SendCommand.
+  virtual void EncodeOutputDelta(commands::Command *command) {}
+
+  // Releases the memory kept for speed while the session is idle.  The
+  // state visible to the user is kept.
+  virtual void Compact() {}
+
   virtual void SetConfig(config::Config *config) = 0;
 
   // Set Request. Currently, this is especial for session::Session.
@@ -67,7 +67,8 @@ SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       engine_(EngineFactory::Create()),
       usage_observer_(new session::SessionUsageObserver()),
-      session_handler_(new SessionHandler(engine_.get())) {
+      session_handler_(new SessionHandler(engine_.get())),
+      command_(new commands::Command) {
   using usage_stats::UsageStatsUploader;
   // start session watch dog timer
   session_handler_->StartWatchDog();
@@ -108,7 +109,10 @@ bool SessionServer::Process(const char *request,
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
+  // Clear() keeps the allocated submessages and strings of the previous
+  // command for reuse.
+  commands::Command &command = *command_;
+  command.Clear();
   if (!command.mutable_input()->ParseFromArray(request, request_size)) {
     LOG(WARNING) << "Invalid request";
     *response_size = 0;
@@ -121,23 +125,25 @@ bool SessionServer::Process(const char *request,
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
+  // Serializes the output directly into the response buffer.
+  const commands::Output &output = command.output();
+  if (!output.IsInitialized()) {
+    LOG(WARNING) << "Output is not initialized";
     *response_size = 0;
     return true;
   }
+  const int output_size = output.ByteSize();
 
   // TODO(taku) automatically increase the buffer.
   // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
+  if (*response_size < static_cast<size_t>(output_size)) {
     LOG(WARNING) << "response size < output.size";
     *response_size = 0;
     return true;
   }
 
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
+  output.SerializeWithCachedSizesToArray(reinterpret_cast<uint8 *>(response));
+  *response_size = output_size;
 
   // debug message
   VLOG(2) << command.DebugString();
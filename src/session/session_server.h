@@ -41,6 +41,10 @@ namespace mozc {
 class EngineInterface;
 class SessionHandlerInterface;
 
+namespace commands {
+class Command;
+}  // namespace commands
+
 namespace session {
 class SessionUsageObserver;
 }  // namespace session
@@ -72,6 +76,9 @@ class SessionServer: public IPCServer {
   std::unique_ptr<EngineInterface> engine_;
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
+  // Reused across the requests so that the messages and the strings in it
+  // keep their memory.  Process() is called only from the server thread.
+  std::unique_ptr<commands::Command> command_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionServer);
 };
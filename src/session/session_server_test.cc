@@ -35,6 +35,7 @@
 
 #include "base/scheduler.h"
 #include "base/system_util.h"
+#include "protocol/commands.pb.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -80,4 +81,58 @@ TEST_F(SessionServerTest, SetSchedulerJobTest) {
   EXPECT_TRUE(job_recorder->HasJob("SaveCachedStats"));
   Scheduler::SetSchedulerHandler(NULL);
 }
+
+TEST_F(SessionServerTest, Process) {
+  std::unique_ptr<SessionServer> session_server(new SessionServer);
+  char response[IPC_RESPONSESIZE];
+  string request;
+  commands::Output output;
+
+  // The same Command object is reused for the requests.
+  uint64 id = 0;
+  for (int i = 0; i < 2; ++i) {
+    commands::Input input;
+    input.set_type(commands::Input::CREATE_SESSION);
+    input.SerializeToString(&request);
+    size_t response_size = sizeof(response);
+    EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                        response, &response_size));
+    ASSERT_LT(0, response_size);
+    EXPECT_TRUE(output.ParseFromArray(response, response_size));
+    EXPECT_EQ(commands::Output::SESSION_SUCCESS, output.error_code());
+    EXPECT_NE(id, output.id());
+    id = output.id();
+  }
+
+  {
+    commands::Input input;
+    input.set_type(commands::Input::SEND_KEY);
+    input.set_id(id);
+    input.mutable_key()->set_key_code('a');
+    input.SerializeToString(&request);
+    size_t response_size = sizeof(response);
+    EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                        response, &response_size));
+    ASSERT_LT(0, response_size);
+    EXPECT_TRUE(output.ParseFromArray(response, response_size));
+    EXPECT_EQ(id, output.id());
+    EXPECT_TRUE(output.has_consumed());
+
+    // The output doesn't fit in the response buffer.
+    response_size = 1;
+    EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                        response, &response_size));
+    EXPECT_EQ(0, response_size);
+  }
+
+  {
+    // Invalid request.
+    const char kInvalidRequest[] = "\xff\xff\xff";
+    size_t response_size = sizeof(response);
+    EXPECT_TRUE(session_server->Process(kInvalidRequest,
+                                        sizeof(kInvalidRequest) - 1,
+                                        response, &response_size));
+    EXPECT_EQ(0, response_size);
+  }
+}
 }  // namespace mozc
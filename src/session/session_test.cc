@@ -9448,6 +9448,27 @@ TEST_F(SessionTest, SuppressSuggestion) {
 
 }
 
+TEST_F(SessionTest, SuggestionIsSkippedForObsoleteRequest) {
+  Session session(mock_data_engine_.get());
+  InitSessionToPrecomposition(&session);
+
+  // A newer request has been issued.
+  commands::Command command;
+  SetSendKeyCommand("a", &command);
+  command.mutable_input()->set_sequence_number(1);
+  command.mutable_input()->set_latest_sequence_number(2);
+  session.SendKey(&command);
+  EXPECT_TRUE(command.output().has_preedit());
+  EXPECT_FALSE(command.output().has_candidates());
+
+  // The newest request gets the suggestion.
+  SetSendKeyCommand("d", &command);
+  command.mutable_input()->set_sequence_number(2);
+  command.mutable_input()->set_latest_sequence_number(2);
+  session.SendKey(&command);
+  EXPECT_TRUE(command.output().has_candidates());
+}
+
 TEST_F(SessionTest, DeleteHistory) {
   std::unique_ptr<Session> session(new Session(engine_.get()));
   InitSessionToPrecomposition(session.get());
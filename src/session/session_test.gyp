@@ -153,6 +153,7 @@
       'target_name': 'session_module_test',
       'type': 'executable',
       'sources': [
+        'output_delta_test.cc',
         'output_util_test.cc',
         'session_observer_handler_test.cc',
         'session_usage_observer_test.cc',
@@ -174,6 +175,7 @@
         'session.gyp:session_usage_observer',
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
+        'session_base.gyp:output_delta',
         'session_base.gyp:output_util',
         'session_base.gyp:session_usage_stats_util',
       ],
@@ -211,6 +213,7 @@
       'type': 'executable',
       'sources': [
         'internal/candidate_list_test.cc',
+        'internal/conversion_prefetcher_test.cc',
         'internal/ime_context_test.cc',
         'internal/keymap_test.cc',
         'internal/keymap_factory_test.cc',
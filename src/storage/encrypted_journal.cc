@@ -0,0 +1,234 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/encrypted_journal.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/password_manager.h"
+#include "base/unverified_sha1.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+// The same salt size as EncryptedStringStorage.
+const size_t kSaltSize = 32;
+
+const size_t kRandomBlockSize = 16;
+
+// The size of the SHA1 digest.
+const size_t kMacSize = 20;
+
+// Returns HMAC-SHA1 (RFC 2104) of |message| with |key|.
+string HmacSha1(StringPiece key, StringPiece message) {
+  const size_t kBlockSize = 64;
+  string block;
+  if (key.size() > kBlockSize) {
+    block = internal::UnverifiedSHA1::MakeDigest(key);
+  } else {
+    key.CopyToString(&block);
+  }
+  block.resize(kBlockSize, '\0');
+
+  string inner(kBlockSize, '\0');
+  string outer(kBlockSize, '\0');
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    inner[i] = block[i] ^ 0x36;
+    outer[i] = block[i] ^ 0x5c;
+  }
+  message.AppendToString(&inner);
+  outer.append(internal::UnverifiedSHA1::MakeDigest(inner));
+  return internal::UnverifiedSHA1::MakeDigest(outer);
+}
+
+// Returns the MAC of the |ciphertext| of the record at |index|.
+string GetMac(const string &mac_key, uint32 index, StringPiece ciphertext) {
+  string message(reinterpret_cast<const char *>(&index), sizeof(index));
+  ciphertext.AppendToString(&message);
+  return HmacSha1(mac_key, message);
+}
+
+// Compares the MACs in a constant time.
+bool IsSameMac(StringPiece mac1, StringPiece mac2) {
+  if (mac1.size() != mac2.size()) {
+    return false;
+  }
+  uint8 diff = 0;
+  for (size_t i = 0; i < mac1.size(); ++i) {
+    diff |= static_cast<uint8>(mac1[i] ^ mac2[i]);
+  }
+  return diff == 0;
+}
+
+}  // namespace
+
+EncryptedJournal::EncryptedJournal() : next_index_(0) {}
+
+EncryptedJournal::~EncryptedJournal() {}
+
+bool EncryptedJournal::Open(const string &filename, uint64 generation,
+                            vector<string> *records) {
+  DCHECK(records);
+  records->clear();
+  key_.reset();
+
+  vector<string> encrypted_records;
+  if (!journal_.Open(filename, generation, &encrypted_records)) {
+    return false;
+  }
+  if (encrypted_records.empty()) {
+    return true;
+  }
+  if (encrypted_records[0].size() != kSaltSize) {
+    LOG(WARNING) << "broken salt of the journal: " << filename;
+    return Reset(generation);
+  }
+  if (!DeriveKey(encrypted_records[0])) {
+    return false;
+  }
+
+  next_index_ = static_cast<uint32>(encrypted_records.size());
+  for (size_t i = 1; i < encrypted_records.size(); ++i) {
+    string record;
+    if (!Decrypt(encrypted_records[i], static_cast<uint32>(i), &record)) {
+      // The rest is dropped from the file too, as the records appended
+      // after it would never be read.
+      LOG(WARNING) << "dropping " << (encrypted_records.size() - i)
+                   << " records which cannot be decrypted: " << filename;
+      return Reset(generation) && Append(*records);
+    }
+    records->push_back(record);
+  }
+  return true;
+}
+
+bool EncryptedJournal::Append(const vector<string> &records) {
+  if (records.empty()) {
+    return true;
+  }
+
+  vector<string> encrypted_records;
+  if (key_ == nullptr) {
+    string salt(kSaltSize, '\0');
+    Util::GetRandomSequence(&salt[0], kSaltSize);
+    if (!DeriveKey(salt)) {
+      return false;
+    }
+    encrypted_records.push_back(salt);
+    next_index_ = 1;
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    encrypted_records.push_back(string());
+    if (!Encrypt(records[i], static_cast<uint32>(next_index_ + i),
+                 &encrypted_records.back())) {
+      return false;
+    }
+  }
+  if (!journal_.Append(encrypted_records)) {
+    // A failed append is removed from the file, so a salt written by it has
+    // to be written again.
+    if (encrypted_records.size() > records.size()) {
+      key_.reset();
+    }
+    return false;
+  }
+  next_index_ += static_cast<uint32>(records.size());
+  return true;
+}
+
+bool EncryptedJournal::Reset(uint64 generation) {
+  key_.reset();
+  return journal_.Reset(generation);
+}
+
+bool EncryptedJournal::DeriveKey(const string &salt) {
+  key_.reset();
+
+  string password;
+  if (!PasswordManager::GetPassword(&password)) {
+    LOG(ERROR) << "PasswordManager::GetPassword() failed";
+    return false;
+  }
+  if (password.empty()) {
+    LOG(ERROR) << "password is empty";
+    return false;
+  }
+
+  std::unique_ptr<Encryptor::Key> key(new Encryptor::Key);
+  if (!key->DeriveFromPassword(password, salt)) {
+    LOG(ERROR) << "Encryptor::Key::DeriveFromPassword() failed";
+    return false;
+  }
+  key_ = std::move(key);
+  // A different key from the cipher key, with the password as the secret.
+  mac_key_ = HmacSha1(password, "EncryptedJournal MAC key" + salt);
+  return true;
+}
+
+bool EncryptedJournal::Encrypt(const string &record, uint32 index,
+                               string *output) const {
+  DCHECK(key_);
+  output->resize(kRandomBlockSize);
+  Util::GetRandomSequence(&(*output)[0], kRandomBlockSize);
+  output->append(record);
+  if (!Encryptor::EncryptString(*key_, output)) {
+    LOG(ERROR) << "Encryptor::EncryptString() failed";
+    return false;
+  }
+  output->append(GetMac(mac_key_, index, *output));
+  return true;
+}
+
+bool EncryptedJournal::Decrypt(const string &record, uint32 index,
+                               string *output) const {
+  DCHECK(key_);
+  if (record.size() < kMacSize) {
+    return false;
+  }
+  const StringPiece ciphertext(record.data(), record.size() - kMacSize);
+  const StringPiece mac(record.data() + ciphertext.size(), kMacSize);
+  if (!IsSameMac(mac, GetMac(mac_key_, index, ciphertext))) {
+    return false;
+  }
+  string data;
+  ciphertext.CopyToString(&data);
+  if (!Encryptor::DecryptString(*key_, &data) ||
+      data.size() < kRandomBlockSize) {
+    return false;
+  }
+  output->assign(data, kRandomBlockSize, string::npos);
+  return true;
+}
+
+}  // namespace storage
+}  // namespace mozc
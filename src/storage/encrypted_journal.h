@@ -0,0 +1,106 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// EncryptedJournal is a Journal whose records are encrypted in the same way
+// as EncryptedStringStorage.  It is used for the files which may contain
+// what the user typed.
+//
+// The first record of each generation is a random salt, from which the
+// cipher key and the MAC key are derived with the password of
+// PasswordManager.  Every other record is stored as |ciphertext|MAC(20 bytes)|,
+// where the ciphertext is |random block(16 bytes)|payload| encrypted in CBC
+// mode, so the random block makes the ciphertexts of the same payload
+// different.  The MAC is HMAC-SHA1 over the index of the record and the
+// ciphertext, and is verified before decryption.  Thus a record which is
+// modified, moved to another position or written with another key is
+// rejected.  Removing the records at the end cannot be detected.
+
+#ifndef MOZC_STORAGE_ENCRYPTED_JOURNAL_H_
+#define MOZC_STORAGE_ENCRYPTED_JOURNAL_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/encryptor.h"
+#include "base/port.h"
+#include "storage/journal.h"
+
+namespace mozc {
+namespace storage {
+
+class EncryptedJournal {
+ public:
+  EncryptedJournal();
+  ~EncryptedJournal();
+
+  // Binds the journal to |filename| and reads the decrypted records written
+  // for the snapshot of |generation| into |records|.  The records which
+  // cannot be decrypted and the following ones are dropped.  Returns false
+  // only when the file cannot be read.
+  bool Open(const string &filename, uint64 generation,
+            vector<string> *records);
+
+  // Encrypts and appends |records| to the file.
+  bool Append(const vector<string> &records);
+
+  // Discards all the records and starts the journal for a new snapshot of
+  // |generation| with a new salt.
+  bool Reset(uint64 generation);
+
+  const string &filename() const { return journal_.filename(); }
+  uint64 generation() const { return journal_.generation(); }
+
+  // The size of the file in bytes.
+  size_t size() const { return journal_.size(); }
+
+ private:
+  // Derives |key_| and |mac_key_| from |salt|.
+  bool DeriveKey(const string &salt);
+
+  // Encrypts or decrypts the record at |index| of the journal, where the
+  // salt is at 0.
+  bool Encrypt(const string &record, uint32 index, string *output) const;
+  bool Decrypt(const string &record, uint32 index, string *output) const;
+
+  Journal journal_;
+  // The keys of the current generation.  |key_| is NULL until the salt is
+  // written or read.
+  std::unique_ptr<Encryptor::Key> key_;
+  string mac_key_;
+  // The index of the next record appended.
+  uint32 next_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(EncryptedJournal);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_ENCRYPTED_JOURNAL_H_
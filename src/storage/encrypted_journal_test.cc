@@ -0,0 +1,227 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/encrypted_journal.h"
+
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/port.h"
+#include "base/system_util.h"
+#include "storage/journal.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+class EncryptedJournalTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+    filename_ = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                   "EncryptedJournalTest.journal");
+    if (FileUtil::FileExists(filename_)) {
+      FileUtil::Unlink(filename_);
+    }
+  }
+
+  virtual void TearDown() {
+    if (FileUtil::FileExists(filename_)) {
+      FileUtil::Unlink(filename_);
+    }
+  }
+
+  string ReadFile() {
+    InputFileStream ifs(filename_.c_str(), ios::in | ios::binary);
+    return string(std::istreambuf_iterator<char>(ifs),
+                  std::istreambuf_iterator<char>());
+  }
+
+  string filename_;
+};
+
+TEST_F(EncryptedJournalTest, AppendAndOpen) {
+  vector<string> records;
+  {
+    EncryptedJournal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    EXPECT_TRUE(records.empty());
+
+    records.push_back("abcdefghijklmnopqrstuvwxyz");
+    records.push_back("abcdefghijklmnopqrstuvwxyz");
+    EXPECT_TRUE(journal.Append(records));
+    records.clear();
+    records.push_back("");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  // The records are not stored as plain text.
+  EXPECT_EQ(string::npos, ReadFile().find("abcdefghijklmnopqrstuvwxyz"));
+
+  EncryptedJournal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", records[0]);
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", records[1]);
+  EXPECT_EQ("", records[2]);
+
+  // Reset() starts a new generation.
+  EXPECT_TRUE(journal.Reset(2));
+  records.clear();
+  records.push_back("next");
+  EXPECT_TRUE(journal.Append(records));
+  EncryptedJournal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 2, &records));
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("next", records[0]);
+}
+
+TEST_F(EncryptedJournalTest, SameRecordsAreEncryptedDifferently) {
+  vector<string> records;
+  EncryptedJournal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  records.push_back("0123456789abcdef");
+  records.push_back("0123456789abcdef");
+  EXPECT_TRUE(journal.Append(records));
+
+  // Read the raw records: |salt|record|record|.
+  Journal raw_journal;
+  EXPECT_TRUE(raw_journal.Open(filename_, 1, &records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_NE(records[1], records[2]);
+}
+
+TEST_F(EncryptedJournalTest, ModifiedRecordIsDropped) {
+  vector<string> records;
+  {
+    EncryptedJournal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    records.push_back("first");
+    records.push_back("second");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  // Replace the second record with a record encrypted with another key.
+  // The framing of the journal is still valid.
+  const string other_filename = filename_ + ".other";
+  {
+    EncryptedJournal other;
+    EXPECT_TRUE(other.Open(other_filename, 1, &records));
+    records.push_back("third");
+    EXPECT_TRUE(other.Append(records));
+  }
+  {
+    vector<string> other_records;
+    Journal raw_journal;
+    EXPECT_TRUE(raw_journal.Open(other_filename, 1, &other_records));
+    ASSERT_EQ(2, other_records.size());
+    FileUtil::Unlink(other_filename);
+
+    EXPECT_TRUE(raw_journal.Open(filename_, 1, &records));
+    ASSERT_EQ(3, records.size());
+    records[2] = other_records[1];
+    EXPECT_TRUE(raw_journal.Reset(1));
+    EXPECT_TRUE(raw_journal.Append(records));
+  }
+
+  EncryptedJournal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("first", records[0]);
+
+  // The broken record is removed from the file, so the records appended
+  // later are read.
+  records.clear();
+  records.push_back("fourth");
+  EXPECT_TRUE(journal.Append(records));
+  EncryptedJournal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 1, &records));
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ("first", records[0]);
+  EXPECT_EQ("fourth", records[1]);
+}
+
+TEST_F(EncryptedJournalTest, TamperedRecordIsDropped) {
+  vector<string> records;
+  {
+    EncryptedJournal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    records.push_back("first");
+    records.push_back("second");
+    records.push_back("third");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  // Flip a bit of the last block of the second record.  The padding of the
+  // cipher may still be valid, but the MAC is not.
+  Journal raw_journal;
+  EXPECT_TRUE(raw_journal.Open(filename_, 1, &records));
+  ASSERT_EQ(4, records.size());
+  string *record = &records[2];
+  (*record)[record->size() - 21] ^= 0x01;
+  EXPECT_TRUE(raw_journal.Reset(1));
+  EXPECT_TRUE(raw_journal.Append(records));
+
+  EncryptedJournal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("first", records[0]);
+}
+
+TEST_F(EncryptedJournalTest, ReorderedRecordIsDropped) {
+  vector<string> records;
+  {
+    EncryptedJournal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    records.push_back("first");
+    records.push_back("second");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  // Each record is valid by itself, but not at the other position.
+  Journal raw_journal;
+  EXPECT_TRUE(raw_journal.Open(filename_, 1, &records));
+  ASSERT_EQ(3, records.size());
+  records[1].swap(records[2]);
+  EXPECT_TRUE(raw_journal.Reset(1));
+  EXPECT_TRUE(raw_journal.Append(records));
+
+  EncryptedJournal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  EXPECT_TRUE(records.empty());
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
@@ -54,6 +54,34 @@ inline uint32 BitsToWords(uint32 bits) {
   return words;
 }
 
+// The third field of the serialized header holds both the number of hashes
+// (lower 8 bits) and the layout (upper bits). CLASSIC_LAYOUT is 0, so the
+// header of a classic filter is identical to the one written before the
+// layout was introduced, and old readers reject other layouts as having a
+// bad number of hashes.
+const int kLayoutShift = 8;
+const int kNumHashesMask = (1 << kLayoutShift) - 1;
+
+// Size of the serialized header: m, n and k with the layout. Note that this
+// is not sizeof(Header), which also has |layout| as a separate field.
+const size_t kSerializedHeaderBytes =
+    sizeof(uint32) + sizeof(uint32) + sizeof(int32);
+
+// Parameters of BLOCKED_LAYOUT. One block is one 64-byte cache line.
+const uint32 kCacheBlockBits = 512;
+const int kCacheBlockBitPosBits = 9;  // log2(kCacheBlockBits)
+
+// Multiplier to derive the bit positions in a block from a hash value
+// (2^64 / golden ratio). Since num_hashes < 8, 7 * 9 = 63 bits are enough.
+const uint64 kCacheBlockMixer = GG_ULONGLONG(0x9E3779B97F4A7C15);
+
+// Returns the |i|-th bit position in a block, where |bits| is
+// hash * kCacheBlockMixer. The top bits of the product are the best mixed.
+inline uint32 GetCacheBlockBitPos(uint64 bits, int i) {
+  return static_cast<uint32>((bits << (kCacheBlockBitPosBits * i)) >>
+                             (64 - kCacheBlockBitPosBits));
+}
+
 }  // namespace
 
 class ExistenceFilter::BlockBitmap {
@@ -64,6 +92,12 @@ class ExistenceFilter::BlockBitmap {
   bool Get(uint32 index) const;
   void Set(uint32 index);
 
+  // Returns the pointer to the word containing the bit |index|. Words are
+  // contiguous up to the end of the underlying 256KB block, so a 64-byte
+  // block starting at a multiple of 512 bits is always contiguous.
+  const uint32 *GetWords(uint32 index) const;
+  uint32 *GetMutableWords(uint32 index);
+
   // REQUIRES: "iter" is zero, or was set by a preceding call
   // to GetMutableFragment().
   //
@@ -151,19 +185,25 @@ void ExistenceFilter::BlockBitmap::Clear() {
 ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
     : vec_size_(m ? m : 1),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      layout_(CLASSIC_LAYOUT) {
   CHECK_LT(num_hashes_, 8);
   rep_.reset(new BlockBitmap(m ? m : 1, true));
   rep_->Clear();
 }
 
 // this is private constructor
-ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Layout layout,
                                  bool is_mutable)
     : vec_size_(m ? m : 1),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      layout_(layout) {
   CHECK_LT(num_hashes_, 8);
+  if (layout_ == BLOCKED_LAYOUT) {
+    CHECK_EQ(0, vec_size_ % kCacheBlockBits)
+        << "The size of blocked filter must be a multiple of 64 bytes";
+  }
   rep_.reset(new BlockBitmap(m ? m : 1, is_mutable));
   rep_->Clear();
 }
@@ -172,15 +212,27 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
 ExistenceFilter *
 ExistenceFilter::CreateImmutableExietenceFilter(uint32 m,
                                                 uint32 n,
-                                                int k) {
-  return new ExistenceFilter(m, n, k, false);
+                                                int k,
+                                                Layout layout) {
+  return new ExistenceFilter(m, n, k, layout, false);
 }
 
 ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
                                                 uint32 estimated_insertions) {
+  return CreateOptimal(size_in_bytes, estimated_insertions, CLASSIC_LAYOUT);
+}
+
+ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
+                                                uint32 estimated_insertions,
+                                                Layout layout) {
   CHECK_LT(size_in_bytes, (1 << 29))
                              << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
+  if (layout == BLOCKED_LAYOUT) {
+    const size_t block_bytes = kCacheBlockBits / 8;
+    size_in_bytes = (size_in_bytes + block_bytes - 1) / block_bytes *
+        block_bytes;
+  }
   const uint32 m = size_in_bytes * 8;
   const uint32 n = estimated_insertions;
 
@@ -195,7 +247,8 @@ ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k);
+  ExistenceFilter *filter =
+      new ExistenceFilter(m, n, optimal_k, layout, true);
   CHECK(filter);
   return filter;
 }
@@ -221,6 +274,15 @@ inline void ExistenceFilter::BlockBitmap::Set(uint32 index) {
   block_[bindex][windex] |= (static_cast<uint32>(1) << bitpos);
 }
 
+inline const uint32 *ExistenceFilter::BlockBitmap::GetWords(
+    uint32 index) const {
+  return &block_[index >> kBlockShift][(index & kBlockMask) >> 5];
+}
+
+inline uint32 *ExistenceFilter::BlockBitmap::GetMutableWords(uint32 index) {
+  return &block_[index >> kBlockShift][(index & kBlockMask) >> 5];
+}
+
 bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
                                                       char ***ptr,
                                                       size_t *size) {
@@ -236,7 +298,29 @@ bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
   return true;
 }
 
+inline uint32 ExistenceFilter::GetCacheBlockOffset(uint64 hash) const {
+  // Maps the upper 32 bits of |hash| to [0, num_blocks) by multiply-shift,
+  // which is cheaper than modulo.
+  const uint64 num_blocks = vec_size_ / kCacheBlockBits;
+  return static_cast<uint32>(((hash >> 32) * num_blocks) >> 32) *
+      kCacheBlockBits;
+}
+
 bool ExistenceFilter::Exists(uint64 hash) const {
+  if (layout_ == BLOCKED_LAYOUT) {
+    // All the probes hit the same cache line. Checking bits one by one with
+    // early exit is faster than building a 512-bit mask and comparing it
+    // with SIMD instructions, as most of the lookups are negative.
+    const uint32 *block = rep_->GetWords(GetCacheBlockOffset(hash));
+    const uint64 bits = hash * kCacheBlockMixer;
+    for (int i = 0; i < num_hashes_; ++i) {
+      const uint32 pos = GetCacheBlockBitPos(bits, i);
+      if (!((block[pos >> 5] >> (pos & 31)) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -248,6 +332,15 @@ bool ExistenceFilter::Exists(uint64 hash) const {
 }
 
 void ExistenceFilter::Insert(uint64 hash) {
+  if (layout_ == BLOCKED_LAYOUT) {
+    uint32 *block = rep_->GetMutableWords(GetCacheBlockOffset(hash));
+    const uint64 bits = hash * kCacheBlockMixer;
+    for (int i = 0; i < num_hashes_; ++i) {
+      const uint32 pos = GetCacheBlockBitPos(bits, i);
+      block[pos >> 5] |= (static_cast<uint32>(1) << (pos & 31));
+    }
+    return;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -276,7 +369,7 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
 // allocate 'buf' and write filter to the buf.
 // 'size' will hold the size of buf
 void ExistenceFilter::Write(char **buf, size_t *size) {
-  const int require_bytes = sizeof(Header) + Size();
+  const int require_bytes = kSerializedHeaderBytes + Size();
 
   *buf = new char[require_bytes];
   CHECK(*buf);
@@ -289,10 +382,13 @@ void ExistenceFilter::Write(char **buf, size_t *size) {
   buf_ptr += sizeof(vec_size_);
   memcpy(buf_ptr, &expected_nelts_, sizeof(expected_nelts_));
   buf_ptr += sizeof(expected_nelts_);
-  memcpy(buf_ptr, &num_hashes_, sizeof(num_hashes_));
-  buf_ptr += sizeof(num_hashes_);
+  const int32 num_hashes_and_layout =
+      num_hashes_ | (static_cast<int32>(layout_) << kLayoutShift);
+  memcpy(buf_ptr, &num_hashes_and_layout, sizeof(num_hashes_and_layout));
+  buf_ptr += sizeof(num_hashes_and_layout);
   LOG(INFO) << "Write header : vec_size" << vec_size_ << " expected_nelts "
-            << expected_nelts_ << " num_hashes " << num_hashes_;
+            << expected_nelts_ << " num_hashes " << num_hashes_
+            << " layout " << layout_;
 
   // write bitmap
   char **fragment_ptr = NULL;
@@ -314,19 +410,36 @@ bool ExistenceFilter::ReadHeader(const char *buf, Header* header) {
   buf += sizeof(header->m);
   memcpy(&(header->n), buf, sizeof(header->n));
   buf += sizeof(header->n);
-  memcpy(&(header->k), buf, sizeof(header->k));
-  buf += sizeof(header->k);
+  int32 num_hashes_and_layout = 0;
+  memcpy(&num_hashes_and_layout, buf, sizeof(num_hashes_and_layout));
+  buf += sizeof(num_hashes_and_layout);
+  header->k = num_hashes_and_layout & kNumHashesMask;
   if (header->k >= 8 || header->k <= 0) {
     LOG(ERROR) << "Bad number of hashes (header->k)";
     return false;
   }
+  const int32 layout = num_hashes_and_layout >> kLayoutShift;
+  switch (layout) {
+    case CLASSIC_LAYOUT:
+      header->layout = CLASSIC_LAYOUT;
+      break;
+    case BLOCKED_LAYOUT:
+      header->layout = BLOCKED_LAYOUT;
+      if (header->m == 0 || header->m % kCacheBlockBits != 0) {
+        LOG(ERROR) << "Bad size of blocked filter (header->m)";
+        return false;
+      }
+      break;
+    default:
+      LOG(ERROR) << "Unknown layout: " << layout;
+      return false;
+  }
   return true;
 }
 
 ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   Header header;
-  const uint32 header_bytes =
-      sizeof(header.m) + sizeof(header.n) + sizeof(header.k);
+  const uint32 header_bytes = kSerializedHeaderBytes;
   if (size < header_bytes) {
     LOG(ERROR) << "Not enough bufsize: could not read header";
     return NULL;
@@ -342,7 +455,7 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   const uint32 filter_bytes = filter_size * sizeof(uint32);
   VLOG(1) << "Reading bloom filter with size: " << filter_bytes << " bytes, "
           << "estimated insertions: " << header.n << " (k: " << header.k
-          << ")";
+          << ", layout: " << header.layout << ")";
 
 
   if (size < header_bytes + filter_bytes) {
@@ -353,7 +466,8 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   ExistenceFilter* filter =
       ExistenceFilter::CreateImmutableExietenceFilter(header.m,
                                                       header.n,
-                                                      header.k);
+                                                      header.k,
+                                                      header.layout);
   char **ptr = NULL;
   size_t n = 0;
   size_t read = 0;
@@ -27,34 +27,88 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// Benchmarks the classic and the cache-line-blocked layouts of
+// ExistenceFilter at equal size, reporting probes/sec and the false positive
+// rate of each layout.
+
+#include <iostream>
+#include <memory>
 #include <string>
 
 #include "base/flags.h"
+#include "base/hash.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "storage/existence_filter.h"
 
+DEFINE_int32(num_entries, 500000, "number of inserted entries");
+DEFINE_int32(num_probes, 5000000, "number of lookups for the benchmark");
+DEFINE_double(error_rate, 0.00001, "target false positive rate");
+
+using mozc::Hash;
+using mozc::Stopwatch;
 using mozc::storage::ExistenceFilter;
 
-int main(int argc, char **argv) {
-  mozc::InitMozc(argv[0], &argc, &argv, false);
+namespace {
+
+void RunBenchmark(ExistenceFilter::Layout layout, size_t num_bytes) {
+  const uint32 n = FLAGS_num_entries;
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(num_bytes, n, layout));
+  for (uint32 i = 0; i < n; ++i) {
+    filter->Insert(Hash::Fingerprint(i * 2));
+  }
+  for (uint32 i = 0; i < n; ++i) {
+    CHECK(filter->Exists(Hash::Fingerprint(i * 2)));
+  }
+
+  // Hash values are precomputed so that only the probes are measured.
+  // Even values are inserted and odd values are not.
+  const uint32 kNumHashes = 1 << 16;
+  std::unique_ptr<uint64[]> hashes(new uint64[kNumHashes]);
+  for (uint32 i = 0; i < kNumHashes; ++i) {
+    hashes[i] = Hash::Fingerprint(i % 2 == 0 ? i : n * 2 + i);
+  }
 
-  int n = 500;
-  int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, n);
-  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n);
-  for (int i = 0; i < n; ++i) {
-    uint64 val = i * 2;
-    filter->Insert(val);
+  int found = 0;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < FLAGS_num_probes; ++i) {
+    found += filter->Exists(hashes[i & (kNumHashes - 1)]);
   }
+  stopwatch.Stop();
+  const double elapsed_sec = stopwatch.GetElapsedMicroseconds() / 1e6;
 
-  for (int i = 0; i < 2 * n; ++i) {
-    uint64 val = i;
-    if ((i % 2) == 0) {
-      CHECK(filter->Exists(val));
+  int false_positives = 0;
+  const uint32 kNumNegatives = 10 * n;
+  for (uint32 i = 0; i < kNumNegatives; ++i) {
+    if (filter->Exists(Hash::Fingerprint(i * 2 + 1))) {
+      ++false_positives;
     }
   }
 
+  std::cout << (layout == ExistenceFilter::BLOCKED_LAYOUT ? "blocked"
+                                                          : "classic")
+            << "\tbytes: " << filter->Size()
+            << "\tprobes/sec: " << FLAGS_num_probes / elapsed_sec
+            << "\tfalse positive rate: "
+            << static_cast<double>(false_positives) / kNumNegatives
+            << "\t(found: " << found << ")" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  const size_t num_bytes = ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+      FLAGS_error_rate, FLAGS_num_entries);
+  std::cout << "entries: " << FLAGS_num_entries
+            << "\terror rate: " << FLAGS_error_rate << std::endl;
+  RunBenchmark(ExistenceFilter::CLASSIC_LAYOUT, num_bytes);
+  RunBenchmark(ExistenceFilter::BLOCKED_LAYOUT, num_bytes);
+
   return 0;
 }
@@ -29,6 +29,7 @@
 
 #include "storage/existence_filter.h"
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -43,7 +44,7 @@ namespace mozc {
 namespace storage {
 namespace {
 
-void CheckValues(ExistenceFilter* filter, int m, int n) {
+int CheckValues(ExistenceFilter* filter, int m, int n) {
   int false_positives = 0;
   for (int i = 0; i < 2 * n; ++i) {
     uint64 hash = Hash::Fingerprint(i);
@@ -59,11 +60,13 @@ void CheckValues(ExistenceFilter* filter, int m, int n) {
   }
 
   LOG(INFO) << "false_positives: " << false_positives;
+  return false_positives;
 }
 
-void RunTest(int m, int n) {
-  LOG(INFO) << "Test " << m << " " << n;
-  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n);
+void RunTest(int m, int n, ExistenceFilter::Layout layout) {
+  LOG(INFO) << "Test " << m << " " << n << " " << layout;
+  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n, layout);
+  EXPECT_EQ(layout, filter->layout());
 
   for (int i = 0; i < n; ++i) {
     int val = i * 2;
@@ -78,6 +81,8 @@ void RunTest(int m, int n) {
   filter->Write(&buf, &size);
   LOG(INFO) << "write size: " << size;
   ExistenceFilter *filter2 = ExistenceFilter::Read(buf, size);
+  ASSERT_NE(nullptr, filter2);
+  EXPECT_EQ(layout, filter2->layout());
   CheckValues(filter2, m, n);
   delete filter2;
   delete[] buf;
@@ -90,7 +95,103 @@ void RunTest(int m, int n) {
 TEST(ExistenceFilterTest, RunTest) {
   int n = 50000;
   int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
-  RunTest(m, n);
+  RunTest(m, n, ExistenceFilter::CLASSIC_LAYOUT);
+  RunTest(m, n, ExistenceFilter::BLOCKED_LAYOUT);
+}
+
+TEST(ExistenceFilterTest, BlockedLayoutFalsePositiveRate) {
+  const int n = 50000;
+  const int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, n);
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(m, n, ExistenceFilter::BLOCKED_LAYOUT));
+  EXPECT_EQ(0, filter->Size() % 64);
+  for (int i = 0; i < n; ++i) {
+    filter->Insert(Hash::Fingerprint(i * 2));
+  }
+  // Blocked filter is slightly worse than the classic one, but should stay
+  // in the same order as the requested error rate.
+  const int false_positives = CheckValues(filter.get(), m, n);
+  EXPECT_LT(false_positives, n * 0.02);
+}
+
+TEST(ExistenceFilterTest, ClassicLayoutHeaderIsCompatible) {
+  // The header of classic filter must be the same as the one written before
+  // the layout was introduced: {m, n, k}.
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(1024, 100));
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  ASSERT_GE(size, 12);
+  uint32 m = 0, n = 0;
+  int32 k = 0;
+  memcpy(&m, buf, 4);
+  memcpy(&n, buf + 4, 4);
+  memcpy(&k, buf + 8, 4);
+  EXPECT_EQ(1024 * 8, m);
+  EXPECT_EQ(100, n);
+  EXPECT_LT(0, k);
+  EXPECT_GT(8, k);
+
+  ExistenceFilter::Header header;
+  EXPECT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(ExistenceFilter::CLASSIC_LAYOUT, header.layout);
+  EXPECT_EQ(k, header.k);
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, ClassicLayoutImageIsCompatible) {
+  // The image written by the encoder before the layout was introduced, for
+  // CreateOptimal(64, 5) with the words below.
+  const uint8 kExpectedImage[] = {
+    0x00, 0x02, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x08, 0x00, 0x80, 0x80, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28,
+    0x00, 0x00, 0x00, 0x12, 0x80, 0x08, 0x00, 0x00, 0x01, 0x00, 0x00, 0x10,
+    0x10, 0x01, 0x00, 0x00, 0x08, 0x00, 0x04, 0x00, 0x80, 0x00, 0x01, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x04, 0x01, 0x01, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00,
+    0x30, 0x00, 0x00, 0x10,
+  };
+  const char *kWords[] = {"a", "b", "c", "mozc", "existence"};
+
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(64, arraysize(kWords)));
+  for (size_t i = 0; i < arraysize(kWords); ++i) {
+    filter->Insert(Hash::Fingerprint(kWords[i]));
+  }
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  ASSERT_EQ(sizeof(kExpectedImage), size);
+  EXPECT_EQ(0, memcmp(kExpectedImage, buf, size));
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, ReadHeaderRejectsBrokenLayout) {
+  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(
+      1024, 100, ExistenceFilter::BLOCKED_LAYOUT));
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+
+  ExistenceFilter::Header header;
+  EXPECT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(ExistenceFilter::BLOCKED_LAYOUT, header.layout);
+
+  // Unknown layout.
+  int32 k = 0;
+  memcpy(&k, buf + 8, 4);
+  const int32 unknown_layout = (k & 0xff) | (0x7f << 8);
+  memcpy(buf + 8, &unknown_layout, 4);
+  EXPECT_FALSE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(nullptr, ExistenceFilter::Read(buf, size));
+
+  // Blocked layout whose size is not a multiple of 64 bytes.
+  memcpy(buf + 8, &k, 4);
+  const uint32 bad_m = 1000;
+  memcpy(buf, &bad_m, 4);
+  EXPECT_FALSE(ExistenceFilter::ReadHeader(buf, &header));
+  delete [] buf;
 }
 
 TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
@@ -135,6 +236,39 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   delete [] buf;
 }
 
+TEST(ExistenceFilterTest, BlockedLayoutReadWriteTest) {
+  vector<string> words;
+  words.push_back("a");
+  words.push_back("b");
+  words.push_back("c");
+
+  static const float kErrorRate = 0.0001;
+  int num_bytes =
+      ExistenceFilter::MinFilterSizeInBytesForErrorRate(kErrorRate,
+                                                        words.size());
+
+  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(
+      num_bytes, words.size(), ExistenceFilter::BLOCKED_LAYOUT));
+
+  for (int i = 0; i < words.size(); ++i) {
+    filter->Insert(Hash::Fingerprint(words[i]));
+  }
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  std::unique_ptr<ExistenceFilter> filter_read(
+      ExistenceFilter::Read(buf, size));
+  ASSERT_NE(nullptr, filter_read.get());
+  EXPECT_EQ(ExistenceFilter::BLOCKED_LAYOUT, filter_read->layout());
+
+  for (int i = 0; i < words.size(); ++i) {
+    EXPECT_TRUE(filter_read->Exists(Hash::Fingerprint(words[i])));
+  }
+
+  delete [] buf;
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   vector<string> words;
   words.push_back("a");
@@ -0,0 +1,248 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/journal.h"
+
+#include <cstring>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+const uint32 kJournalMagic = 0x4a5a434d;  // "MCZJ"
+const uint32 kJournalVersion = 1;
+
+// |magic(uint32)|version(uint32)|generation(uint64)|
+const size_t kHeaderSize = 16;
+// |size(uint32)|checksum(uint32)|
+const size_t kRecordHeaderSize = 8;
+
+// A record larger than this is considered broken.
+const uint32 kMaxRecordSize = 16 * 1024 * 1024;
+
+uint32 Checksum(const char *data, size_t size) {
+  return Hash::Fingerprint32WithVersion(StringPiece(data, size),
+                                        Hash::FINGERPRINT_FAST);
+}
+
+void AppendUint32(uint32 value, string *output) {
+  output->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void AppendRecord(const string &record, string *output) {
+  AppendUint32(static_cast<uint32>(record.size()), output);
+  AppendUint32(Checksum(record.data(), record.size()), output);
+  output->append(record);
+}
+
+uint32 ReadUint32(const char *ptr) {
+  uint32 value = 0;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+Journal::Journal() : generation_(0), size_(0), broken_(false) {}
+
+Journal::~Journal() {}
+
+bool Journal::Open(const string &filename, uint64 generation,
+                   vector<string> *records) {
+  DCHECK(records);
+  records->clear();
+  filename_ = filename;
+  generation_ = generation;
+  size_ = 0;
+  broken_ = false;
+  if (!FileUtil::FileExists(filename_)) {
+    return true;
+  }
+
+  size_t valid_size = 0;
+  size_t file_size = 0;
+  {
+    Mmap mmap;
+    if (!mmap.Open(filename_.c_str(), "r")) {
+      // Mmap fails on an empty file, which is a journal without a header.
+      LOG(WARNING) << "cannot open journal: " << filename_;
+      return Rewrite(*records);
+    }
+    const char *begin = mmap.begin();
+    file_size = mmap.size();
+    if (file_size < kHeaderSize ||
+        ReadUint32(begin) != kJournalMagic ||
+        ReadUint32(begin + 4) != kJournalVersion) {
+      LOG(WARNING) << "broken journal header: " << filename_;
+      return Rewrite(*records);
+    }
+    uint64 journal_generation = 0;
+    memcpy(&journal_generation, begin + 8, sizeof(journal_generation));
+    if (journal_generation != generation_) {
+      // The records are for an older snapshot, which have been merged into
+      // the current one.
+      VLOG(1) << "stale journal: " << filename_;
+      return Rewrite(*records);
+    }
+
+    valid_size = kHeaderSize;
+    while (valid_size + kRecordHeaderSize <= file_size) {
+      const char *ptr = begin + valid_size;
+      const uint32 record_size = ReadUint32(ptr);
+      if (record_size > kMaxRecordSize ||
+          valid_size + kRecordHeaderSize + record_size > file_size) {
+        break;
+      }
+      const char *payload = ptr + kRecordHeaderSize;
+      if (Checksum(payload, record_size) != ReadUint32(ptr + 4)) {
+        break;
+      }
+      records->push_back(string(payload, record_size));
+      valid_size += kRecordHeaderSize + record_size;
+    }
+  }
+
+  if (valid_size != file_size) {
+    LOG(WARNING) << "dropping " << (file_size - valid_size)
+                 << " broken bytes of the journal: " << filename_;
+    return Rewrite(*records);
+  }
+  size_ = file_size;
+  return true;
+}
+
+bool Journal::Append(const vector<string> &records) {
+  DCHECK(!filename_.empty());
+  if (records.empty()) {
+    return true;
+  }
+  if (broken_) {
+    return false;
+  }
+  if (size_ == 0) {
+    return Rewrite(records);
+  }
+
+  string output;
+  for (size_t i = 0; i < records.size(); ++i) {
+    AppendRecord(records[i], &output);
+  }
+  OutputFileStream ofs(filename_.c_str(),
+                       ios::out | ios::binary | ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open journal: " << filename_;
+    return false;
+  }
+  ofs.write(output.data(), output.size());
+  ofs.close();
+  if (ofs.fail()) {
+    LOG(ERROR) << "cannot write journal: " << filename_;
+    // The tail may be torn, which would hide the records appended next.
+    if (!Truncate()) {
+      LOG(ERROR) << "cannot remove the torn tail of the journal: "
+                 << filename_;
+      broken_ = true;
+    }
+    return false;
+  }
+  size_ += output.size();
+  return true;
+}
+
+bool Journal::Reset(uint64 generation) {
+  generation_ = generation;
+  broken_ = false;
+  return Rewrite(vector<string>());
+}
+
+bool Journal::Rewrite(const vector<string> &records) {
+  DCHECK(!filename_.empty());
+  string output;
+  AppendUint32(kJournalMagic, &output);
+  AppendUint32(kJournalVersion, &output);
+  output.append(reinterpret_cast<const char *>(&generation_),
+                sizeof(generation_));
+  DCHECK_EQ(kHeaderSize, output.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    AppendRecord(records[i], &output);
+  }
+  return WriteFile(output);
+}
+
+bool Journal::Truncate() {
+  DCHECK_LE(kHeaderSize, size_);
+  string output(size_, '\0');
+  {
+    InputFileStream ifs(filename_.c_str(), ios::in | ios::binary);
+    if (!ifs.read(&output[0], output.size())) {
+      LOG(ERROR) << "cannot read journal: " << filename_;
+      return false;
+    }
+  }
+  return WriteFile(output);
+}
+
+bool Journal::WriteFile(const string &output) {
+  const string tmp_filename = filename_ + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         ios::out | ios::binary | ios::trunc);
+    if (!ofs) {
+      LOG(ERROR) << "cannot open journal: " << tmp_filename;
+      size_ = 0;
+      return false;
+    }
+    ofs.write(output.data(), output.size());
+    ofs.close();
+    if (ofs.fail()) {
+      // Don't replace the journal with a partial one.
+      LOG(ERROR) << "cannot write journal: " << tmp_filename;
+      FileUtil::Unlink(tmp_filename);
+      size_ = 0;
+      return false;
+    }
+  }
+  if (!FileUtil::AtomicRename(tmp_filename, filename_)) {
+    LOG(ERROR) << "AtomicRename failed";
+    size_ = 0;
+    return false;
+  }
+  size_ = output.size();
+  return true;
+}
+
+}  // namespace storage
+}  // namespace mozc
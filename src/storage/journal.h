@@ -0,0 +1,109 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Journal is an append-only log of small records kept next to a snapshot
+// file.  Instead of rewriting the whole snapshot on every sync, a store
+// appends the changes since the last sync to the journal and rewrites the
+// snapshot only once in a while (compaction).
+//
+// The journal starts with a header holding the generation of the snapshot
+// which the records apply to.  A store bumps the generation whenever it
+// writes a new snapshot, so the records of the previous snapshot are ignored
+// even when the process dies before the journal is reset.
+//
+// Each record is framed as |size(uint32)|checksum(uint32)|payload|.  A torn
+// or corrupted record, e.g. after a crash in the middle of Append(), ends the
+// journal; it and the following bytes are dropped when the journal is opened.
+// Since the records appended after a torn one would be dropped too, a failed
+// Append() cuts the file back to its previous size.
+
+#ifndef MOZC_STORAGE_JOURNAL_H_
+#define MOZC_STORAGE_JOURNAL_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace storage {
+
+class Journal {
+ public:
+  Journal();
+  ~Journal();
+
+  // Binds the journal to |filename| and reads the records written for the
+  // snapshot of |generation| into |records|.  Returns true if the file does
+  // not exist or belongs to another generation, with no record.  Returns
+  // false only when the file cannot be read.
+  bool Open(const string &filename, uint64 generation,
+            vector<string> *records);
+
+  // Appends |records| to the file.  On failure, the file is cut back to the
+  // records appended before.  If even that fails, this and the following
+  // calls return false until Reset(), so the caller has to write a snapshot
+  // instead.
+  bool Append(const vector<string> &records);
+
+  // Discards all the records and starts the journal for a new snapshot of
+  // |generation|.
+  bool Reset(uint64 generation);
+
+  const string &filename() const { return filename_; }
+  uint64 generation() const { return generation_; }
+
+  // The size of the file in bytes, including the header.
+  size_t size() const { return size_; }
+
+ private:
+  // Rewrites the file with the header and |records|.
+  bool Rewrite(const vector<string> &records);
+
+  // Cuts the file back to |size_| bytes.
+  bool Truncate();
+
+  // Replaces the file with |output| through a temporary file, and updates
+  // |size_|.
+  bool WriteFile(const string &output);
+
+  string filename_;
+  uint64 generation_;
+  size_t size_;
+  // True if the file may end with a torn record which could not be removed.
+  bool broken_;
+
+  DISALLOW_COPY_AND_ASSIGN(Journal);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_JOURNAL_H_
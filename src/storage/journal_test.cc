@@ -0,0 +1,239 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/journal.h"
+
+#ifndef OS_WIN
+#include <signal.h>
+#include <sys/resource.h>
+#endif  // OS_WIN
+
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/port.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+class JournalTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    filename_ = FileUtil::JoinPath(FLAGS_test_tmpdir, "JournalTest.journal");
+    if (FileUtil::FileExists(filename_)) {
+      FileUtil::Unlink(filename_);
+    }
+  }
+
+  virtual void TearDown() {
+    if (FileUtil::FileExists(filename_)) {
+      FileUtil::Unlink(filename_);
+    }
+  }
+
+  void AppendBytes(const string &bytes) {
+    OutputFileStream ofs(filename_.c_str(),
+                         ios::out | ios::binary | ios::app);
+    ofs.write(bytes.data(), bytes.size());
+  }
+
+  string filename_;
+};
+
+TEST_F(JournalTest, AppendAndOpen) {
+  vector<string> records;
+  {
+    Journal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    EXPECT_TRUE(records.empty());
+    EXPECT_EQ(0, journal.size());
+
+    records.push_back("first");
+    records.push_back("");
+    EXPECT_TRUE(journal.Append(records));
+    records.clear();
+    records.push_back(string("th\0rd", 5));
+    EXPECT_TRUE(journal.Append(records));
+    EXPECT_LT(0, journal.size());
+  }
+
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("first", records[0]);
+  EXPECT_EQ("", records[1]);
+  EXPECT_EQ(string("th\0rd", 5), records[2]);
+}
+
+TEST_F(JournalTest, OtherGenerationIsDiscarded) {
+  vector<string> records;
+  {
+    Journal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    records.push_back("record");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 2, &records));
+  EXPECT_TRUE(records.empty());
+  EXPECT_EQ(2, journal.generation());
+
+  // Reset() also discards the records.
+  records.push_back("record");
+  EXPECT_TRUE(journal.Append(records));
+  EXPECT_TRUE(journal.Reset(3));
+  Journal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 3, &records));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(JournalTest, BrokenTailIsDropped) {
+  vector<string> records;
+  size_t valid_size = 0;
+  {
+    Journal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    records.push_back("first");
+    records.push_back("second");
+    EXPECT_TRUE(journal.Append(records));
+    valid_size = journal.size();
+  }
+  // A torn record header.
+  AppendBytes("\x05\x00");
+
+  {
+    Journal journal;
+    EXPECT_TRUE(journal.Open(filename_, 1, &records));
+    ASSERT_EQ(2, records.size());
+    EXPECT_EQ(valid_size, journal.size());
+
+    // Appending after the broken tail works.
+    records.assign(1, "third");
+    EXPECT_TRUE(journal.Append(records));
+  }
+
+  // A record with a wrong checksum ends the journal.
+  AppendBytes(string("\x03\x00\x00\x00\x00\x00\x00\x00" "bad", 11));
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("first", records[0]);
+  EXPECT_EQ("second", records[1]);
+  EXPECT_EQ("third", records[2]);
+}
+
+#ifndef OS_WIN
+TEST_F(JournalTest, FailedAppendIsRemoved) {
+  vector<string> records;
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  records.push_back("first");
+  EXPECT_TRUE(journal.Append(records));
+  const size_t valid_size = journal.size();
+
+  // Limit the file size so that only a part of the next record is written,
+  // as when the disk is full.
+  struct rlimit original_limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &original_limit));
+  struct rlimit limit = original_limit;
+  limit.rlim_cur = valid_size + 4;
+  void (*original_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+  records.assign(1, "second");
+  const bool appended = journal.Append(records);
+  EXPECT_EQ(0, setrlimit(RLIMIT_FSIZE, &original_limit));
+  signal(SIGXFSZ, original_handler);
+  EXPECT_FALSE(appended);
+  EXPECT_EQ(valid_size, journal.size());
+
+  // The record appended next is not hidden by the failed one.
+  records.assign(1, "third");
+  EXPECT_TRUE(journal.Append(records));
+
+  Journal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 1, &records));
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ("first", records[0]);
+  EXPECT_EQ("third", records[1]);
+  EXPECT_EQ(journal.size(), journal2.size());
+}
+
+TEST_F(JournalTest, FailedResetKeepsJournal) {
+  vector<string> records;
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  records.push_back("first");
+  EXPECT_TRUE(journal.Append(records));
+
+  // The new journal cannot be written completely.
+  struct rlimit original_limit;
+  ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &original_limit));
+  struct rlimit limit = original_limit;
+  limit.rlim_cur = 4;
+  void (*original_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+  const bool reset = journal.Reset(2);
+  EXPECT_EQ(0, setrlimit(RLIMIT_FSIZE, &original_limit));
+  signal(SIGXFSZ, original_handler);
+  EXPECT_FALSE(reset);
+  EXPECT_EQ(0, journal.size());
+  EXPECT_FALSE(FileUtil::FileExists(filename_ + ".tmp"));
+
+  Journal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 1, &records));
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("first", records[0]);
+}
+#endif  // OS_WIN
+
+TEST_F(JournalTest, BrokenHeader) {
+  AppendBytes("broken");
+  vector<string> records;
+  Journal journal;
+  EXPECT_TRUE(journal.Open(filename_, 1, &records));
+  EXPECT_TRUE(records.empty());
+  records.push_back("record");
+  EXPECT_TRUE(journal.Append(records));
+
+  Journal journal2;
+  EXPECT_TRUE(journal2.Open(filename_, 1, &records));
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("record", records[0]);
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
@@ -29,11 +29,17 @@
 
 #include "storage/louds/louds.h"
 
+#include "base/logging.h"
+
 namespace mozc {
 namespace storage {
 namespace louds {
 
-Louds::Louds() : select0_cache_size_(0), select1_cache_size_(0) {}
+Louds::Louds()
+    : select0_cache_size_(0),
+      select1_cache_size_(0),
+      select0_cache_ptr_(nullptr),
+      select1_cache_ptr_(nullptr) {}
 
 Louds::~Louds() {}
 
@@ -58,34 +64,102 @@ void Louds::Init(const uint8 *image, int length,
   select0_cache_size_ = select0_cache_size;
   select1_cache_size_ = select1_cache_size;
   const size_t cache_size = select0_cache_size + select1_cache_size;
+  select_cache_.reset();
+  select0_cache_ptr_ = nullptr;
+  select1_cache_ptr_ = nullptr;
   if (cache_size == 0) {
     return;
   }
   select_cache_.reset(new int[cache_size]);
+  select0_cache_ptr_ = select_cache_.get();
+  select1_cache_ptr_ = select_cache_.get() + select0_cache_size;
 
   if (select0_cache_size > 0) {
     // Precompute Select0(i) + 1 for i in (0, select0_cache_size).
-    select_cache_[0] = 0;
+    int *select0_cache = select_cache_.get();
+    select0_cache[0] = 0;
     for (size_t i = 1; i < select0_cache_size; ++i) {
-      select_cache_[i] = index_.Select0(i) + 1;
+      select0_cache[i] = index_.Select0(i) + 1;
     }
   }
 
   if (select1_cache_size > 0) {
     // Precompute Select1(i) for i in (0, select1_cache_size).
-    select1_cache_ptr_ = select_cache_.get() + select0_cache_size;
-    select1_cache_ptr_[0] = 0;
+    int *select1_cache = select_cache_.get() + select0_cache_size;
+    select1_cache[0] = 0;
     for (size_t i = 1; i < select1_cache_size; ++i) {
-      select1_cache_ptr_[i] = index_.Select1(i);
+      select1_cache[i] = index_.Select1(i);
     }
   }
 }
 
+bool Louds::InitWithIndexImage(const uint8 *image, int length,
+                               StringPiece *index_image) {
+  Reset();
+  if (!index_.InitWithIndexImage(image, length, index_image)) {
+    return false;
+  }
+
+  // The image of the select caches: select0 cache size, select1 cache size,
+  // followed by the caches.
+  if (index_image->size() < 2 * sizeof(int)) {
+    LOG(ERROR) << "Broken index image: no select cache";
+    Reset();
+    return false;
+  }
+  const int *header = reinterpret_cast<const int *>(index_image->data());
+  const int select0_cache_size = header[0];
+  const int select1_cache_size = header[1];
+  if (select0_cache_size < 0 || select0_cache_size > index_.GetNum0Bits() ||
+      select1_cache_size < 0 || select1_cache_size > index_.GetNum1Bits() ||
+      index_image->size() <
+          (2 + select0_cache_size + select1_cache_size) * sizeof(int)) {
+    LOG(ERROR) << "Broken index image: invalid select cache size";
+    Reset();
+    return false;
+  }
+  const int *caches = header + 2;
+  for (int i = 0; i < select0_cache_size + select1_cache_size; ++i) {
+    if (caches[i] < 0 || caches[i] > 8 * length) {
+      LOG(ERROR) << "Broken index image: invalid select cache";
+      Reset();
+      return false;
+    }
+  }
+
+  select0_cache_size_ = select0_cache_size;
+  select1_cache_size_ = select1_cache_size;
+  select0_cache_ptr_ = caches;
+  select1_cache_ptr_ = caches + select0_cache_size;
+  index_image->remove_prefix(
+      (2 + select0_cache_size + select1_cache_size) * sizeof(int));
+  return true;
+}
+
+void Louds::SerializeIndex(string *output) const {
+  index_.SerializeIndex(output);
+  const int header[2] = {
+    static_cast<int>(select0_cache_size_),
+    static_cast<int>(select1_cache_size_),
+  };
+  output->append(reinterpret_cast<const char *>(header), sizeof(header));
+  if (select0_cache_size_ > 0) {
+    output->append(reinterpret_cast<const char *>(select0_cache_ptr_),
+                   select0_cache_size_ * sizeof(int));
+  }
+  if (select1_cache_size_ > 0) {
+    output->append(reinterpret_cast<const char *>(select1_cache_ptr_),
+                   select1_cache_size_ * sizeof(int));
+  }
+}
+
 void Louds::Reset() {
   index_.Reset();
   select_cache_.reset();
   select0_cache_size_ = 0;
   select1_cache_size_ = 0;
+  select0_cache_ptr_ = nullptr;
+  select1_cache_ptr_ = nullptr;
 }
 
 }  // namespace louds
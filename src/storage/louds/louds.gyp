@@ -67,6 +67,17 @@
         'bit_stream',
       ],
     },
+    {
+      'target_name': 'streaming_louds_trie_builder',
+      'type': 'static_library',
+      'toolsets': ['target', 'host'],
+      'sources': [
+        'streaming_louds_trie_builder.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+      ],
+    },
     # Implementation of an array of string based on bit vector.
     {
       'target_name': 'bit_vector_based_array',
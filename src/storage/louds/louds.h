@@ -31,8 +31,10 @@
 #define MOZC_STORAGE_LOUDS_LOUDS_H_
 
 #include <memory>
+#include <string>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
 namespace mozc {
@@ -106,6 +108,16 @@ class Louds {
     Init(image, length, 0, 0, 0, 0);
   }
 
+  // Initializes this LOUDS from bit array and the image of the index and the
+  // caches created by SerializeIndex(), instead of building them on the heap.
+  // The image is consumed from the beginning of |index_image| and is not
+  // copied; see SimpleSuccinctBitVectorIndex::InitWithIndexImage().
+  bool InitWithIndexImage(const uint8 *image, int length,
+                          StringPiece *index_image);
+
+  // Appends the image of the index and the caches to |output|.
+  void SerializeIndex(string *output) const;
+
   // Explicitly clears the internal bit array.
   void Reset();
 
@@ -134,7 +146,7 @@ class Louds {
   // REQUIRES: |node| is valid.
   void MoveToFirstChild(Node *node) const {
     node->edge_index_ = node->node_id_ < select0_cache_size_
-                            ? select_cache_[node->node_id_]
+                            ? select0_cache_ptr_[node->node_id_]
                             : index_.Select0(node->node_id_) + 1;
     node->node_id_ = node->edge_index_ - node->node_id_ + 1;
   }
@@ -173,8 +185,11 @@ class Louds {
   SimpleSuccinctBitVectorIndex index_;
   size_t select0_cache_size_;
   size_t select1_cache_size_;
+  // The caches point to either |select_cache_| built by Init() or the image
+  // given to InitWithIndexImage().
   std::unique_ptr<int[]> select_cache_;
-  int* select1_cache_ptr_;  // = select_cache_.get() + select0_cache_size_
+  const int *select0_cache_ptr_;
+  const int *select1_cache_ptr_;
 
   DISALLOW_COPY_AND_ASSIGN(Louds);
 };
@@ -58,6 +58,23 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'streaming_louds_trie_builder_test',
+      'type': 'executable',
+      'sources': [
+        'streaming_louds_trie_builder_test.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../testing/testing.gyp:gtest_main',
+        'louds.gyp:louds_trie',
+        'louds.gyp:louds_trie_builder',
+        'louds.gyp:streaming_louds_trie_builder',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'bit_vector_based_array_test',
       'type': 'executable',
@@ -111,6 +128,7 @@
         'louds_test',
         'louds_trie_test',
         'simple_succinct_bit_vector_index_test',
+        'streaming_louds_trie_builder_test',
       ],
     },
   ],
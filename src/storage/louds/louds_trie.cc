@@ -29,6 +29,8 @@
 
 #include "storage/louds/louds_trie.h"
 
+#include <cstring>
+
 #include "base/logging.h"
 #include "base/port.h"
 #include "storage/louds/louds.h"
@@ -39,10 +41,42 @@ namespace storage {
 namespace louds {
 
 namespace {
+
+// The flag set to the num bits of the edge character if the image has the
+// tails.
+const int kTailFlag = 0x100;
+
+// The interval of the tails of which the offsets are stored.
+const int kTailSampleInterval = 16;
+
 inline int32 ReadInt32(const uint8 *data) {
   // TODO(noriyukit): static assertion for the endian.
   return *reinterpret_cast<const int32*>(data);
 }
+
+// Splits the binary image into its sections. See LoudsTrie::Open for the
+// format.
+void ParseImage(const uint8 *image,
+                const uint8 **louds_image, int *louds_size,
+                const uint8 **terminal_image, int *terminal_size,
+                const uint8 **edge_character, const uint8 **tail_image) {
+  *louds_size = ReadInt32(image);
+  *terminal_size = ReadInt32(image + 4);
+  const int num_character_bits = ReadInt32(image + 8);
+  const int edge_character_size = ReadInt32(image + 12);
+  CHECK_EQ(num_character_bits & ~kTailFlag, 8);
+  CHECK_GT(edge_character_size, 0);
+
+  *louds_image = image + 16;
+  *terminal_image = *louds_image + *louds_size;
+  *edge_character = *terminal_image + *terminal_size;
+  *tail_image = nullptr;
+  if (num_character_bits & kTailFlag) {
+    // The tail image is aligned to 32-bit boundary.
+    *tail_image = *edge_character + (edge_character_size + 3) / 4 * 4;
+  }
+}
+
 }  // namespace
 
 bool LoudsTrie::Open(const uint8 *image,
@@ -61,6 +95,14 @@ bool LoudsTrie::Open(const uint8 *image,
   // [trie image: "trie size" bytes]
   // [terminal image: "terminal size" bytes]
   // [edge character image: "edge character image size" bytes]
+  // If the trie has the tails, 0x100 is set to the num bits for each
+  // character, and the following sections are appended:
+  // [padding to 32-bit boundary]
+  // [tail bit vector size: little endian 4 byte int]
+  // [num tails: little endian 4 byte int]
+  // [tail bit vector image: "tail bit vector size" bytes]
+  // [tail offsets: little endian 4 byte int for every 16th tail]
+  // [tail image: the tails each of which is preceded by its length - 1]
   //
   // Here, "terminal" means "the node is one of the end of a word."
   // For example, if we have a trie for "aa" and "aaa", the trie looks like:
@@ -73,16 +115,10 @@ bool LoudsTrie::Open(const uint8 *image,
   //   [3]
   // In this case, [0] and [1] are not terminal (as the original words contains
   // neither "" nor "a"), and [2] and [3] are terminal.
-  const int louds_size = ReadInt32(image);
-  const int terminal_size = ReadInt32(image + 4);
-  const int num_character_bits = ReadInt32(image + 8);
-  const int edge_character_size = ReadInt32(image + 12);
-  CHECK_EQ(num_character_bits, 8);
-  CHECK_GT(edge_character_size, 0);
-
-  const uint8 *louds_image = image + 16;
-  const uint8 *terminal_image = louds_image + louds_size;
-  const uint8 *edge_character = terminal_image + terminal_size;
+  const uint8 *louds_image, *terminal_image, *edge_character, *tail_image;
+  int louds_size, terminal_size;
+  ParseImage(image, &louds_image, &louds_size, &terminal_image, &terminal_size,
+             &edge_character, &tail_image);
 
   louds_.Init(louds_image, louds_size,
               louds_lb0_cache_size, louds_lb1_cache_size,
@@ -91,14 +127,78 @@ bool LoudsTrie::Open(const uint8 *image,
                             0,  // Select0 is not carried out.
                             termvec_lb1_cache_size);
   edge_character_ = reinterpret_cast<const char*>(edge_character);
+  OpenTail(tail_image, nullptr);
 
   return true;
 }
 
+bool LoudsTrie::OpenWithIndexImage(const uint8 *image,
+                                   StringPiece *index_image) {
+  const uint8 *louds_image, *terminal_image, *edge_character, *tail_image;
+  int louds_size, terminal_size;
+  ParseImage(image, &louds_image, &louds_size, &terminal_image, &terminal_size,
+             &edge_character, &tail_image);
+
+  if (!louds_.InitWithIndexImage(louds_image, louds_size, index_image) ||
+      !terminal_bit_vector_.InitWithIndexImage(terminal_image, terminal_size,
+                                               index_image) ||
+      !OpenTail(tail_image, index_image)) {
+    Close();
+    return false;
+  }
+  edge_character_ = reinterpret_cast<const char*>(edge_character);
+  return true;
+}
+
+bool LoudsTrie::OpenTail(const uint8 *tail_image, StringPiece *index_image) {
+  has_tail_ = (tail_image != nullptr);
+  if (!has_tail_) {
+    return true;
+  }
+  const int bit_vector_size = ReadInt32(tail_image);
+  const int num_tails = ReadInt32(tail_image + 4);
+  const uint8 *bit_vector_image = tail_image + 8;
+  if (index_image == nullptr) {
+    tail_bit_vector_.Init(bit_vector_image, bit_vector_size);
+  } else if (!tail_bit_vector_.InitWithIndexImage(
+                 bit_vector_image, bit_vector_size, index_image)) {
+    return false;
+  }
+  tail_offsets_ =
+      reinterpret_cast<const uint32 *>(bit_vector_image + bit_vector_size);
+  tail_data_ = reinterpret_cast<const uint8 *>(
+      tail_offsets_ +
+      (num_tails + kTailSampleInterval - 1) / kTailSampleInterval);
+  return true;
+}
+
+void LoudsTrie::SerializeIndex(string *output) const {
+  louds_.SerializeIndex(output);
+  terminal_bit_vector_.SerializeIndex(output);
+  if (has_tail_) {
+    tail_bit_vector_.SerializeIndex(output);
+  }
+}
+
 void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  if (has_tail_) {
+    tail_bit_vector_.Reset();
+    tail_offsets_ = nullptr;
+    tail_data_ = nullptr;
+    has_tail_ = false;
+  }
+}
+
+StringPiece LoudsTrie::GetTailByIndex(int index) const {
+  // Skip the tails from the nearest one of which the offset is stored.
+  const uint8 *ptr = tail_data_ + tail_offsets_[index / kTailSampleInterval];
+  for (int i = index % kTailSampleInterval; i > 0; --i) {
+    ptr += *ptr + 2;
+  }
+  return StringPiece(reinterpret_cast<const char *>(ptr + 1), *ptr + 1);
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
@@ -113,29 +213,60 @@ bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
 }
 
 bool LoudsTrie::Traverse(StringPiece key, Node *node) const {
-  for (auto iter = key.begin(); iter != key.end(); ++iter) {
-    if (!MoveToChildByLabel(*iter, node)) {
+  for (StringPiece::size_type i = 0; i < key.size(); ) {
+    if (!MoveToChildByLabel(key[i], node)) {
       return false;
     }
+    ++i;
+    if (has_tail_ && i < key.size() && IsTerminalNode(*node)) {
+      const StringPiece tail = GetTail(GetKeyIdOfTerminalNode(*node));
+      if (!tail.empty()) {
+        // The node is a leaf.  The rest of |key| has to be in the tail.
+        return tail.starts_with(key.substr(i));
+      }
+    }
   }
   return true;
 }
 
 int LoudsTrie::ExactSearch(StringPiece key) const {
   Node node;  // Root
-  if (Traverse(key, &node) && IsTerminalNode(node)) {
+  for (StringPiece::size_type i = 0; i < key.size(); ) {
+    if (!MoveToChildByLabel(key[i], &node)) {
+      return -1;
+    }
+    ++i;
+    if (has_tail_ && IsTerminalNode(node)) {
+      const int key_id = GetKeyIdOfTerminalNode(node);
+      const StringPiece tail = GetTail(key_id);
+      if (!tail.empty()) {
+        return key.substr(i) == tail ? key_id : -1;
+      }
+    }
+  }
+  if (IsTerminalNode(node)) {
     return GetKeyIdOfTerminalNode(node);
   }
   return -1;
 }
 
-StringPiece LoudsTrie::RestoreKeyString(Node node, char *buf) const {
+StringPiece LoudsTrie::RestoreKeyString(Node node, int key_id,
+                                        char *buf) const {
   // Ensure the returned StringPiece is null-terminated.
   char *const buf_end = buf + kMaxDepth;
   *buf_end = '\0';
 
-  // Climb up the trie to the root and fill |buf| backward.
+  // Copy the tail to the end of |buf|.
   char *ptr = buf_end;
+  if (key_id >= 0) {
+    const StringPiece tail = GetTail(key_id);
+    if (!tail.empty()) {
+      ptr -= tail.size();
+      memcpy(ptr, tail.data(), tail.size());
+    }
+  }
+
+  // Climb up the trie to the root and fill |buf| backward.
   for (; !louds_.IsRoot(node); louds_.MoveToParent(&node)) {
     *--ptr = GetEdgeLabelToParentNode(node);
   }
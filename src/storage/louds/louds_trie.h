@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_LOUDS_LOUDS_TRIE_H_
 
 #include <memory>
+#include <string>
 
 #include "base/port.h"
 #include "base/string_piece.h"
@@ -41,6 +42,11 @@ namespace mozc {
 namespace storage {
 namespace louds {
 
+// A trie may be built with tails (see LoudsTrieBuilder), in which case the
+// single-child chain below the node where a key becomes unique is not stored
+// in LOUDS; the node is a terminal leaf and the rest of the key is stored as
+// the tail of the key.  The higher level APIs below handle the tails, while
+// the node based APIs see such leaves as the terminal nodes.
 class LoudsTrie {
  public:
   // The max depth of the trie.
@@ -49,7 +55,11 @@ class LoudsTrie {
   // This class stores a traversal state.
   typedef Louds::Node Node;
 
-  LoudsTrie() : edge_character_(nullptr) {}
+  LoudsTrie()
+      : edge_character_(nullptr),
+        has_tail_(false),
+        tail_offsets_(nullptr),
+        tail_data_(nullptr) {}
   ~LoudsTrie() {}
 
   // Opens the binary image and constructs the data structure.  The first four
@@ -69,6 +79,19 @@ class LoudsTrie {
     return Open(data, 0, 0, 0, 0, 0);
   }
 
+  // Opens the binary image with the rank/select indexes and caches restored
+  // from |index_image|, which was created by SerializeIndex() for the same
+  // binary image. The index is not built on the heap and |index_image| is not
+  // copied, so the caller needs to keep both |data| and |index_image| alive
+  // until Close is invoked. The image is consumed from the beginning of
+  // |index_image|. Returns false if the index image doesn't match |data|.
+  bool OpenWithIndexImage(const uint8 *data, StringPiece *index_image);
+
+  // Appends the image of the rank/select indexes and caches built by Open()
+  // to |output|. The image can be shared by other instances (e.g., in other
+  // processes) via OpenWithIndexImage().
+  void SerializeIndex(string *output) const;
+
   // Destructs the internal data structure explicitly (the destructor will do
   // clean up too).
   void Close();
@@ -109,12 +132,29 @@ class LoudsTrie {
     return node;
   }
 
-  // Restores the key string that reaches to |node|.  The caller is
-  // responsible for allocating a buffer for the result StringPiece, which needs
-  // to be passed in |buf|.  The returned StringPiece points to a piece of
-  // |buf|.
+  // Returns true if the trie has the tails.
+  bool has_tail() const { return has_tail_; }
+
+  // Returns the tail of the key of |key_id|, which is empty if the trie
+  // doesn't have the tails.
+  StringPiece GetTail(int key_id) const {
+    if (!has_tail_ || tail_bit_vector_.Get(key_id) == 0) {
+      return StringPiece();
+    }
+    return GetTailByIndex(tail_bit_vector_.Rank1(key_id));
+  }
+
+  // Restores the key string that reaches to |node|, including its tail.  The
+  // caller is responsible for allocating a buffer for the result StringPiece,
+  // which needs to be passed in |buf|.  The returned StringPiece points to a
+  // piece of |buf|.
   // REQUIRES: |buf| is longer than kMaxDepth + 1.
-  StringPiece RestoreKeyString(Node node, char *buf) const;
+  StringPiece RestoreKeyString(Node node, char *buf) const {
+    return RestoreKeyString(
+        node,
+        has_tail_ && IsTerminalNode(node) ? GetKeyIdOfTerminalNode(node) : -1,
+        buf);
+  }
 
   // Restores the key string corresponding to |key_id|.  The caller is
   // responsible for allocating a buffer for the result StringPiece, which needs
@@ -125,7 +165,7 @@ class LoudsTrie {
     // TODO(noriyukit): Check if it's necessary to handle negative IDs.
     return key_id < 0
         ? StringPiece()
-        : RestoreKeyString(GetTerminalNodeFromKeyId(key_id), buf);
+        : RestoreKeyString(GetTerminalNodeFromKeyId(key_id), key_id, buf);
   }
 
   // Methods for moving node exported from Louds class; see louds.h.
@@ -150,13 +190,18 @@ class LoudsTrie {
 
   // Traverses a trie for |key|, starting from |node|, and modifies |node| to
   // the destination terminal node.  Here, |node| is not necessarily the root.
-  // Returns false if there's no node reachable by |key|.
+  // Returns false if there's no node reachable by |key|.  If the trie has the
+  // tails and |key| ends in the tail of a leaf, |node| becomes the leaf, whose
+  // key is longer than |key|.
   bool Traverse(StringPiece key, Node *node) const;
 
   // Higher level APIs.
 
   // Returns true if |key| is in this trie.
   bool HasKey(StringPiece key) const {
+    if (has_tail_) {
+      return ExactSearch(key) != -1;
+    }
     Node node;  // Root
     return Traverse(key, &node) && IsTerminalNode(node);
   }
@@ -189,12 +234,31 @@ class LoudsTrie {
       }
       ++i;  // Increment here for next loop and call |callback|.
       if (IsTerminalNode(node)) {
+        if (has_tail_) {
+          const StringPiece tail = GetTail(GetKeyIdOfTerminalNode(node));
+          if (!tail.empty()) {
+            // The node is a leaf, whose key matches only if the tail follows.
+            if (key.substr(i).starts_with(tail)) {
+              callback(key, i + tail.size(), *this, node);
+            }
+            return;
+          }
+        }
         callback(key, i, *this, node);
       }
     }
   }
 
  private:
+  // Restores the key string of |node|, of which the key_id is |key_id| if
+  // it's a terminal node with the tail.  Otherwise |key_id| is -1.
+  StringPiece RestoreKeyString(Node node, int key_id, char *buf) const;
+
+  bool OpenTail(const uint8 *tail_image, StringPiece *index_image);
+
+  // Returns the |index|-th non-empty tail.
+  StringPiece GetTailByIndex(int index) const;
+
   Louds louds_;  // Tree structure representation by LOUDS.
 
   // Bit-vector to represent whether each node in LOUDS tree is terminal.
@@ -210,6 +274,17 @@ class LoudsTrie {
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_;
 
+  // The following members are available only if |has_tail_| is true.
+  bool has_tail_;
+  // Bit-vector to represent whether each key has a non-empty tail, indexed by
+  // the key_ids.
+  SimpleSuccinctBitVectorIndex tail_bit_vector_;
+  // The non-empty tails are stored in |tail_data_| in the order of the
+  // key_ids, each of which is preceded by a byte of its length - 1.  The
+  // offsets of every kTailSampleInterval-th tail are in |tail_offsets_|.
+  const uint32 *tail_offsets_;
+  const uint8 *tail_data_;
+
   DISALLOW_COPY_AND_ASSIGN(LoudsTrie);
 };
 
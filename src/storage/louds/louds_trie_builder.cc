@@ -40,7 +40,11 @@ namespace mozc {
 namespace storage {
 namespace louds {
 
-LoudsTrieBuilder::LoudsTrieBuilder() : built_(false) {
+LoudsTrieBuilder::LoudsTrieBuilder() : built_(false), use_tail_(false) {
+}
+
+LoudsTrieBuilder::LoudsTrieBuilder(bool use_tail)
+    : built_(false), use_tail_(use_tail) {
 }
 
 void LoudsTrieBuilder::Add(const string &word) {
@@ -51,19 +55,35 @@ void LoudsTrieBuilder::Add(const string &word) {
 
 namespace {
 
+// The unique suffixes shorter than this are stored as the nodes.  A tail
+// saves about 2 bits per byte over the nodes, which doesn't pay for its
+// length byte and the index if the tail is short.
+const size_t kMinTailLength = 4;
+
+// The interval of the tails of which the offsets are stored.  See also
+// LoudsTrie.
+const int kTailSampleInterval = 16;
+
 // A pair of word and its original index in the (sorted) word_list_.
 class Entry {
  public:
   Entry(const string &word, size_t original_index)
-      : word_(&word), original_index_(original_index) {
+      : word_(&word), original_index_(original_index),
+        length_(word.length()) {
   }
 
   const string &word() const { return *word_; }
   size_t original_index() const { return original_index_; }
 
+  // The length of the prefix of the word represented by the nodes.  The rest
+  // is the tail.
+  size_t length() const { return length_; }
+  void set_length(size_t length) { length_ = length; }
+
  private:
   const string *word_;
   size_t original_index_;
+  size_t length_;
 };
 
 class EntryLengthLessThan {
@@ -72,7 +92,7 @@ class EntryLengthLessThan {
   }
 
   bool operator()(const Entry &entry) {
-    return entry.word().length() < length_;
+    return entry.length() < length_;
   }
 
  private:
@@ -110,6 +130,9 @@ void LoudsTrieBuilder::Build() {
   BitStream terminal_stream;
   string edge_character;
 
+  // The tails indexed by the ids, if |use_tail_| is true.
+  vector<string> tails;
+
   // Push root.
   trie_stream.PushBit(1);
   trie_stream.PushBit(0);
@@ -155,11 +178,16 @@ void LoudsTrieBuilder::Build() {
   // depth, and skip "edge check" for the entries.
   // This doesn't break the edge check condition, and stop bit check condition,
   // but adds a chance to output stop bits for leaves.
+  //
+  // If |use_tail_| is true, a new node is made a terminal leaf when no other
+  // entry shares the prefix[0:depth] (inclusive), and the rest of the word is
+  // stored as the tail.  The length of the entry is shortened to the depth of
+  // the leaf, so that the entry is handled as a terminal from then on.
   int id = 0;
   for (size_t depth = 0; !entry_list.empty(); ++depth) {
     for (size_t i = 0; i < entry_list.size(); ++i) {
       const string &word = entry_list[i].word();
-      if (word.length() > depth &&
+      if (entry_list[i].length() > depth &&
           (i == 0 ||
            // To ensure the entry_list[i - 1].word().length >= depth + 1,
            // we call c_str() (which adds '\0' if necessary) as a hack.
@@ -170,13 +198,25 @@ void LoudsTrieBuilder::Build() {
         trie_stream.PushBit(1);
         edge_character.push_back(entry_list[i].word()[depth]);
 
-        if (entry_list[i].word().length() == depth + 1) {
+        if (use_tail_ &&
+            entry_list[i].length() >= depth + 1 + kMinTailLength &&
+            (i == entry_list.size() - 1 ||
+             word.compare(0, depth + 1,
+                          entry_list[i + 1].word(), 0, depth + 1) != 0)) {
+          // No other entry shares this node.  Make it a terminal leaf and
+          // the rest of the word is output as the tail.
+          entry_list[i].set_length(depth + 1);
+        }
+        if (entry_list[i].length() == depth + 1) {
           // This is a terminal node.
           // Note that the terminal string should be at the first of
           // strings sharing the node. So the check above should work well.
           terminal_stream.PushBit(1);
           id_list_[entry_list[i].original_index()] = id;
           ++id;
+          if (use_tail_) {
+            tails.push_back(word.substr(depth + 1));
+          }
         } else {
           // This is not a terminal node.
           terminal_stream.PushBit(0);
@@ -203,14 +243,50 @@ void LoudsTrieBuilder::Build() {
   // Output
   PushInt(trie_stream.ByteSize(), &image_);
   PushInt(terminal_stream.ByteSize(), &image_);
-  // The num bits of each character annoated to each edge.
-  PushInt(8, &image_);
+  // The num bits of each character annoated to each edge.  0x100 is set if
+  // the image has the tails.
+  PushInt(use_tail_ ? (8 | 0x100) : 8, &image_);
   PushInt(edge_character.size(), &image_);
 
   image_.append(trie_stream.image());
   image_.append(terminal_stream.image());
   image_.append(edge_character);
 
+  if (use_tail_) {
+    DCHECK_EQ(static_cast<size_t>(id), tails.size());
+    BitStream tail_stream;
+    string tail_offsets;
+    string tail_data;
+    int num_tails = 0;
+    for (size_t i = 0; i < tails.size(); ++i) {
+      if (tails[i].empty()) {
+        tail_stream.PushBit(0);
+        continue;
+      }
+      tail_stream.PushBit(1);
+      if (num_tails % kTailSampleInterval == 0) {
+        PushInt(tail_data.size(), &tail_offsets);
+      }
+      ++num_tails;
+      // The length is stored as length - 1 to fit kMaxDepth in a byte.
+      CHECK_LE(tails[i].size(), 256u);
+      tail_data.push_back(static_cast<char>(tails[i].size() - 1));
+      tail_data.append(tails[i]);
+    }
+    // Output a sentinel, and align to 32 bits.
+    tail_stream.PushBit(0);
+    tail_stream.FillPadding32();
+
+    // Align the tail image to 32-bit boundary.  See LoudsTrie::Open for the
+    // format.
+    image_.append((4 - image_.size() % 4) % 4, '\0');
+    PushInt(tail_stream.ByteSize(), &image_);
+    PushInt(num_tails, &image_);
+    image_.append(tail_stream.image());
+    image_.append(tail_offsets);
+    image_.append(tail_data);
+  }
+
   built_ = true;
 }
 
@@ -42,6 +42,11 @@ namespace louds {
 class LoudsTrieBuilder {
  public:
   LoudsTrieBuilder();
+  // If |use_tail| is true, the single-child chain below the node where a word
+  // becomes unique is not stored as the nodes, but as the tail of the word.
+  // It makes the restoration of long words faster, while the image is
+  // slightly larger.  See also LoudsTrie.
+  explicit LoudsTrieBuilder(bool use_tail);
 
   // Adds the word to the builder. It is necessary to call this method,
   // before Build invocation.
@@ -60,6 +65,7 @@ class LoudsTrieBuilder {
 
  private:
   bool built_;
+  const bool use_tail_;
 
   vector<string> word_list_;
   vector<int> id_list_;
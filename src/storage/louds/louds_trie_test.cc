@@ -29,6 +29,8 @@
 
 #include "storage/louds/louds_trie.h"
 
+#include <cstring>
+#include <string>
 #include <vector>
 
 #include "base/port.h"
@@ -551,6 +553,240 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
 }
 INSTANTIATE_TEST_CASE(GenRestoreKeyStringTest);
 
+TEST_P(LoudsTrieTest, OpenWithIndexImage) {
+  LoudsTrieBuilder builder;
+  builder.Add("aa");
+  builder.Add("ab");
+  builder.Add("abc");
+  builder.Add("abcd");
+  builder.Add("abcde");
+  builder.Add("abcdef");
+  builder.Add("abcea");
+  builder.Add("abcef");
+  builder.Add("abd");
+  builder.Add("ebd");
+  builder.Build();
+  const uint8 *data = reinterpret_cast<const uint8 *>(builder.image().data());
+
+  const CacheSizeParam &param = GetParam();
+  string index_image;
+  {
+    LoudsTrie trie;
+    trie.Open(data,
+              param.louds_lb0_cache_size,
+              param.louds_lb1_cache_size,
+              param.louds_select0_cache_size,
+              param.louds_select1_cache_size,
+              param.termvec_lb1_cache_size);
+    trie.SerializeIndex(&index_image);
+  }
+
+  // Append a trailing marker to check that only the trie's part is consumed.
+  const size_t index_size = index_image.size();
+  index_image.append("tail");
+  // Copy the image to an int-aligned buffer, as a mapped file is.
+  vector<int> buffer((index_image.size() + sizeof(int) - 1) / sizeof(int));
+  memcpy(buffer.data(), index_image.data(), index_image.size());
+  StringPiece image(reinterpret_cast<const char *>(buffer.data()),
+                    index_image.size());
+
+  LoudsTrie trie;
+  ASSERT_TRUE(trie.OpenWithIndexImage(data, &image));
+  EXPECT_EQ("tail", image);
+
+  string reserialized;
+  trie.SerializeIndex(&reserialized);
+  EXPECT_EQ(index_image.substr(0, index_size), reserialized);
+
+  char buffer_for_key[LoudsTrie::kMaxDepth + 1];
+  const char *kKeys[] = {
+    "aa", "ab", "abc", "abcd", "abcde", "abcdef", "abcea", "abcef", "abd",
+    "ebd",
+  };
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    EXPECT_EQ(builder.GetId(kKeys[i]), trie.ExactSearch(kKeys[i]));
+    EXPECT_EQ(kKeys[i],
+              trie.RestoreKeyString(builder.GetId(kKeys[i]), buffer_for_key));
+  }
+  EXPECT_EQ(-1, trie.ExactSearch("abce"));
+  EXPECT_EQ(-1, trie.ExactSearch("b"));
+  trie.Close();
+}
+INSTANTIATE_TEST_CASE(OpenWithIndexImageTest);
+
+TEST(LoudsTrieIndexImageTest, RejectMismatchedImage) {
+  LoudsTrieBuilder builder1;
+  builder1.Add("a");
+  builder1.Add("b");
+  builder1.Build();
+  LoudsTrieBuilder builder2;
+  for (int i = 0; i < 100; ++i) {
+    builder2.Add(string(1 + i % 10, static_cast<char>('a' + i % 26)) +
+                 static_cast<char>('A' + i / 26));
+  }
+  builder2.Build();
+
+  string index_image;
+  {
+    LoudsTrie trie;
+    trie.Open(reinterpret_cast<const uint8 *>(builder2.image().data()));
+    trie.SerializeIndex(&index_image);
+  }
+  vector<int> buffer((index_image.size() + sizeof(int) - 1) / sizeof(int));
+  memcpy(buffer.data(), index_image.data(), index_image.size());
+
+  LoudsTrie trie;
+  StringPiece image(reinterpret_cast<const char *>(buffer.data()),
+                    index_image.size());
+  EXPECT_FALSE(trie.OpenWithIndexImage(
+      reinterpret_cast<const uint8 *>(builder1.image().data()), &image));
+
+  // Truncated image.
+  image.set(reinterpret_cast<const char *>(buffer.data()),
+            index_image.size() / 2);
+  EXPECT_FALSE(trie.OpenWithIndexImage(
+      reinterpret_cast<const uint8 *>(builder2.image().data()), &image));
+}
+
+TEST(LoudsTrieTailTest, HigherLevelApis) {
+  const char *kKeys[] = {
+    "a", "abc", "abcd", "ae", "aecdfghi", "b", "bc", "bcxyzuv",
+    "\x01\xFF\xFF\xFF\xFF\xFF",
+  };
+  LoudsTrieBuilder builder(true);
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    builder.Add(kKeys[i]);
+  }
+  builder.Build();
+
+  LoudsTrie trie;
+  ASSERT_TRUE(trie.Open(
+      reinterpret_cast<const uint8 *>(builder.image().data())));
+  EXPECT_TRUE(trie.has_tail());
+
+  char buffer[LoudsTrie::kMaxDepth + 1];
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    const int id = builder.GetId(kKeys[i]);
+    EXPECT_EQ(id, trie.ExactSearch(kKeys[i]));
+    EXPECT_TRUE(trie.HasKey(kKeys[i]));
+    EXPECT_EQ(kKeys[i], trie.RestoreKeyString(id, buffer));
+    EXPECT_EQ(kKeys[i], trie.RestoreKeyString(Traverse(trie, kKeys[i]),
+                                              buffer));
+  }
+  // "aecdfghi" and "bcxyzuv" are stored with the tails, while "abcd" is not
+  // as its unique suffix is too short.
+  EXPECT_EQ("dfghi", trie.GetTail(builder.GetId("aecdfghi")));
+  EXPECT_EQ("yzuv", trie.GetTail(builder.GetId("bcxyzuv")));
+  EXPECT_EQ("\xFF\xFF\xFF\xFF\xFF",
+            trie.GetTail(builder.GetId("\x01\xFF\xFF\xFF\xFF\xFF")));
+  EXPECT_EQ("", trie.GetTail(builder.GetId("abcd")));
+  EXPECT_EQ("", trie.GetTail(builder.GetId("abc")));
+
+  const char *kNonKeys[] = {
+    "", "ab", "aec", "aecdf", "aecdfgh", "aecdfghij", "aecx", "bcx",
+    "bcxyzu", "bcxyzuvw", "\x01\xFF",
+  };
+  for (size_t i = 0; i < arraysize(kNonKeys); ++i) {
+    EXPECT_EQ(-1, trie.ExactSearch(kNonKeys[i])) << kNonKeys[i];
+    EXPECT_FALSE(trie.HasKey(kNonKeys[i])) << kNonKeys[i];
+  }
+
+  // Traverse() reaches the leaf if the key ends in its tail.
+  LoudsTrie::Node node;
+  EXPECT_TRUE(trie.Traverse("aecd", &node));
+  EXPECT_EQ(Traverse(trie, "aecdfghi"), node);
+  node = LoudsTrie::Node();
+  EXPECT_FALSE(trie.Traverse("aecx", &node));
+  node = LoudsTrie::Node();
+  EXPECT_FALSE(trie.Traverse("aecdfghij", &node));
+
+  {
+    const StringPiece kKey = "aecdfghij";
+    vector<RecordCallbackArgs::CallbackArgs> actual;
+    trie.PrefixSearch(kKey, RecordCallbackArgs(&actual));
+    ASSERT_EQ(3, actual.size());
+    EXPECT_EQ(1, actual[0].prefix_len);
+    EXPECT_EQ(2, actual[1].prefix_len);
+    EXPECT_EQ(8, actual[2].prefix_len);
+    EXPECT_EQ(builder.GetId("aecdfghi"),
+              trie.GetKeyIdOfTerminalNode(actual[2].node));
+  }
+  {
+    vector<RecordCallbackArgs::CallbackArgs> actual;
+    trie.PrefixSearch("aecdf", RecordCallbackArgs(&actual));
+    ASSERT_EQ(2, actual.size());
+    EXPECT_EQ(2, actual[1].prefix_len);
+  }
+  trie.Close();
+  EXPECT_FALSE(trie.has_tail());
+}
+
+TEST(LoudsTrieTailTest, SameKeysAsPlainTrie) {
+  // Keys over a small alphabet, which share many prefixes.
+  vector<string> keys;
+  for (int i = 0; i < 3000; ++i) {
+    string key;
+    for (int n = i; ; n /= 5) {
+      key.push_back("ab\x80\xE3\xFF"[n % 5]);
+      if (n < 5 || key.size() > static_cast<size_t>(i % 11)) {
+        break;
+      }
+    }
+    keys.push_back(key);
+  }
+  LoudsTrieBuilder builder(true);
+  LoudsTrieBuilder plain_builder;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    builder.Add(keys[i]);
+    plain_builder.Add(keys[i]);
+  }
+  builder.Build();
+  plain_builder.Build();
+
+  LoudsTrie trie, plain_trie;
+  ASSERT_TRUE(trie.Open(
+      reinterpret_cast<const uint8 *>(builder.image().data())));
+  ASSERT_TRUE(plain_trie.Open(
+      reinterpret_cast<const uint8 *>(plain_builder.image().data())));
+
+  char buffer[LoudsTrie::kMaxDepth + 1];
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const int id = trie.ExactSearch(keys[i]);
+    ASSERT_EQ(builder.GetId(keys[i]), id);
+    EXPECT_EQ(keys[i], trie.RestoreKeyString(id, buffer));
+
+    // The prefixes of a query found in the both tries are the same.
+    const string query = keys[i] + keys[keys.size() - 1 - i];
+    vector<RecordCallbackArgs::CallbackArgs> actual, expected;
+    trie.PrefixSearch(query, RecordCallbackArgs(&actual));
+    plain_trie.PrefixSearch(query, RecordCallbackArgs(&expected));
+    ASSERT_EQ(expected.size(), actual.size()) << query;
+    for (size_t j = 0; j < actual.size(); ++j) {
+      EXPECT_EQ(expected[j].prefix_len, actual[j].prefix_len);
+    }
+  }
+
+  // The index of the tails is restored from the serialized index, too.
+  string index_image;
+  trie.SerializeIndex(&index_image);
+  vector<int> index_buffer((index_image.size() + sizeof(int) - 1) /
+                           sizeof(int));
+  memcpy(index_buffer.data(), index_image.data(), index_image.size());
+  StringPiece image(reinterpret_cast<const char *>(index_buffer.data()),
+                    index_image.size());
+  LoudsTrie indexed_trie;
+  ASSERT_TRUE(indexed_trie.OpenWithIndexImage(
+      reinterpret_cast<const uint8 *>(builder.image().data()), &image));
+  EXPECT_TRUE(image.empty());
+  ASSERT_TRUE(indexed_trie.has_tail());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const int id = builder.GetId(keys[i]);
+    EXPECT_EQ(id, indexed_trie.ExactSearch(keys[i]));
+    EXPECT_EQ(trie.GetTail(id), indexed_trie.GetTail(id));
+    EXPECT_EQ(keys[i], indexed_trie.RestoreKeyString(id, buffer));
+  }
+}
+
 }  // namespace
 }  // namespace louds
 }  // namespace storage
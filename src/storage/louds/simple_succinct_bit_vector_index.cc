@@ -30,7 +30,9 @@
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
+#include <string>
 #include <vector>
 
 #include "base/iterator_adapter.h"
@@ -48,18 +50,18 @@ class ZeroBitAdapter : public AdapterBase<int> {
   // Needs to be default constructive to create invalid iterator.
   ZeroBitAdapter() : index_(nullptr), chunk_size_(0) {}
 
-  ZeroBitAdapter(const vector<int>* index, int chunk_size)
+  ZeroBitAdapter(const int *index, int chunk_size)
       : index_(index), chunk_size_(chunk_size) {}
 
   value_type operator()(const int *ptr) const {
     // The number of 0-bits
     //   = (total num bits) - (1-bits)
     //   = (chunk_size [bytes] * 8 [bits/byte] * (ptr's offset) - (1-bits)
-    return chunk_size_ * 8 * (ptr - index_->data()) - *ptr;
+    return chunk_size_ * 8 * (ptr - index_) - *ptr;
   }
 
  private:
-  const vector<int> *index_;
+  const int *index_;
   int chunk_size_;
 };
 
@@ -128,39 +130,53 @@ void InitIndex(
   CHECK_EQ(chunk_length + 1, index->size());
 }
 
+// Appends the lower bound cache to |cache| as offsets in |index|.
 void InitLowerBound0Cache(const vector<int> &index, int chunk_size,
                           size_t increment, size_t size,
-                          vector<const int *> *cache) {
+                          vector<int> *cache) {
   DCHECK_GT(increment, 0);
-  cache->clear();
-  cache->reserve(size + 2);
-  cache->push_back(index.data());
-  ZeroBitAdapter adapter(&index, chunk_size);
+  cache->push_back(0);
+  ZeroBitAdapter adapter(index.data(), chunk_size);
   for (size_t i = 1; i <= size; ++i) {
     const int target_index = increment * i;
     const int *ptr = std::lower_bound(
         MakeIteratorAdapter(index.data(), adapter),
         MakeIteratorAdapter(index.data() + index.size(), adapter),
         target_index).base();
-    cache->push_back(ptr);
+    cache->push_back(ptr - index.data());
   }
-  cache->push_back(index.data() + index.size());
+  cache->push_back(index.size());
 }
 
 void InitLowerBound1Cache(const vector<int> &index, int chunk_size,
                           size_t increment, size_t size,
-                          vector<const int *> *cache) {
+                          vector<int> *cache) {
   DCHECK_GT(increment, 0);
-  cache->clear();
-  cache->reserve(size + 2);
-  cache->push_back(index.data());
+  cache->push_back(0);
   for (size_t i = 1; i <= size; ++i) {
     const int target_index = increment * i;
     const int *ptr = std::lower_bound(index.data(), index.data() + index.size(),
                                       target_index);
-    cache->push_back(ptr);
+    cache->push_back(ptr - index.data());
   }
-  cache->push_back(index.data() + index.size());
+  cache->push_back(index.size());
+}
+
+// The header of the index image: chunk size, bit vector length, index size,
+// lb0 cache increment, lb0 cache size, lb1 cache increment and lb1 cache
+// size, followed by the index and the caches.
+const int kIndexImageHeaderSize = 7;
+
+// Returns true if all the offsets in |cache| are in [0, index_size].
+bool IsValidLowerBoundCache(const int *cache, int cache_size,
+                            int index_size) {
+  for (int i = 0; i < cache_size; ++i) {
+    if (cache[i] < 0 || cache[i] > index_size ||
+        (i > 0 && cache[i] < cache[i - 1])) {
+      return false;
+    }
+  }
+  return true;
 }
 
 }  // namespace
@@ -170,35 +186,129 @@ void SimpleSuccinctBitVectorIndex::Init(const uint8 *data, int length,
                                         size_t lb1_cache_size) {
   data_ = data;
   length_ = length;
-  InitIndex(data, length, chunk_size_, &index_);
+  vector<int> index;
+  InitIndex(data, length, chunk_size_, &index);
+  const int num1_bits = index.back();
+  const int num0_bits = 8 * length - num1_bits;
 
   // TODO(noriyukit): Currently, we simply use uniform increment width for lower
   // bound cache.  Nonuniform increment width may improve performance.
   lb0_cache_increment_ =
-      lb0_cache_size == 0 ? GetNum0Bits() : GetNum0Bits() / lb0_cache_size;
+      lb0_cache_size == 0 ? num0_bits : num0_bits / lb0_cache_size;
   if (lb0_cache_increment_ == 0) {
     lb0_cache_increment_ = 1;
   }
-  InitLowerBound0Cache(index_, chunk_size_, lb0_cache_increment_,
-                       lb0_cache_size, &lb0_cache_);
-
   lb1_cache_increment_ =
-      lb1_cache_size == 0 ? GetNum1Bits() : GetNum1Bits() / lb1_cache_size;
+      lb1_cache_size == 0 ? num1_bits : num1_bits / lb1_cache_size;
   if (lb1_cache_increment_ == 0) {
     lb1_cache_increment_ = 1;
   }
-  InitLowerBound1Cache(index_, chunk_size_, lb1_cache_increment_,
-                       lb1_cache_size, &lb1_cache_);
+
+  // Lays out the index and the caches in one buffer, in the same order as
+  // the serialized image.
+  buffer_.clear();
+  buffer_.reserve(index.size() + lb0_cache_size + lb1_cache_size + 4);
+  buffer_.insert(buffer_.end(), index.begin(), index.end());
+  InitLowerBound0Cache(index, chunk_size_, lb0_cache_increment_,
+                       lb0_cache_size, &buffer_);
+  InitLowerBound1Cache(index, chunk_size_, lb1_cache_increment_,
+                       lb1_cache_size, &buffer_);
+
+  index_size_ = index.size();
+  lb0_cache_size_ = lb0_cache_size + 2;
+  lb1_cache_size_ = lb1_cache_size + 2;
+  index_ = buffer_.data();
+  lb0_cache_ = index_ + index_size_;
+  lb1_cache_ = lb0_cache_ + lb0_cache_size_;
+}
+
+bool SimpleSuccinctBitVectorIndex::InitWithIndexImage(
+    const uint8 *data, int length, StringPiece *index_image) {
+  Reset();
+  if (reinterpret_cast<uintptr_t>(index_image->data()) % sizeof(int) != 0 ||
+      index_image->size() < kIndexImageHeaderSize * sizeof(int)) {
+    LOG(ERROR) << "Broken index image: too short or unaligned";
+    return false;
+  }
+  const int *header = reinterpret_cast<const int *>(index_image->data());
+  const int chunk_size = header[0];
+  const int length_in_image = header[1];
+  const int index_size = header[2];
+  const int lb0_cache_increment = header[3];
+  const int lb0_cache_size = header[4];
+  const int lb1_cache_increment = header[5];
+  const int lb1_cache_size = header[6];
+  if (chunk_size != chunk_size_ || length_in_image != length ||
+      index_size != (length + chunk_size - 1) / chunk_size + 1 ||
+      lb0_cache_increment <= 0 || lb0_cache_size < 2 ||
+      lb1_cache_increment <= 0 || lb1_cache_size < 2) {
+    LOG(ERROR) << "Index image doesn't match the bit vector";
+    return false;
+  }
+  const size_t num_ints =
+      kIndexImageHeaderSize + index_size + lb0_cache_size + lb1_cache_size;
+  if (index_image->size() < num_ints * sizeof(int)) {
+    LOG(ERROR) << "Broken index image: too short";
+    return false;
+  }
+
+  const int *index = header + kIndexImageHeaderSize;
+  const int *lb0_cache = index + index_size;
+  const int *lb1_cache = lb0_cache + lb0_cache_size;
+  for (int i = 1; i < index_size; ++i) {
+    if (index[i] < index[i - 1] || index[i] - index[i - 1] > 8 * chunk_size) {
+      LOG(ERROR) << "Broken index image: invalid rank index";
+      return false;
+    }
+  }
+  if (index[0] != 0 || index[index_size - 1] > 8 * length ||
+      !IsValidLowerBoundCache(lb0_cache, lb0_cache_size, index_size) ||
+      !IsValidLowerBoundCache(lb1_cache, lb1_cache_size, index_size)) {
+    LOG(ERROR) << "Broken index image: invalid cache";
+    return false;
+  }
+
+  data_ = data;
+  length_ = length;
+  index_ = index;
+  index_size_ = index_size;
+  lb0_cache_increment_ = lb0_cache_increment;
+  lb0_cache_ = lb0_cache;
+  lb0_cache_size_ = lb0_cache_size;
+  lb1_cache_increment_ = lb1_cache_increment;
+  lb1_cache_ = lb1_cache;
+  lb1_cache_size_ = lb1_cache_size;
+  index_image->remove_prefix(num_ints * sizeof(int));
+  return true;
+}
+
+void SimpleSuccinctBitVectorIndex::SerializeIndex(string *output) const {
+  const int header[kIndexImageHeaderSize] = {
+    chunk_size_, length_, index_size_,
+    lb0_cache_increment_, lb0_cache_size_,
+    lb1_cache_increment_, lb1_cache_size_,
+  };
+  output->append(reinterpret_cast<const char *>(header), sizeof(header));
+  output->append(reinterpret_cast<const char *>(index_),
+                 index_size_ * sizeof(int));
+  output->append(reinterpret_cast<const char *>(lb0_cache_),
+                 lb0_cache_size_ * sizeof(int));
+  output->append(reinterpret_cast<const char *>(lb1_cache_),
+                 lb1_cache_size_ * sizeof(int));
 }
 
 void SimpleSuccinctBitVectorIndex::Reset() {
   data_ = nullptr;
   length_ = 0;
-  index_.clear();
+  index_ = nullptr;
+  index_size_ = 0;
   lb0_cache_increment_ = 1;
-  lb0_cache_.clear();
+  lb0_cache_ = nullptr;
+  lb0_cache_size_ = 0;
   lb1_cache_increment_ = 1;
-  lb1_cache_.clear();
+  lb1_cache_ = nullptr;
+  lb1_cache_size_ = 0;
+  buffer_.clear();
 }
 
 int SimpleSuccinctBitVectorIndex::Rank1(int n) const {
@@ -227,19 +337,20 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
 
   // Narrow down the range of |index_| on which lower bound is performed.
   int lb0_cache_index = n / lb0_cache_increment_;
-  if (lb0_cache_index > lb0_cache_.size() - 2) {
-    lb0_cache_index = lb0_cache_.size() - 2;
+  if (lb0_cache_index > lb0_cache_size_ - 2) {
+    lb0_cache_index = lb0_cache_size_ - 2;
   }
   DCHECK_GE(lb0_cache_index, 0);
 
   // Binary search on chunks.
-  ZeroBitAdapter adapter(&index_, chunk_size_);
+  ZeroBitAdapter adapter(index_, chunk_size_);
   const int *chunk_ptr =
       std::lower_bound(
-          MakeIteratorAdapter(lb0_cache_[lb0_cache_index], adapter),
-          MakeIteratorAdapter(lb0_cache_[lb0_cache_index + 1], adapter), n)
-          .base();
-  const int chunk_index = (chunk_ptr - index_.data()) - 1;
+          MakeIteratorAdapter(index_ + lb0_cache_[lb0_cache_index], adapter),
+          MakeIteratorAdapter(index_ + lb0_cache_[lb0_cache_index + 1],
+                              adapter),
+          n).base();
+  const int chunk_index = (chunk_ptr - index_) - 1;
   DCHECK_GE(chunk_index, 0);
   n -= chunk_size_ * 8 * chunk_index - index_[chunk_index];
 
@@ -270,15 +381,16 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
 
   // Narrow down the range of |index_| on which lower bound is performed.
   int lb1_cache_index = n / lb1_cache_increment_;
-  if (lb1_cache_index > lb1_cache_.size() - 2) {
-    lb1_cache_index = lb1_cache_.size() - 2;
+  if (lb1_cache_index > lb1_cache_size_ - 2) {
+    lb1_cache_index = lb1_cache_size_ - 2;
   }
   DCHECK_GE(lb1_cache_index, 0);
 
   // Binary search on chunks.
-  const int *chunk_ptr = std::lower_bound(lb1_cache_[lb1_cache_index],
-                                          lb1_cache_[lb1_cache_index + 1], n);
-  const int chunk_index = (chunk_ptr - index_.data()) - 1;
+  const int *chunk_ptr =
+      std::lower_bound(index_ + lb1_cache_[lb1_cache_index],
+                       index_ + lb1_cache_[lb1_cache_index + 1], n);
+  const int chunk_index = (chunk_ptr - index_) - 1;
   DCHECK_GE(chunk_index, 0);
   n -= index_[chunk_index];
 
@@ -30,8 +30,11 @@
 #ifndef MOZC_STORAGE_LOUDS_SIMPLE_SUCCINCT_BIT_VECTOR_INDEX_H_
 #define MOZC_STORAGE_LOUDS_SIMPLE_SUCCINCT_BIT_VECTOR_INDEX_H_
 
+#include <string>
 #include <vector>
+
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 namespace storage {
@@ -45,8 +48,14 @@ class SimpleSuccinctBitVectorIndex {
       : data_(nullptr),
         length_(0),
         chunk_size_(32),
+        index_(nullptr),
+        index_size_(0),
         lb0_cache_increment_(1),
-        lb1_cache_increment_(1) {}
+        lb0_cache_(nullptr),
+        lb0_cache_size_(0),
+        lb1_cache_increment_(1),
+        lb1_cache_(nullptr),
+        lb1_cache_size_(0) {}
 
   // chunk_size is in bytes, and must be greater than or equal to 4
   // and power of 2, at the moment, although we may relax the restriction
@@ -55,8 +64,14 @@ class SimpleSuccinctBitVectorIndex {
       : data_(nullptr),
         length_(0),
         chunk_size_(chunk_size),
+        index_(nullptr),
+        index_size_(0),
         lb0_cache_increment_(1),
-        lb1_cache_increment_(1) {}
+        lb0_cache_(nullptr),
+        lb0_cache_size_(0),
+        lb1_cache_increment_(1),
+        lb1_cache_(nullptr),
+        lb1_cache_size_(0) {}
 
   // Initializes the index. This class doesn't have the ownership of the memory
   // pointed by data, so it is caller's responsibility to manage its life time.
@@ -68,6 +83,21 @@ class SimpleSuccinctBitVectorIndex {
     Init(data, length, 0, 0);
   }
 
+  // Initializes the index from the image created by SerializeIndex() for the
+  // same bit vector, instead of building it on the heap. The image is read
+  // from the beginning of |index_image|, which is advanced past the consumed
+  // bytes. The image is not copied, so it must outlive this instance; e.g.,
+  // it may be in a read-only file mapping shared by multiple processes. The
+  // image needs to be aligned to 32-bits. Returns false if the image doesn't
+  // match the bit vector.
+  bool InitWithIndexImage(const uint8 *data, int length,
+                          StringPiece *index_image);
+
+  // Appends the image of the index (rank index and lower bound caches) to
+  // |output|. The image is position independent and its size is a multiple
+  // of 4 bytes.
+  void SerializeIndex(string *output) const;
+
   // Resets the internal state, especially releases the allocated memory
   // for the index used internally.
   void Reset();
@@ -95,19 +125,27 @@ class SimpleSuccinctBitVectorIndex {
   // Returned index is 0-origin.
   int Select1(int n) const;
 
-  int GetNum1Bits() const { return index_.back(); }
-  int GetNum0Bits() const { return 8 * length_ - index_.back(); }
+  int GetNum1Bits() const { return index_[index_size_ - 1]; }
+  int GetNum0Bits() const { return 8 * length_ - index_[index_size_ - 1]; }
 
  private:
   const uint8 *data_;
   int length_;
   int chunk_size_;
 
-  vector<int> index_;
+  // The rank index and the lower bound caches point to either |buffer_|
+  // built by Init() or the image given to InitWithIndexImage(). The lower
+  // bound caches hold offsets in |index_|, not pointers, so that the image is
+  // position independent.
+  const int *index_;
+  int index_size_;
   int lb0_cache_increment_;
-  vector<const int *> lb0_cache_;
+  const int *lb0_cache_;
+  int lb0_cache_size_;
   int lb1_cache_increment_;
-  vector<const int *> lb1_cache_;
+  const int *lb1_cache_;
+  int lb1_cache_size_;
+  vector<int> buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleSuccinctBitVectorIndex);
 };
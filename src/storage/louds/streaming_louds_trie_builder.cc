@@ -0,0 +1,381 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/louds/streaming_louds_trie_builder.h"
+
+#include <algorithm>
+#include <ostream>
+#include <utility>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+const size_t kDefaultMaxBufferSize = 1 << 16;
+
+void PushInt(size_t value, ostream *os) {
+  // Make sure the value is fit in the 32-bit value.
+  CHECK_EQ(value & ~0xFFFFFFFF, 0);
+
+  // Output LSB to MSB.
+  for (int shift = 0; shift < 32; shift += 8) {
+    os->put(static_cast<char>((value >> shift) & 0xFF));
+  }
+}
+
+// Returns the size of the bit stream aligned to the 32-bit boundary, as
+// BitStream::FillPadding32() does.
+size_t GetPaddedByteSize(size_t num_bits) {
+  const size_t num_bytes = (num_bits + 7) / 8;
+  return (num_bytes + 3) / 4 * 4;
+}
+
+// Writes bits to the stream in the same layout as BitStream.
+class BitWriter {
+ public:
+  explicit BitWriter(ostream *os) : os_(os), num_bits_(0) {}
+
+  ~BitWriter() {
+    Flush(true);
+  }
+
+  // Pushes the lowest |n| bits of |bits|, from LSB to MSB.
+  void PushBits(uint8 bits, size_t n) {
+    DCHECK_LE(n, 8);
+    if (n == 0) {
+      return;
+    }
+    bits &= static_cast<uint8>((1 << n) - 1);
+    const size_t shift = num_bits_ % 8;
+    if (shift == 0) {
+      buffer_.push_back(static_cast<char>(bits));
+    } else {
+      *buffer_.rbegin() |= static_cast<char>(bits << shift);
+      if (n > 8 - shift) {
+        buffer_.push_back(static_cast<char>(bits >> (8 - shift)));
+      }
+    }
+    num_bits_ += n;
+    if (buffer_.size() >= kDefaultMaxBufferSize) {
+      Flush(false);
+    }
+  }
+
+  // Fills the padding (0-bit) until the size is aligned to 32bit boundary.
+  void FillPadding32() {
+    const size_t padded_bits = GetPaddedByteSize(num_bits_) * 8;
+    while (num_bits_ < padded_bits) {
+      PushBits(0, std::min<size_t>(8, padded_bits - num_bits_));
+    }
+  }
+
+  // Writes the completed bytes, or all the bytes if |all| is true.
+  void Flush(bool all) {
+    size_t size = buffer_.size();
+    if (!all && size > 0 && num_bits_ % 8 != 0) {
+      --size;
+    }
+    os_->write(buffer_.data(), size);
+    buffer_.erase(0, size);
+  }
+
+ private:
+  ostream *os_;
+  string buffer_;
+  size_t num_bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitWriter);
+};
+
+}  // namespace
+
+// Stream of bits in the same layout as BitStream.  The completed bytes are
+// spilled to the temporary file.
+class StreamingLoudsTrieBuilder::Spool {
+ public:
+  Spool() : num_bits_(0) {}
+
+  size_t num_bits() const { return num_bits_; }
+  size_t buffer_size() const { return buffer_.size(); }
+
+  void PushBit(int bit) {
+    DCHECK(bit == 0 || bit == 1);
+    const size_t shift = num_bits_ % 8;
+    if (shift == 0) {
+      buffer_.push_back('\0');
+    }
+    *buffer_.rbegin() |= (bit & 1) << shift;
+    ++num_bits_;
+  }
+
+  void PushByte(char c) {
+    DCHECK_EQ(0, num_bits_ % 8);
+    buffer_.push_back(c);
+    num_bits_ += 8;
+  }
+
+  // Appends the completed bytes to |temp_stream| at |*temp_size|.
+  void Spill(ostream *temp_stream, uint64 *temp_size) {
+    const size_t size =
+        num_bits_ % 8 == 0 ? buffer_.size() : buffer_.size() - 1;
+    if (size == 0) {
+      return;
+    }
+    temp_stream->write(buffer_.data(), size);
+    chunks_.push_back(std::make_pair(*temp_size, size));
+    *temp_size += size;
+    buffer_.erase(0, size);
+  }
+
+  // Writes all the bits to |writer|, reading the spilled chunks from
+  // |temp_stream|.
+  bool WriteTo(istream *temp_stream, BitWriter *writer) const {
+    string chunk;
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      chunk.resize(chunks_[i].second);
+      temp_stream->seekg(chunks_[i].first);
+      if (!temp_stream->read(&chunk[0], chunk.size())) {
+        return false;
+      }
+      for (size_t j = 0; j < chunk.size(); ++j) {
+        writer->PushBits(static_cast<uint8>(chunk[j]), 8);
+      }
+    }
+    for (size_t j = 0; j < buffer_.size(); ++j) {
+      const bool last = (j + 1 == buffer_.size());
+      writer->PushBits(static_cast<uint8>(buffer_[j]),
+                       last && num_bits_ % 8 != 0 ? num_bits_ % 8 : 8);
+    }
+    return true;
+  }
+
+ private:
+  // The offset and the size of the spilled chunks in the temporary file.
+  vector<pair<uint64, size_t>> chunks_;
+  string buffer_;
+  size_t num_bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(Spool);
+};
+
+struct StreamingLoudsTrieBuilder::Level {
+  Level() : num_terminals(0) {}
+
+  // LOUDS bits for the children of the nodes of this depth.
+  Spool louds;
+  // Terminal bits and edge characters of the nodes of this depth.
+  Spool terminals;
+  Spool edges;
+  size_t num_terminals;
+};
+
+StreamingLoudsTrieBuilder::StreamingLoudsTrieBuilder(
+    const string &temp_filename)
+    : temp_filename_(temp_filename),
+      max_buffer_size_(kDefaultMaxBufferSize),
+      temp_size_(0),
+      last_handle_(0),
+      num_words_(0),
+      built_(false) {
+}
+
+StreamingLoudsTrieBuilder::StreamingLoudsTrieBuilder(
+    const string &temp_filename, size_t max_buffer_size)
+    : temp_filename_(temp_filename),
+      max_buffer_size_(max_buffer_size),
+      temp_size_(0),
+      last_handle_(0),
+      num_words_(0),
+      built_(false) {
+}
+
+StreamingLoudsTrieBuilder::~StreamingLoudsTrieBuilder() {
+  if (temp_stream_.get() != NULL) {
+    temp_stream_.reset();
+    FileUtil::Unlink(temp_filename_);
+  }
+}
+
+StreamingLoudsTrieBuilder::Level *StreamingLoudsTrieBuilder::GetLevel(
+    size_t depth) {
+  while (levels_.size() <= depth) {
+    levels_.push_back(std::unique_ptr<Level>(new Level));
+  }
+  return levels_[depth].get();
+}
+
+void StreamingLoudsTrieBuilder::MaybeSpill(Level *level) {
+  if (temp_filename_.empty()) {
+    return;
+  }
+  Spool *spools[] = {&level->louds, &level->terminals, &level->edges};
+  for (size_t i = 0; i < arraysize(spools); ++i) {
+    if (spools[i]->buffer_size() < max_buffer_size_) {
+      continue;
+    }
+    if (temp_stream_.get() == NULL) {
+      temp_stream_.reset(new OutputFileStream(temp_filename_.c_str(),
+                                              ios::out | ios::binary));
+    }
+    spools[i]->Spill(temp_stream_.get(), &temp_size_);
+  }
+}
+
+uint64 StreamingLoudsTrieBuilder::Add(StringPiece word) {
+  CHECK(!built_);
+  CHECK(!word.empty());
+  CHECK(num_words_ == 0 || StringPiece(last_word_) <= word)
+      << "Words must be added in ascending order: " << word;
+  if (num_words_ > 0 && StringPiece(last_word_) == word) {
+    return last_handle_;
+  }
+
+  size_t common_length = 0;
+  while (common_length < last_word_.size() && common_length < word.size() &&
+         last_word_[common_length] == word[common_length]) {
+    ++common_length;
+  }
+
+  // The nodes of the last word deeper than the common prefix have no more
+  // children.  Output the stop bits for them.
+  for (size_t depth = last_word_.size(); depth > common_length; --depth) {
+    GetLevel(depth)->louds.PushBit(0);
+  }
+
+  // Then output the new nodes.  Only the last one is a terminal, since the
+  // prefixes of the word have already been added if they are in the trie.
+  for (size_t depth = common_length; depth < word.size(); ++depth) {
+    GetLevel(depth)->louds.PushBit(1);
+    Level *child = GetLevel(depth + 1);
+    child->edges.PushByte(word[depth]);
+    if (depth + 1 == word.size()) {
+      child->terminals.PushBit(1);
+      last_handle_ = (static_cast<uint64>(word.size()) << 32) |
+                     child->num_terminals;
+      ++child->num_terminals;
+    } else {
+      child->terminals.PushBit(0);
+    }
+  }
+
+  const size_t max_depth = std::max(last_word_.size(), word.size());
+  for (size_t depth = common_length; depth <= max_depth; ++depth) {
+    MaybeSpill(GetLevel(depth));
+  }
+
+  word.CopyToString(&last_word_);
+  ++num_words_;
+  return last_handle_;
+}
+
+bool StreamingLoudsTrieBuilder::Build(ostream *os) {
+  CHECK(!built_);
+  built_ = true;
+
+  // Close the nodes of the last word including the root.
+  if (num_words_ > 0) {
+    for (size_t depth = last_word_.size() + 1; depth > 0; --depth) {
+      GetLevel(depth - 1)->louds.PushBit(0);
+    }
+  }
+
+  // The key_ids are assigned to the terminal nodes in the level order.
+  size_t louds_bits = 2;  // For the super root.
+  size_t terminal_bits = 1;
+  size_t num_edges = 1;
+  id_offsets_.resize(levels_.size() + 1);
+  id_offsets_[0] = 0;
+  for (size_t depth = 0; depth < levels_.size(); ++depth) {
+    const Level &level = *levels_[depth];
+    louds_bits += level.louds.num_bits();
+    terminal_bits += level.terminals.num_bits();
+    num_edges += level.edges.num_bits() / 8;
+    id_offsets_[depth + 1] = id_offsets_[depth] + level.num_terminals;
+  }
+
+  std::unique_ptr<InputFileStream> temp_stream;
+  if (temp_stream_.get() != NULL) {
+    temp_stream_.reset();
+    temp_stream.reset(new InputFileStream(temp_filename_.c_str(),
+                                          ios::in | ios::binary));
+  }
+
+  PushInt(GetPaddedByteSize(louds_bits), os);
+  PushInt(GetPaddedByteSize(terminal_bits), os);
+  // The num bits of each character annoated to each edge.
+  PushInt(8, os);
+  PushInt(num_edges, os);
+
+  bool result = true;
+  {
+    BitWriter writer(os);
+    // The super root, whose child is the root.
+    writer.PushBits(1, 2);
+    for (size_t depth = 0; depth < levels_.size(); ++depth) {
+      result &= levels_[depth]->louds.WriteTo(temp_stream.get(), &writer);
+    }
+    writer.FillPadding32();
+
+    // The root is not a terminal.
+    writer.PushBits(0, 1);
+    for (size_t depth = 0; depth < levels_.size(); ++depth) {
+      result &= levels_[depth]->terminals.WriteTo(temp_stream.get(), &writer);
+    }
+    writer.FillPadding32();
+
+    writer.PushBits(0, 8);
+    for (size_t depth = 0; depth < levels_.size(); ++depth) {
+      result &= levels_[depth]->edges.WriteTo(temp_stream.get(), &writer);
+    }
+  }
+
+  if (temp_stream.get() != NULL) {
+    temp_stream.reset();
+    FileUtil::Unlink(temp_filename_);
+  }
+  levels_.clear();
+  return result && os->good();
+}
+
+int StreamingLoudsTrieBuilder::GetId(uint64 handle) const {
+  CHECK(built_);
+  const size_t depth = static_cast<size_t>(handle >> 32);
+  DCHECK_LT(depth, id_offsets_.size());
+  return id_offsets_[depth] + static_cast<int>(handle & 0xFFFFFFFF);
+}
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
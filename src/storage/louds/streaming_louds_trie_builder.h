@@ -0,0 +1,121 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_STORAGE_LOUDS_STREAMING_LOUDS_TRIE_BUILDER_H_
+#define MOZC_STORAGE_LOUDS_STREAMING_LOUDS_TRIE_BUILDER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+class OutputFileStream;
+
+namespace storage {
+namespace louds {
+
+// Builds the same trie image as LoudsTrieBuilder without holding the words in
+// memory.  The words have to be added in ascending order.
+//
+// In a trie, the nodes of the same depth appear in the lexicographical order
+// of their prefixes, which is also the level order of LOUDS.  So the builder
+// appends the LOUDS bits, the terminal bits and the edge characters of each
+// depth to a separate stream while the words are added, and concatenates the
+// streams on Build().  The streams are spilled to a temporary file chunk by
+// chunk, so the memory usage is proportional to the depth of the trie rather
+// than to the number of words.
+//
+// Usage:
+//   StreamingLoudsTrieBuilder builder(temp_filename);
+//   for (...) {
+//     handles.push_back(builder.Add(word));
+//   }
+//   builder.Build(&output_stream);
+//   const int key_id = builder.GetId(handles[i]);
+class StreamingLoudsTrieBuilder {
+ public:
+  // The streams are spilled to |temp_filename|, which is removed on Build().
+  // If |temp_filename| is empty, everything is kept in memory.
+  explicit StreamingLoudsTrieBuilder(const string &temp_filename);
+  // |max_buffer_size| is the number of bytes each stream keeps in memory.
+  StreamingLoudsTrieBuilder(const string &temp_filename,
+                            size_t max_buffer_size);
+  ~StreamingLoudsTrieBuilder();
+
+  // Adds the word, which must not be smaller than the previously added word.
+  // Adding the same word again is ignored.  Returns the handle to get the
+  // key_id of the word after Build().
+  uint64 Add(StringPiece word);
+
+  // Writes the trie image to |os|.  Returns false if the temporary file or
+  // |os| fails.
+  bool Build(ostream *os);
+
+  // Returns the key_id for the handle returned by Add().
+  int GetId(uint64 handle) const;
+
+  size_t num_words() const { return num_words_; }
+
+ private:
+  class Spool;
+  struct Level;
+
+  Level *GetLevel(size_t depth);
+  void MaybeSpill(Level *level);
+
+  const string temp_filename_;
+  const size_t max_buffer_size_;
+  std::unique_ptr<OutputFileStream> temp_stream_;
+  uint64 temp_size_;
+
+  // The last added word, i.e., the path of the nodes which are not closed.
+  string last_word_;
+  uint64 last_handle_;
+  size_t num_words_;
+  bool built_;
+
+  // levels_[d] holds the nodes of depth d.
+  vector<std::unique_ptr<Level>> levels_;
+  // The key_id of the first terminal node of each depth.
+  vector<int> id_offsets_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingLoudsTrieBuilder);
+};
+
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_LOUDS_STREAMING_LOUDS_TRIE_BUILDER_H_
@@ -0,0 +1,145 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/louds/streaming_louds_trie_builder.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/port.h"
+#include "base/util.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+// Generates words over a small alphabet so that they share many prefixes.
+// Some characters have the MSB set to check the unsigned comparison.
+vector<string> GenerateWords(size_t num_words) {
+  const char kAlphabet[] = {'a', 'b', 'c', '\x80', '\xFF'};
+  vector<string> words;
+  for (size_t i = 0; i < num_words; ++i) {
+    string word;
+    const size_t length = Util::Random(12) + 1;
+    for (size_t j = 0; j < length; ++j) {
+      word.push_back(kAlphabet[Util::Random(arraysize(kAlphabet))]);
+    }
+    words.push_back(word);
+  }
+  return words;
+}
+
+string BuildStreaming(const vector<string> &sorted_words,
+                      StreamingLoudsTrieBuilder *builder,
+                      vector<uint64> *handles) {
+  for (size_t i = 0; i < sorted_words.size(); ++i) {
+    handles->push_back(builder->Add(sorted_words[i]));
+  }
+  std::ostringstream os;
+  EXPECT_TRUE(builder->Build(&os));
+  return os.str();
+}
+
+TEST(StreamingLoudsTrieBuilderTest, Empty) {
+  LoudsTrieBuilder expected;
+  expected.Build();
+
+  StreamingLoudsTrieBuilder builder("");
+  std::ostringstream os;
+  EXPECT_TRUE(builder.Build(&os));
+  EXPECT_EQ(expected.image(), os.str());
+}
+
+TEST(StreamingLoudsTrieBuilderTest, SameImageAsLoudsTrieBuilder) {
+  Util::SetRandomSeed(0);
+  const vector<string> words = GenerateWords(5000);
+
+  LoudsTrieBuilder expected;
+  for (size_t i = 0; i < words.size(); ++i) {
+    expected.Add(words[i]);
+  }
+  expected.Build();
+
+  // Duplicates are allowed in the sorted input.
+  vector<string> sorted_words(words);
+  std::sort(sorted_words.begin(), sorted_words.end());
+
+  const string temp_filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "streaming_louds_trie.tmp");
+  const size_t kMaxBufferSizes[] = {1, 7, 64, 1 << 16};
+  for (size_t i = 0; i < arraysize(kMaxBufferSizes); ++i) {
+    SCOPED_TRACE(kMaxBufferSizes[i]);
+    StreamingLoudsTrieBuilder builder(temp_filename, kMaxBufferSizes[i]);
+    vector<uint64> handles;
+    const string image = BuildStreaming(sorted_words, &builder, &handles);
+    EXPECT_FALSE(FileUtil::FileExists(temp_filename));
+    ASSERT_EQ(expected.image(), image);
+
+    LoudsTrie trie;
+    ASSERT_TRUE(trie.Open(reinterpret_cast<const uint8 *>(image.data())));
+    for (size_t j = 0; j < sorted_words.size(); ++j) {
+      const int id = builder.GetId(handles[j]);
+      EXPECT_EQ(expected.GetId(sorted_words[j]), id);
+      EXPECT_EQ(id, trie.ExactSearch(sorted_words[j]));
+    }
+  }
+}
+
+TEST(StreamingLoudsTrieBuilderTest, InMemory) {
+  const char *kWords[] = {"a", "aa", "ab", "bd"};
+  LoudsTrieBuilder expected;
+  StreamingLoudsTrieBuilder builder("");
+  vector<uint64> handles;
+  for (size_t i = 0; i < arraysize(kWords); ++i) {
+    expected.Add(kWords[i]);
+    handles.push_back(builder.Add(kWords[i]));
+  }
+  expected.Build();
+  std::ostringstream os;
+  EXPECT_TRUE(builder.Build(&os));
+  EXPECT_EQ(expected.image(), os.str());
+  EXPECT_EQ(arraysize(kWords), builder.num_words());
+  for (size_t i = 0; i < arraysize(kWords); ++i) {
+    EXPECT_EQ(expected.GetId(kWords[i]), builder.GetId(handles[i]));
+  }
+}
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
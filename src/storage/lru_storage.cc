@@ -55,6 +55,22 @@ namespace {
 const size_t kMaxLRUSize   = 1000000;  // 1M
 const size_t kMaxValueSize = 1024;     // 1024 byte
 
+// The file starts with the header of the following uint32 fields:
+//   value size, size, seed, fingerprint version, migration time and
+//   legacy fingerprint version,
+// followed by |size| entries of 64-bit fingerprint, 32-bit last access time
+// and the value.  The legacy files don't have the last three fields, and
+// their fingerprints are FINGERPRINT_LOOKUP2.
+const size_t kLegacyHeaderSize = 12;
+const size_t kHeaderSize = 24;
+const Hash::FingerprintVersion kDefaultFingerprintVersion =
+    Hash::FINGERPRINT_FAST;
+
+bool IsValidFingerprintVersion(uint32 version) {
+  return version == Hash::FINGERPRINT_LOOKUP2 ||
+         version == Hash::FINGERPRINT_FAST;
+}
+
 template <class T>
 inline void ReadValue(char **ptr, T *value) {
   memcpy(value, *ptr, sizeof(*value));
@@ -73,16 +89,27 @@ const char* GetValue(const char *ptr) {
   return ptr + 12;
 }
 
-void Update(char *ptr) {
+// Returns true if the last access time is changed.
+bool Update(char *ptr) {
   const uint32 last_access_time = static_cast<uint32>(Clock::GetTime());
+  const bool changed = GetTimeStamp(ptr) != last_access_time;
   memcpy(ptr + 8, reinterpret_cast<const char *>(&last_access_time), 4);
+  return changed;
 }
 
-void Update(char *ptr, uint64 fp, const char *value, size_t value_size) {
+void SetFP(char *ptr, uint64 fp) {
+  memcpy(ptr, reinterpret_cast<const char *>(&fp), 8);
+}
+
+// Returns true if the last access time or the value is changed.
+bool Update(char *ptr, uint64 fp, const char *value, size_t value_size) {
   const uint32 last_access_time = static_cast<uint32>(Clock::GetTime());
+  const bool changed = GetTimeStamp(ptr) != last_access_time ||
+                       memcmp(GetValue(ptr), value, value_size) != 0;
   memcpy(ptr,     reinterpret_cast<const char *>(&fp), 8);
   memcpy(ptr + 8, reinterpret_cast<const char *>(&last_access_time), 4);
   memcpy(ptr + 12, value, value_size);
+  return changed;
 }
 
 class CompareByTimeStamp {
@@ -210,6 +237,13 @@ bool LRUStorage::CreateStorageFile(const char *filename,
                                    size_t value_size,
                                    size_t size,
                                    uint32 seed) {
+  return CreateStorageFile(filename, value_size, size, seed,
+                           kDefaultFingerprintVersion);
+}
+
+bool LRUStorage::CreateStorageFile(
+    const char *filename, size_t value_size, size_t size, uint32 seed,
+    Hash::FingerprintVersion fingerprint_version) {
   if (value_size == 0 || value_size > kMaxValueSize) {
     LOG(ERROR) << "value_size is out of range";
     return false;
@@ -240,6 +274,8 @@ bool LRUStorage::CreateStorageFile(const char *filename,
             sizeof(size_uint32));
   ofs.write(reinterpret_cast<const char *>(&seed),
             sizeof(seed));
+  const uint32 header[3] = {static_cast<uint32>(fingerprint_version), 0, 0};
+  ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
   vector<char> ary(value_size, '\0');
   const uint32 last_access_time = 0;
   const uint64 fp = 0;
@@ -262,12 +298,14 @@ bool LRUStorage::Clear() {
       lru_list_->size() == 0) {
     return true;
   }
-  const size_t offset =
-      sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
+  const size_t offset = kHeaderSize;
   if (offset >= mmap_->size()) {   // should not happen
     return false;
   }
   memset(mmap_->begin() + offset, '\0', mmap_->size() - offset);
+  // No entries to migrate.
+  migration_time_ = 0;
+  WriteHeader();
   lru_list_.reset();
   map_.clear();
   Open(mmap_->begin(), mmap_->size());
@@ -291,6 +329,21 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
     return false;
   }
 
+  if (fingerprint_version_ != storage.fingerprint_version_) {
+    return false;
+  }
+
+  // The migration states are merged by the latest migration time, before
+  // which the entries may have the fingerprints of the legacy version.
+  if (storage.migration_time_ != 0) {
+    if (migration_time_ != 0 &&
+        legacy_fingerprint_version_ != storage.legacy_fingerprint_version_) {
+      return false;
+    }
+    migration_time_ = max(migration_time_, storage.migration_time_);
+    legacy_fingerprint_version_ = storage.legacy_fingerprint_version_;
+  }
+
   vector<const char *> ary;
 
   // this file
@@ -334,6 +387,7 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
   if (new_size < old_size) {
     memset(begin_ + new_size, '\0', old_size - new_size);
   }
+  WriteHeader();
 
   return Open(mmap_->begin(), mmap_->size());
 }
@@ -342,8 +396,12 @@ LRUStorage::LRUStorage()
     : value_size_(0),
       size_(0),
       seed_(0),
+      fingerprint_version_(kDefaultFingerprintVersion),
+      migration_time_(0),
+      legacy_fingerprint_version_(kDefaultFingerprintVersion),
       last_item_(NULL),
-      begin_(NULL), end_(NULL) {}
+      begin_(NULL), end_(NULL),
+      generation_(0) {}
 
 LRUStorage::~LRUStorage() {
   Close();
@@ -353,12 +411,22 @@ bool LRUStorage::OpenOrCreate(const char *filename,
                               size_t new_value_size,
                               size_t new_size,
                               uint32 new_seed) {
+  return OpenOrCreate(filename, new_value_size, new_size, new_seed,
+                      kDefaultFingerprintVersion);
+}
+
+bool LRUStorage::OpenOrCreate(const char *filename,
+                              size_t new_value_size,
+                              size_t new_size,
+                              uint32 new_seed,
+                              Hash::FingerprintVersion fingerprint_version) {
   if (!FileUtil::FileExists(filename)) {
     // This is also an expected scenario. Let's create a new data file.
     VLOG(1) << filename << " does not exist. Creating a new one.";
     if (!LRUStorage::CreateStorageFile(filename,
                                        new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed against " << filename;
       return false;
     }
@@ -376,7 +444,8 @@ bool LRUStorage::OpenOrCreate(const char *filename,
     //     data file and the content is actually valid.
     if (!LRUStorage::CreateStorageFile(filename,
                                        new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed";
       return false;
     }
@@ -391,7 +460,8 @@ bool LRUStorage::OpenOrCreate(const char *filename,
   if (new_value_size != value_size() || new_size != size()) {
     Close();
     if (!LRUStorage::CreateStorageFile(filename, new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed";
       return false;
     }
@@ -408,9 +478,74 @@ bool LRUStorage::OpenOrCreate(const char *filename,
     return false;
   }
 
+  if (fingerprint_version_ != fingerprint_version) {
+    StartMigration(fingerprint_version);
+  }
+
   return true;
 }
 
+void LRUStorage::StartMigration(Hash::FingerprintVersion fingerprint_version) {
+  VLOG(1) << "Migrating the fingerprints of " << filename_ << " from "
+          << fingerprint_version_ << " to " << fingerprint_version;
+  if (migration_time_ != 0) {
+    // The entries of the older version become unreachable, and are evicted
+    // eventually.
+    LOG(WARNING) << "The previous migration is not finished";
+  }
+  if (used_size() == 0) {
+    migration_time_ = 0;
+  } else {
+    legacy_fingerprint_version_ = fingerprint_version_;
+    // The entries updated in this second are looked up with the new version
+    // first, so they can be regarded as the legacy ones.
+    migration_time_ = static_cast<uint32>(Clock::GetTime()) + 1;
+  }
+  fingerprint_version_ = fingerprint_version;
+  WriteHeader();
+}
+
+void LRUStorage::WriteHeader() {
+  if (mmap_.get() == NULL || mmap_->size() < kHeaderSize) {
+    return;
+  }
+  const uint32 header[3] = {
+    static_cast<uint32>(fingerprint_version_),
+    migration_time_,
+    migration_time_ == 0 ? 0 : static_cast<uint32>(legacy_fingerprint_version_),
+  };
+  memcpy(mmap_->begin() + kLegacyHeaderSize, header, sizeof(header));
+}
+
+bool LRUStorage::ConvertLegacyFile(const char *filename) {
+  LOG(INFO) << "Converting the legacy LRU file: " << filename;
+  const string temp_filename = string(filename) + ".tmp";
+  {
+    OutputFileStream ofs(temp_filename.c_str(), ios::binary|ios::out);
+    if (!ofs) {
+      LOG(ERROR) << "cannot open " << temp_filename;
+      return false;
+    }
+    // The legacy entries have the fingerprints of FINGERPRINT_LOOKUP2.
+    const uint32 header[3] = {Hash::FINGERPRINT_LOOKUP2, 0, 0};
+    ofs.write(mmap_->begin(), kLegacyHeaderSize);
+    ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+    ofs.write(mmap_->begin() + kLegacyHeaderSize,
+              mmap_->size() - kLegacyHeaderSize);
+    if (!ofs) {
+      LOG(ERROR) << "cannot write " << temp_filename;
+      return false;
+    }
+  }
+  mmap_.reset(new Mmap);
+  if (!FileUtil::AtomicRename(temp_filename, filename)) {
+    LOG(ERROR) << "cannot rename " << temp_filename << " to " << filename;
+    FileUtil::Unlink(temp_filename);
+    return false;
+  }
+  return mmap_->Open(filename, "r+");
+}
+
 bool LRUStorage::Open(const char *filename) {
   mmap_.reset(new Mmap);
 
@@ -430,20 +565,57 @@ bool LRUStorage::Open(const char *filename) {
     return false;
   }
 
+  // The legacy file has the smaller header.  Such sizes are never valid in
+  // the current format since value_size + 12 > 12.
+  uint32 value_size = 0;
+  uint32 size = 0;
+  memcpy(&value_size, mmap_->begin(), sizeof(value_size));
+  memcpy(&size, mmap_->begin() + sizeof(value_size), sizeof(size));
+  if (mmap_->size() >= kLegacyHeaderSize &&
+      (static_cast<uint64>(value_size) + 12) * size ==
+          mmap_->size() - kLegacyHeaderSize &&
+      !ConvertLegacyFile(filename)) {
+    LOG(ERROR) << "cannot convert the legacy file";
+    return false;
+  }
+
   filename_ = filename;
   return Open(mmap_->begin(), mmap_->size());
 }
 
 bool LRUStorage::Open(char *ptr, size_t ptr_size) {
+  ++generation_;
   begin_ = ptr;
   end_ = ptr + ptr_size;
 
   uint32 value_size_uint32 = 0;
   uint32 size_uint32 = 0;
 
+  if (ptr_size < kHeaderSize) {
+    LOG(ERROR) << "file size is too small";
+    return false;
+  }
+
+  uint32 fingerprint_version = 0;
+  uint32 legacy_fingerprint_version = 0;
   ReadValue<uint32>(&begin_, &value_size_uint32);
   ReadValue<uint32>(&begin_, &size_uint32);
   ReadValue<uint32>(&begin_, &seed_);
+  ReadValue<uint32>(&begin_, &fingerprint_version);
+  ReadValue<uint32>(&begin_, &migration_time_);
+  ReadValue<uint32>(&begin_, &legacy_fingerprint_version);
+
+  if (!IsValidFingerprintVersion(fingerprint_version) ||
+      (migration_time_ != 0 &&
+       !IsValidFingerprintVersion(legacy_fingerprint_version))) {
+    LOG(ERROR) << "Unknown fingerprint version: " << fingerprint_version;
+    return false;
+  }
+  fingerprint_version_ =
+      static_cast<Hash::FingerprintVersion>(fingerprint_version);
+  legacy_fingerprint_version_ = migration_time_ == 0 ?
+      fingerprint_version_ :
+      static_cast<Hash::FingerprintVersion>(legacy_fingerprint_version);
 
   value_size_ = static_cast<size_t>(value_size_uint32);
   size_ = static_cast<size_t>(size_uint32);
@@ -463,7 +635,7 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  const size_t file_size = mmap_->size() - 12;
+  const size_t file_size = ptr_size - kHeaderSize;
   if ((value_size_ + 12) * size_ != file_size) {
     LOG(ERROR) << "LRU file is broken";
     return false;
@@ -481,19 +653,30 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
   lru_list_.reset(new LRUList(size_));
   map_.clear();
   last_item_ = NULL;
+  size_t num_legacy_entries = 0;
   for (size_t i = 0; i < ary.size(); ++i) {
     if (GetTimeStamp(ary[i]) != 0) {
       Node *node = lru_list_->Add(ary[i]);
       map_.insert(std::make_pair(GetFP(ary[i]), node));
+      if (GetTimeStamp(ary[i]) < migration_time_) {
+        ++num_legacy_entries;
+      }
     } else if (last_item_ == NULL) {
       last_item_ = ary[i];
     }
   }
 
+  if (migration_time_ != 0 && num_legacy_entries == 0) {
+    VLOG(1) << "The migration of the fingerprints is finished";
+    migration_time_ = 0;
+    WriteHeader();
+  }
+
   return true;
 }
 
 void LRUStorage::Close() {
+  ++generation_;
   filename_.clear();
   mmap_.reset();
   lru_list_.reset();
@@ -505,15 +688,43 @@ const char* LRUStorage::Lookup(const string &key) const {
   return Lookup(key, &last_access_time);
 }
 
+LRUStorage::Node *LRUStorage::FindNode(const string &key, uint64 *fp) const {
+  *fp = Hash::FingerprintWithVersion(key, seed_, fingerprint_version_);
+  map<uint64, Node *>::const_iterator it = map_.find(*fp);
+  if (it != map_.end()) {
+    return it->second;
+  }
+  if (migration_time_ == 0) {
+    return NULL;
+  }
+  // The entry may be stored before the migration.
+  it = map_.find(Hash::FingerprintWithVersion(key, seed_,
+                                              legacy_fingerprint_version_));
+  if (it == map_.end() || GetTimeStamp(it->second->value) >= migration_time_) {
+    return NULL;
+  }
+  return it->second;
+}
+
+void LRUStorage::MaybeMigrateNode(uint64 fp, Node *node) {
+  const uint64 old_fp = GetFP(node->value);
+  if (old_fp == fp) {
+    return;
+  }
+  map_.erase(old_fp);
+  map_.insert(std::make_pair(fp, node));
+  SetFP(node->value, fp);
+}
+
 const char* LRUStorage::Lookup(const string &key,
                                uint32 *last_access_time) const {
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  map<uint64, Node *>::const_iterator it = map_.find(fp);
-  if (it == map_.end()) {
+  uint64 fp = 0;
+  const Node *node = FindNode(key, &fp);
+  if (node == NULL) {
     return NULL;
   }
-  *last_access_time = GetTimeStamp(it->second->value);
-  return GetValue(it->second->value);
+  *last_access_time = GetTimeStamp(node->value);
+  return GetValue(node->value);
 }
 
 bool LRUStorage::GetAllValues(vector<string> *values) const {
@@ -539,11 +750,14 @@ bool LRUStorage::Touch(const string &key) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value);
-    lru_list_->MoveToTop(it->second);
+  uint64 fp = 0;
+  Node *node = FindNode(key, &fp);
+  if (node != NULL) {     // find in the cache
+    MaybeMigrateNode(fp, node);
+    if (Update(node->value)) {
+      ++generation_;
+    }
+    lru_list_->MoveToTop(node);
     return true;
   }
   return false;
@@ -554,11 +768,14 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  uint64 fp = 0;
+  Node *found = FindNode(key, &fp);
+  if (found != NULL) {     // find in the cache
+    MaybeMigrateNode(fp, found);
+    if (Update(found->value, fp, value, value_size_)) {
+      ++generation_;
+    }
+    lru_list_->MoveToTop(found);
   } else if (lru_list_->size() >= size_ ||
              last_item_ == NULL) {  // not found, but cache is FULL
     Node *node = lru_list_->GetLastNode();
@@ -570,6 +787,7 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
     map_.insert(std::make_pair(fp, node));
+    ++generation_;
   } else if (last_item_ < mmap_->end()) {  // not found, cahce is not FULL
     Node *node = lru_list_->Add(last_item_);
     lru_list_->MoveToTop(node);
@@ -579,6 +797,7 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     if (last_item_ >= mmap_->end()) {
       last_item_ = NULL;
     }
+    ++generation_;
   } else {
     LOG(ERROR) << "insertion failed";
     return false;
@@ -592,11 +811,14 @@ bool LRUStorage::TryInsert(const string &key, const char *value) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  uint64 fp = 0;
+  Node *node = FindNode(key, &fp);
+  if (node != NULL) {     // find in the cache
+    MaybeMigrateNode(fp, node);
+    if (Update(node->value, fp, value, value_size_)) {
+      ++generation_;
+    }
+    lru_list_->MoveToTop(node);
   }
 
   return true;
@@ -622,11 +844,24 @@ const string &LRUStorage::filename() const {
   return filename_;
 }
 
+Hash::FingerprintVersion LRUStorage::fingerprint_version() const {
+  return fingerprint_version_;
+}
+
+bool LRUStorage::is_migrating() const {
+  return migration_time_ != 0;
+}
+
+uint64 LRUStorage::generation() const {
+  return generation_;
+}
+
 void LRUStorage::Write(size_t i,
                        uint64 fp,
                        const string &value,
                        uint32 last_access_time) {
   DCHECK_LT(i, size_);
+  ++generation_;
   char *ptr = begin_ + (i * (value_size_ + 12));
   memcpy(ptr,     reinterpret_cast<const char *>(&fp), 8);
   memcpy(ptr + 8, reinterpret_cast<const char *>(&last_access_time), 4);
@@ -35,6 +35,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/port.h"
 
 namespace mozc {
@@ -59,6 +60,16 @@ class LRUStorage {
                     size_t new_size,
                     uint32 new_seed);
 
+  // Same as above, but the keys are hashed with the fingerprint of
+  // |fingerprint_version|.  The existing entries hashed with another version
+  // are migrated lazily: they are looked up with their version until they
+  // are updated or evicted.
+  bool OpenOrCreate(const char *filename,
+                    size_t new_value_size,
+                    size_t new_size,
+                    uint32 new_seed,
+                    Hash::FingerprintVersion fingerprint_version);
+
   // Lookup key
   const char *Lookup(const string &key,
                      uint32 *last_access_time) const;
@@ -94,6 +105,14 @@ class LRUStorage {
   size_t used_size() const;
   uint32 seed() const;
   const string &filename() const;
+  Hash::FingerprintVersion fingerprint_version() const;
+  // Returns true if some entries may still have the fingerprints of the
+  // previous version.
+  bool is_migrating() const;
+  // Returns a number incremented whenever the entries are changed, including
+  // their last access times.  Inserting the same value in the same second as
+  // the last access doesn't change it.
+  uint64 generation() const;
 
   // Write one entry at |i| th index.
   // i must be 0 <= i < size.
@@ -124,6 +143,12 @@ class LRUStorage {
                                 size_t value_size,
                                 size_t size,
                                 uint32 seed);
+  static bool CreateStorageFile(const char *filename,
+                                size_t value_size,
+                                size_t size,
+                                uint32 seed,
+                                Hash::FingerprintVersion fingerprint_version);
+
  private:
   class LRUList;
   class Node;
@@ -131,9 +156,32 @@ class LRUStorage {
   // load from memory buffer
   bool Open(char *ptr, size_t ptr_size);
 
+  // Rewrites the file of the format without the fingerprint version, which
+  // is opened by |mmap_|, and reopens it.
+  bool ConvertLegacyFile(const char *filename);
+
+  // Writes the fingerprint version and the migration state to the header.
+  void WriteHeader();
+
+  // Starts migrating the entries to |fingerprint_version|.
+  void StartMigration(Hash::FingerprintVersion fingerprint_version);
+
+  // Returns the node of |key|, or NULL if not found.  |fp| is set to the
+  // fingerprint of |key| in the current version.
+  Node *FindNode(const string &key, uint64 *fp) const;
+
+  // Rewrites the fingerprint of |node| found by FindNode() to |fp| if it has
+  // the fingerprint of the previous version.
+  void MaybeMigrateNode(uint64 fp, Node *node);
+
   size_t value_size_;
   size_t size_;
   uint32 seed_;
+  Hash::FingerprintVersion fingerprint_version_;
+  // The entries accessed before |migration_time_| may have the fingerprints
+  // of |legacy_fingerprint_version_|.  0 if no migration is in progress.
+  uint32 migration_time_;
+  Hash::FingerprintVersion legacy_fingerprint_version_;
   char *last_item_;
   char *begin_;
   char *end_;
@@ -141,6 +189,7 @@ class LRUStorage {
   map<uint64, Node *> map_;
   std::unique_ptr<LRUList> lru_list_;
   std::unique_ptr<Mmap> mmap_;
+  uint64 generation_;
 
   DISALLOW_COPY_AND_ASSIGN(LRUStorage);
 };
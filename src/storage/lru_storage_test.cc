@@ -35,8 +35,11 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -324,6 +327,152 @@ TEST_F(LRUStorageTest, InvalidFileOpenTest) {
   EXPECT_FALSE(storage.Insert("test", NULL));
 }
 
+TEST_F(LRUStorageTest, ConvertLegacyFile) {
+  const string filename = GetTemporaryFilePath();
+  const uint32 kSeed = 0x76fef;
+  {
+    // The legacy file has the 12-byte header and the lookup2 fingerprints.
+    OutputFileStream ofs(filename.c_str(), ios::binary|ios::out);
+    const uint32 header[3] = {4, 2, kSeed};
+    ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+    const uint64 fp = Hash::FingerprintWithSeed("test", kSeed);
+    const uint32 timestamp = 10;
+    const uint32 value = 823;
+    ofs.write(reinterpret_cast<const char *>(&fp), sizeof(fp));
+    ofs.write(reinterpret_cast<const char *>(&timestamp), sizeof(timestamp));
+    ofs.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    const char kEmpty[16] = {};
+    ofs.write(kEmpty, sizeof(kEmpty));
+  }
+
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(filename.c_str()));
+    EXPECT_EQ(Hash::FINGERPRINT_LOOKUP2, storage.fingerprint_version());
+    EXPECT_FALSE(storage.is_migrating());
+    EXPECT_EQ(4, storage.value_size());
+    EXPECT_EQ(2, storage.size());
+    EXPECT_EQ(1, storage.used_size());
+    const char *value = storage.Lookup("test");
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(823, *reinterpret_cast<const uint32 *>(value));
+  }
+
+  FileUtil::Unlink(filename);
+}
+
+TEST_F(LRUStorageTest, MigrateFingerprint) {
+  const string filename = GetTemporaryFilePath();
+  const uint32 kSeed = 0x76fef;
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  ASSERT_TRUE(LRUStorage::CreateStorageFile(filename.c_str(), 4, 10, kSeed,
+                                            Hash::FINGERPRINT_LOOKUP2));
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(filename.c_str()));
+    const uint32 v1 = 1, v2 = 2;
+    storage.Insert("key1", reinterpret_cast<const char *>(&v1));
+    storage.Insert("key2", reinterpret_cast<const char *>(&v2));
+  }
+
+  clock.PutClockForward(10, 0);
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.OpenOrCreate(filename.c_str(), 4, 10, kSeed));
+    EXPECT_EQ(Hash::FINGERPRINT_FAST, storage.fingerprint_version());
+    EXPECT_TRUE(storage.is_migrating());
+
+    // The legacy entries are still reachable, and are migrated on update.
+    ASSERT_NE(nullptr, storage.Lookup("key1"));
+    ASSERT_NE(nullptr, storage.Lookup("key2"));
+    EXPECT_TRUE(storage.Touch("key1"));
+    EXPECT_EQ(2, storage.used_size());
+    uint64 fp = 0;
+    string value;
+    uint32 last_access_time = 0;
+    storage.Read(0, &fp, &value, &last_access_time);
+    EXPECT_EQ(Hash::FastFingerprintWithSeed("key1", kSeed), fp);
+  }
+
+  clock.PutClockForward(10, 0);
+  {
+    // The entries updated in the second of the migration are regarded as
+    // the legacy ones.
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(filename.c_str()));
+    EXPECT_TRUE(storage.is_migrating());
+    EXPECT_TRUE(storage.Touch("key1"));
+    const uint32 v3 = 3;
+    storage.Insert("key2", reinterpret_cast<const char *>(&v3));
+    EXPECT_EQ(2, storage.used_size());
+    const char *value = storage.Lookup("key2");
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(3, *reinterpret_cast<const uint32 *>(value));
+  }
+
+  {
+    // All the entries are migrated.
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(filename.c_str()));
+    EXPECT_FALSE(storage.is_migrating());
+    EXPECT_NE(nullptr, storage.Lookup("key1"));
+    EXPECT_NE(nullptr, storage.Lookup("key2"));
+  }
+
+  Clock::SetClockForUnitTest(NULL);
+  FileUtil::Unlink(filename);
+}
+
+TEST_F(LRUStorageTest, Generation) {
+  const string filename = GetTemporaryFilePath();
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  ASSERT_TRUE(LRUStorage::CreateStorageFile(filename.c_str(), 4, 2, 0x76fef));
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(filename.c_str()));
+  const uint32 v1 = 1, v2 = 2, v3 = 3;
+
+  uint64 generation = storage.generation();
+  storage.Insert("key1", reinterpret_cast<const char *>(&v1));
+  EXPECT_LT(generation, storage.generation());
+
+  // Neither the value nor the last access time is changed.
+  generation = storage.generation();
+  storage.Insert("key1", reinterpret_cast<const char *>(&v1));
+  EXPECT_TRUE(storage.Touch("key1"));
+  storage.TryInsert("key2", reinterpret_cast<const char *>(&v2));
+  EXPECT_EQ(generation, storage.generation());
+
+  storage.Insert("key1", reinterpret_cast<const char *>(&v2));
+  EXPECT_LT(generation, storage.generation());
+
+  generation = storage.generation();
+  clock.PutClockForward(1, 0);
+  EXPECT_TRUE(storage.Touch("key1"));
+  EXPECT_LT(generation, storage.generation());
+
+  // Adding and evicting the entries.
+  generation = storage.generation();
+  storage.Insert("key2", reinterpret_cast<const char *>(&v2));
+  EXPECT_LT(generation, storage.generation());
+  generation = storage.generation();
+  storage.Insert("key3", reinterpret_cast<const char *>(&v3));
+  EXPECT_LT(generation, storage.generation());
+
+  generation = storage.generation();
+  EXPECT_TRUE(storage.Clear());
+  EXPECT_LT(generation, storage.generation());
+  generation = storage.generation();
+  EXPECT_TRUE(storage.Clear());
+  EXPECT_EQ(generation, storage.generation());
+
+  Clock::SetClockForUnitTest(NULL);
+  FileUtil::Unlink(filename);
+}
+
 class LRUStorageOpenOrCreateTest : public testing::Test {
  protected:
   LRUStorageOpenOrCreateTest() {}
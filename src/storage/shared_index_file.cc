@@ -0,0 +1,223 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/shared_index_file.h"
+
+#ifndef OS_WIN
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // OS_WIN
+
+#include <cstring>
+#include <string>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+// File format (all integers are in the native byte order, as the file is
+// shared only on the same host):
+//   [magic: 8 bytes]
+//   [format version: 4 bytes]
+//   [reserved: 4 bytes]
+//   [key: 8 bytes]
+//   [image size: 8 bytes]
+//   [fingerprint of image: 8 bytes]
+//   [image]
+const char kMagic[8] = {'M', 'O', 'Z', 'C', 'I', 'D', 'X', '\0'};
+const uint32 kFormatVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32 version;
+  uint32 reserved;
+  uint64 key;
+  uint64 image_size;
+  uint64 image_fingerprint;
+};
+
+// Returns true if the file can be used without rebuilding the image.
+bool IsTrustedFile(const string &filename) {
+#ifdef OS_WIN
+  return FileUtil::FileExists(filename);
+#else  // OS_WIN
+  struct stat st;
+  if (::stat(filename.c_str(), &st) != 0) {
+    return false;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    LOG(WARNING) << "Not a regular file: " << filename;
+    return false;
+  }
+  if (st.st_uid != 0 && st.st_uid != ::geteuid()) {
+    LOG(WARNING) << "Owned by another user: " << filename;
+    return false;
+  }
+  if ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LOG(WARNING) << "Writable by others: " << filename;
+    return false;
+  }
+  return true;
+#endif  // OS_WIN
+}
+
+}  // namespace
+
+SharedIndexFile::SharedIndexFile() {}
+
+SharedIndexFile::~SharedIndexFile() {}
+
+// static
+string SharedIndexFile::GetFileName(const string &directory, uint64 key) {
+  return FileUtil::JoinPath(
+      directory, Util::StringPrintf("%016llx.idx", key));
+}
+
+// static
+string SharedIndexFile::GetPrivateFileName(const string &directory,
+                                           uint64 key) {
+#ifdef OS_WIN
+  return GetFileName(directory, key);
+#else  // OS_WIN
+  const uid_t uid = ::geteuid();
+  if (uid == 0) {
+    return GetFileName(directory, key);
+  }
+  return FileUtil::JoinPath(
+      directory,
+      Util::StringPrintf("%016llx.%u.idx", key, static_cast<uint32>(uid)));
+#endif  // OS_WIN
+}
+
+bool SharedIndexFile::Open(const string &directory, uint64 key) {
+  Close();
+  const string filename = GetFileName(directory, key);
+  if (OpenFile(filename, key)) {
+    return true;
+  }
+  const string private_filename = GetPrivateFileName(directory, key);
+  return private_filename != filename && OpenFile(private_filename, key);
+}
+
+bool SharedIndexFile::OpenFile(const string &filename, uint64 key) {
+  if (!IsTrustedFile(filename)) {
+    return false;
+  }
+  if (!mmap_.Open(filename.c_str(), "r")) {
+    return false;
+  }
+
+  FileHeader header;
+  if (mmap_.size() < sizeof(header)) {
+    LOG(ERROR) << "Broken index file: " << filename;
+    Close();
+    return false;
+  }
+  memcpy(&header, mmap_.begin(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kFormatVersion || header.key != key ||
+      header.image_size != mmap_.size() - sizeof(header)) {
+    LOG(ERROR) << "Invalid index file: " << filename;
+    Close();
+    return false;
+  }
+  const StringPiece image(mmap_.begin() + sizeof(header), header.image_size);
+  if (Hash::Fingerprint(image) != header.image_fingerprint) {
+    LOG(ERROR) << "Fingerprint mismatch: " << filename;
+    Close();
+    return false;
+  }
+
+  image_ = image;
+  VLOG(1) << "Mapped shared index: " << filename << " (" << image_.size()
+          << " bytes)";
+  return true;
+}
+
+bool SharedIndexFile::Create(const string &directory, uint64 key,
+                             StringPiece image) {
+  Close();
+  // Never replaces the file of another user, which would make each user's
+  // process reject and recreate the other's in turn.
+  const string filename = GetPrivateFileName(directory, key);
+
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.reserved = 0;
+  header.key = key;
+  header.image_size = image.size();
+  header.image_fingerprint = Hash::Fingerprint(image);
+
+  // Other processes may create the same file concurrently. As each of them
+  // writes to its own temporary file and renames it, the file is always
+  // complete.
+  const string tmp_filename = Util::StringPrintf(
+      "%s.%d.tmp", filename.c_str(), Util::Random(kint32max));
+  {
+    OutputFileStream ofs(tmp_filename.c_str(), ios::out | ios::binary);
+    if (!ofs) {
+      LOG(WARNING) << "failed to write: " << tmp_filename;
+      return false;
+    }
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ofs.write(image.data(), image.size());
+    if (!ofs) {
+      LOG(WARNING) << "failed to write: " << tmp_filename;
+      ofs.close();
+      FileUtil::Unlink(tmp_filename);
+      return false;
+    }
+  }
+#ifndef OS_WIN
+  // Makes the file readable by the other users regardless of umask.
+  ::chmod(tmp_filename.c_str(), 0644);
+#endif  // OS_WIN
+  if (!FileUtil::AtomicRename(tmp_filename, filename)) {
+    LOG(WARNING) << "AtomicRename failed: " << filename;
+    FileUtil::Unlink(tmp_filename);
+    return false;
+  }
+
+  return OpenFile(filename, key);
+}
+
+void SharedIndexFile::Close() {
+  mmap_.Close();
+  image_.clear();
+}
+
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,111 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_SHARED_INDEX_FILE_H_
+#define MOZC_STORAGE_SHARED_INDEX_FILE_H_
+
+#include <string>
+
+#include "base/mmap.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+namespace storage {
+
+// Read-only index image shared among processes through a memory mapped file.
+//
+// Some data structures are derived from the data set when a process starts
+// and are kept on its heap, e.g., rank/select indexes of LOUDS tries. When
+// many server processes run on the same host, each of them has an identical
+// copy. This class writes such an image once to a file keyed by a
+// fingerprint of the data set, and every process maps the file read-only, so
+// that the physical pages are shared through the page cache.
+//
+// On POSIX, a file is trusted only when it's owned by root or the current
+// user, as the owner could rewrite the mapped image in place. So that the
+// processes of different users never replace each other's file, a process
+// running as a normal user creates a file private to the user. The file
+// shared among all the users is created by a process running as root, e.g.,
+// engine/gen_shared_dictionary_index_main at installation.
+//
+// Usage:
+//   SharedIndexFile file;
+//   if (!file.Open(directory, key)) {
+//     string image;
+//     BuildImage(&image);
+//     if (!file.Create(directory, key, image)) {
+//       // Use |image| on the heap instead.
+//     }
+//   }
+//   Use(file.image());
+class SharedIndexFile {
+ public:
+  SharedIndexFile();
+  ~SharedIndexFile();
+
+  // Maps the index file for |key| in |directory|, trying the shared file
+  // first and then the one private to the current user. Returns false if
+  // neither exists, is valid and is trusted. On POSIX, a file is trusted only
+  // when it's owned by root or the current user and is not writable by
+  // others, since the image is used without rebuilding.
+  bool Open(const string &directory, uint64 key);
+
+  // Writes |image| to the index file for |key| in |directory| atomically and
+  // maps it. The file is the shared one if the process runs as root, and the
+  // private one otherwise. Returns false if the file cannot be written.
+  bool Create(const string &directory, uint64 key, StringPiece image);
+
+  void Close();
+
+  // Returns the mapped image, which is aligned to 8 bytes.
+  StringPiece image() const { return image_; }
+
+  // Returns the path to the index file for |key| in |directory| shared among
+  // all the users.
+  static string GetFileName(const string &directory, uint64 key);
+
+  // Returns the path to the index file for |key| in |directory| which
+  // Create() writes in the current process. Same as GetFileName() for root
+  // and on Windows.
+  static string GetPrivateFileName(const string &directory, uint64 key);
+
+ private:
+  bool OpenFile(const string &filename, uint64 key);
+
+  Mmap mmap_;
+  StringPiece image_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedIndexFile);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_SHARED_INDEX_FILE_H_
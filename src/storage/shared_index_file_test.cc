@@ -0,0 +1,192 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/shared_index_file.h"
+
+#ifndef OS_WIN
+#include <sys/stat.h>
+#endif  // OS_WIN
+
+#include <iterator>
+#include <string>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+const uint64 kKey = GG_ULONGLONG(0x0123456789abcdef);
+
+string ReadFile(const string &filename) {
+  InputFileStream ifs(filename.c_str(), ios::in | ios::binary);
+  return string(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string &filename, const string &content) {
+  OutputFileStream ofs(filename.c_str(), ios::out | ios::binary);
+  ofs.write(content.data(), content.size());
+}
+
+class SharedIndexFileTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    RemoveFiles();
+  }
+
+  virtual void TearDown() {
+    RemoveFiles();
+  }
+
+  static void RemoveFiles() {
+    FileUtil::Unlink(SharedIndexFile::GetFileName(FLAGS_test_tmpdir, kKey));
+    FileUtil::Unlink(
+        SharedIndexFile::GetPrivateFileName(FLAGS_test_tmpdir, kKey));
+  }
+};
+
+TEST_F(SharedIndexFileTest, CreateAndOpen) {
+  const string image = "index image for test";
+  SharedIndexFile file;
+  EXPECT_FALSE(file.Open(FLAGS_test_tmpdir, kKey));
+  ASSERT_TRUE(file.Create(FLAGS_test_tmpdir, kKey, image));
+  EXPECT_EQ(image, file.image());
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(file.image().data()) % 8);
+
+  // Another instance maps the same file.
+  SharedIndexFile file2;
+  ASSERT_TRUE(file2.Open(FLAGS_test_tmpdir, kKey));
+  EXPECT_EQ(image, file2.image());
+
+  // The key is a part of the file name and is also checked in the header.
+  SharedIndexFile file3;
+  EXPECT_FALSE(file3.Open(FLAGS_test_tmpdir, kKey + 1));
+
+  file.Close();
+  EXPECT_TRUE(file.image().empty());
+}
+
+TEST_F(SharedIndexFileTest, RejectBrokenFile) {
+  const string filename =
+      SharedIndexFile::GetPrivateFileName(FLAGS_test_tmpdir, kKey);
+  {
+    SharedIndexFile file;
+    ASSERT_TRUE(file.Create(FLAGS_test_tmpdir, kKey, "index image"));
+  }
+
+  const string content = ReadFile(filename);
+  ASSERT_LT(10, content.size());
+
+  // Corrupt the image.
+  {
+    string broken = content;
+    broken[broken.size() - 1] ^= 1;
+    WriteFile(filename, broken);
+    SharedIndexFile file;
+    EXPECT_FALSE(file.Open(FLAGS_test_tmpdir, kKey));
+  }
+
+  // Truncate the image.
+  {
+    WriteFile(filename, content.substr(0, content.size() - 1));
+    SharedIndexFile file;
+    EXPECT_FALSE(file.Open(FLAGS_test_tmpdir, kKey));
+  }
+
+  // Truncate the header.
+  {
+    WriteFile(filename, content.substr(0, 10));
+    SharedIndexFile file;
+    EXPECT_FALSE(file.Open(FLAGS_test_tmpdir, kKey));
+  }
+}
+
+TEST_F(SharedIndexFileTest, OpenSharedFileFirst) {
+  const string filename =
+      SharedIndexFile::GetFileName(FLAGS_test_tmpdir, kKey);
+  const string private_filename =
+      SharedIndexFile::GetPrivateFileName(FLAGS_test_tmpdir, kKey);
+
+  // Makes the shared file as a process running as root does.
+  {
+    SharedIndexFile file;
+    ASSERT_TRUE(file.Create(FLAGS_test_tmpdir, kKey, "shared image"));
+  }
+  if (private_filename != filename) {
+    ASSERT_TRUE(FileUtil::AtomicRename(private_filename, filename));
+  }
+  SharedIndexFile file;
+  ASSERT_TRUE(file.Open(FLAGS_test_tmpdir, kKey));
+  EXPECT_EQ("shared image", file.image());
+  if (private_filename == filename) {
+    // Running as root.
+    return;
+  }
+
+  // A normal user doesn't replace the shared file, and the shared file is
+  // preferred to the private one.
+  {
+    SharedIndexFile private_file;
+    ASSERT_TRUE(
+        private_file.Create(FLAGS_test_tmpdir, kKey, "private image"));
+    EXPECT_EQ("private image", private_file.image());
+  }
+  ASSERT_TRUE(file.Open(FLAGS_test_tmpdir, kKey));
+  EXPECT_EQ("shared image", file.image());
+
+  // The private file is used without the shared one.
+  FileUtil::Unlink(filename);
+  ASSERT_TRUE(file.Open(FLAGS_test_tmpdir, kKey));
+  EXPECT_EQ("private image", file.image());
+}
+
+#ifndef OS_WIN
+TEST_F(SharedIndexFileTest, RejectWritableByOthers) {
+  const string filename =
+      SharedIndexFile::GetPrivateFileName(FLAGS_test_tmpdir, kKey);
+  {
+    SharedIndexFile file;
+    ASSERT_TRUE(file.Create(FLAGS_test_tmpdir, kKey, "index image"));
+  }
+  ASSERT_EQ(0, ::chmod(filename.c_str(), 0666));
+  SharedIndexFile file;
+  EXPECT_FALSE(file.Open(FLAGS_test_tmpdir, kKey));
+  ASSERT_EQ(0, ::chmod(filename.c_str(), 0644));
+  EXPECT_TRUE(file.Open(FLAGS_test_tmpdir, kKey));
+}
+#endif  // OS_WIN
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
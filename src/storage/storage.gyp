@@ -34,16 +34,20 @@
       'type': 'static_library',
       'toolsets': ['target', 'host'],
       'sources': [
+        'encrypted_journal.cc',
         'encrypted_string_storage.cc',
         'existence_filter.cc',
+        'journal.cc',
         'lru_storage.cc',
         'memory_storage.cc',
         'registry.cc',
+        'shared_index_file.cc',
         'tiny_storage.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
         '../base/base.gyp:encryptor',
+        '../base/base.gyp:obfuscator_support',
       ],
     },
   ],
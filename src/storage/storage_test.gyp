@@ -33,14 +33,18 @@
       'target_name': 'storage_test',
       'type': 'executable',
       'sources': [
+        'encrypted_journal_test.cc',
         'encrypted_string_storage_test.cc',
         'existence_filter_test.cc',
+        'journal_test.cc',
         'lru_storage_test.cc',
         'memory_storage_test.cc',
         'registry_test.cc',
+        'shared_index_file_test.cc',
         'tiny_storage_test.cc',
       ],
       'dependencies': [
+        '../base/base_test.gyp:clock_mock',
         '../testing/testing.gyp:gtest_main',
         'storage.gyp:storage',
       ],
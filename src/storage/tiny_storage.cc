@@ -33,22 +33,28 @@
 #include <Windows.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
+#include "storage/journal.h"
 
 namespace mozc {
 namespace storage {
 namespace {
 
-const uint32 kStorageVersion = 0;
+// Version 1 adds the generation of the snapshot, which the journal refers to.
+const uint32 kStorageVersion = 1;
+const uint32 kStorageVersionWithoutGeneration = 0;
 const uint32 kStorageMagicId = 0x431fe241;  // random seed
 const size_t kMaxElementSize = 1024;        // max map size
 const size_t kMaxKeySize     = 4096;        // 4k for key/value
@@ -57,6 +63,17 @@ const size_t kMaxValueSize   = 4096;        // 4k for key/value
 // so 10Mbyte data is reasonable upper bound for file size
 const size_t kMaxFileSize     = 1024 * 1024 * 10;  // 10Mbyte
 
+// The changes are appended to the journal until it grows larger than the
+// snapshot (or this size for small snapshots), then the snapshot is rewritten.
+const size_t kMinJournalSizeToCompact = 16 * 1024;
+
+const char kJournalSuffix[] = ".journal";
+
+// Journal records: |'I'|key_size(uint32)|key|value| for Insert and
+// |'E'|key| for Erase.
+const char kInsertRecord = 'I';
+const char kEraseRecord = 'E';
+
 template<typename T>
 bool ReadData(char **begin, const char *end, T *value) {
   if (*begin + sizeof(*value) > end) {
@@ -100,14 +117,36 @@ class TinyStorageImpl : public StorageInterface {
   }
 
  private:
+  // Applies a journal record to |dic_|.
+  bool Replay(const string &record);
+
+  // Appends the changes of |dirty_keys_| to the journal.
+  bool AppendToJournal();
+
+  // Rewrites the whole file as a new generation and resets the journal.
+  bool WriteSnapshot();
+
   string filename_;
   bool should_sync_;
   map<string, string> dic_;
 
+  // The keys changed since the last sync.
+  set<string> dirty_keys_;
+  // True if the changes can't be expressed by |dirty_keys_|, e.g. after
+  // Clear() or when there is no snapshot yet.
+  bool should_write_snapshot_;
+  uint64 generation_;
+  size_t snapshot_size_;
+  Journal journal_;
+
   DISALLOW_COPY_AND_ASSIGN(TinyStorageImpl);
 };
 
-TinyStorageImpl::TinyStorageImpl() : should_sync_(true) {
+TinyStorageImpl::TinyStorageImpl()
+    : should_sync_(true),
+      should_write_snapshot_(true),
+      generation_(0),
+      snapshot_size_(0) {
   // the each entry consumes at most
   // sizeof(uint32) * 2 (key/value length) +
   // kMaxKeySize + kMaxValueSize
@@ -125,7 +164,12 @@ TinyStorageImpl::~TinyStorageImpl() {
 bool TinyStorageImpl::Open(const string &filename) {
   Mmap mmap;
   dic_.clear();
+  dirty_keys_.clear();
   filename_ = filename;
+  should_sync_ = true;
+  should_write_snapshot_ = true;
+  generation_ = 0;
+  snapshot_size_ = 0;
   if (!mmap.Open(filename.c_str(), "r")) {
     LOG(WARNING) << "cannot open:" << filename;
     // here we return true if we cannot open the file.
@@ -162,7 +206,8 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
-  if (version != kStorageVersion) {
+  if (version != kStorageVersion &&
+      version != kStorageVersionWithoutGeneration) {
     LOG(ERROR) << "Incompatible version";
     return false;
   }
@@ -172,6 +217,13 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
+  uint64 generation = 0;
+  if (version == kStorageVersion &&
+      !ReadData<uint64>(&begin, end, &generation)) {
+    LOG(ERROR) << "cannot read generation";
+    return false;
+  }
+
   for (size_t i = 0; i < size; ++i) {
     uint32 key_size = 0;
     uint32 value_size = 0;
@@ -213,20 +265,110 @@ bool TinyStorageImpl::Open(const string &filename) {
     dic_.clear();
     return false;
   }
+  generation_ = generation;
+  snapshot_size_ = mmap.size();
+
+  vector<string> records;
+  if (!journal_.Open(filename_ + kJournalSuffix, generation_, &records)) {
+    // The snapshot alone is consistent.  The journal is recreated with the
+    // next snapshot.
+    LOG(ERROR) << "cannot open journal of " << filename_;
+    return true;
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (!Replay(records[i])) {
+      LOG(ERROR) << "broken journal record of " << filename_;
+      return true;
+    }
+  }
 
+  // The memory and the files have the same contents.
+  should_sync_ = false;
+  should_write_snapshot_ = false;
+  return true;
+}
+
+bool TinyStorageImpl::Replay(const string &record) {
+  if (record.empty()) {
+    return false;
+  }
+  if (record[0] == kEraseRecord) {
+    dic_.erase(record.substr(1));
+    return true;
+  }
+  if (record[0] != kInsertRecord) {
+    return false;
+  }
+  char *begin = const_cast<char *>(record.data()) + 1;
+  const char *end = record.data() + record.size();
+  uint32 key_size = 0;
+  if (!ReadData<uint32>(&begin, end, &key_size) || begin + key_size > end) {
+    return false;
+  }
+  const string key(begin, key_size);
+  const string value(begin + key_size, end - begin - key_size);
+  if (dic_.find(key) == dic_.end() && IsInvalid(key, value, dic_.size())) {
+    return false;
+  }
+  dic_[key] = value;
   return true;
 }
 
-// Format of storage:
-// |magic(uint32 file_size ^ kStorageVersion)|version(uint32)|size(uint32)|
-// |key_size(uint32)|key(variable length)|
-// |value_size(uint32)|value(variable length)| ...
 bool TinyStorageImpl::Sync() {
   if (!should_sync_) {
     VLOG(2) << "Already synced";
     return true;
   }
 
+  // Small changes are appended to the journal, which is merged into the
+  // snapshot once it grows as large as the snapshot.
+  if (!should_write_snapshot_ && journal_.size() > 0 &&
+      journal_.size() < max(kMinJournalSizeToCompact, snapshot_size_) &&
+      AppendToJournal()) {
+    dirty_keys_.clear();
+    should_sync_ = false;
+    return true;
+  }
+
+  if (!WriteSnapshot()) {
+    return false;
+  }
+  dirty_keys_.clear();
+  should_write_snapshot_ = false;
+  should_sync_ = false;
+  return true;
+}
+
+bool TinyStorageImpl::AppendToJournal() {
+  vector<string> records;
+  for (set<string>::const_iterator it = dirty_keys_.begin();
+       it != dirty_keys_.end(); ++it) {
+    const string &key = *it;
+    map<string, string>::const_iterator entry = dic_.find(key);
+    string record;
+    if (entry == dic_.end()) {
+      record.append(1, kEraseRecord);
+      record.append(key);
+    } else {
+      const uint32 key_size = static_cast<uint32>(key.size());
+      record.append(1, kInsertRecord);
+      record.append(reinterpret_cast<const char *>(&key_size),
+                    sizeof(key_size));
+      record.append(key);
+      record.append(entry->second);
+    }
+    records.push_back(record);
+  }
+  return journal_.Append(records);
+}
+
+// Format of storage:
+// |magic(uint32 file_size ^ kStorageVersion)|version(uint32)|size(uint32)|
+// |generation(uint64)|
+// |key_size(uint32)|key(variable length)|
+// |value_size(uint32)|value(variable length)| ...
+bool TinyStorageImpl::WriteSnapshot() {
+  const uint64 generation = generation_ + 1;
   const string output_filename = filename_ + ".tmp";
 
   OutputFileStream ofs(output_filename.c_str(),
@@ -244,6 +386,8 @@ bool TinyStorageImpl::Sync() {
             sizeof(kStorageVersion));
   ofs.write(reinterpret_cast<const char *>(&size),
             sizeof(size));
+  ofs.write(reinterpret_cast<const char *>(&generation),
+            sizeof(generation));
 
   for (map<string, string>::const_iterator it = dic_.begin();
        it != dic_.end(); ++it) {
@@ -263,7 +407,8 @@ bool TinyStorageImpl::Sync() {
     ++size;
   }
 
-  magic = static_cast<uint32>(ofs.tellp());
+  const size_t snapshot_size = static_cast<size_t>(ofs.tellp());
+  magic = static_cast<uint32>(snapshot_size);
   ofs.seekp(0);
   magic ^= kStorageMagicId;
 
@@ -289,7 +434,21 @@ bool TinyStorageImpl::Sync() {
   }
 #endif
 
-  should_sync_ = false;
+  generation_ = generation;
+  snapshot_size_ = snapshot_size;
+
+  // The journal of the previous generation is ignored from now on, so
+  // failing to reset it only costs a snapshot at the next sync.
+  if (journal_.filename().empty()) {
+    vector<string> unused_records;
+    journal_.Open(filename_ + kJournalSuffix, generation_, &unused_records);
+  }
+  if (!journal_.Reset(generation_)) {
+    LOG(ERROR) << "cannot reset journal of " << filename_;
+  }
+#ifdef OS_WIN
+  FileUtil::HideFile(journal_.filename());
+#endif
 
   return true;
 }
@@ -299,7 +458,13 @@ bool TinyStorageImpl::Insert(const string &key, const string &value) {
     LOG(WARNING) << "invalid key/value is passed";
     return false;
   }
+  map<string, string>::iterator it = dic_.find(key);
+  if (it != dic_.end() && it->second == value) {
+    // No need to write the same value again.
+    return true;
+  }
   dic_[key] = value;
+  dirty_keys_.insert(key);
   should_sync_ = true;
   return true;
 }
@@ -311,6 +476,7 @@ bool TinyStorageImpl::Erase(const string &key) {
     return false;
   }
   dic_.erase(it);
+  dirty_keys_.insert(key);
   should_sync_ = true;
   return true;
 }
@@ -327,7 +493,9 @@ bool TinyStorageImpl::Lookup(const string &key, string *value) const {
 
 bool TinyStorageImpl::Clear() {
   dic_.clear();
+  dirty_keys_.clear();
   should_sync_ = true;
+  should_write_snapshot_ = true;
   return Sync();
 }
 
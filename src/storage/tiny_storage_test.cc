@@ -29,6 +29,7 @@
 
 #include "storage/tiny_storage.h"
 
+#include <iterator>
 #include <map>
 #include <memory>
 #include <set>
@@ -36,6 +37,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/port.h"
 #include "storage/storage_interface.h"
@@ -76,6 +78,10 @@ class TinyStorageTest : public testing::Test {
     if (FileUtil::FileExists(path)) {
       FileUtil::Unlink(path);
     }
+    const string journal_path = GetJournalFilePath();
+    if (FileUtil::FileExists(journal_path)) {
+      FileUtil::Unlink(journal_path);
+    }
   }
 
   static StorageInterface *CreateStorage() {
@@ -87,6 +93,26 @@ class TinyStorageTest : public testing::Test {
     return FileUtil::JoinPath(FLAGS_test_tmpdir, "TinyStorageTest_test.db");
   }
 
+  static string GetJournalFilePath() {
+    return GetTemporaryFilePath() + ".journal";
+  }
+
+  static size_t GetFileSize(const string &filename) {
+    InputFileStream ifs(filename.c_str(), ios::in | ios::binary);
+    ifs.seekg(0, ios::end);
+    return static_cast<size_t>(ifs.tellg());
+  }
+
+  static bool ReadFile(const string &filename, string *contents) {
+    InputFileStream ifs(filename.c_str(), ios::in | ios::binary);
+    if (!ifs) {
+      return false;
+    }
+    contents->assign(std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>());
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(TinyStorageTest);
 };
@@ -172,5 +198,114 @@ TEST_F(TinyStorageTest, TinyStorageTest) {
   }
 }
 
+TEST_F(TinyStorageTest, SyncAppendsChangesToJournal) {
+  const string filename = GetTemporaryFilePath();
+  map<string, string> target;
+  CreateKeyValue(&target, 100);
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    for (map<string, string>::const_iterator it = target.begin();
+         it != target.end(); ++it) {
+      EXPECT_TRUE(storage->Insert(it->first, it->second));
+    }
+    EXPECT_TRUE(storage->Sync());
+  }
+  const size_t snapshot_size = GetFileSize(filename);
+  string snapshot;
+  ASSERT_TRUE(ReadFile(filename, &snapshot));
+
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_EQ(100, storage->Size());
+    const size_t journal_size = GetFileSize(GetJournalFilePath());
+
+    // Nothing is written when nothing has changed.
+    EXPECT_TRUE(storage->Insert("key1", "value1"));
+    EXPECT_TRUE(storage->Sync());
+    EXPECT_EQ(journal_size, GetFileSize(GetJournalFilePath()));
+
+    // Small changes only grow the journal.
+    EXPECT_TRUE(storage->Insert("key1", "new_value1"));
+    EXPECT_TRUE(storage->Erase("key2"));
+    EXPECT_TRUE(storage->Insert("new_key", "new_value"));
+    EXPECT_TRUE(storage->Sync());
+    EXPECT_LT(journal_size, GetFileSize(GetJournalFilePath()));
+    string contents;
+    ASSERT_TRUE(ReadFile(filename, &contents));
+    EXPECT_EQ(snapshot, contents);
+    EXPECT_EQ(snapshot_size, GetFileSize(filename));
+  }
+
+  // The journal is replayed on the snapshot.
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(100, storage->Size());
+  string value;
+  EXPECT_TRUE(storage->Lookup("key1", &value));
+  EXPECT_EQ("new_value1", value);
+  EXPECT_FALSE(storage->Lookup("key2", &value));
+  EXPECT_TRUE(storage->Lookup("new_key", &value));
+  EXPECT_EQ("new_value", value);
+  EXPECT_TRUE(storage->Lookup("key3", &value));
+  EXPECT_EQ("value3", value);
+}
+
+TEST_F(TinyStorageTest, JournalIsCompacted) {
+  const string filename = GetTemporaryFilePath();
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_TRUE(storage->Insert("key", "value"));
+  EXPECT_TRUE(storage->Sync());
+  const size_t empty_journal_size = GetFileSize(GetJournalFilePath());
+
+  // Rewriting the same key many times grows the journal until it is merged
+  // into the snapshot.
+  const string long_value(1000, 'a');
+  bool compacted = false;
+  for (int i = 0; i < 100 && !compacted; ++i) {
+    EXPECT_TRUE(storage->Insert("key", long_value + static_cast<char>(i)));
+    EXPECT_TRUE(storage->Sync());
+    compacted = GetFileSize(GetJournalFilePath()) == empty_journal_size;
+  }
+  EXPECT_TRUE(compacted);
+
+  std::unique_ptr<StorageInterface> storage2(CreateStorage());
+  EXPECT_TRUE(storage2->Open(filename));
+  string value;
+  EXPECT_TRUE(storage2->Lookup("key", &value));
+  string expected;
+  EXPECT_TRUE(storage->Lookup("key", &expected));
+  EXPECT_EQ(expected, value);
+}
+
+TEST_F(TinyStorageTest, StaleJournalIsIgnored) {
+  const string filename = GetTemporaryFilePath();
+  string old_journal;
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key", "value1"));
+    EXPECT_TRUE(storage->Sync());
+    EXPECT_TRUE(storage->Insert("key", "value2"));
+    EXPECT_TRUE(storage->Sync());
+    ASSERT_TRUE(ReadFile(GetJournalFilePath(), &old_journal));
+    // Clear() writes a new snapshot.
+    EXPECT_TRUE(storage->Clear());
+  }
+
+  // Emulates a crash after the new snapshot is written but before the
+  // journal is reset.
+  {
+    OutputFileStream ofs(GetJournalFilePath().c_str(),
+                         ios::out | ios::binary | ios::trunc);
+    ofs.write(old_journal.data(), old_journal.size());
+  }
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(0, storage->Size());
+}
+
 }  // namespace storage
 }  // namespace mozc
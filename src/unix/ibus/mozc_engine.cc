@@ -237,10 +237,23 @@ std::unique_ptr<client::ClientInterface> CreateAndConfigureClient() {
   // Currently client capability is fixed.
   commands::Capability capability;
   capability.set_text_deletion(commands::Capability::DELETE_PRECEDING_TEXT);
+  // Unchanged candidate windows are omitted from the outputs and restored by
+  // the client.
+  capability.set_delta_output(true);
   client->set_client_capability(capability);
   return client;
 }
 
+#ifdef ENABLE_GTK_RENDERER
+renderer::RendererClient *CreateRendererClient() {
+  renderer::RendererClient *renderer_client = new renderer::RendererClient();
+  // Candidate window updates are sent from a dedicated thread so that key
+  // handling doesn't wait for the renderer.
+  renderer_client->EnableAsyncMode();
+  return renderer_client;
+}
+#endif  // ENABLE_GTK_RENDERER
+
 }  // namespace
 
 MozcEngine::MozcEngine()
@@ -255,7 +268,7 @@ MozcEngine::MozcEngine()
       preedit_handler_(new PreeditHandler()),
 #ifdef ENABLE_GTK_RENDERER
       gtk_candidate_window_handler_(new GtkCandidateWindowHandler(
-          new renderer::RendererClient())),
+          CreateRendererClient())),
 #endif  // ENABLE_GTK_RENDERER
       ibus_candidate_window_handler_(new IBusCandidateWindowHandler()),
       preedit_method_(config::Config::ROMAN) {